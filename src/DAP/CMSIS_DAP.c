@@ -19,9 +19,12 @@
 #include <string.h>
 #include "DAP/CMSIS_DAP_config.h"
 #include "DAP/CMSIS_DAP.h"
+#include "DAP/stats.h"
+#include "tick.h"
 
 #include <libopencm3/cm3/systick.h>
 #include <libopencmsis/core_cm3.h>
+#include <libopencm3/cm3/cortex.h>
 #define DAP_FW_VER      "1.0"   // Firmware Version
 
 #ifndef __weak
@@ -43,14 +46,45 @@
 #endif
 
 
-// Clock Macros
+// Longest stretch a run of transfers in a command batch keeps interrupts
+// masked. Capabilities bit 4 (atomic commands) only holds within it: a
+// longer run, e.g. through WAIT retries, lets pending interrupts in
+// every DAP_ATOMIC_MAX_US and carries on.
+#define DAP_ATOMIC_MAX_US       500U
+
 
-#define MAX_SWJ_CLOCK(delay_cycles) \
-  (CPU_CLOCK/2 / (IO_PORT_WRITE_CYCLES + delay_cycles))
+// Clock Macros
 
 #define CLOCK_DELAY(swj_clock) \
  ((CPU_CLOCK/2 / swj_clock) - IO_PORT_WRITE_CYCLES)
 
+#if (DAP_SWD_TIMER != 0)
+#if (SWJ_CLOCK_CALIBRATE != 0)
+// Fastest clock the timer paces, measured by SWJ_CalibrateClock();
+// the timer is not used before
+static uint32_t swd_timer_max_clock = 0;
+#elif defined(SWD_TIMER_MIN_TICKS)
+static uint32_t swd_timer_max_clock = SWD_TIMER_CLOCK/2 / SWD_TIMER_MIN_TICKS;
+#else
+#error "DAP_SWD_TIMER needs SWJ_CLOCK_CALIBRATE or SWD_TIMER_MIN_TICKS"
+#endif
+#endif
+
+// SWCLK periods of the fast loop and of the delay loop, in
+// 1/SWJ_PERIOD_SCALE CPU cycles: nominal until SWJ_CalibrateClock()
+// has measured them.
+//   fast loop:  swj_fast_period
+//   delay loop: swj_slow_base + delay * swj_slow_step
+#define SWJ_PERIOD_CLOCK(period) \
+  ((CPU_CLOCK * SWJ_PERIOD_SCALE) / (period))
+
+static uint32_t swj_fast_period =
+  2U * (IO_PORT_WRITE_CYCLES + DELAY_FAST_CYCLES) * SWJ_PERIOD_SCALE;
+static uint32_t swj_slow_base =
+  2U * IO_PORT_WRITE_CYCLES * SWJ_PERIOD_SCALE;
+static uint32_t swj_slow_step =
+  2U * DELAY_SLOW_CYCLES * SWJ_PERIOD_SCALE;
+
 
          DAP_Data_t DAP_Data;           // DAP Data
 volatile uint8_t    DAP_TransferAbort;  // Trasfer Abort Flag
@@ -116,10 +150,32 @@ static uint8_t DAP_Info(uint8_t id, uint8_t *info) {
 #endif
       break;
     case DAP_ID_CAPABILITIES:
-      info[0] = ((DAP_SWD  != 0) ? (1 << 0) : 0) |
-                ((DAP_JTAG != 0) ? (1 << 1) : 0);
+      info[0] = ((DAP_SWD    != 0) ? (1 << 0) : 0) |
+                ((DAP_JTAG   != 0) ? (1 << 1) : 0) |
+                ((SWO_UART   != 0) ? (1 << 2) : 0) |
+                (1 << 4) |      // Atomic commands, DAP_ATOMIC_MAX_US at a time
+                ((TIMESTAMP_CLOCK != 0) ? (1 << 5) : 0) |
+                ((SWO_STREAM != 0) ? (1 << 6) : 0);
       length = 1;
       break;
+#if (TIMESTAMP_CLOCK != 0)
+    case DAP_ID_TIMESTAMP_CLOCK:
+      info[0] = (uint8_t)(TIMESTAMP_CLOCK >>  0);
+      info[1] = (uint8_t)(TIMESTAMP_CLOCK >>  8);
+      info[2] = (uint8_t)(TIMESTAMP_CLOCK >> 16);
+      info[3] = (uint8_t)(TIMESTAMP_CLOCK >> 24);
+      length = 4;
+      break;
+#endif
+#if (SWO_UART != 0)
+    case DAP_ID_SWO_BUFFER_SIZE:
+      info[0] = (uint8_t)(SWO_BUFFER_SIZE >>  0);
+      info[1] = (uint8_t)(SWO_BUFFER_SIZE >>  8);
+      info[2] = (uint8_t)(SWO_BUFFER_SIZE >> 16);
+      info[3] = (uint8_t)(SWO_BUFFER_SIZE >> 24);
+      length = 4;
+      break;
+#endif
     case DAP_ID_PACKET_SIZE:
       info[0] = (uint8_t)(DAP_PACKET_SIZE >> 0);
       info[1] = (uint8_t)(DAP_PACKET_SIZE >> 8);
@@ -170,7 +226,8 @@ void Delayms(uint32_t delay) {
 // Process Delay command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 static uint32_t DAP_Delay(uint8_t *request, uint8_t *response) {
   uint32_t delay;
 
@@ -180,14 +237,15 @@ static uint32_t DAP_Delay(uint8_t *request, uint8_t *response) {
   PIN_DELAY_SLOW(delay);
 
   *response = DAP_OK;
-  return (1);
+  return ((2 << 16) | 1);
 }
 
 
 // Process Host Status command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 static uint32_t DAP_HostStatus(uint8_t *request, uint8_t *response) {
 
   switch (*request) {
@@ -199,18 +257,19 @@ static uint32_t DAP_HostStatus(uint8_t *request, uint8_t *response) {
       break;
     default:
       *response = DAP_ERROR;
-      return (1);
+      return ((2 << 16) | 1);
   }
 
   *response = DAP_OK;
-  return (1);
+  return ((2 << 16) | 1);
 }
 
 
 // Process Connect command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 static uint32_t DAP_Connect(uint8_t *request, uint8_t *response) {
   uint32_t port;
 
@@ -225,6 +284,12 @@ static uint32_t DAP_Connect(uint8_t *request, uint8_t *response) {
     case DAP_PORT_SWD:
       DAP_Data.debug_port = DAP_PORT_SWD;
       PORT_SWD_SETUP();
+#if (DAP_SWD_CACHE != 0)
+      SWD_CacheForgetTarget();
+#endif
+      // The host's line reset follows; keep the probe's own accesses off
+      // the wire until it has read DPIDR
+      DAP_Data.swd_conf.dpidr_pending = 1;
       break;
 #endif
 #if (DAP_JTAG != 0)
@@ -235,18 +300,19 @@ static uint32_t DAP_Connect(uint8_t *request, uint8_t *response) {
 #endif
     default:
       *response = DAP_PORT_DISABLED;
-      return (1);
+      return ((1 << 16) | 1);
   }
 
   *response = port;
-  return (1);
+  return ((1 << 16) | 1);
 }
 
 
 // Process Disconnect command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 static uint32_t DAP_Disconnect(uint8_t *response) {
 
   DAP_Data.debug_port = DAP_PORT_DISABLED;
@@ -260,9 +326,14 @@ static uint32_t DAP_Disconnect(uint8_t *response) {
 // Process Reset Target command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 static uint32_t DAP_ResetTarget(uint8_t *response) {
 
+#if ((DAP_SWD != 0) && (DAP_SWD_CACHE != 0))
+  // The reset may reach the debug logic as well
+  SWD_CacheInvalidate();
+#endif
   *(response+1) = RESET_TARGET();
   *(response+0) = DAP_OK;
   return (2);
@@ -272,7 +343,8 @@ static uint32_t DAP_ResetTarget(uint8_t *response) {
 // Process SWJ Pins command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if ((DAP_SWD != 0) || (DAP_JTAG != 0))
 static uint32_t DAP_SWJ_Pins(uint8_t *request, uint8_t *response) {
   uint32_t value;
@@ -309,6 +381,10 @@ static uint32_t DAP_SWJ_Pins(uint8_t *request, uint8_t *response) {
   if (select & (1 << DAP_SWJ_nRESET)) {
     PIN_nRESET_OUT(value >> DAP_SWJ_nRESET);
   }
+#if ((DAP_SWD != 0) && (DAP_SWD_CACHE != 0))
+  // Bit-banged sequences and resets bypass the register cache
+  SWD_CacheInvalidate();
+#endif
 
   if (wait) {
     if (wait > 3000000) wait = 3000000;
@@ -342,7 +418,143 @@ static uint32_t DAP_SWJ_Pins(uint8_t *request, uint8_t *response) {
           (PIN_nRESET_IN()    << DAP_SWJ_nRESET);
 
   *response = (uint8_t)value;
-  return (1);
+  return ((6 << 16) | 1);
+}
+#endif
+
+
+// SWCLK period of a delay loop setting
+//   fast:   1 = fast loop, 0 = delay loop
+//   delay:  delay loop count
+//   return: period in 1/SWJ_PERIOD_SCALE CPU cycles
+uint32_t SWJ_ClockPeriod(uint32_t fast, uint32_t delay) {
+  if (fast) {
+    return (swj_fast_period);
+  }
+  return (swj_slow_base + delay * swj_slow_step);
+}
+
+
+#if (SWJ_CLOCK_CALIBRATE != 0)
+
+#define SWJ_CALIBRATE_BITS      256U    // Bits read per measurement
+#define SWJ_CALIBRATE_DELAY     16U     // Delay loop counts apart
+
+// CPU cycles taken by SWJ_CALIBRATE_BITS data phase bits
+static uint32_t SWJ_TimeBits(uint32_t delay) {
+  uint32_t primask;
+  uint32_t start;
+  uint32_t cycles;
+
+  primask = cm_mask_interrupts(1);
+  start   = get_cycles();
+  SWJ_ReadBits(SWJ_CALIBRATE_BITS, delay);
+  cycles  = get_cycles() - start;
+  cm_mask_interrupts(primask);
+
+  return (cycles);
+}
+
+
+#if (DAP_SWD_TIMER != 0)
+// CPU cycles taken by SWJ_CALIBRATE_BITS data phase bits paced by the
+// timer at its shortest period, i.e. by the loop overhead alone
+static uint32_t SWJ_TimeBitsTimer(void) {
+  uint32_t primask;
+  uint32_t start;
+  uint32_t cycles;
+
+  SWD_TIMER_SET_PERIOD(2);
+  primask = cm_mask_interrupts(1);
+  start   = get_cycles();
+  SWJ_ReadBitsTimer(SWJ_CALIBRATE_BITS);
+  cycles  = get_cycles() - start;
+  cm_mask_interrupts(primask);
+
+  return (cycles);
+}
+#endif
+
+
+// Measure the SWCLK period of the fast loop and of the delay loop
+// against SysTick, so that the clock reported for them includes the
+// loop overhead, and set the current clock up again with it. With
+// DAP_SWD_TIMER, the timer paces clocks whose half period covers half
+// a bit of the paced loop. SysTick must be running. SWCLK toggles, so
+// call it while the port is off.
+void SWJ_CalibrateClock(void) {
+  uint32_t near;
+  uint32_t far;
+#if (DAP_SWD_TIMER != 0)
+  uint32_t ticks;
+#endif
+
+  swj_fast_period = SWJ_TimeBits(0) * SWJ_PERIOD_SCALE / SWJ_CALIBRATE_BITS;
+  near = SWJ_TimeBits(1);
+  far  = SWJ_TimeBits(1 + SWJ_CALIBRATE_DELAY);
+
+  swj_slow_step = (far - near) * SWJ_PERIOD_SCALE /
+                  (SWJ_CALIBRATE_BITS * SWJ_CALIBRATE_DELAY);
+  swj_slow_base = near * SWJ_PERIOD_SCALE / SWJ_CALIBRATE_BITS - swj_slow_step;
+
+#if (DAP_SWD_TIMER != 0)
+  // In timer clocks, rounded up to whole half bits
+  ticks = SWJ_TimeBitsTimer() * (SWD_TIMER_CLOCK / 1000U) / (CPU_CLOCK / 1000U);
+  ticks = (ticks + (2 * SWJ_CALIBRATE_BITS - 1)) / (2 * SWJ_CALIBRATE_BITS);
+  swd_timer_max_clock = SWD_TIMER_CLOCK/2 / ticks;
+#endif
+
+  SWJ_SetClock(DAP_Data.clock_request);
+}
+
+#endif
+
+
+// Set up the clock generation for the requested SWJ clock
+//   clock:  requested clock in Hz (non-zero)
+//   return: none
+#if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+void SWJ_SetClock(uint32_t clock) {
+  uint32_t delay;
+  uint32_t period;
+
+  DAP_Data.clock_request = clock;
+
+  if (clock >= SWJ_PERIOD_CLOCK(swj_fast_period)) {
+    DAP_Data.fast_clock  = 1;
+    DAP_Data.clock_delay = 1;
+    DAP_Data.clock_actual = SWJ_PERIOD_CLOCK(swj_fast_period);
+  } else {
+    DAP_Data.fast_clock  = 0;
+
+    period = (CPU_CLOCK * SWJ_PERIOD_SCALE + (clock - 1)) / clock;
+    if (period > swj_slow_base + swj_slow_step) {
+      delay = (period - swj_slow_base + (swj_slow_step - 1)) / swj_slow_step;
+    } else {
+      delay = 1;
+    }
+
+    DAP_Data.clock_delay = delay;
+    DAP_Data.clock_actual = SWJ_PERIOD_CLOCK(SWJ_ClockPeriod(0, delay));
+  }
+
+#if (DAP_SWD_TIMER != 0)
+  // The timer paces SWD transfers exactly; sequences and JTAG still use
+  // the delay loop set up above
+  if (clock <= swd_timer_max_clock) {
+    delay = SWD_TIMER_SET_PERIOD((SWD_TIMER_CLOCK/2 + (clock - 1)) / clock);
+    DAP_Data.timer_clock  = 1;
+    DAP_Data.clock_actual = SWD_TIMER_CLOCK/2 / delay;
+  } else {
+    DAP_Data.timer_clock  = 0;
+  }
+#endif
+#if (DAP_SWD_SPI != 0)
+  DAP_Data.spi_clock = SWD_SPI_SET_CLOCK(clock);
+#endif
+#if (DAP_SWD != 0)
+  SWD_TransferSelect();
+#endif
 }
 #endif
 
@@ -350,11 +562,11 @@ static uint32_t DAP_SWJ_Pins(uint8_t *request, uint8_t *response) {
 // Process SWJ Clock command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if ((DAP_SWD != 0) || (DAP_JTAG != 0))
 static uint32_t DAP_SWJ_Clock(uint8_t *request, uint8_t *response) {
   uint32_t clock;
-  uint32_t delay;
 
   clock = (*(request+0) <<  0) |
           (*(request+1) <<  8) |
@@ -363,28 +575,101 @@ static uint32_t DAP_SWJ_Clock(uint8_t *request, uint8_t *response) {
 
   if (clock == 0) {
     *response = DAP_ERROR;
-    return (1);
+    return ((4 << 16) | 1);
   }
 
-  if (clock >= MAX_SWJ_CLOCK(DELAY_FAST_CYCLES)) {
-    DAP_Data.fast_clock  = 1;
-    DAP_Data.clock_delay = 1;
-  } else {
-    DAP_Data.fast_clock  = 0;
+  SWJ_SetClock(clock);
 
-    delay = (CPU_CLOCK/2 + (clock - 1)) / clock;
-    if (delay > IO_PORT_WRITE_CYCLES) {
-      delay -= IO_PORT_WRITE_CYCLES;
-      delay  = (delay + (DELAY_SLOW_CYCLES - 1)) / DELAY_SLOW_CYCLES;
-    } else {
-      delay  = 1;
-    }
+  *response = DAP_OK;
+  return ((4 << 16) | 1);
+}
+#endif
 
-    DAP_Data.clock_delay = delay;
+
+// Process vendor SWJ Clock Info command and prepare response
+//   request:  pointer to request data (command ID)
+//   response: pointer to response data
+//             ID, status, clock source, SPI flag, requested clock (4),
+//             generated clock (4), fastest timer paced clock (4)
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+// The generated clock is exact when the timer paces the transfers. For
+// the delay loops it is the rate measured at startup with
+// SWJ_CLOCK_CALIBRATE, and the nominal one (ignoring loop overhead)
+// without.
+uint32_t SWJ_ClockInfo(uint8_t *request, uint8_t *response) {
+  uint32_t source;
+  uint32_t max_timer;
+
+  source = DAP_Data.fast_clock ? DAP_CLOCK_SOURCE_FAST : DAP_CLOCK_SOURCE_DELAY;
+#if (DAP_SWD_TIMER != 0)
+  if (DAP_Data.timer_clock) {
+    source = DAP_CLOCK_SOURCE_TIMER;
+  }
+  max_timer = swd_timer_max_clock;
+#else
+  max_timer = 0;
+#endif
+
+  *(response+0) = *request;
+  *(response+1) = DAP_OK;
+  *(response+2) = (uint8_t)source;
+#if (DAP_SWD_SPI != 0)
+  *(response+3) = DAP_Data.spi_clock;
+#else
+  *(response+3) = 0;
+#endif
+  *(response+4)  = (uint8_t)(DAP_Data.clock_request >>  0);
+  *(response+5)  = (uint8_t)(DAP_Data.clock_request >>  8);
+  *(response+6)  = (uint8_t)(DAP_Data.clock_request >> 16);
+  *(response+7)  = (uint8_t)(DAP_Data.clock_request >> 24);
+  *(response+8)  = (uint8_t)(DAP_Data.clock_actual  >>  0);
+  *(response+9)  = (uint8_t)(DAP_Data.clock_actual  >>  8);
+  *(response+10) = (uint8_t)(DAP_Data.clock_actual  >> 16);
+  *(response+11) = (uint8_t)(DAP_Data.clock_actual  >> 24);
+  *(response+12) = (uint8_t)(max_timer >>  0);
+  *(response+13) = (uint8_t)(max_timer >>  8);
+  *(response+14) = (uint8_t)(max_timer >> 16);
+  *(response+15) = (uint8_t)(max_timer >> 24);
+
+  return ((1 << 16) | 16);
+}
+
+
+// Process vendor SWD Cache Control command and prepare response
+//   request:  pointer to request data (command ID, mode)
+//   response: pointer to response data
+//             ID, status, enable flag, number of skipped writes (4)
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+#if ((DAP_SWD != 0) && (DAP_SWD_CACHE != 0))
+uint32_t SWD_CacheControl(uint8_t *request, uint8_t *response) {
+  uint32_t skipped;
+
+  *(response+0) = *request;
+  *(response+1) = DAP_OK;
+  switch (*(request+1)) {
+    case DAP_CACHE_DISABLE:
+    case DAP_CACHE_ENABLE:
+      DAP_Data.swd_cache.enable = *(request+1);
+      // Start over from the writes that follow
+      SWD_CacheInvalidate();
+      break;
+    case DAP_CACHE_QUERY:
+      break;
+    default:
+      *(response+1) = DAP_ERROR;
+      break;
   }
 
-  *response = DAP_OK;
-  return (1);
+  skipped = DAP_Data.swd_cache.skipped;
+  *(response+2) = DAP_Data.swd_cache.enable;
+  *(response+3) = (uint8_t)(skipped >>  0);
+  *(response+4) = (uint8_t)(skipped >>  8);
+  *(response+5) = (uint8_t)(skipped >> 16);
+  *(response+6) = (uint8_t)(skipped >> 24);
+
+  return ((2 << 16) | 7);
 }
 #endif
 
@@ -392,7 +677,8 @@ static uint32_t DAP_SWJ_Clock(uint8_t *request, uint8_t *response) {
 // Process SWJ Sequence command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if ((DAP_SWD != 0) || (DAP_JTAG != 0))
 static uint32_t DAP_SWJ_Sequence(uint8_t *request, uint8_t *response) {
   uint32_t count;
@@ -401,9 +687,15 @@ static uint32_t DAP_SWJ_Sequence(uint8_t *request, uint8_t *response) {
   if (count == 0) count = 256;
 
   SWJ_Sequence(count, request);
+#if (DAP_SWD != 0)
+  // A line reset may have selected another multi-drop target, and the
+  // next transaction must be the host's DPIDR read
+  DAP_Data.swd_conf.target_known  = 0;
+  DAP_Data.swd_conf.dpidr_pending = 1;
+#endif
 
   *response = DAP_OK;
-  return (1);
+  return (((1 + (count + 7) / 8) << 16) | 1);
 }
 #endif
 
@@ -411,7 +703,8 @@ static uint32_t DAP_SWJ_Sequence(uint8_t *request, uint8_t *response) {
 // Process SWD Configure command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_SWD != 0)
 static uint32_t DAP_SWD_Configure(uint8_t *request, uint8_t *response) {
   uint8_t value;
@@ -419,25 +712,94 @@ static uint32_t DAP_SWD_Configure(uint8_t *request, uint8_t *response) {
   value = *request;
   DAP_Data.swd_conf.turnaround  = (value & 0x03) + 1;
   DAP_Data.swd_conf.data_phase  = (value & 0x04) ? 1 : 0;
+  SWD_TransferSelect();
 
   *response = DAP_OK;
 
-  return (1);
+  return ((1 << 16) | 1);
 }
 #endif
 
 
+// Process SWD Sequence command and prepare response
+//   request:  pointer to request data
+//   response: pointer to response data
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+static uint32_t DAP_SWD_Sequence(uint8_t *request, uint8_t *response) {
+  uint32_t sequence_info;
+  uint32_t sequence_count;
+  uint32_t request_count;
+  uint32_t response_count;
+  uint32_t count;
+
+#if (DAP_SWD != 0)
+  *response++ = DAP_OK;
+  // The host may have selected another multi-drop target, which has to
+  // see its DPIDR read first
+  DAP_Data.swd_conf.target_known  = 0;
+  DAP_Data.swd_conf.dpidr_pending = 1;
+#else
+  *response++ = DAP_ERROR;
+#endif
+  request_count  = 1;
+  response_count = 1;
+
+  sequence_count = *request++;
+  while (sequence_count--) {
+    sequence_info = *request++;
+    count = sequence_info & SWD_SEQUENCE_CLK;
+    if (count == 0) {
+      count = 64;
+    }
+    count = (count + 7) / 8;
+#if (DAP_SWD != 0)
+    if (sequence_info & SWD_SEQUENCE_DIN) {
+      // Captured data has to fit into the response, which also starts
+      // with the command ID
+      if ((1 + response_count + count) > DAP_PACKET_SIZE) {
+        *(response - response_count) = DAP_ERROR;
+        count = 0;
+      } else {
+        PIN_SWDIO_OUT_DISABLE();
+        SWD_Sequence(sequence_info, request, response);
+      }
+    } else {
+      PIN_SWDIO_OUT_ENABLE();
+      SWD_Sequence(sequence_info, request, response);
+    }
+    if (sequence_count == 0) {
+      PIN_SWDIO_OUT_ENABLE();
+    }
+#endif
+    if (sequence_info & SWD_SEQUENCE_DIN) {
+      request_count++;
+#if (DAP_SWD != 0)
+      response += count;
+      response_count += count;
+#endif
+    } else {
+      request += count;
+      request_count += count + 1;
+    }
+  }
+
+  return ((request_count << 16) | response_count);
+}
+
+
 // Process SWD Abort command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_SWD != 0)
 static uint32_t DAP_SWD_Abort(uint8_t *request, uint8_t *response) {
   uint32_t data;
 
   if (DAP_Data.debug_port != DAP_PORT_SWD) {
     *response = DAP_ERROR;
-    return (1);
+    return ((5 << 16) | 1);
   }
 
   // Load data (Ignore DAP index)
@@ -450,7 +812,7 @@ static uint32_t DAP_SWD_Abort(uint8_t *request, uint8_t *response) {
   SWD_Transfer(DP_ABORT, &data);
   *response = DAP_OK;
 
-  return (1);
+  return ((5 << 16) | 1);
 }
 #endif
 
@@ -458,13 +820,17 @@ static uint32_t DAP_SWD_Abort(uint8_t *request, uint8_t *response) {
 // Process JTAG Sequence command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_JTAG != 0)
 static uint32_t DAP_JTAG_Sequence(uint8_t *request, uint8_t *response) {
   uint32_t sequence_info;
   uint32_t sequence_count;
   uint32_t response_count;
   uint32_t count;
+  uint8_t  *request_head;
+
+  request_head = request;
 
   *response++ = DAP_OK;
   response_count = 1;
@@ -483,7 +849,7 @@ static uint32_t DAP_JTAG_Sequence(uint8_t *request, uint8_t *response) {
     }
   }
 
-  return (response_count);
+  return (((request - request_head) << 16) | response_count);
 }
 #endif
 
@@ -491,7 +857,8 @@ static uint32_t DAP_JTAG_Sequence(uint8_t *request, uint8_t *response) {
 // Process JTAG Configure command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_JTAG != 0)
 static uint32_t DAP_JTAG_Configure(uint8_t *request, uint8_t *response) {
   uint32_t count;
@@ -515,7 +882,7 @@ static uint32_t DAP_JTAG_Configure(uint8_t *request, uint8_t *response) {
   }
 
   *response = DAP_OK;
-  return (1);
+  return (((count + 1) << 16) | 1);
 }
 #endif
 
@@ -523,14 +890,15 @@ static uint32_t DAP_JTAG_Configure(uint8_t *request, uint8_t *response) {
 // Process JTAG IDCODE command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_JTAG != 0)
 static uint32_t DAP_JTAG_IDCode(uint8_t *request, uint8_t *response) {
   uint32_t data;
 
   if (DAP_Data.debug_port != DAP_PORT_JTAG) {
 err:*response = DAP_ERROR;
-    return (1);
+    return ((1 << 16) | 1);
   }
 
   // Device index (JTAP TAP)
@@ -550,7 +918,7 @@ err:*response = DAP_ERROR;
   *(response+3) = (uint8_t)(data >> 16);
   *(response+4) = (uint8_t)(data >> 24);
 
-  return (1+4);
+  return ((1 << 16) | (1+4));
 }
 #endif
 
@@ -558,14 +926,15 @@ err:*response = DAP_ERROR;
 // Process JTAG Abort command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_JTAG != 0)
 static uint32_t DAP_JTAG_Abort(uint8_t *request, uint8_t *response) {
   uint32_t data;
 
   if (DAP_Data.debug_port != DAP_PORT_JTAG) {
 err:*response = DAP_ERROR;
-    return (1);
+    return ((5 << 16) | 1);
   }
 
   // Device index (JTAP TAP)
@@ -585,7 +954,7 @@ err:*response = DAP_ERROR;
   JTAG_WriteAbort(data);
   *response = DAP_OK;
 
-  return (1);
+  return ((5 << 16) | 1);
 }
 #endif
 
@@ -593,29 +962,35 @@ err:*response = DAP_ERROR;
 // Process Transfer Configure command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 static uint32_t DAP_TransferConfigure(uint8_t *request, uint8_t *response) {
 
   DAP_Data.transfer.idle_cycles = *(request+0);
   DAP_Data.transfer.retry_count = *(request+1) | (*(request+2) << 8);
   DAP_Data.transfer.match_retry = *(request+3) | (*(request+4) << 8);
+#if (DAP_SWD != 0)
+  SWD_TransferSelect();
+#endif
 
   *response = DAP_OK;
 
-  return (1);
+  return ((5 << 16) | 1);
 }
 
 
 // Process SWD Transfer command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_SWD != 0)
 static uint32_t DAP_SWD_Transfer(uint8_t *request, uint8_t *response) {
   uint32_t  request_count;
   uint32_t  request_value;
   uint32_t  response_count;
   uint32_t  response_value;
+  uint8_t  *request_head;
   uint8_t  *response_head;
   uint32_t  post_read;
   uint32_t  check_write;
@@ -623,6 +998,11 @@ static uint32_t DAP_SWD_Transfer(uint8_t *request, uint8_t *response) {
   uint32_t  match_retry;
   uint32_t  retry;
   uint32_t  data;
+#if (TIMESTAMP_CLOCK != 0)
+  uint32_t  timestamp;
+#endif
+
+  request_head   = request;
 
   response_count = 0;
   response_value = 0;
@@ -637,7 +1017,8 @@ static uint32_t DAP_SWD_Transfer(uint8_t *request, uint8_t *response) {
   request++;            // Ignore DAP index
 
   request_count = *request++;
-  while (request_count--) {
+  while (request_count != 0) {
+    request_count--;
     request_value = *request++;
     if (request_value & DAP_TRANSFER_RnW) {
       // Read register
@@ -662,6 +1043,18 @@ static uint32_t DAP_SWD_Transfer(uint8_t *request, uint8_t *response) {
         *response++ = (uint8_t)(data >>  8);
         *response++ = (uint8_t)(data >> 16);
         *response++ = (uint8_t)(data >> 24);
+#if (TIMESTAMP_CLOCK != 0)
+        if (post_read) {
+          // Store Timestamp of next AP read
+          if (request_value & DAP_TRANSFER_TIMESTAMP) {
+            timestamp = DAP_Data.timestamp;
+            *response++ = (uint8_t) timestamp;
+            *response++ = (uint8_t)(timestamp >>  8);
+            *response++ = (uint8_t)(timestamp >> 16);
+            *response++ = (uint8_t)(timestamp >> 24);
+          }
+        }
+#endif
       }
       if (request_value & DAP_TRANSFER_MATCH_VALUE) {
         // Read with value match
@@ -702,6 +1095,16 @@ static uint32_t DAP_SWD_Transfer(uint8_t *request, uint8_t *response) {
               response_value = SWD_Transfer(request_value, NULL);
             } while ((response_value == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
             if (response_value != DAP_TRANSFER_OK) break;
+#if (TIMESTAMP_CLOCK != 0)
+            // Store Timestamp
+            if (request_value & DAP_TRANSFER_TIMESTAMP) {
+              timestamp = DAP_Data.timestamp;
+              *response++ = (uint8_t) timestamp;
+              *response++ = (uint8_t)(timestamp >>  8);
+              *response++ = (uint8_t)(timestamp >> 16);
+              *response++ = (uint8_t)(timestamp >> 24);
+            }
+#endif
             post_read = 1;
           }
         } else {
@@ -710,6 +1113,16 @@ static uint32_t DAP_SWD_Transfer(uint8_t *request, uint8_t *response) {
             response_value = SWD_Transfer(request_value, &data);
           } while ((response_value == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
           if (response_value != DAP_TRANSFER_OK) break;
+#if (TIMESTAMP_CLOCK != 0)
+          // Store Timestamp
+          if (request_value & DAP_TRANSFER_TIMESTAMP) {
+            timestamp = DAP_Data.timestamp;
+            *response++ = (uint8_t) timestamp;
+            *response++ = (uint8_t)(timestamp >>  8);
+            *response++ = (uint8_t)(timestamp >> 16);
+            *response++ = (uint8_t)(timestamp >> 24);
+          }
+#endif
           // Store data
           *response++ = (uint8_t) data;
           *response++ = (uint8_t)(data >>  8);
@@ -746,12 +1159,33 @@ static uint32_t DAP_SWD_Transfer(uint8_t *request, uint8_t *response) {
         response_value = DAP_TRANSFER_OK;
       } else {
         // Write DP/AP register
-        retry = DAP_Data.transfer.retry_count;
-        do {
-          response_value = SWD_Transfer(request_value, &data);
-        } while ((response_value == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
-        if (response_value != DAP_TRANSFER_OK) break;
-        check_write = 1;
+#if (DAP_SWD_CACHE != 0)
+        if (SWD_CacheHit(request_value, data)) {
+          // Register already holds the value: skip the write
+          response_value = DAP_TRANSFER_OK;
+#if (TIMESTAMP_CLOCK != 0)
+          DAP_Data.timestamp = TIMESTAMP_GET();
+#endif
+        } else
+#endif
+        {
+          retry = DAP_Data.transfer.retry_count;
+          do {
+            response_value = SWD_Transfer(request_value, &data);
+          } while ((response_value == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
+          if (response_value != DAP_TRANSFER_OK) break;
+          check_write = 1;
+        }
+#if (TIMESTAMP_CLOCK != 0)
+        // Store Timestamp
+        if (request_value & DAP_TRANSFER_TIMESTAMP) {
+          timestamp = DAP_Data.timestamp;
+          *response++ = (uint8_t) timestamp;
+          *response++ = (uint8_t)(timestamp >>  8);
+          *response++ = (uint8_t)(timestamp >> 16);
+          *response++ = (uint8_t)(timestamp >> 24);
+        }
+#endif
       }
     }
     response_count++;
@@ -781,10 +1215,25 @@ static uint32_t DAP_SWD_Transfer(uint8_t *request, uint8_t *response) {
   }
 
 end:
+  // Skip the requests that were not processed
+  while (request_count != 0) {
+    request_count--;
+    request_value = *request++;
+    if (request_value & DAP_TRANSFER_RnW) {
+      if (request_value & DAP_TRANSFER_MATCH_VALUE) {
+        // Read with value match
+        request += 4;
+      }
+    } else {
+      // Write register
+      request += 4;
+    }
+  }
+
   *(response_head+0) = (uint8_t)response_count;
   *(response_head+1) = (uint8_t)response_value;
 
-  return (response - response_head);
+  return (((request - request_head) << 16) | (response - response_head));
 }
 #endif
 
@@ -792,7 +1241,8 @@ end:
 // Process JTAG Transfer command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 #if (DAP_JTAG != 0)
 static uint32_t DAP_JTAG_Transfer(uint8_t *request, uint8_t *response) {
   uint32_t  request_count;
@@ -800,6 +1250,7 @@ static uint32_t DAP_JTAG_Transfer(uint8_t *request, uint8_t *response) {
   uint32_t  request_ir;
   uint32_t  response_count;
   uint32_t  response_value;
+  uint8_t  *request_head;
   uint8_t  *response_head;
   uint32_t  post_read;
   uint32_t  match_value;
@@ -808,6 +1259,8 @@ static uint32_t DAP_JTAG_Transfer(uint8_t *request, uint8_t *response) {
   uint32_t  data;
   uint32_t  ir;
 
+  request_head   = request;
+
   response_count = 0;
   response_value = 0;
   response_head  = response;
@@ -820,10 +1273,11 @@ static uint32_t DAP_JTAG_Transfer(uint8_t *request, uint8_t *response) {
 
   // Device index (JTAP TAP)
   DAP_Data.jtag_dev.index = *request++;
+  request_count = *request++;
   if (DAP_Data.jtag_dev.index >= DAP_Data.jtag_dev.count) goto end;
 
-  request_count = *request++;
-  while (request_count--) {
+  while (request_count != 0) {
+    request_count--;
     request_value = *request++;
     request_ir = (request_value & DAP_TRANSFER_APnDP) ? JTAG_APACC : JTAG_DPACC;
     if (request_value & DAP_TRANSFER_RnW) {
@@ -980,26 +1434,54 @@ static uint32_t DAP_JTAG_Transfer(uint8_t *request, uint8_t *response) {
   }
 
 end:
+  // Skip the requests that were not processed
+  while (request_count != 0) {
+    request_count--;
+    request_value = *request++;
+    if (request_value & DAP_TRANSFER_RnW) {
+      if (request_value & DAP_TRANSFER_MATCH_VALUE) {
+        // Read with value match
+        request += 4;
+      }
+    } else {
+      // Write register
+      request += 4;
+    }
+  }
+
   *(response_head+0) = (uint8_t)response_count;
   *(response_head+1) = (uint8_t)response_value;
 
-  return (response - response_head);
+  return (((request - request_head) << 16) | (response - response_head));
 }
 #endif
 
 
+#if (DAP_SWD != 0)
+// Retry a SWD transfer that the target answered with WAIT
+//   request: A[3:2] RnW APnDP
+//   data:    DATA[31:0]
+//   ack:     response of the first attempt
+//   return:  ACK[2:0]
+static uint32_t SWD_TransferRetry(uint32_t request, uint32_t *data, uint32_t ack) {
+  uint32_t retry = DAP_Data.transfer.retry_count;
+
+  while ((ack == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort) {
+    ack = SWD_Transfer(request, data);
+  }
+  return (ack);
+}
+
 // Process SWD Transfer Block command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
 //   return:   number of bytes in response
-#if (DAP_SWD != 0)
 static uint32_t DAP_SWD_TransferBlock(uint8_t *request, uint8_t *response) {
   uint32_t  request_count;
   uint32_t  request_value;
   uint32_t  response_count;
   uint32_t  response_value;
   uint8_t  *response_head;
-  uint32_t  retry;
   uint32_t  data;
 
   response_count = 0;
@@ -1020,11 +1502,11 @@ static uint32_t DAP_SWD_TransferBlock(uint8_t *request, uint8_t *response) {
     // Read register block
     if (request_value & DAP_TRANSFER_APnDP) {
       // Post AP read
-      retry = DAP_Data.transfer.retry_count;
-      do {
-        response_value = SWD_Transfer(request_value, NULL);
-      } while ((response_value == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
-      if (response_value != DAP_TRANSFER_OK) goto end;
+      response_value = SWD_Transfer(request_value, NULL);
+      if (response_value != DAP_TRANSFER_OK) {
+        response_value = SWD_TransferRetry(request_value, NULL, response_value);
+        if (response_value != DAP_TRANSFER_OK) goto end;
+      }
     }
     while (request_count--) {
       // Read DP/AP register
@@ -1032,11 +1514,12 @@ static uint32_t DAP_SWD_TransferBlock(uint8_t *request, uint8_t *response) {
         // Last AP read
         request_value = DP_RDBUFF | DAP_TRANSFER_RnW;
       }
-      retry = DAP_Data.transfer.retry_count;
-      do {
-        response_value = SWD_Transfer(request_value, &data);
-      } while ((response_value == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
-      if (response_value != DAP_TRANSFER_OK) goto end;
+      // Only leave the back-to-back reads when the target answers WAIT
+      response_value = SWD_Transfer(request_value, &data);
+      if (response_value != DAP_TRANSFER_OK) {
+        response_value = SWD_TransferRetry(request_value, &data, response_value);
+        if (response_value != DAP_TRANSFER_OK) goto end;
+      }
       // Store data
       *response++ = (uint8_t) data;
       *response++ = (uint8_t)(data >>  8);
@@ -1054,18 +1537,16 @@ static uint32_t DAP_SWD_TransferBlock(uint8_t *request, uint8_t *response) {
              (*(request+3) << 24);
       request += 4;
       // Write DP/AP register
-      retry = DAP_Data.transfer.retry_count;
-      do {
-        response_value = SWD_Transfer(request_value, &data);
-      } while ((response_value == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
-      if (response_value != DAP_TRANSFER_OK) goto end;
+      response_value = SWD_Transfer(request_value, &data);
+      if (response_value != DAP_TRANSFER_OK) {
+        response_value = SWD_TransferRetry(request_value, &data, response_value);
+        if (response_value != DAP_TRANSFER_OK) goto end;
+      }
       response_count++;
     }
     // Check last write
-    retry = DAP_Data.transfer.retry_count;
-    do {
-      response_value = SWD_Transfer(DP_RDBUFF | DAP_TRANSFER_RnW, NULL);
-    } while ((response_value == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
+    response_value = SWD_Transfer(DP_RDBUFF | DAP_TRANSFER_RnW, NULL);
+    response_value = SWD_TransferRetry(DP_RDBUFF | DAP_TRANSFER_RnW, NULL, response_value);
   }
 
 end:
@@ -1180,22 +1661,128 @@ end:
 #endif
 
 
+// Process Dummy Transfer command (for disabled or unsupported debug port)
+//   request:  pointer to request data
+//   response: pointer to response data
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+static uint32_t DAP_Dummy_Transfer(uint8_t *request, uint8_t *response) {
+  uint8_t  *request_head;
+  uint32_t  request_count;
+  uint32_t  request_value;
+
+  request_head  =  request;
+
+  request++;            // Ignore DAP index
+
+  request_count = *request++;
+
+  while (request_count != 0) {
+    request_count--;
+    request_value = *request++;
+    if (request_value & DAP_TRANSFER_RnW) {
+      if (request_value & DAP_TRANSFER_MATCH_VALUE) {
+        // Read with value match
+        request += 4;
+      }
+    } else {
+      // Write register
+      request += 4;
+    }
+  }
+
+  *(response+0) = 0;    // Response count
+  *(response+1) = 0;    // Response value
+
+  return (((request - request_head) << 16) | 2);
+}
+
+
+// Process Transfer command and prepare response
+//   request:  pointer to request data
+//   response: pointer to response data
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+static uint32_t DAP_Transfer(uint8_t *request, uint8_t *response) {
+  uint32_t num;
+
+  switch (DAP_Data.debug_port) {
+#if (DAP_SWD != 0)
+    case DAP_PORT_SWD:
+      num = DAP_SWD_Transfer(request, response);
+      break;
+#endif
+#if (DAP_JTAG != 0)
+    case DAP_PORT_JTAG:
+      num = DAP_JTAG_Transfer(request, response);
+      break;
+#endif
+    default:
+      num = DAP_Dummy_Transfer(request, response);
+      break;
+  }
+
+  return (num);
+}
+
+
+// Process Transfer Block command and prepare response
+//   request:  pointer to request data
+//   response: pointer to response data
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+static uint32_t DAP_TransferBlock(uint8_t *request, uint8_t *response) {
+  uint32_t num;
+
+  switch (DAP_Data.debug_port) {
+#if (DAP_SWD != 0)
+    case DAP_PORT_SWD:
+      num = DAP_SWD_TransferBlock(request, response);
+      break;
+#endif
+#if (DAP_JTAG != 0)
+    case DAP_PORT_JTAG:
+      num = DAP_JTAG_TransferBlock(request, response);
+      break;
+#endif
+    default:
+      *(response+0) = 0;    // Response count [7:0]
+      *(response+1) = 0;    // Response count[15:8]
+      *(response+2) = 0;    // Response value
+      num = 3;
+      break;
+  }
+
+  if (*(request+3) & DAP_TRANSFER_RnW) {
+    // Read register block
+    num |= 4 << 16;
+  } else {
+    // Write register block
+    num |= (4 + ((*(request+1) | (*(request+2) << 8)) * 4)) << 16;
+  }
+
+  return (num);
+}
+
+
 // Process DAP Vendor command and prepare response
 // Default function (can be overridden)
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 __weak uint32_t DAP_ProcessVendorCommand(uint8_t *request, uint8_t *response) {
   (void)request;
   *response = ID_DAP_Invalid;
-  return (1);
+  return ((1 << 16) | 1);
 }
 
 
 // Process DAP command and prepare response
 //   request:  pointer to request data
 //   response: pointer to response data
-//   return:   number of bytes in response
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
 uint32_t DAP_ProcessCommand(uint8_t *request, uint8_t *response) {
   uint32_t num;
 
@@ -1209,7 +1796,7 @@ uint32_t DAP_ProcessCommand(uint8_t *request, uint8_t *response) {
     case ID_DAP_Info:
       num = DAP_Info(*request, response+1);
       *response = num;
-      return (2 + num);
+      return ((2 << 16) + 2 + num);
     case ID_DAP_HostStatus:
       num = DAP_HostStatus(request, response);
       break;
@@ -1238,10 +1825,16 @@ uint32_t DAP_ProcessCommand(uint8_t *request, uint8_t *response) {
       break;
 #else
     case ID_DAP_SWJ_Pins:
+      *response = DAP_ERROR;
+      return ((7 << 16) | 2);
     case ID_DAP_SWJ_Clock:
+      *response = DAP_ERROR;
+      return ((5 << 16) | 2);
     case ID_DAP_SWJ_Sequence:
+      num = *request;
+      if (num == 0) num = 256;
       *response = DAP_ERROR;
-      return (2);
+      return (((2 + (num + 7) / 8) << 16) | 2);
 #endif
 
 #if (DAP_SWD != 0)
@@ -1251,9 +1844,13 @@ uint32_t DAP_ProcessCommand(uint8_t *request, uint8_t *response) {
 #else
     case ID_DAP_SWD_Configure:
       *response = DAP_ERROR;
-      return (2);
+      return ((2 << 16) | 2);
 #endif
 
+    case ID_DAP_SWD_Sequence:
+      num = DAP_SWD_Sequence(request, response);
+      break;
+
 #if (DAP_JTAG != 0)
     case ID_DAP_JTAG_Sequence:
       num = DAP_JTAG_Sequence(request, response);
@@ -1269,7 +1866,28 @@ uint32_t DAP_ProcessCommand(uint8_t *request, uint8_t *response) {
     case ID_DAP_JTAG_Configure:
     case ID_DAP_JTAG_IDCODE:
       *response = DAP_ERROR;
-      return (2);
+      return ((1 << 16) | 2);
+#endif
+
+#if (SWO_UART != 0)
+    case ID_DAP_SWO_Transport:
+      num = SWO_Transport(request, response);
+      break;
+    case ID_DAP_SWO_Mode:
+      num = SWO_Mode(request, response);
+      break;
+    case ID_DAP_SWO_Baudrate:
+      num = SWO_Baudrate(request, response);
+      break;
+    case ID_DAP_SWO_Control:
+      num = SWO_Control(request, response);
+      break;
+    case ID_DAP_SWO_Status:
+      num = SWO_Status(response);
+      break;
+    case ID_DAP_SWO_Data:
+      num = SWO_Data(request, response);
+      break;
 #endif
 
     case ID_DAP_TransferConfigure:
@@ -1277,42 +1895,11 @@ uint32_t DAP_ProcessCommand(uint8_t *request, uint8_t *response) {
       break;
 
     case ID_DAP_Transfer:
-      switch (DAP_Data.debug_port) {
-#if (DAP_SWD != 0)
-        case DAP_PORT_SWD:
-          num = DAP_SWD_Transfer (request, response);
-          break;
-#endif
-#if (DAP_JTAG != 0)
-        case DAP_PORT_JTAG:
-          num = DAP_JTAG_Transfer(request, response);
-          break;
-#endif
-        default:
-          *(response+0) = 0;    // Response count
-          *(response+1) = 0;    // Response value
-          num = 2;
-      }
+      num = DAP_Transfer(request, response);
       break;
 
     case ID_DAP_TransferBlock:
-      switch (DAP_Data.debug_port) {
-#if (DAP_SWD != 0)
-        case DAP_PORT_SWD:
-          num = DAP_SWD_TransferBlock (request, response);
-          break;
-#endif
-#if (DAP_JTAG != 0)
-        case DAP_PORT_JTAG:
-          num = DAP_JTAG_TransferBlock(request, response);
-          break;
-#endif
-        default:
-          *(response+0) = 0;    // Response count [7:0]
-          *(response+1) = 0;    // Response count[15:8]
-          *(response+2) = 0;    // Response value
-          num = 3;
-      }
+      num = DAP_TransferBlock(request, response);
       break;
 
     case ID_DAP_WriteABORT:
@@ -1329,16 +1916,104 @@ uint32_t DAP_ProcessCommand(uint8_t *request, uint8_t *response) {
 #endif
         default:
           *response = DAP_ERROR;
-          return (2);
+          return ((6 << 16) | 2);
       }
       break;
 
+    case ID_DAP_ExecuteCommands:
+    case ID_DAP_QueueCommands:
     default:
       *(response-1) = ID_DAP_Invalid;
-      return (1);
+      return ((1 << 16) | 1);
   }
 
-  return (1 + num);
+  return ((1 << 16) + 1 + num);
+}
+
+
+// Process DAP command and account for its execution time
+static uint32_t DAP_ProcessCommandTimed(uint8_t *request, uint8_t *response) {
+#if DAP_STATS_AVAILABLE
+  uint8_t  id = *request;
+  uint32_t start = get_cycles();
+  uint32_t num = DAP_ProcessCommand(request, response);
+
+  dap_stats_command(id, get_cycles() - start);
+  return (num);
+#else
+  return DAP_ProcessCommand(request, response);
+#endif
+}
+
+
+// Runs of transfers inside a command batch go out with interrupts masked,
+// so that they follow each other without gaps, but for no longer than
+// DAP_ATOMIC_MAX_US at a time: SysTick can only make up for one missed
+// tick, and the USB and UART interrupts must not be held off for long.
+// The deadline is a raw cycle count, so checking it costs no divide.
+#define DAP_ATOMIC_MAX_CYCLES   (CPU_CLOCK / 1000000U * DAP_ATOMIC_MAX_US)
+
+static uint8_t  atomic_active;
+static uint32_t atomic_primask;
+static uint32_t atomic_deadline;
+
+static void DAP_AtomicBegin(void) {
+  if (!atomic_active) {
+    atomic_primask  = cm_mask_interrupts(1);
+    atomic_deadline = get_cycles() + DAP_ATOMIC_MAX_CYCLES;
+    atomic_active   = 1;
+  }
+}
+
+static void DAP_AtomicEnd(void) {
+  if (atomic_active) {
+    cm_mask_interrupts(atomic_primask);
+    atomic_active = 0;
+  }
+}
+
+// Called after every SWD transaction: let pending interrupts in once the
+// masked stretch has gone on too long, e.g. through WAIT retries
+void DAP_AtomicYield(void) {
+  if (atomic_active && ((int32_t)(get_cycles() - atomic_deadline) >= 0)) {
+    cm_mask_interrupts(atomic_primask);
+    atomic_primask  = cm_mask_interrupts(1);
+    atomic_deadline = get_cycles() + DAP_ATOMIC_MAX_CYCLES;
+  }
+}
+
+
+// Execute DAP command (process request and prepare response)
+//   request:  pointer to request data
+//   response: pointer to response data
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+uint32_t DAP_ExecuteCommand(uint8_t *request, uint8_t *response) {
+  uint32_t cnt, num, n;
+
+  if (*request == ID_DAP_ExecuteCommands) {
+    *response++ = *request++;
+    cnt = *request++;
+    *response++ = (uint8_t)cnt;
+    num = (2 << 16) | 2;
+    while (cnt--) {
+      if ((*request == ID_DAP_Transfer) ||
+          (*request == ID_DAP_TransferBlock) ||
+          (*request == ID_DAP_WriteABORT)) {
+        DAP_AtomicBegin();
+      } else {
+        DAP_AtomicEnd();
+      }
+      n = DAP_ProcessCommandTimed(request, response);
+      num += n;
+      request  += (uint16_t)(n >> 16);
+      response += (uint16_t) n;
+    }
+    DAP_AtomicEnd();
+    return (num);
+  }
+
+  return DAP_ProcessCommandTimed(request, response);
 }
 
 
@@ -1356,10 +2031,17 @@ void DAP_Setup(void) {
 #if (DAP_SWD != 0)
   DAP_Data.swd_conf.turnaround  = 1;
 //DAP_Data.swd_conf.data_phase  = 0;
+#if (DAP_SWD_CACHE != 0)
+  DAP_Data.swd_cache.enable     = 1;
+  DAP_Data.swd_cache.mem_ap     = 1;
+#endif
 #endif
 #if (DAP_JTAG != 0)
 //DAP_Data.jtag_dev.count = 0;
 #endif
 
   DAP_SETUP();  // Device specific setup
+#if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+  SWJ_SetClock(DAP_DEFAULT_SWJ_CLOCK);
+#endif
 }
@@ -37,6 +37,15 @@
 #define ID_DAP_JTAG_Sequence            0x14
 #define ID_DAP_JTAG_Configure           0x15
 #define ID_DAP_JTAG_IDCODE              0x16
+#define ID_DAP_SWO_Transport            0x17
+#define ID_DAP_SWO_Mode                 0x18
+#define ID_DAP_SWO_Baudrate             0x19
+#define ID_DAP_SWO_Control              0x1A
+#define ID_DAP_SWO_Status               0x1B
+#define ID_DAP_SWO_Data                 0x1C
+#define ID_DAP_SWD_Sequence             0x1D
+#define ID_DAP_QueueCommands            0x7E
+#define ID_DAP_ExecuteCommands          0x7F
 
 // DAP Vendor Command IDs
 #define ID_DAP_Vendor0                  0x80
@@ -86,9 +95,26 @@
 #define DAP_ID_DEVICE_VENDOR            5
 #define DAP_ID_DEVICE_NAME              6
 #define DAP_ID_CAPABILITIES             0xF0
+#define DAP_ID_TIMESTAMP_CLOCK          0xF1
+#define DAP_ID_SWO_BUFFER_SIZE          0xFD
 #define DAP_ID_PACKET_COUNT             0xFE
 #define DAP_ID_PACKET_SIZE              0xFF
 
+// SWO Trace Transport
+#define DAP_SWO_TRANSPORT_NONE          0
+#define DAP_SWO_TRANSPORT_DATA          1       // Read with DAP_SWO_Data command
+#define DAP_SWO_TRANSPORT_STREAM        2       // Streamed on the SWO trace endpoint
+
+// SWO Trace Mode
+#define DAP_SWO_OFF                     0
+#define DAP_SWO_UART                    1
+#define DAP_SWO_MANCHESTER              2
+
+// SWO Trace Status
+#define DAP_SWO_CAPTURE_ACTIVE          (1<<0)
+#define DAP_SWO_STREAM_ERROR            (1<<6)
+#define DAP_SWO_BUFFER_OVERRUN          (1<<7)
+
 // DAP Host Status
 #define DAP_DEBUGGER_CONNECTED          0
 #define DAP_TARGET_RUNNING              1
@@ -99,6 +125,16 @@
 #define DAP_PORT_SWD                    1       // SWD Port (SWCLK, SWDIO) + nRESET
 #define DAP_PORT_JTAG                   2       // JTAG Port (TCK, TMS, TDI, TDO, nTRST) + nRESET
 
+// SWJ Clock Source (SWJ Clock Info vendor command)
+#define DAP_CLOCK_SOURCE_DELAY          0       // Delay loop
+#define DAP_CLOCK_SOURCE_FAST           1       // Fixed fast loop
+#define DAP_CLOCK_SOURCE_TIMER          2       // Paced by a hardware timer
+
+// SWD Register Cache Mode (SWD Cache Control vendor command)
+#define DAP_CACHE_DISABLE               0       // Send every write
+#define DAP_CACHE_ENABLE                1       // Skip writes that change nothing
+#define DAP_CACHE_QUERY                 0xFF    // Leave the setting unchanged
+
 // DAP SWJ Pins
 #define DAP_SWJ_SWCLK_TCK               0       // SWCLK/TCK
 #define DAP_SWJ_SWDIO_TMS               1       // SWDIO/TMS
@@ -114,6 +150,7 @@
 #define DAP_TRANSFER_A3                 (1<<3)
 #define DAP_TRANSFER_MATCH_VALUE        (1<<4)
 #define DAP_TRANSFER_MATCH_MASK         (1<<5)
+#define DAP_TRANSFER_TIMESTAMP          (1<<7)
 
 // DAP Transfer Response
 #define DAP_TRANSFER_OK                 (1<<0)
@@ -131,6 +168,16 @@
 #define DP_SELECT                       0x08    // Select Register (JTAG R/W & SW W)
 #define DP_RESEND                       0x08    // Resend (SW Read Only)
 #define DP_RDBUFF                       0x0C    // Read Buffer (Read Only)
+#define DP_TARGETSEL                    0x0C    // Target Select (SWDv2 Write Only)
+
+// SWCLK periods returned by SWJ_ClockPeriod() are in these fractions
+// of a CPU cycle
+#define SWJ_PERIOD_SCALE                16U
+
+// SWD Register Cache Valid Flags
+#define SWD_CACHE_SELECT                (1<<0)  // DP SELECT known
+#define SWD_CACHE_CSW                   (1<<1)  // AP CSW known
+#define SWD_CACHE_TAR                   (1<<2)  // AP TAR known
 
 // JTAG IR Codes
 #define JTAG_ABORT                      0x08
@@ -139,6 +186,10 @@
 #define JTAG_IDCODE                     0x0E
 #define JTAG_BYPASS                     0x0F
 
+// SWD Sequence Info
+#define SWD_SEQUENCE_CLK                0x3F    // SWCLK count
+#define SWD_SEQUENCE_DIN                0x80    // SWDIO capture
+
 // JTAG Sequence Info
 #define JTAG_SEQUENCE_TCK               0x3F    // TCK count
 #define JTAG_SEQUENCE_TMS               0x40    // TMS value
@@ -153,6 +204,14 @@ typedef struct {
   uint8_t     debug_port;                       // Debug Port
   uint8_t     fast_clock;                       // Fast Clock Flag
   uint32_t   clock_delay;                       // Clock Delay
+  uint32_t   clock_request;                     // SWJ Clock requested by the host (Hz)
+  uint32_t   clock_actual;                      // SWJ Clock generated for SWD transfers (Hz)
+#if (DAP_SWD_SPI != 0)
+  uint8_t     spi_clock;                        // SPI Clock Flag (SWD data phases via SPI)
+#endif
+#if (DAP_SWD_TIMER != 0)
+  uint8_t     timer_clock;                      // Timer Clock Flag (SWD bits paced by a timer)
+#endif
   struct {                                      // Transfer Configuration
     uint8_t   idle_cycles;                      // Idle cycles after transfer
     uint16_t  retry_count;                      // Number of retries after WAIT response
@@ -163,7 +222,26 @@ typedef struct {
   struct {                                      // SWD Configuration
     uint8_t    turnaround;                      // Turnaround period
     uint8_t    data_phase;                      // Always generate Data Phase
+    uint32_t   select;                          // Last value written to DP SELECT
+    uint32_t   ctrl_stat;                       // Last value written to DP CTRL/STAT
+    uint32_t   targetsel;                       // Last TARGETSEL sent by the probe
+    uint8_t    target_known;                    // Nothing else selected a target since
+    uint8_t    dpidr_pending;                   // Host sequence or connect, DPIDR not read since
   } swd_conf;
+#if (DAP_SWD_CACHE != 0)
+  struct {                                      // SWD Register Cache (write-through)
+    uint8_t    enable;                          // Skip writes that change nothing
+    uint8_t    valid;                           // SWD_CACHE_* flags
+    uint32_t   csw;                             // AP CSW of the AP in SELECT
+    uint32_t   tar;                             // AP TAR, following auto-increment
+    uint32_t   mem_ap;                          // APSEL 0-31 known to be MEM-APs
+    uint8_t    idr_pending;                     // APSEL+1 of a posted AP IDR read
+    uint32_t   skipped;                         // Number of writes skipped
+  } swd_cache;
+#endif
+#endif
+#if (TIMESTAMP_CLOCK != 0)
+  uint32_t    timestamp;                        // Last captured Timestamp
 #endif
 #if (DAP_JTAG != 0)
   struct {                                      // JTAG Device Chain
@@ -189,13 +267,43 @@ extern void     JTAG_IR         (uint32_t ir);
 extern uint32_t JTAG_ReadIDCode (void);
 extern void     JTAG_WriteAbort (uint32_t data);
 extern uint8_t  JTAG_Transfer   (uint32_t request, uint32_t *data);
+extern void     SWD_Sequence    (uint32_t info,  uint8_t *swdo, uint8_t *swdi);
 extern uint8_t  SWD_Transfer    (uint32_t request, uint32_t *data);
+extern void     SWD_TransferSelect (void);
+#if (DAP_SWD_CACHE != 0)
+extern uint32_t SWD_CacheHit    (uint32_t request, uint32_t data);
+extern void     SWD_CacheInvalidate (void);
+extern void     SWD_CacheForgetTarget (void);
+extern uint32_t SWD_CacheControl (uint8_t *request, uint8_t *response);
+#endif
+extern void     SWJ_SetClock    (uint32_t clock);
+extern uint32_t SWJ_ClockPeriod (uint32_t fast, uint32_t delay);
+#if (SWJ_CLOCK_CALIBRATE != 0)
+extern uint32_t SWJ_ReadBits    (uint32_t count, uint32_t delay);
+#if (DAP_SWD_TIMER != 0)
+extern uint32_t SWJ_ReadBitsTimer (uint32_t count);
+#endif
+extern void     SWJ_CalibrateClock (void);
+#endif
+extern uint32_t SWJ_ClockInfo   (uint8_t *request, uint8_t *response);
 
 extern void     Delayms         (uint32_t delay);
 
+#if (SWO_UART != 0)
+extern uint32_t SWO_Transport   (uint8_t *request, uint8_t *response);
+extern uint32_t SWO_Mode        (uint8_t *request, uint8_t *response);
+extern uint32_t SWO_Baudrate    (uint8_t *request, uint8_t *response);
+extern uint32_t SWO_Control     (uint8_t *request, uint8_t *response);
+extern uint32_t SWO_Status      (uint8_t *response);
+extern uint32_t SWO_Data        (uint8_t *request, uint8_t *response);
+extern uint32_t SWO_Stream      (uint8_t *data, uint32_t max);
+#endif
+
 extern uint32_t DAP_ProcessVendorCommand (uint8_t *request, uint8_t *response);
 
 extern uint32_t DAP_ProcessCommand (uint8_t *request, uint8_t *response);
+extern uint32_t DAP_ExecuteCommand (uint8_t *request, uint8_t *response);
+extern void     DAP_AtomicYield (void);
 extern void     DAP_Setup (void);
 
 #ifndef __forceinline
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * CMSIS-DAP SWO trace commands.
+ *
+ * Only UART (NRZ) mode is supported. The UART driver in swo_uart.c
+ * fills trace_buffer in a circle and counts every byte it receives;
+ * the commands here only move the read index. Like the DAP command
+ * handlers in CMSIS_DAP.c, each handler returns the number of request
+ * bytes (upper 16 bits) and response bytes (lower 16 bits) excluding
+ * the command ID.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "DAP/CMSIS_DAP_config.h"
+#include "DAP/CMSIS_DAP.h"
+
+#if (SWO_UART != 0)
+
+#include "swo_uart.h"
+
+#if ((SWO_BUFFER_SIZE & (SWO_BUFFER_SIZE - 1)) != 0)
+#error "SWO_BUFFER_SIZE must be a power of 2"
+#endif
+
+static uint8_t trace_buffer[SWO_BUFFER_SIZE];
+
+/* Free-running byte counts; only their difference matters */
+static uint32_t trace_index_in;
+static uint32_t trace_index_out;
+
+static uint8_t trace_transport;
+static uint8_t trace_mode;
+static uint8_t trace_status;
+static uint32_t trace_baudrate;
+
+static void trace_start(void) {
+    trace_index_in = 0;
+    trace_index_out = 0;
+    swo_uart_start(trace_buffer, SWO_BUFFER_SIZE);
+    trace_status = DAP_SWO_CAPTURE_ACTIVE;
+}
+
+static void trace_stop(void) {
+    if (trace_status & DAP_SWO_CAPTURE_ACTIVE) {
+        swo_uart_stop();
+        trace_index_in = swo_uart_count();
+        trace_status &= ~DAP_SWO_CAPTURE_ACTIVE;
+    }
+}
+
+/* Drop whatever is left over from a stopped capture */
+static void trace_clear(void) {
+    trace_index_out = trace_index_in;
+}
+
+static uint32_t trace_available(void) {
+    uint32_t count;
+
+    if (trace_status & DAP_SWO_CAPTURE_ACTIVE) {
+        trace_index_in = swo_uart_count();
+    }
+
+    count = trace_index_in - trace_index_out;
+    if (count > SWO_BUFFER_SIZE) {
+        /* The DMA lapped the reader. Skip ahead, leaving some slack
+           because the oldest data is being overwritten right now. */
+        trace_status |= DAP_SWO_BUFFER_OVERRUN;
+        trace_index_out = trace_index_in - SWO_BUFFER_SIZE/2;
+        count = SWO_BUFFER_SIZE/2;
+    }
+
+    return count;
+}
+
+static uint32_t trace_read(uint8_t* data, uint32_t max) {
+    uint32_t count = trace_available();
+    uint32_t i;
+
+    if (count > max) {
+        count = max;
+    }
+
+    for (i = 0; i < count; i++) {
+        data[i] = trace_buffer[(trace_index_out + i) & (SWO_BUFFER_SIZE - 1)];
+    }
+    trace_index_out += count;
+
+    return count;
+}
+
+uint32_t SWO_Transport(uint8_t* request, uint8_t* response) {
+    uint8_t transport = request[0];
+
+    if ((trace_status & DAP_SWO_CAPTURE_ACTIVE)
+        || (transport > DAP_SWO_TRANSPORT_STREAM)
+        || (transport == DAP_SWO_TRANSPORT_STREAM && !SWO_STREAM)) {
+        response[0] = DAP_ERROR;
+    } else {
+        trace_transport = transport;
+        trace_clear();
+        response[0] = DAP_OK;
+    }
+
+    return ((1 << 16) | 1);
+}
+
+uint32_t SWO_Mode(uint8_t* request, uint8_t* response) {
+    uint8_t mode = request[0];
+
+    trace_stop();
+    trace_clear();
+
+    if (mode == DAP_SWO_OFF || mode == DAP_SWO_UART) {
+        trace_mode = mode;
+        trace_status = 0;
+        response[0] = DAP_OK;
+    } else {
+        trace_mode = DAP_SWO_OFF;
+        response[0] = DAP_ERROR;
+    }
+
+    return ((1 << 16) | 1);
+}
+
+uint32_t SWO_Baudrate(uint8_t* request, uint8_t* response) {
+    uint32_t baudrate = ((uint32_t)request[0] <<  0)
+                      | ((uint32_t)request[1] <<  8)
+                      | ((uint32_t)request[2] << 16)
+                      | ((uint32_t)request[3] << 24);
+    bool restart = (trace_status & DAP_SWO_CAPTURE_ACTIVE) != 0;
+
+    trace_stop();
+
+    if (trace_mode == DAP_SWO_UART) {
+        trace_baudrate = swo_uart_set_baudrate(baudrate);
+    } else {
+        trace_baudrate = 0;
+    }
+
+    if (restart && trace_baudrate != 0) {
+        trace_start();
+    }
+
+    response[0] = (uint8_t)(trace_baudrate >>  0);
+    response[1] = (uint8_t)(trace_baudrate >>  8);
+    response[2] = (uint8_t)(trace_baudrate >> 16);
+    response[3] = (uint8_t)(trace_baudrate >> 24);
+
+    return ((4 << 16) | 4);
+}
+
+uint32_t SWO_Control(uint8_t* request, uint8_t* response) {
+    bool start = (request[0] & 0x01) != 0;
+
+    response[0] = DAP_OK;
+    if (!start) {
+        trace_stop();
+    } else if (!(trace_status & DAP_SWO_CAPTURE_ACTIVE)) {
+        if (trace_mode == DAP_SWO_UART && trace_baudrate != 0) {
+            trace_start();
+        } else {
+            response[0] = DAP_ERROR;
+        }
+    }
+
+    return ((1 << 16) | 1);
+}
+
+uint32_t SWO_Status(uint8_t* response) {
+    uint32_t count = trace_available();
+
+    response[0] = trace_status;
+    response[1] = (uint8_t)(count >>  0);
+    response[2] = (uint8_t)(count >>  8);
+    response[3] = (uint8_t)(count >> 16);
+    response[4] = (uint8_t)(count >> 24);
+
+    /* Errors are reported once */
+    trace_status &= DAP_SWO_CAPTURE_ACTIVE;
+
+    return ((0 << 16) | 5);
+}
+
+uint32_t SWO_Data(uint8_t* request, uint8_t* response) {
+    uint32_t max = ((uint32_t)request[0] << 0)
+                 | ((uint32_t)request[1] << 8);
+    uint32_t count = 0;
+
+    /* Command ID, status and count come first */
+    if (max > DAP_PACKET_SIZE - 4) {
+        max = DAP_PACKET_SIZE - 4;
+    }
+
+    if (trace_transport == DAP_SWO_TRANSPORT_DATA) {
+        count = trace_read(&response[3], max);
+    }
+
+    response[0] = trace_status;
+    response[1] = (uint8_t)(count >> 0);
+    response[2] = (uint8_t)(count >> 8);
+
+    trace_status &= DAP_SWO_CAPTURE_ACTIVE;
+
+    return ((2 << 16) | (3 + count));
+}
+
+/* Trace data for the streaming endpoint, if streaming was selected */
+uint32_t SWO_Stream(uint8_t* data, uint32_t max) {
+    if (trace_transport != DAP_SWO_TRANSPORT_STREAM) {
+        return 0;
+    }
+
+    return trace_read(data, max);
+}
+
+#endif
@@ -16,6 +16,7 @@
 
 #include "DAP/CMSIS_DAP_config.h"
 #include "DAP/CMSIS_DAP.h"
+#include "DAP/stats.h"
 
 
 // SW Macros
@@ -44,6 +45,7 @@
   PIN_DELAY()
 
 #define PIN_DELAY() PIN_DELAY_SLOW(DAP_Data.clock_delay)
+#define PIN_DELAY_START()
 
 
 // Generate SWJ Sequence
@@ -71,15 +73,172 @@ void SWJ_Sequence (uint32_t count, uint8_t *data) {
     val >>= 1;
     n--;
   }
+#if ((DAP_SWD != 0) && (DAP_SWD_CACHE != 0))
+  // May be a line reset, which clears SELECT
+  SWD_CacheInvalidate();
+#endif
 }
 #endif
 
 
+// Read bits the way the data phase of a transfer does, for
+// SWJ_CalibrateClock() to time the SWCLK loops
+//   count:  number of bits
+//   delay:  delay loop count, 0 = fast loop
+//   return: last 32 bits read
+#if ((DAP_SWD != 0) && (SWJ_CLOCK_CALIBRATE != 0))
+uint32_t SWJ_ReadBits (uint32_t count, uint32_t delay) {
+  uint32_t bit;
+  uint32_t val;
+
+  val = 0;
+  if (delay == 0) {
+#undef  PIN_DELAY
+#define PIN_DELAY() PIN_DELAY_FAST()
+    while (count--) {
+      SW_READ_BIT(bit);
+      val >>= 1;
+      val  |= bit << 31;
+    }
+  } else {
+#undef  PIN_DELAY
+#define PIN_DELAY() PIN_DELAY_SLOW(delay)
+    while (count--) {
+      SW_READ_BIT(bit);
+      val >>= 1;
+      val  |= bit << 31;
+    }
+  }
+#undef  PIN_DELAY
+#define PIN_DELAY() PIN_DELAY_SLOW(DAP_Data.clock_delay)
+  return (val);
+}
+
+// Read bits paced by the timer, as SWJ_ReadBits()
+#if (DAP_SWD_TIMER != 0)
+uint32_t SWJ_ReadBitsTimer (uint32_t count) {
+  uint32_t bit;
+  uint32_t val;
+
+  val = 0;
+  SWD_TIMER_START();
+#undef  PIN_DELAY
+#define PIN_DELAY() SWD_TIMER_WAIT()
+  while (count--) {
+    SW_READ_BIT(bit);
+    val >>= 1;
+    val  |= bit << 31;
+  }
+#undef  PIN_DELAY
+#define PIN_DELAY() PIN_DELAY_SLOW(DAP_Data.clock_delay)
+  return (val);
+}
+#endif
+#endif
+
+
 #if (DAP_SWD != 0)
 
 
+// Generate SWD Sequence
+//   info:   sequence information
+//   swdo:   pointer to SWDIO generated data
+//   swdi:   pointer to SWDIO captured data
+//   return: none
+void SWD_Sequence (uint32_t info, uint8_t *swdo, uint8_t *swdi) {
+  uint32_t val;
+  uint32_t bit;
+  uint32_t n, k;
+
+  n = info & SWD_SEQUENCE_CLK;
+  if (n == 0) {
+    n = 64;
+  }
+
+  if (info & SWD_SEQUENCE_DIN) {
+    while (n) {
+      val = 0;
+      for (k = 8; k && n; k--, n--) {
+        SW_READ_BIT(bit);
+        val >>= 1;
+        val  |= bit << 7;
+      }
+      val >>= k;
+      *swdi++ = (uint8_t)val;
+    }
+  } else {
+    while (n) {
+      val = *swdo++;
+      for (k = 8; k && n; k--, n--) {
+        SW_WRITE_BIT(val);
+        val >>= 1;
+      }
+    }
+  }
+#if (DAP_SWD_CACHE != 0)
+  // May have selected another multi-drop target
+  SWD_CacheForgetTarget();
+#endif
+}
+
+
+// Packet request header for each APnDP/RnW/A2/A3 combination, sent LSB
+// first: Start, APnDP, RnW, A2, A3, Parity, Stop, Park
+#define SWD_REQUEST_HEADER(req)                                         \
+  (0x81 | ((req) << 1) |                                                \
+   ((((req) ^ ((req) >> 1) ^ ((req) >> 2) ^ ((req) >> 3)) & 1) << 5))
+
+static const uint8_t SWD_RequestHeader[16] = {
+  SWD_REQUEST_HEADER(0x0), SWD_REQUEST_HEADER(0x1),
+  SWD_REQUEST_HEADER(0x2), SWD_REQUEST_HEADER(0x3),
+  SWD_REQUEST_HEADER(0x4), SWD_REQUEST_HEADER(0x5),
+  SWD_REQUEST_HEADER(0x6), SWD_REQUEST_HEADER(0x7),
+  SWD_REQUEST_HEADER(0x8), SWD_REQUEST_HEADER(0x9),
+  SWD_REQUEST_HEADER(0xA), SWD_REQUEST_HEADER(0xB),
+  SWD_REQUEST_HEADER(0xC), SWD_REQUEST_HEADER(0xD),
+  SWD_REQUEST_HEADER(0xE), SWD_REQUEST_HEADER(0xF),
+};
+
+// Even parity of a 32-bit word, folded once outside the bit loops
+static inline __forceinline uint32_t SWD_Parity (uint32_t val) {
+  val ^= val >> 16;
+  val ^= val >> 8;
+  val ^= val >> 4;
+  val ^= val >> 2;
+  val ^= val >> 1;
+  return (val & 1);
+}
+
+// Transfer configuration seen by the transfer templates below. Each
+// template is instantiated once with these read from DAP_Data and once
+// with the constants of the common configuration (turnaround of one
+// cycle, no data phase on WAIT/FAULT, no idle cycles), which lets the
+// compiler drop the configuration loops from the hot path altogether.
+#define SWD_TURNAROUND  DAP_Data.swd_conf.turnaround
+#define SWD_DATA_PHASE  DAP_Data.swd_conf.data_phase
+#define SWD_IDLE_CYCLES DAP_Data.transfer.idle_cycles
+
+#define SWD_CONFIG_DEFAULT()                    \
+  ((DAP_Data.swd_conf.turnaround  == 1U) &&     \
+   (DAP_Data.swd_conf.data_phase  == 0U) &&     \
+   (DAP_Data.transfer.idle_cycles == 0U))
+
+
+// Capture the Timestamp at the start of the data phase when requested
+#if (TIMESTAMP_CLOCK != 0)
+#define SWD_TIMESTAMP(request)                                                  \
+  do {                                                                          \
+    if ((request) & DAP_TRANSFER_TIMESTAMP) {                                   \
+      DAP_Data.timestamp = TIMESTAMP_GET();                                     \
+    }                                                                           \
+  } while (0)
+#else
+#define SWD_TIMESTAMP(request)  do { } while (0)
+#endif
+
+
 // SWD Transfer I/O
-//   request: A[3:2] RnW APnDP
+//   request: A[3:2] RnW APnDP, TIMESTAMP
 //   data:    DATA[31:0]
 //   return:  ACK[2:0]
 #define SWD_TransferFunction(speed)     /**/                                    \
@@ -91,28 +250,18 @@ static uint8_t SWD_Transfer##speed (uint32_t request, uint32_t *data) {
                                                                                 \
   uint32_t n;                                                                   \
                                                                                 \
-  /* Packet Request */                                                          \
-  parity = 0;                                                                   \
-  SW_WRITE_BIT(1);                      /* Start Bit */                         \
-  bit = request >> 0;                                                           \
-  SW_WRITE_BIT(bit);                    /* APnDP Bit */                         \
-  parity += bit;                                                                \
-  bit = request >> 1;                                                           \
-  SW_WRITE_BIT(bit);                    /* RnW Bit */                           \
-  parity += bit;                                                                \
-  bit = request >> 2;                                                           \
-  SW_WRITE_BIT(bit);                    /* A2 Bit */                            \
-  parity += bit;                                                                \
-  bit = request >> 3;                                                           \
-  SW_WRITE_BIT(bit);                    /* A3 Bit */                            \
-  parity += bit;                                                                \
-  SW_WRITE_BIT(parity);                 /* Parity Bit */                        \
-  SW_WRITE_BIT(0);                      /* Stop Bit */                          \
-  SW_WRITE_BIT(1);                      /* Park Bit */                          \
+  PIN_DELAY_START();                                                            \
+                                                                                \
+  /* Packet Request: Start, APnDP, RnW, A2, A3, Parity, Stop, Park */           \
+  val = SWD_RequestHeader[request & 0x0F];                                      \
+  for (n = 8; n; n--) {                                                         \
+    SW_WRITE_BIT(val);                                                          \
+    val >>= 1;                                                                  \
+  }                                                                             \
                                                                                 \
   /* Turnaround */                                                              \
   PIN_SWDIO_OUT_DISABLE();                                                      \
-  for (n = DAP_Data.swd_conf.turnaround; n; n--) {                              \
+  for (n = SWD_TURNAROUND; n; n--) {                                            \
     SW_CLOCK_CYCLE();                                                           \
   }                                                                             \
                                                                                 \
@@ -127,43 +276,42 @@ static uint8_t SWD_Transfer##speed (uint32_t request, uint32_t *data) {
   if (ack == DAP_TRANSFER_OK) {         /* OK response */                       \
     /* Data transfer */                                                         \
     if (request & DAP_TRANSFER_RnW) {                                           \
+      SWD_TIMESTAMP(request);                                                   \
       /* Read data */                                                           \
       val = 0;                                                                  \
-      parity = 0;                                                               \
       for (n = 32; n; n--) {                                                    \
         SW_READ_BIT(bit);               /* Read RDATA[0:31] */                  \
-        parity += bit;                                                          \
         val >>= 1;                                                              \
         val  |= bit << 31;                                                      \
       }                                                                         \
       SW_READ_BIT(bit);                 /* Read Parity */                       \
-      if ((parity ^ bit) & 1) {                                                 \
+      if ((SWD_Parity(val) ^ bit) & 1) {                                        \
         ack = DAP_TRANSFER_ERROR;                                               \
       }                                                                         \
       if (data) *data = val;                                                    \
       /* Turnaround */                                                          \
-      for (n = DAP_Data.swd_conf.turnaround; n; n--) {                          \
+      for (n = SWD_TURNAROUND; n; n--) {                                        \
         SW_CLOCK_CYCLE();                                                       \
       }                                                                         \
       PIN_SWDIO_OUT_ENABLE();                                                   \
     } else {                                                                    \
       /* Turnaround */                                                          \
-      for (n = DAP_Data.swd_conf.turnaround; n; n--) {                          \
+      for (n = SWD_TURNAROUND; n; n--) {                                        \
         SW_CLOCK_CYCLE();                                                       \
       }                                                                         \
       PIN_SWDIO_OUT_ENABLE();                                                   \
+      SWD_TIMESTAMP(request);                                                   \
       /* Write data */                                                          \
       val = *data;                                                              \
-      parity = 0;                                                               \
+      parity = SWD_Parity(val);                                                 \
       for (n = 32; n; n--) {                                                    \
         SW_WRITE_BIT(val);              /* Write WDATA[0:31] */                 \
-        parity += val;                                                          \
         val >>= 1;                                                              \
       }                                                                         \
       SW_WRITE_BIT(parity);             /* Write Parity Bit */                  \
     }                                                                           \
     /* Idle cycles */                                                           \
-    n = DAP_Data.transfer.idle_cycles;                                          \
+    n = SWD_IDLE_CYCLES;                                                        \
     if (n) {                                                                    \
       PIN_SWDIO_OUT(0);                                                         \
       for (; n; n--) {                                                          \
@@ -176,17 +324,17 @@ static uint8_t SWD_Transfer##speed (uint32_t request, uint32_t *data) {
                                                                                 \
   if ((ack == DAP_TRANSFER_WAIT) || (ack == DAP_TRANSFER_FAULT)) {              \
     /* WAIT or FAULT response */                                                \
-    if (DAP_Data.swd_conf.data_phase && ((request & DAP_TRANSFER_RnW) != 0)) {  \
+    if (SWD_DATA_PHASE && ((request & DAP_TRANSFER_RnW) != 0)) {                \
       for (n = 32+1; n; n--) {                                                  \
         SW_CLOCK_CYCLE();               /* Dummy Read RDATA[0:31] + Parity */   \
       }                                                                         \
     }                                                                           \
     /* Turnaround */                                                            \
-    for (n = DAP_Data.swd_conf.turnaround; n; n--) {                            \
+    for (n = SWD_TURNAROUND; n; n--) {                                          \
       SW_CLOCK_CYCLE();                                                         \
     }                                                                           \
     PIN_SWDIO_OUT_ENABLE();                                                     \
-    if (DAP_Data.swd_conf.data_phase && ((request & DAP_TRANSFER_RnW) == 0)) {  \
+    if (SWD_DATA_PHASE && ((request & DAP_TRANSFER_RnW) == 0)) {                \
       PIN_SWDIO_OUT(0);                                                         \
       for (n = 32+1; n; n--) {                                                  \
         SW_CLOCK_CYCLE();               /* Dummy Write WDATA[0:31] + Parity */  \
@@ -197,9 +345,10 @@ static uint8_t SWD_Transfer##speed (uint32_t request, uint32_t *data) {
   }                                                                             \
                                                                                 \
   /* Protocol error */                                                          \
-  for (n = DAP_Data.swd_conf.turnaround + 32 + 1; n; n--) {                     \
+  for (n = SWD_TURNAROUND + 32 + 1; n; n--) {                                   \
     SW_CLOCK_CYCLE();                   /* Back off data phase */               \
   }                                                                             \
+  PIN_SWDIO_OUT_ENABLE();                                                       \
   PIN_SWDIO_OUT(1);                                                             \
   return (ack);                                                                 \
 }
@@ -213,18 +362,439 @@ SWD_TransferFunction(Fast);
 #define PIN_DELAY() PIN_DELAY_SLOW(DAP_Data.clock_delay)
 SWD_TransferFunction(Slow);
 
+// Timer paced: every half SWCLK period ends on a timer update, counted
+// from the start of the transfer, so the clock is exact for any rate
+// the loop can keep up with
+#if (DAP_SWD_TIMER != 0)
+#undef  PIN_DELAY
+#undef  PIN_DELAY_START
+#define PIN_DELAY() SWD_TIMER_WAIT()
+#define PIN_DELAY_START() SWD_TIMER_START()
+SWD_TransferFunction(Timer);
+#undef  PIN_DELAY_START
+#define PIN_DELAY_START()
+#endif
 
-// SWD Transfer I/O
+#undef  SWD_TURNAROUND
+#undef  SWD_DATA_PHASE
+#undef  SWD_IDLE_CYCLES
+#define SWD_TURNAROUND  1U
+#define SWD_DATA_PHASE  0U
+#define SWD_IDLE_CYCLES 0U
+
+#undef  PIN_DELAY
+#define PIN_DELAY() PIN_DELAY_FAST()
+SWD_TransferFunction(FastDefault);
+
+#undef  PIN_DELAY
+#define PIN_DELAY() PIN_DELAY_SLOW(DAP_Data.clock_delay)
+SWD_TransferFunction(SlowDefault);
+
+#if (DAP_SWD_TIMER != 0)
+#undef  PIN_DELAY
+#undef  PIN_DELAY_START
+#define PIN_DELAY() SWD_TIMER_WAIT()
+#define PIN_DELAY_START() SWD_TIMER_START()
+SWD_TransferFunction(TimerDefault);
+#undef  PIN_DELAY_START
+#define PIN_DELAY_START()
+#endif
+
+#undef  PIN_DELAY
+#define PIN_DELAY() PIN_DELAY_SLOW(DAP_Data.clock_delay)
+
+#undef  SWD_TURNAROUND
+#undef  SWD_DATA_PHASE
+#undef  SWD_IDLE_CYCLES
+#define SWD_TURNAROUND  DAP_Data.swd_conf.turnaround
+#define SWD_DATA_PHASE  DAP_Data.swd_conf.data_phase
+#define SWD_IDLE_CYCLES DAP_Data.transfer.idle_cycles
+
+
+#if (DAP_SWD_SPI != 0)
+
+// SWD Transfer I/O with the SPI peripheral shifting the packet request
+// and the 32 data bits. Turnaround, acknowledge and parity bits are
+// still clocked through the GPIOs at the configured clock delay.
 //   request: A[3:2] RnW APnDP
 //   data:    DATA[31:0]
 //   return:  ACK[2:0]
-uint8_t  SWD_Transfer(uint32_t request, uint32_t *data) {
+#define SWD_TransferSPIFunction(name)   /**/                                    \
+static uint8_t SWD_Transfer##name (uint32_t request, uint32_t *data) {          \
+  uint32_t ack;                                                                 \
+  uint32_t bit;                                                                 \
+  uint32_t val;                                                                 \
+                                                                                \
+  uint32_t n;                                                                   \
+                                                                                \
+  /* Packet Request: Start, APnDP, RnW, A2, A3, Parity, Stop, Park */           \
+  SWD_SPI_WRITE(SWD_RequestHeader[request & 0x0F], 8);                          \
+                                                                                \
+  /* Turnaround */                                                              \
+  PIN_SWDIO_OUT_DISABLE();                                                      \
+  for (n = SWD_TURNAROUND; n; n--) {                                            \
+    SW_CLOCK_CYCLE();                                                           \
+  }                                                                             \
+                                                                                \
+  /* Acknowledge response */                                                    \
+  SW_READ_BIT(bit);                                                             \
+  ack  = bit << 0;                                                              \
+  SW_READ_BIT(bit);                                                             \
+  ack |= bit << 1;                                                              \
+  SW_READ_BIT(bit);                                                             \
+  ack |= bit << 2;                                                              \
+                                                                                \
+  if (ack == DAP_TRANSFER_OK) {         /* OK response */                       \
+    /* Data transfer */                                                         \
+    if (request & DAP_TRANSFER_RnW) {                                           \
+      SWD_TIMESTAMP(request);                                                   \
+      /* Read data */                                                           \
+      val = SWD_SPI_READ(32);           /* Read RDATA[0:31] */                  \
+      SW_READ_BIT(bit);                 /* Read Parity */                       \
+      if ((SWD_Parity(val) ^ bit) & 1) {                                        \
+        ack = DAP_TRANSFER_ERROR;                                               \
+      }                                                                         \
+      if (data) *data = val;                                                    \
+      /* Turnaround */                                                          \
+      for (n = SWD_TURNAROUND; n; n--) {                                        \
+        SW_CLOCK_CYCLE();                                                       \
+      }                                                                         \
+      PIN_SWDIO_OUT_ENABLE();                                                   \
+    } else {                                                                    \
+      /* Turnaround */                                                          \
+      for (n = SWD_TURNAROUND; n; n--) {                                        \
+        SW_CLOCK_CYCLE();                                                       \
+      }                                                                         \
+      PIN_SWDIO_OUT_ENABLE();                                                   \
+      SWD_TIMESTAMP(request);                                                   \
+      /* Write data */                                                          \
+      val = *data;                                                              \
+      SWD_SPI_WRITE(val, 32);           /* Write WDATA[0:31] */                 \
+      SW_WRITE_BIT(SWD_Parity(val));    /* Write Parity Bit */                  \
+    }                                                                           \
+    /* Idle cycles */                                                           \
+    n = SWD_IDLE_CYCLES;                                                        \
+    if (n) {                                                                    \
+      PIN_SWDIO_OUT(0);                                                         \
+      for (; n; n--) {                                                          \
+        SW_CLOCK_CYCLE();                                                       \
+      }                                                                         \
+    }                                                                           \
+    PIN_SWDIO_OUT(1);                                                           \
+    return (ack);                                                               \
+  }                                                                             \
+                                                                                \
+  if ((ack == DAP_TRANSFER_WAIT) || (ack == DAP_TRANSFER_FAULT)) {              \
+    /* WAIT or FAULT response */                                                \
+    if (SWD_DATA_PHASE && ((request & DAP_TRANSFER_RnW) != 0)) {                \
+      for (n = 32+1; n; n--) {                                                  \
+        SW_CLOCK_CYCLE();               /* Dummy Read RDATA[0:31] + Parity */   \
+      }                                                                         \
+    }                                                                           \
+    /* Turnaround */                                                            \
+    for (n = SWD_TURNAROUND; n; n--) {                                          \
+      SW_CLOCK_CYCLE();                                                         \
+    }                                                                           \
+    PIN_SWDIO_OUT_ENABLE();                                                     \
+    if (SWD_DATA_PHASE && ((request & DAP_TRANSFER_RnW) == 0)) {                \
+      PIN_SWDIO_OUT(0);                                                         \
+      for (n = 32+1; n; n--) {                                                  \
+        SW_CLOCK_CYCLE();               /* Dummy Write WDATA[0:31] + Parity */  \
+      }                                                                         \
+    }                                                                           \
+    PIN_SWDIO_OUT(1);                                                           \
+    return (ack);                                                               \
+  }                                                                             \
+                                                                                \
+  /* Protocol error */                                                          \
+  for (n = SWD_TURNAROUND + 32 + 1; n; n--) {                                   \
+    SW_CLOCK_CYCLE();                   /* Back off data phase */               \
+  }                                                                             \
+  PIN_SWDIO_OUT_ENABLE();                                                       \
+  PIN_SWDIO_OUT(1);                                                             \
+  return (ack);                                                                 \
+}
+
+SWD_TransferSPIFunction(SPI);
+
+#undef  SWD_TURNAROUND
+#undef  SWD_DATA_PHASE
+#undef  SWD_IDLE_CYCLES
+#define SWD_TURNAROUND  1U
+#define SWD_DATA_PHASE  0U
+#define SWD_IDLE_CYCLES 0U
+
+SWD_TransferSPIFunction(SPIDefault);
+
+#undef  SWD_TURNAROUND
+#undef  SWD_DATA_PHASE
+#undef  SWD_IDLE_CYCLES
+#define SWD_TURNAROUND  DAP_Data.swd_conf.turnaround
+#define SWD_DATA_PHASE  DAP_Data.swd_conf.data_phase
+#define SWD_IDLE_CYCLES DAP_Data.transfer.idle_cycles
+
+#endif  /* (DAP_SWD_SPI != 0) */
+
+
+// Transfer function for the current clock and transfer configuration
+static uint8_t (*SWD_TransferKernel)(uint32_t request, uint32_t *data) = SWD_TransferSlow;
+
+
+// Select the transfer function; called whenever the SWJ clock, the SWD
+// configuration or the transfer configuration changes
+void SWD_TransferSelect (void) {
+  uint32_t common = SWD_CONFIG_DEFAULT();
+
+#if (DAP_SWD_TIMER != 0)
+  if (DAP_Data.timer_clock) {
+    SWD_TransferKernel = common ? SWD_TransferTimerDefault : SWD_TransferTimer;
+  } else
+#endif
+#if (DAP_SWD_SPI != 0)
+  if (DAP_Data.spi_clock) {
+    SWD_TransferKernel = common ? SWD_TransferSPIDefault : SWD_TransferSPI;
+  } else
+#endif
   if (DAP_Data.fast_clock) {
-    return SWD_TransferFast(request, data);
+    SWD_TransferKernel = common ? SWD_TransferFastDefault : SWD_TransferFast;
   } else {
-    return SWD_TransferSlow(request, data);
+    SWD_TransferKernel = common ? SWD_TransferSlowDefault : SWD_TransferSlow;
   }
 }
 
 
+#if (DAP_SWD_CACHE != 0)
+
+// MEM-AP registers in bank 0
+#define AP_CSW                  0x00
+#define AP_TAR                  0x04
+#define AP_DRW                  0x0C
+
+// AP IDR in bank 0xF; class 0x8 is a MEM-AP
+#define AP_IDR                  0x0C
+#define AP_IDR_BANK             0xF0
+#define IDR_CLASS_MASK          0x0001E000
+#define IDR_CLASS_MEM_AP        0x00010000
+
+#define CSW_SIZE_MASK           0x07
+#define CSW_SIZE_32             0x02
+#define CSW_ADDRINC_MASK        0x30
+#define CSW_ADDRINC_SINGLE      0x10
+
+#define SWD_CACHE_AP            (SWD_CACHE_CSW | SWD_CACHE_TAR)
+
+// CSW and TAR are only cached in bank 0 of an AP known to be a MEM-AP;
+// other AP classes may have command registers at the same addresses
+#define SWD_CACHE_MEM_AP(select) \
+  ((((select) & 0xE00000F0) == 0) && \
+   (DAP_Data.swd_cache.mem_ap & (1U << ((select) >> 24))))
+
+// Forget all cached register values
+void SWD_CacheInvalidate (void) {
+  DAP_Data.swd_cache.valid       = 0;
+  DAP_Data.swd_cache.idr_pending = 0;
+}
+
+
+// Forget what is known about the APs as well, for a new target. AP 0
+// is taken to be a MEM-AP until its IDR reads otherwise, as the probe's
+// own memory accesses do.
+void SWD_CacheForgetTarget (void) {
+  SWD_CacheInvalidate();
+  DAP_Data.swd_cache.mem_ap = 1U;
+}
+
+
+// Record the class of an AP from its IDR
+static void SWD_CacheIdentify (uint32_t apsel, uint32_t idr) {
+  if ((idr & IDR_CLASS_MASK) == IDR_CLASS_MEM_AP) {
+    DAP_Data.swd_cache.mem_ap |=  (1U << apsel);
+  } else {
+    DAP_Data.swd_cache.mem_ap &= ~(1U << apsel);
+    if ((DAP_Data.swd_conf.select >> 24) == apsel) {
+      DAP_Data.swd_cache.valid &= ~SWD_CACHE_AP;
+    }
+  }
+}
+
+
+// Check whether a register write can be skipped because the register
+// is known to hold the value already
+//   request: A[3:2] RnW APnDP
+//   data:    value to write
+//   return:  1 = skip the write, 0 = send it
+uint32_t SWD_CacheHit (uint32_t request, uint32_t data) {
+  uint32_t hit;
+
+  if (!DAP_Data.swd_cache.enable) {
+    return (0);
+  }
+
+  switch (request & (DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW | 0x0C)) {
+    case DP_SELECT:
+      hit = (DAP_Data.swd_cache.valid & SWD_CACHE_SELECT) &&
+            (data == DAP_Data.swd_conf.select);
+      break;
+    case DAP_TRANSFER_APnDP | AP_CSW:
+      hit = SWD_CACHE_MEM_AP(DAP_Data.swd_conf.select) &&
+            (DAP_Data.swd_cache.valid & SWD_CACHE_CSW) &&
+            (data == DAP_Data.swd_cache.csw);
+      break;
+    case DAP_TRANSFER_APnDP | AP_TAR:
+      hit = SWD_CACHE_MEM_AP(DAP_Data.swd_conf.select) &&
+            (DAP_Data.swd_cache.valid & SWD_CACHE_TAR) &&
+            (data == DAP_Data.swd_cache.tar);
+      break;
+    default:
+      hit = 0;
+      break;
+  }
+
+  if (hit) {
+    DAP_Data.swd_cache.skipped++;
+  }
+  return (hit);
+}
+
+
+// Follow a completed transfer in the register cache. CSW and TAR are
+// only kept for the AP that SELECT points to; they are only valid
+// while SELECT is.
+static void SWD_CacheUpdate (uint32_t request, uint8_t ack, uint32_t *data) {
+  uint32_t select;
+  uint32_t value;
+  uint32_t tar;
+
+  if (ack != DAP_TRANSFER_OK) {
+    if (ack != DAP_TRANSFER_WAIT) {
+      // FAULT or protocol error: the AP may have been left in any state
+      SWD_CacheInvalidate();
+    }
+    return;
+  }
+
+  select = DAP_Data.swd_conf.select;
+  value  = (data != NULL) ? *data : 0;
+
+  // AP reads are posted: an AP or RDBUFF read returns the previous one
+  if ((request & DAP_TRANSFER_RnW) &&
+      ((request & DAP_TRANSFER_APnDP) || ((request & 0x0C) == DP_RDBUFF))) {
+    if (DAP_Data.swd_cache.idr_pending && (data != NULL)) {
+      SWD_CacheIdentify(DAP_Data.swd_cache.idr_pending - 1U, value);
+    }
+    DAP_Data.swd_cache.idr_pending = 0;
+    if ((request & DAP_TRANSFER_APnDP) && ((request & 0x0C) == AP_IDR) &&
+        ((select & 0xE00000F0) == AP_IDR_BANK)) {
+      DAP_Data.swd_cache.idr_pending = (uint8_t)((select >> 24) + 1U);
+    }
+  } else if (request & DAP_TRANSFER_APnDP) {
+    DAP_Data.swd_cache.idr_pending = 0;
+  }
+
+  if (!(request & DAP_TRANSFER_APnDP)) {
+    if (request & DAP_TRANSFER_RnW) {
+      return;
+    }
+    switch (request & 0x0C) {
+      case DP_SELECT:
+        // select still holds the previous value here
+        if (!(DAP_Data.swd_cache.valid & SWD_CACHE_SELECT) ||
+            ((value ^ select) & 0xFF000000)) {
+          DAP_Data.swd_cache.valid = 0;
+        }
+        DAP_Data.swd_cache.valid |= SWD_CACHE_SELECT;
+        break;
+      case DP_ABORT:
+      case DP_CTRL_STAT:
+        // Aborted transfers and debug power-down can change the AP
+        DAP_Data.swd_cache.valid &= ~SWD_CACHE_AP;
+        break;
+    }
+    return;
+  }
+
+  if (!SWD_CACHE_MEM_AP(select)) {
+    return;
+  }
+  switch (request & (DAP_TRANSFER_RnW | 0x0C)) {
+    case AP_CSW:
+      DAP_Data.swd_cache.csw    = value;
+      DAP_Data.swd_cache.valid |= SWD_CACHE_CSW;
+      break;
+    case AP_TAR:
+      DAP_Data.swd_cache.tar    = value;
+      DAP_Data.swd_cache.valid |= SWD_CACHE_TAR;
+      break;
+    case DAP_TRANSFER_RnW | AP_CSW:
+    case DAP_TRANSFER_RnW | AP_TAR:
+      // The debugger reads back what the target may have changed
+      // (e.g. self-clearing bits of a vendor AP): send the next write
+      DAP_Data.swd_cache.valid &= ~((request & 0x04) ? SWD_CACHE_TAR : SWD_CACHE_CSW);
+      break;
+    case AP_DRW:
+    case DAP_TRANSFER_RnW | AP_DRW:
+      // Follow TAR through word accesses with single auto-increment
+      // within a 1KB block; anything else is not worth predicting
+      if ((DAP_Data.swd_cache.valid & SWD_CACHE_CSW) &&
+          ((DAP_Data.swd_cache.csw & CSW_ADDRINC_MASK) == 0)) {
+        break;
+      }
+      tar = DAP_Data.swd_cache.tar + 4;
+      if ((DAP_Data.swd_cache.valid & SWD_CACHE_CSW) &&
+          ((DAP_Data.swd_cache.csw & (CSW_ADDRINC_MASK | CSW_SIZE_MASK)) ==
+           (CSW_ADDRINC_SINGLE | CSW_SIZE_32)) &&
+          ((tar & 0x3FF) != 0)) {
+        DAP_Data.swd_cache.tar = tar;
+      } else {
+        DAP_Data.swd_cache.valid &= ~SWD_CACHE_TAR;
+      }
+      break;
+  }
+}
+
+#endif  /* (DAP_SWD_CACHE != 0) */
+
+
+// SWD Transfer I/O
+//   request: A[3:2] RnW APnDP
+//   data:    DATA[31:0]
+//   return:  ACK[2:0]
+uint8_t  SWD_Transfer(uint32_t request, uint32_t *data) {
+  uint8_t ack;
+
+  ack = SWD_TransferKernel(request, data);
+
+  DAP_AtomicYield();
+  dap_stats_ack(ack);
+
+#if (DAP_SWD_CACHE != 0)
+  SWD_CacheUpdate(request, ack, data);
+#endif
+
+  /* SELECT is write-only; remember it so that on-probe memory accesses
+     can put it back after using the MEM-AP (see mem_ap.c) */
+  if ((ack == DAP_TRANSFER_OK) &&
+      ((request & (DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW | 0x0C)) == DP_SELECT)) {
+    DAP_Data.swd_conf.select = *data;
+  }
+
+  /* After a line reset the DPIDR read has to come first; on-probe
+     memory accesses wait for the host to make it (see mem_ap.c) */
+  if ((ack == DAP_TRANSFER_OK) &&
+      ((request & (DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW | 0x0C)) ==
+       (DP_IDCODE | DAP_TRANSFER_RnW))) {
+    DAP_Data.swd_conf.dpidr_pending = 0;
+  }
+
+  /* The CTRL/STAT written last (power-up requests) is kept per target
+     when switching between multi-drop targets (see multidrop.c) */
+  if ((ack == DAP_TRANSFER_OK) && ((DAP_Data.swd_conf.select & 0x0F) == 0) &&
+      ((request & (DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW | 0x0C)) == DP_CTRL_STAT)) {
+    DAP_Data.swd_conf.ctrl_stat = *data;
+  }
+
+  return (ack);
+}
+
+
 #endif  /* (DAP_SWD != 0) */
@@ -22,36 +22,315 @@
 #include "DAP/CMSIS_DAP_config.h"
 #include "DAP/CMSIS_DAP.h"
 
+#include "USB/composite_usb_conf.h"
 #include "USB/hid.h"
+#include "USB/bulk.h"
 #include "DAP/app.h"
+#include "DAP/rtt.h"
+#include "DAP/stats.h"
+#include "DAP/tune.h"
+#include "DAP/block.h"
+#include "DAP/flash.h"
+#include "DAP/crc.h"
+#include "DAP/multidrop.h"
+#include "DAP/capture.h"
 
-static uint8_t request_buffers[DAP_PACKET_SIZE][DAP_PACKET_QUEUE_SIZE];
-static uint8_t response_buffers[DAP_PACKET_SIZE][DAP_PACKET_QUEUE_SIZE];
+#include "config.h"
+#include "tick.h"
 
-static uint8_t inbox_tail;
-static uint8_t process_head;
-static uint8_t outbox_head;
+/* Responses go back over the transport that the request came in on */
+enum {
+    DAP_TRANSPORT_HID,
+    DAP_TRANSPORT_BULK,
+};
+
+/* Each OUT endpoint may have one packet latched before a NAK takes
+   effect, so receiving is paused while that many slots are still free */
+#if DAP_BULK_AVAILABLE
+#define DAP_RX_RESERVE 2
+#else
+#define DAP_RX_RESERVE 1
+#endif
+
+#if (DAP_PACKET_QUEUE_SIZE <= DAP_PACKET_COUNT + DAP_RX_RESERVE)
+#error "DAP_PACKET_QUEUE_SIZE is too small for DAP_PACKET_COUNT"
+#endif
+
+/* Ring of request/response slot pairs. The USB OUT callbacks read
+   requests straight into the slot at inbox_tail and responses are
+   written straight from the slot at outbox_head:
+
+     [outbox_head, process_head)  executed, response not sent yet
+     [process_head, inbox_tail)   received, not executed yet
+
+   inbox_tail is only advanced from the USB interrupt and process_head
+   only by the main loop; outbox_head is advanced by both, so the main
+   loop masks the USB interrupt while sending.
+
+   The buffers and lengths are plain memory, so the compiler is free to
+   move their accesses across the volatile indices; DAP_APP_BARRIER()
+   keeps a slot's contents on the right side of the index that hands it
+   over. The interrupt runs on the same core, so no DMB is needed. */
+#define DAP_APP_BARRIER() __asm__ volatile ("" ::: "memory")
+
+static uint8_t request_buffers[DAP_PACKET_QUEUE_SIZE][DAP_PACKET_SIZE];
+static uint8_t response_buffers[DAP_PACKET_QUEUE_SIZE][DAP_PACKET_SIZE];
+static uint8_t request_transports[DAP_PACKET_QUEUE_SIZE];
+static uint16_t response_lengths[DAP_PACKET_QUEUE_SIZE];
+
+static volatile uint8_t inbox_tail;
+static volatile uint8_t process_head;
+static volatile uint8_t outbox_head;
+static volatile bool receive_paused;
+
+/* A response that continues in further packets: the packet in
+   chain_slot is refilled in place each time it has gone out, and
+   outbox_head only moves on once the last packet is sent */
+static DAP_app_chain_function chain_function;
+static uint8_t chain_slot;
+static volatile bool chain_refill;
+static bool chain_allowed;
 
 static GenericCallback dfu_request_callback = NULL;
 
-static void on_receive_report(uint8_t* data, uint16_t len) {
-    memcpy((void*)request_buffers[inbox_tail], (const void*)data, len);
+#if (SWO_STREAM != 0)
+/* Trace data waiting for the streaming endpoint to accept it */
+static uint8_t trace_packet[DAP_PACKET_SIZE];
+static uint16_t trace_packet_len;
+#endif
+
+/* Slots that can still receive a request; one always stays empty */
+static uint8_t DAP_app_free_slots(void) {
+    return (outbox_head + DAP_PACKET_QUEUE_SIZE - inbox_tail - 1)
+           % DAP_PACKET_QUEUE_SIZE;
+}
+
+static void DAP_app_pause_receive(bool pause) {
+    receive_paused = pause;
+    hid_pause_receive(pause);
+#if DAP_BULK_AVAILABLE
+    bulk_pause_receive(pause);
+#endif
+}
+
+static uint8_t* DAP_app_receive_buffer(void) {
+    uint8_t free_slots = DAP_app_free_slots();
+
+    if (free_slots == 0) {
+        return NULL;
+    }
+
+    /* NAK the host before reading in the packet that fills the ring */
+    if (free_slots <= DAP_RX_RESERVE && !receive_paused) {
+        DAP_app_pause_receive(true);
+    }
+
+    return request_buffers[inbox_tail];
+}
+
+static void DAP_app_receive(uint16_t len, uint8_t transport) {
+    /* Short bulk packets must not leave a stale tail behind */
+    if (len < DAP_PACKET_SIZE) {
+        memset(&request_buffers[inbox_tail][len], 0, DAP_PACKET_SIZE - len);
+    }
+    request_transports[inbox_tail] = transport;
     inbox_tail = (inbox_tail + 1) % DAP_PACKET_QUEUE_SIZE;
+    dap_stats_queue_depth((uint8_t)(DAP_PACKET_QUEUE_SIZE - 1
+                                    - DAP_app_free_slots()));
 }
 
-static void on_send_report(uint8_t* data, uint16_t* len) {
-    if (outbox_head != process_head) {
-        memcpy((void*)data, (const void*)response_buffers[outbox_head],
-               DAP_PACKET_SIZE);
-        *len = DAP_PACKET_SIZE;
+/* Send the oldest unsent response, if its endpoint is free */
+static bool DAP_app_send(void) {
+    const uint8_t* response = response_buffers[outbox_head];
+    bool sent;
 
+    if (outbox_head == process_head || chain_refill) {
+        return false;
+    }
+
+#if DAP_BULK_AVAILABLE
+    if (request_transports[outbox_head] == DAP_TRANSPORT_BULK) {
+        sent = bulk_send_packet(response, response_lengths[outbox_head]);
+    } else
+#endif
+    {
+        sent = hid_send_report(response, DAP_PACKET_SIZE);
+    }
+
+    if (sent && chain_function && outbox_head == chain_slot) {
+        chain_refill = true;
+    } else if (sent) {
         outbox_head = (outbox_head + 1) % DAP_PACKET_QUEUE_SIZE;
+        if (receive_paused && DAP_app_free_slots() > DAP_RX_RESERVE) {
+            DAP_app_pause_receive(false);
+        }
     } else {
-        *len = 0;
+        dap_stats_in_busy();
+    }
+
+    return sent;
+}
+
+static void on_receive_report(uint8_t* data, uint16_t len) {
+    (void)data;
+    DAP_app_receive(len, DAP_TRANSPORT_HID);
+}
+
+#if DAP_BULK_AVAILABLE
+static void on_receive_bulk(uint8_t* data, uint16_t len) {
+    (void)data;
+    DAP_app_receive(len, DAP_TRANSPORT_BULK);
+}
+#endif
+
+/* An IN endpoint became free */
+static void on_packet_sent(void) {
+    DAP_app_send();
+}
+
+#if RTT_AVAILABLE
+/* RTT and the capture share the byte stream */
+static bool DAP_app_capture_running(void) {
+#if DAP_CAPTURE_AVAILABLE
+    return capture_running();
+#else
+    return false;
+#endif
+}
+
+/* Vendor command to start/stop the on-probe RTT engine:
+   request:  ID, enable, search address (4 bytes), search size (4 bytes)
+   response: ID, status, RTT state, control block address (4 bytes) */
+static uint32_t DAP_app_rtt_command(uint8_t* request, uint8_t* response) {
+    uint32_t address = ((uint32_t)request[2] <<  0)
+                     | ((uint32_t)request[3] <<  8)
+                     | ((uint32_t)request[4] << 16)
+                     | ((uint32_t)request[5] << 24);
+    uint32_t size = ((uint32_t)request[6] <<  0)
+                  | ((uint32_t)request[7] <<  8)
+                  | ((uint32_t)request[8] << 16)
+                  | ((uint32_t)request[9] << 24);
+    uint32_t control_block;
+
+    response[0] = request[0];
+    response[1] = DAP_OK;
+    if (request[1] == 0) {
+        rtt_stop();
+    } else if (size == 0) {
+        /* Just report the state */
+    } else if (DAP_app_capture_running()) {
+        response[1] = DAP_ERROR;
+    } else if (rtt_state() == RTT_STATE_STOPPED
+               || rtt_control_block() == 0) {
+        rtt_start(address, size);
+    }
+
+    control_block = rtt_control_block();
+    response[2] = rtt_state();
+    response[3] = (uint8_t)(control_block >>  0);
+    response[4] = (uint8_t)(control_block >>  8);
+    response[5] = (uint8_t)(control_block >> 16);
+    response[6] = (uint8_t)(control_block >> 24);
+
+    return ((10 << 16) | 7);
+}
+#endif
+
+#if DAP_CAPTURE_AVAILABLE
+/* Vendor command to start/stop logging the DAP traffic (see capture.h):
+   request:  ID, mode
+   response: ID, status, capture running, records lost (4 bytes)
+   Starting fails while RTT has the byte stream. */
+static uint32_t DAP_app_capture_command(uint8_t* request, uint8_t* response) {
+    uint32_t lost;
+
+    response[0] = request[0];
+    response[1] = DAP_OK;
+    if (request[1] == CAPTURE_MODE_STOP) {
+        capture_stop();
+    } else if (request[1] == CAPTURE_MODE_START) {
+#if RTT_AVAILABLE
+        if (rtt_state() != RTT_STATE_STOPPED) {
+            response[1] = DAP_ERROR;
+        } else
+#endif
+        {
+            capture_start();
+        }
+    } else if (request[1] != CAPTURE_MODE_QUERY) {
+        response[1] = DAP_ERROR;
     }
+
+    lost = capture_lost();
+    response[2] = capture_running() ? 1 : 0;
+    response[3] = (uint8_t)(lost >>  0);
+    response[4] = (uint8_t)(lost >>  8);
+    response[5] = (uint8_t)(lost >> 16);
+    response[6] = (uint8_t)(lost >> 24);
+
+    return ((2 << 16) | 7);
 }
+#endif
 
 uint32_t DAP_ProcessVendorCommand(uint8_t* request, uint8_t* response) {
+#if RTT_AVAILABLE
+    if (request[0] == ID_DAP_Vendor1) {
+        return DAP_app_rtt_command(request, response);
+    }
+#endif
+
+#if DAP_STATS_AVAILABLE
+    if (request[0] == ID_DAP_Vendor2) {
+        return dap_stats_report(request, response);
+    }
+#endif
+
+    if (request[0] == ID_DAP_Vendor3) {
+        return SWJ_ClockInfo(request, response);
+    }
+
+#if DAP_CLOCK_TUNE_AVAILABLE
+    if (request[0] == ID_DAP_Vendor4) {
+        return dap_tune_clock(request, response);
+    }
+#endif
+
+#if DAP_BLOCK_READ_AVAILABLE
+    if (request[0] == ID_DAP_Vendor5) {
+        return dap_block_read(request, response);
+    }
+#endif
+
+#if DAP_FLASH_AVAILABLE
+    if (request[0] == ID_DAP_Vendor6) {
+        return dap_flash_command(request, response);
+    }
+#endif
+
+#if DAP_CRC_AVAILABLE
+    if (request[0] == ID_DAP_Vendor7) {
+        return dap_crc_command(request, response);
+    }
+#endif
+
+#if DAP_MULTIDROP_AVAILABLE
+    if (request[0] == ID_DAP_Vendor8) {
+        return dap_multidrop_command(request, response);
+    }
+#endif
+
+#if (DAP_SWD_CACHE != 0)
+    if (request[0] == ID_DAP_Vendor9) {
+        return SWD_CacheControl(request, response);
+    }
+#endif
+
+#if DAP_CAPTURE_AVAILABLE
+    if (request[0] == ID_DAP_Vendor10) {
+        return DAP_app_capture_command(request, response);
+    }
+#endif
+
     if (request[0] == ID_DAP_Vendor31) {
         if (request[1] == 'D' && request[2] == 'F' && request[3] == 'U') {
             response[0] = request[0];
@@ -62,41 +341,144 @@ uint32_t DAP_ProcessVendorCommand(uint8_t* request, uint8_t* response) {
             } else {
                 response[1] = DAP_ERROR;
             }
-            return 2;
+            return ((4 << 16) | 2);
         } else {
             response[0] = request[0];
             response[1] = DAP_ERROR;
-            return 2;
+            return ((4 << 16) | 2);
         }
     }
 
     response[0] = ID_DAP_Invalid;
-    return 1;
+    return ((1 << 16) | 1);
+}
+
+/* Queued commands are held back until a packet that isn't a
+   QueueCommands packet arrives, then run as ExecuteCommands. If the
+   ring fills up with queued packets, they run anyway, since nothing
+   more can arrive until they do. */
+static bool DAP_app_request_ready(void) {
+    uint8_t index = process_head;
+
+    if (chain_function) {
+        return false;
+    }
+
+    while (index != inbox_tail) {
+        /* The request was written before inbox_tail moved past it */
+        DAP_APP_BARRIER();
+        if (request_buffers[index][0] != ID_DAP_QueueCommands) {
+            return true;
+        }
+        index = (index + 1) % DAP_PACKET_QUEUE_SIZE;
+    }
+
+    return receive_paused && (process_head != inbox_tail);
 }
 
 bool DAP_app_update(void) {
     bool active = false;
 
-    if (process_head != inbox_tail) {
+    if (DAP_app_request_ready()) {
+        uint8_t* request = request_buffers[process_head];
+        uint32_t lengths;
+#if DAP_CAPTURE_AVAILABLE
+        uint8_t command = request[0];
+        /* The clock is only read while there is something to log */
+        bool capture = capture_running();
+        uint32_t start = capture ? get_micros() : 0;
+#endif
+        if (request[0] == ID_DAP_QueueCommands) {
+            request[0] = ID_DAP_ExecuteCommands;
+        }
         memset(response_buffers[process_head], 0, DAP_PACKET_SIZE);
-        DAP_ProcessCommand(request_buffers[process_head],
-                           response_buffers[process_head]);
+        /* Commands batched in one packet share its response */
+        chain_allowed = (request[0] != ID_DAP_ExecuteCommands);
+        /* Before the command can register a chain function, since the
+           USB interrupt may look for the chain's slot right away */
+        chain_slot = process_head;
+        lengths = DAP_ExecuteCommand(request, response_buffers[process_head]);
+        response_lengths[process_head] = (uint16_t)lengths;
+        chain_allowed = false;
+#if DAP_CAPTURE_AVAILABLE
+        /* Logged as received, so that a replay queues it the same way */
+        request[0] = command;
+        if (capture && command != ID_DAP_Vendor10) {
+            uint16_t request_len = (uint16_t)(lengths >> 16);
+            capture_record(0, start, get_micros() - start, request,
+                           (request_len < DAP_PACKET_SIZE) ? request_len
+                                                           : DAP_PACKET_SIZE,
+                           response_buffers[process_head],
+                           response_lengths[process_head]);
+        }
+#endif
+        /* The response and its length go out once process_head moves */
+        DAP_APP_BARRIER();
         process_head = (process_head + 1) % DAP_PACKET_QUEUE_SIZE;
         active = true;
+    } else if (chain_refill) {
+#if DAP_CAPTURE_AVAILABLE
+        bool capture = capture_running();
+        uint32_t start = capture ? get_micros() : 0;
+#endif
+        /* The slot is free again once its packet has been sent */
+        memset(response_buffers[chain_slot], 0, DAP_PACKET_SIZE);
+        response_lengths[chain_slot] = chain_function(response_buffers[chain_slot]);
+        DAP_APP_BARRIER();
+        chain_refill = false;
+#if DAP_CAPTURE_AVAILABLE
+        if (capture) {
+            capture_record(CAPTURE_CHAINED, start, get_micros() - start,
+                           NULL, 0, response_buffers[chain_slot],
+                           response_lengths[chain_slot]);
+        }
+#endif
+        active = true;
     }
 
+    /* Responses left unsent, and a chain waiting for its previous
+       packet to go out, are taken care of by the IN interrupt */
+    cmp_usb_disable_interrupts();
     if (outbox_head != process_head) {
-        if (hid_send_report(response_buffers[outbox_head], DAP_PACKET_SIZE)) {
-            outbox_head = (outbox_head + 1) % DAP_PACKET_QUEUE_SIZE;
+        DAP_app_send();
+    }
+
+#if (SWO_STREAM != 0)
+    if (trace_packet_len == 0) {
+        trace_packet_len = (uint16_t)SWO_Stream(trace_packet,
+                                                sizeof(trace_packet));
+    }
+
+    if (trace_packet_len != 0) {
+        if (bulk_send_trace(trace_packet, trace_packet_len)) {
+            trace_packet_len = 0;
+            active = true;
         }
-        active = true;
     }
+#endif
+    cmp_usb_enable_interrupts();
 
     return active;
 }
 
+bool DAP_app_chaining(void) {
+    return chain_function != NULL;
+}
+
+bool DAP_app_chain_response(DAP_app_chain_function next) {
+    if (next && !chain_allowed) {
+        return false;
+    }
+
+    chain_function = next;
+    return true;
+}
+
 void DAP_app_setup(usbd_device* usbd_dev, GenericCallback on_dfu_request) {
     DAP_Setup();
-    hid_setup(usbd_dev, &on_send_report, &on_receive_report);
+    hid_setup(usbd_dev, &on_packet_sent, &DAP_app_receive_buffer, &on_receive_report);
+#if DAP_BULK_AVAILABLE
+    bulk_setup(usbd_dev, &on_packet_sent, &DAP_app_receive_buffer, &on_receive_bulk);
+#endif
     dfu_request_callback = on_dfu_request;
 }
@@ -21,9 +21,24 @@
 
 #include <libopencm3/usb/usbd.h>
 
+/* Runs the next request, if any; returns true if there may be more
+   to do right away rather than after the next USB event */
 extern bool DAP_app_update(void);
 
 typedef void (*GenericCallback)(void);
 extern void DAP_app_setup(usbd_device* usbd_dev, GenericCallback on_dfu_request);
 
+/* A command whose response doesn't fit in one packet registers a
+   function that writes the next packet of it. Each time the previous
+   packet has gone out, the function is called again into the same
+   response slot and returns the packet length; it passes NULL here
+   along with the last packet. No other request runs in between.
+   Chaining is refused inside ExecuteCommands batches. */
+typedef uint16_t (*DAP_app_chain_function)(uint8_t* response);
+extern bool DAP_app_chain_response(DAP_app_chain_function next);
+
+/* True until the last packet of a chained response is written; the
+   SWD port must be left alone until then */
+extern bool DAP_app_chaining(void);
+
 #endif
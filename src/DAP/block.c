@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "DAP/CMSIS_DAP_config.h"
+#include "DAP/CMSIS_DAP.h"
+#include "DAP/app.h"
+#include "DAP/mem_ap.h"
+#include "DAP/block.h"
+
+#if DAP_BLOCK_READ_AVAILABLE && (DAP_SWD != 0)
+
+#define BLOCK_HEADER_SIZE       4U
+#define BLOCK_MAX_WORDS         ((DAP_PACKET_SIZE - BLOCK_HEADER_SIZE) / 4U)
+
+/* Words still to be sent in the chain of responses */
+static uint32_t remaining;
+
+/* Where TAR was left by the last DAP_BLOCK_HOST_AP read */
+static uint32_t next_address;
+static bool next_valid;
+static bool host_ap;
+
+/* Write the next response of the read, ending the read and the chain
+   with the last one */
+static uint16_t block_next(uint8_t* response) {
+    uint32_t words[BLOCK_MAX_WORDS];
+    uint32_t count = (remaining < BLOCK_MAX_WORDS) ? remaining : BLOCK_MAX_WORDS;
+    uint32_t read = mem_ap_stream_read(words, count);
+    bool ok = (read == count);
+    uint8_t* data = &response[BLOCK_HEADER_SIZE];
+    uint32_t header;
+    uint32_t i;
+
+    remaining = ok ? (remaining - count) : 0;
+    if (remaining == 0) {
+        ok = mem_ap_end() && ok;
+        next_valid = host_ap && ok;
+        DAP_app_chain_response(NULL);
+    }
+
+    for (i = 0; i < read; i++) {
+        *data++ = (uint8_t)(words[i] >>  0);
+        *data++ = (uint8_t)(words[i] >>  8);
+        *data++ = (uint8_t)(words[i] >> 16);
+        *data++ = (uint8_t)(words[i] >> 24);
+    }
+
+    header = read | ((remaining > 0) ? DAP_BLOCK_MORE : 0);
+    response[0] = ID_DAP_Vendor5;
+    response[1] = ok ? DAP_OK : DAP_ERROR;
+    response[2] = (uint8_t)(header >> 0);
+    response[3] = (uint8_t)(header >> 8);
+
+    return (uint16_t)(BLOCK_HEADER_SIZE + 4 * read);
+}
+
+uint32_t dap_block_read(uint8_t* request, uint8_t* response) {
+    uint8_t flags = request[1];
+    uint32_t address = ((uint32_t)request[2] <<  0)
+                     | ((uint32_t)request[3] <<  8)
+                     | ((uint32_t)request[4] << 16)
+                     | ((uint32_t)request[5] << 24);
+    uint32_t count = ((uint32_t)request[6] << 0)
+                   | ((uint32_t)request[7] << 8);
+    bool write_tar = !(flags & DAP_BLOCK_CONTINUE) || !next_valid
+                  || (address != next_address);
+    bool ok;
+
+    host_ap = (flags & DAP_BLOCK_HOST_AP) != 0;
+    next_address = address + 4 * count;
+    next_valid = false;
+
+    ok = (address & 0x3U) == 0 && count < DAP_BLOCK_MORE
+      && (count <= BLOCK_MAX_WORDS || DAP_app_chain_response(&block_next));
+    if (ok && !(host_ap ? mem_ap_begin_host() : mem_ap_begin())) {
+        DAP_app_chain_response(NULL);
+        ok = false;
+    }
+
+    if (!ok) {
+        response[0] = request[0];
+        response[1] = DAP_ERROR;
+        response[2] = 0;
+        response[3] = 0;
+        return ((8 << 16) | BLOCK_HEADER_SIZE);
+    }
+
+    remaining = count;
+    if (!mem_ap_stream_begin(address, count, !host_ap || write_tar)) {
+        remaining = 0;
+    }
+
+    return ((8 << 16) | block_next(response));
+}
+
+#endif
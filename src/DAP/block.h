@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef BLOCK_H_INCLUDED
+#define BLOCK_H_INCLUDED
+
+#include <stdint.h>
+
+#include "config.h"
+
+/*
+ * Vendor command 0x85: read target memory by address. Unlike
+ * DAP_TransferBlock, the probe writes TAR itself, again at every 1KB
+ * boundary where auto-increment stops, and keeps the DRW reads posted
+ * back to back across those writes, reading RDBUFF only once at the
+ * end. A read larger than one packet is answered with a chain of
+ * responses, each with the same header; all but the last have
+ * DAP_BLOCK_MORE set in the word count. The whole read is one request,
+ * and the DRW reads stay posted from one response to the next.
+ *
+ * By default the host's SELECT, CSW and TAR are saved and restored
+ * around each read. A host that owns the AP setup can skip that:
+ * with DAP_BLOCK_HOST_AP, SELECT and CSW must already be set up for
+ * 32-bit auto-incrementing accesses to AP 0, and with DAP_BLOCK_CONTINUE
+ * as well, TAR is not written again if the read starts where the
+ * previous one ended.
+ */
+
+#if DAP_BLOCK_READ_AVAILABLE
+
+#define DAP_BLOCK_HOST_AP       0x01U
+#define DAP_BLOCK_CONTINUE      0x02U
+
+/* Set in the word count of every response but the last of a chain */
+#define DAP_BLOCK_MORE          0x8000U
+
+/* request:  ID, flags, address (4 bytes), word count (2 bytes)
+   response: ID, status, words in this response (2 bytes),
+             data (4 bytes per word)
+   Reads that don't fit in one response are refused inside an
+   ExecuteCommands batch. After a failure the chain ends early, with
+   an error status and the words read up to the failure. */
+extern uint32_t dap_block_read(uint8_t* request, uint8_t* response);
+
+#endif
+
+#endif
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "DAP/capture.h"
+
+#include "config.h"
+
+#if DAP_CAPTURE_AVAILABLE
+
+#if (DAP_CAPTURE_BUFFER_SIZE & (DAP_CAPTURE_BUFFER_SIZE - 1)) != 0
+#error "DAP_CAPTURE_BUFFER_SIZE must be a power of two"
+#endif
+
+#define CAPTURE_MASK            (DAP_CAPTURE_BUFFER_SIZE - 1U)
+
+static CaptureSendFunction capture_send_callback = NULL;
+
+/* Logged bytes are [head, tail); the indices run freely and are masked
+   on access. Records are only written and drained from the main loop. */
+static uint8_t ring[DAP_CAPTURE_BUFFER_SIZE];
+static uint32_t head;
+static uint32_t tail;
+
+static bool running;
+static bool lost_pending;
+static uint32_t lost;
+
+void capture_setup(CaptureSendFunction send_cb) {
+    capture_send_callback = send_cb;
+    running = false;
+}
+
+void capture_start(void) {
+    head = 0;
+    tail = 0;
+    lost = 0;
+    lost_pending = false;
+    running = true;
+}
+
+void capture_stop(void) {
+    running = false;
+}
+
+bool capture_running(void) {
+    return running;
+}
+
+uint32_t capture_lost(void) {
+    return lost;
+}
+
+static void capture_put(const uint8_t* data, uint16_t len) {
+    uint16_t i;
+
+    for (i = 0; i < len; i++) {
+        ring[tail++ & CAPTURE_MASK] = data[i];
+    }
+}
+
+void capture_record(uint8_t flags, uint32_t start, uint32_t duration,
+                    const uint8_t* request, uint16_t request_len,
+                    const uint8_t* response, uint16_t response_len) {
+    uint8_t header[CAPTURE_HEADER_SIZE];
+
+    if (!running) {
+        return;
+    }
+
+    if (CAPTURE_HEADER_SIZE + request_len + response_len
+        > DAP_CAPTURE_BUFFER_SIZE - (tail - head)) {
+        lost++;
+        lost_pending = true;
+        return;
+    }
+
+    if (duration > 0xFFFFU) {
+        duration = 0xFFFFU;
+    }
+
+    header[0] = CAPTURE_SYNC;
+    header[1] = flags | (lost_pending ? CAPTURE_LOST : 0);
+    header[2] = (uint8_t)(start >>  0);
+    header[3] = (uint8_t)(start >>  8);
+    header[4] = (uint8_t)(start >> 16);
+    header[5] = (uint8_t)(start >> 24);
+    header[6] = (uint8_t)(duration >> 0);
+    header[7] = (uint8_t)(duration >> 8);
+    header[8] = (uint8_t)request_len;
+    header[9] = (uint8_t)response_len;
+    lost_pending = false;
+
+    capture_put(header, sizeof(header));
+    capture_put(request, request_len);
+    capture_put(response, response_len);
+}
+
+bool capture_update(void) {
+    uint32_t offset = head & CAPTURE_MASK;
+    uint32_t len = tail - head;
+    size_t sent;
+
+    if (len == 0 || !capture_send_callback) {
+        return false;
+    }
+
+    /* Up to the end of the ring; the rest goes next time */
+    if (offset + len > DAP_CAPTURE_BUFFER_SIZE) {
+        len = DAP_CAPTURE_BUFFER_SIZE - offset;
+    }
+
+    sent = capture_send_callback(&ring[offset], len);
+    head += (uint32_t)sent;
+    return sent > 0;
+}
+
+#endif
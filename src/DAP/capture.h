@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef CAPTURE_H_INCLUDED
+#define CAPTURE_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+
+/*
+ * Capture of the CMSIS-DAP traffic for replaying it later against the
+ * simulated target (see host/replay.c). While a capture runs, every
+ * request and its response are logged to a RAM ring, which is drained
+ * to a byte stream (the virtual CDC port on the firmware) between
+ * commands. Each record is
+ *
+ *   CAPTURE_SYNC, flags, start time (4 bytes, microseconds),
+ *   execution time (2 bytes, microseconds, saturating),
+ *   request length, response length, request, response
+ *
+ * all little-endian. The further packets of a chained response get a
+ * record of their own, with CAPTURE_CHAINED set and no request. When
+ * the ring is full, records are dropped whole and the next one that
+ * fits has CAPTURE_LOST set.
+ */
+
+#define CAPTURE_SYNC            0xDAU
+#define CAPTURE_HEADER_SIZE     10U
+
+#define CAPTURE_LOST            0x01U   /* Records were dropped before this one */
+#define CAPTURE_CHAINED         0x02U   /* Further packet of a chained response */
+
+/* Vendor command 0x8A modes */
+#define CAPTURE_MODE_STOP       0x00U
+#define CAPTURE_MODE_START      0x01U
+#define CAPTURE_MODE_QUERY      0xFFU
+
+typedef size_t (*CaptureSendFunction)(const uint8_t* data, size_t len);
+
+extern void capture_setup(CaptureSendFunction send_cb);
+extern void capture_start(void);
+extern void capture_stop(void);
+extern bool capture_running(void);
+
+/* Number of records dropped since the capture started */
+extern uint32_t capture_lost(void);
+
+extern void capture_record(uint8_t flags, uint32_t start, uint32_t duration,
+                           const uint8_t* request, uint16_t request_len,
+                           const uint8_t* response, uint16_t response_len);
+
+/* Pass logged bytes on to send_cb; returns true if any were taken.
+   Keeps draining after the capture is stopped until the ring is
+   empty. */
+extern bool capture_update(void);
+
+#endif
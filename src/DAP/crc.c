@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "DAP/CMSIS_DAP_config.h"
+#include "DAP/CMSIS_DAP.h"
+#include "DAP/mem_ap.h"
+#include "DAP/flash.h"
+#include "DAP/crc.h"
+
+#if DAP_CRC_AVAILABLE && (DAP_SWD != 0)
+
+#define CRC_REQUEST_SIZE        18U
+#define CRC_RESPONSE_SIZE       6U
+
+/* Words read per pass; the reads stay posted between passes */
+#define CRC_STAGING_WORDS       16U
+
+/* Reflected CRC-32 (0xEDB88320), four bits at a time */
+static const uint32_t crc_nibbles[16] = {
+    0x00000000U, 0x1DB71064U, 0x3B6E20C8U, 0x26D930ACU,
+    0x76DC4190U, 0x6B6B51F4U, 0x4DB26158U, 0x5005713CU,
+    0xEDB88320U, 0xF00F9344U, 0xD6D6A3E8U, 0xCB61B38CU,
+    0x9B64C2B0U, 0x86D3D2D4U, 0xA00AE278U, 0xBDBDF21CU,
+};
+
+#if DAP_FLASH_AVAILABLE
+/* Called like an algorithm function: R0 address, R1 length, R2
+   initial CRC; returns the CRC in R0. Bitwise, in Thumb-1 so that it
+   runs on any Cortex-M, without touching the stack:
+
+       mvns r2, r2          loop: cmp  r0, r1       bit:  lsrs r2, r2, #1
+       ldr  r3, =0xEDB88320       beq  done               bcc  skip
+       adds r1, r0, r1            ldrb r4, [r0]           eors r2, r3
+                                  adds r0, #1       skip: subs r4, #1
+       done: mvns r0, r2          eors r2, r4             bne  bit
+             bx   lr              movs r4, #8             b    loop
+*/
+static const uint32_t crc_stub[] = {
+    0x4B0843D2U, 0x42881841U, 0x7804D009U, 0x40623001U, 0x08522408U,
+    0x405AD300U, 0xD1FA3C01U, 0x43D0E7F3U, 0x46C04770U, 0xEDB88320U,
+};
+#endif
+
+static uint32_t crc_u32(const uint8_t* data) {
+    return ((uint32_t)data[0] <<  0)
+         | ((uint32_t)data[1] <<  8)
+         | ((uint32_t)data[2] << 16)
+         | ((uint32_t)data[3] << 24);
+}
+
+static uint32_t crc_word(uint32_t crc, uint32_t word) {
+    uint32_t i;
+
+    crc ^= word;
+    for (i = 0; i < 8; i++) {
+        crc = (crc >> 4) ^ crc_nibbles[crc & 0xFU];
+    }
+
+    return crc;
+}
+
+/* The low count bytes of a word, for the ends of an unaligned range */
+static uint32_t crc_bytes(uint32_t crc, uint32_t word, uint32_t count) {
+    while (count--) {
+        crc ^= word & 0xFFU;
+        crc = (crc >> 4) ^ crc_nibbles[crc & 0xFU];
+        crc = (crc >> 4) ^ crc_nibbles[crc & 0xFU];
+        word >>= 8;
+    }
+
+    return crc;
+}
+
+static bool crc_probe(uint32_t address, uint32_t length, uint32_t* crc) {
+    uint32_t words[CRC_STAGING_WORDS];
+    uint32_t skip = address & 0x3U;
+    uint32_t remaining = (skip + length + 3) / 4;
+    uint32_t value = ~*crc;
+    bool ok;
+
+    if (!mem_ap_begin()) {
+        return false;
+    }
+
+    ok = mem_ap_stream_begin(address - skip, remaining, true);
+    while (ok && remaining > 0) {
+        uint32_t count = (remaining < CRC_STAGING_WORDS) ? remaining
+                                                         : CRC_STAGING_WORDS;
+        uint32_t i;
+
+        ok = (mem_ap_stream_read(words, count) == count);
+        for (i = 0; ok && i < count; i++) {
+            uint32_t bytes = (length < 4 - skip) ? length : 4 - skip;
+            if (bytes == 4) {
+                value = crc_word(value, words[i]);
+            } else {
+                value = crc_bytes(value, words[i] >> (8 * skip), bytes);
+            }
+            length -= bytes;
+            skip = 0;
+        }
+        remaining -= count;
+    }
+
+    ok = mem_ap_end() && ok;
+    *crc = ~value;
+    return ok;
+}
+
+#if DAP_FLASH_AVAILABLE
+static uint32_t crc_target(uint32_t address, uint32_t length,
+                           uint32_t stub, uint32_t* crc) {
+    uint32_t status = DAP_ERROR;
+
+    if ((stub & 0x3U) != 0 || !mem_ap_begin()) {
+        return DAP_ERROR;
+    }
+
+    if (mem_ap_write_words(stub, crc_stub, sizeof(crc_stub) / 4)
+        && dap_flash_run(stub | 0x1U, address, length, *crc) == DAP_OK) {
+        status = dap_flash_status(crc);
+    }
+
+    if (!mem_ap_end()) {
+        status = DAP_ERROR;
+    }
+
+    return status;
+}
+
+static uint32_t crc_result(uint32_t* crc) {
+    uint32_t status;
+
+    if (!mem_ap_begin()) {
+        return DAP_ERROR;
+    }
+
+    status = dap_flash_status(crc);
+    if (!mem_ap_end()) {
+        status = DAP_ERROR;
+    }
+
+    return status;
+}
+#endif
+
+uint32_t dap_crc_command(uint8_t* request, uint8_t* response) {
+    uint32_t address = crc_u32(&request[2]);
+    uint32_t length = crc_u32(&request[6]);
+    uint32_t crc = crc_u32(&request[10]);
+    uint32_t status = DAP_ERROR;
+
+    switch (request[1]) {
+        case DAP_CRC_PROBE: {
+            if (length <= DAP_CRC_MAX_LENGTH && crc_probe(address, length, &crc)) {
+                status = DAP_OK;
+            }
+            break;
+        }
+#if DAP_FLASH_AVAILABLE
+        case DAP_CRC_TARGET: {
+            status = crc_target(address, length, crc_u32(&request[14]), &crc);
+            break;
+        }
+        case DAP_CRC_RESULT: {
+            status = crc_result(&crc);
+            break;
+        }
+#endif
+        default: {
+            break;
+        }
+    }
+
+    if (status != DAP_OK) {
+        crc = 0;
+    }
+
+    response[0] = request[0];
+    response[1] = (uint8_t)status;
+    response[2] = (uint8_t)(crc >>  0);
+    response[3] = (uint8_t)(crc >>  8);
+    response[4] = (uint8_t)(crc >> 16);
+    response[5] = (uint8_t)(crc >> 24);
+
+    return ((CRC_REQUEST_SIZE << 16) | CRC_RESPONSE_SIZE);
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef CRC_H_INCLUDED
+#define CRC_H_INCLUDED
+
+#include <stdint.h>
+
+#include "config.h"
+
+/*
+ * Vendor command 0x87: CRC-32 (as zlib's crc32()) of a range of target
+ * memory, so that flash can be verified without reading it back over
+ * USB. DAP_CRC_PROBE reads the range with pipelined word reads and
+ * computes the CRC on the probe, up to DAP_CRC_MAX_LENGTH bytes per
+ * request; longer ranges are covered by passing each result on as the
+ * initial CRC of the next request.
+ *
+ * DAP_CRC_TARGET copies a small Thumb routine into target RAM at the
+ * stub address and runs it on the target core, through the flash
+ * engine in flash.c: the engine has to be set up and the core halted,
+ * as for flash programming. Any length goes. If the routine is still
+ * running when the response is due, the status is DAP_CRC_BUSY and
+ * DAP_CRC_RESULT requests wait for it again.
+ *
+ * The host's SELECT, CSW and TAR are put back after every request.
+ */
+
+#if DAP_CRC_AVAILABLE
+
+#define DAP_CRC_PROBE           0x00U
+#define DAP_CRC_TARGET          0x01U
+#define DAP_CRC_RESULT          0x02U
+
+#define DAP_CRC_BUSY            0x01U
+
+#define DAP_CRC_MAX_LENGTH      4096U
+
+/* request:  ID, mode, address, length, initial CRC, stub address
+             (4 bytes each; 0 for the fields a mode doesn't use)
+   response: ID, status, CRC (4 bytes) */
+extern uint32_t dap_crc_command(uint8_t* request, uint8_t* response);
+
+#endif
+
+#endif
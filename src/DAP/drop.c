@@ -0,0 +1,761 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "DAP/CMSIS_DAP_config.h"
+#include "DAP/CMSIS_DAP.h"
+#include "DAP/mem_ap.h"
+#include "DAP/flash.h"
+#include "DAP/drop.h"
+
+#if MSD_AVAILABLE && (DAP_SWD != 0)
+
+/* Cortex-M debug registers */
+#define AIRCR                   0xE000ED0CU
+#define DHCSR                   0xE000EDF0U
+#define DEMCR                   0xE000EDFCU
+
+#define AIRCR_VECTKEY           0x05FA0000U
+#define AIRCR_SYSRESETREQ       (1U << 2)
+#define DHCSR_DBGKEY            0xA05F0000U
+#define DHCSR_C_DEBUGEN         (1U << 0)
+#define DHCSR_C_HALT            (1U << 1)
+#define DHCSR_S_HALT            (1U << 17)
+#define DEMCR_VC_CORERESET      (1U << 0)
+
+#define DP_ABORT_CLEAR          0x0000001EU
+#define DP_CTRL_POWERUP_REQ     0x50000000U
+#define DP_CTRL_POWERUP_ACK     0xA0000000U
+
+#define DROP_POLLS              64U
+
+/* Flash engine waits, each of up to a few hundred DHCSR reads */
+#define DROP_WAIT_TRIES         4096U
+
+#define DROP_CHUNK_WORDS        16U
+
+/* What Init and UnInit are called for */
+#define OPERATION_NONE          0U
+#define OPERATION_ERASE         1U
+#define OPERATION_PROGRAM       2U
+
+enum {
+    FORMAT_NONE,
+    FORMAT_ALGO,
+    FORMAT_HEX,
+    FORMAT_BIN,
+};
+
+enum {
+    STATUS_READY,
+    STATUS_BUSY,
+    STATUS_LOADED,
+    STATUS_PROGRAMMED,
+    STATUS_NO_TARGET,
+    STATUS_NO_ALGO,
+    STATUS_BAD_ALGO,
+    STATUS_BAD_HEX,
+    STATUS_BAD_ADDRESS,
+    STATUS_ERASE_FAILED,
+    STATUS_PROGRAM_FAILED,
+};
+
+static const char* const status_text[] = {
+    [STATUS_READY] = "Ready for a flash algorithm",
+    [STATUS_BUSY] = "Programming",
+    [STATUS_LOADED] = "Flash algorithm loaded, ready for an image",
+    [STATUS_PROGRAMMED] = "Programmed, ready for a flash algorithm",
+    [STATUS_NO_TARGET] = "Error: no target found",
+    [STATUS_NO_ALGO] = "Error: no flash algorithm loaded",
+    [STATUS_BAD_ALGO] = "Error: bad flash algorithm",
+    [STATUS_BAD_HEX] = "Error: bad HEX record",
+    [STATUS_BAD_ADDRESS] = "Error: data outside the flash or out of order",
+    [STATUS_ERASE_FAILED] = "Error: erase failed",
+    [STATUS_PROGRAM_FAILED] = "Error: programming failed",
+};
+
+/* The flash described by the last algorithm file */
+static struct {
+    uint32_t address;
+    uint32_t size;
+    uint32_t sectors[DROP_ALGO_REGIONS][2];
+    uint32_t page_size;
+    uint8_t empty;
+    bool valid;                 /* Its code is in target RAM */
+} flash;
+
+static drop_idle_function idle_callback;
+static uint8_t status = STATUS_READY;
+static uint8_t format = FORMAT_NONE;
+static bool done;               /* The rest of the file doesn't matter */
+static bool port_opened;        /* The port was off before the file */
+static uint32_t offset;         /* Bytes of the file so far */
+
+/* Algorithm file: file offsets where the code ends and the image
+   starts, and what to set up once the code is loaded */
+static uint32_t code_address;
+static uint32_t code_end;
+static uint32_t image_start;
+static uint32_t fields[DAP_FLASH_FIELDS];
+
+/* Flash writes, in ascending address order */
+static uint32_t page_address;
+static bool page_open;
+static uint32_t next_address;   /* Below here is programmed already */
+static uint32_t erased_end;     /* Sectors erased up to here */
+static uint8_t operation;       /* Init has been called for */
+static uint32_t bin_address;
+
+/* The part of the open page that hasn't been sent yet */
+static uint32_t chunk[DROP_CHUNK_WORDS];
+static uint32_t chunk_offset;   /* Offset of chunk[0] in the page */
+static uint32_t chunk_bytes;
+
+/* Intel HEX record being parsed */
+static struct {
+    bool in_record;
+    bool low_nibble;
+    uint8_t byte;
+    uint8_t count;
+    uint8_t type;
+    uint8_t sum;
+    uint16_t index;
+    uint16_t address;
+    uint32_t value;
+    uint32_t base;
+    uint8_t data[255];  /* Programmed once the checksum is known good */
+} hex;
+
+static uint32_t drop_u32(const uint8_t* data) {
+    return ((uint32_t)data[0] <<  0)
+         | ((uint32_t)data[1] <<  8)
+         | ((uint32_t)data[2] << 16)
+         | ((uint32_t)data[3] << 24);
+}
+
+static int drop_hex_digit(uint8_t c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+static uint8_t drop_format(const uint8_t* data, uint32_t len) {
+    uint32_t i;
+
+    if (len >= DROP_ALGO_SECTORS + 8 * DROP_ALGO_REGIONS
+        && drop_u32(&data[0]) == DROP_ALGO_MAGIC0
+        && drop_u32(&data[4]) == DROP_ALGO_MAGIC1) {
+        return FORMAT_ALGO;
+    }
+
+    /* Byte count, address and record type */
+    if (len >= 9 && data[0] == ':') {
+        for (i = 1; i < 9 && drop_hex_digit(data[i]) >= 0; i++) {
+        }
+        if (i == 9) {
+            return FORMAT_HEX;
+        }
+    }
+
+    /* Initial stack pointer and reset vector */
+    if (len >= 8 && flash.valid) {
+        uint32_t sp = drop_u32(&data[0]);
+        uint32_t reset = drop_u32(&data[4]);
+        if (sp != 0 && (sp & 0x3U) == 0 && (reset & 0x1U)
+            && reset - flash.address < flash.size) {
+            return FORMAT_BIN;
+        }
+    }
+
+    return FORMAT_NONE;
+}
+
+static bool drop_fail(uint8_t error) {
+    if (status == STATUS_BUSY) {
+        status = error;
+    }
+    return false;
+}
+
+static bool drop_parse_algo(const uint8_t* header) {
+    uint32_t code_size = drop_u32(&header[DROP_ALGO_CODE_SIZE]);
+    uint32_t i;
+
+    code_address = drop_u32(&header[DROP_ALGO_LOAD]);
+    code_end = DROP_ALGO_HEADER_SIZE + code_size;
+    image_start = (code_end + DROP_ALGO_HEADER_SIZE - 1)
+                & ~(DROP_ALGO_HEADER_SIZE - 1);
+
+    flash.valid = false;
+    flash.address = drop_u32(&header[DROP_ALGO_FLASH]);
+    flash.size = drop_u32(&header[DROP_ALGO_FLASH_SIZE]);
+    flash.empty = header[DROP_ALGO_EMPTY];
+    for (i = 0; i < DAP_FLASH_FIELDS; i++) {
+        fields[i] = drop_u32(&header[DROP_ALGO_FIELDS + 4*i]);
+    }
+    for (i = 0; i < DROP_ALGO_REGIONS; i++) {
+        flash.sectors[i][0] = drop_u32(&header[DROP_ALGO_SECTORS + 8*i]);
+        flash.sectors[i][1] = drop_u32(&header[DROP_ALGO_SECTORS + 8*i + 4]);
+    }
+    flash.page_size = fields[DAP_FLASH_PAGE_SIZE];
+
+    return code_size > 0 && flash.size > 0
+        && flash.page_size > 0 && (flash.page_size & 0x3U) == 0
+        && flash.sectors[0][0] > 0 && flash.sectors[0][1] == 0;
+}
+
+/* Connect the way a debugger would: line reset, JTAG-to-SWD, line
+   reset, then read IDCODE and power up the debug domain */
+static bool drop_connect(void) {
+    static uint8_t line_reset[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    static uint8_t jtag_to_swd[] = { 0x9E, 0xE7 };
+    static uint8_t idle[] = { 0x00 };
+    uint32_t value;
+    uint32_t polls;
+
+    if (DAP_Data.debug_port != DAP_PORT_SWD) {
+        DAP_Data.debug_port = DAP_PORT_SWD;
+        PORT_SWD_SETUP();
+        port_opened = true;
+    }
+
+    SWJ_Sequence(51, line_reset);
+    SWJ_Sequence(16, jtag_to_swd);
+    SWJ_Sequence(51, line_reset);
+    SWJ_Sequence(8, idle);
+
+    if (SWD_Transfer(DP_IDCODE | DAP_TRANSFER_RnW, &value) != DAP_TRANSFER_OK) {
+        return false;
+    }
+
+    value = DP_ABORT_CLEAR;
+    SWD_Transfer(DP_ABORT, &value);
+    value = DP_CTRL_POWERUP_REQ;
+    if (SWD_Transfer(DP_CTRL_STAT, &value) != DAP_TRANSFER_OK) {
+        return false;
+    }
+
+    for (polls = 0; polls < DROP_POLLS; polls++) {
+        if (SWD_Transfer(DP_CTRL_STAT | DAP_TRANSFER_RnW, &value)
+            != DAP_TRANSFER_OK) {
+            return false;
+        }
+        if ((value & DP_CTRL_POWERUP_ACK) == DP_CTRL_POWERUP_ACK) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Let go of the port again if it was off before */
+static void drop_release(void) {
+    if (port_opened) {
+        DAP_Data.debug_port = DAP_PORT_DISABLED;
+        PORT_OFF();
+        port_opened = false;
+    }
+    format = FORMAT_NONE;
+}
+
+static bool drop_halt(void) {
+    uint32_t value = DHCSR_DBGKEY | DHCSR_C_DEBUGEN | DHCSR_C_HALT;
+    uint32_t polls;
+
+    if (!mem_ap_write_words(DHCSR, &value, 1)) {
+        return false;
+    }
+
+    for (polls = 0; polls < DROP_POLLS; polls++) {
+        if (!mem_ap_read_words(DHCSR, &value, 1)) {
+            return false;
+        }
+        if (value & DHCSR_S_HALT) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Reset the target and let it run, without stopping at the reset vector */
+static bool drop_reset(void) {
+    uint32_t demcr;
+    uint32_t value;
+
+    if (!mem_ap_read_words(DEMCR, &demcr, 1)) {
+        return false;
+    }
+
+    /* The core comes out of reset still halted, and runs once debug
+       is turned off */
+    demcr &= ~DEMCR_VC_CORERESET;
+    mem_ap_write_words(DEMCR, &demcr, 1);
+    value = AIRCR_VECTKEY | AIRCR_SYSRESETREQ;
+    mem_ap_write_words(AIRCR, &value, 1);
+    value = DHCSR_DBGKEY;
+
+    /* Whatever the target runs now may overwrite the algorithm */
+    flash.valid = false;
+    return mem_ap_write_words(DHCSR, &value, 1);
+}
+
+/* Wait for the running algorithm call, which must succeed */
+static bool drop_wait(void) {
+    uint32_t tries = DROP_WAIT_TRIES;
+    uint32_t call_result = 1;
+    uint32_t state;
+
+    while ((state = dap_flash_status(&call_result)) == DAP_FLASH_BUSY
+           && tries-- > 0) {
+        if (idle_callback) {
+            idle_callback();
+        }
+    }
+
+    return (state == DAP_OK) && (call_result == 0);
+}
+
+static bool drop_call(uint8_t function, uint32_t r0, uint32_t r1, uint32_t r2) {
+    return drop_wait()
+        && dap_flash_call(function, r0, r1, r2) == DAP_OK
+        && drop_wait();
+}
+
+/* Switch the algorithm over to erasing or programming */
+static bool drop_operation(uint8_t next) {
+    if (operation == next) {
+        return true;
+    }
+
+    if (operation != OPERATION_NONE
+        && !drop_call(DAP_FLASH_UNINIT, operation, 0, 0)) {
+        return false;
+    }
+    operation = OPERATION_NONE;
+
+    if (next != OPERATION_NONE
+        && !drop_call(DAP_FLASH_INIT, flash.address, 0, next)) {
+        return false;
+    }
+    operation = next;
+
+    return true;
+}
+
+/* Erase the sectors that end up to end that aren't erased yet */
+static bool drop_erase(uint32_t end) {
+    while (erased_end < end) {
+        uint32_t address = (erased_end > page_address) ? erased_end : page_address;
+        uint32_t from = address - flash.address;
+        uint32_t start = 0;
+        uint32_t size = 0;
+        uint32_t i = DROP_ALGO_REGIONS;
+
+        while (i-- > 0) {
+            if (flash.sectors[i][0] > 0 && from >= flash.sectors[i][1]) {
+                size = flash.sectors[i][0];
+                start = flash.sectors[i][1]
+                      + (from - flash.sectors[i][1]) / size * size;
+                break;
+            }
+        }
+
+        if (size == 0 || !drop_operation(OPERATION_ERASE)
+            || !drop_call(DAP_FLASH_ERASE_SECTOR, flash.address + start, 0, 0)) {
+            return drop_fail(STATUS_ERASE_FAILED);
+        }
+        erased_end = flash.address + start + size;
+    }
+
+    return true;
+}
+
+/* Send the chunk to the page buffer; the engine starts programming
+   the page once the chunk completes it */
+static bool drop_flush(void) {
+    uint32_t tries = DROP_WAIT_TRIES;
+    uint32_t state;
+
+    if (chunk_bytes == 0) {
+        return true;
+    }
+
+    while ((state = dap_flash_page(page_address, chunk_offset, chunk,
+                                   chunk_bytes / 4)) == DAP_FLASH_BUSY
+           && tries-- > 0) {
+        if (idle_callback) {
+            idle_callback();
+        }
+    }
+
+    chunk_offset += chunk_bytes;
+    chunk_bytes = 0;
+    return (state == DAP_OK) || drop_fail(STATUS_PROGRAM_FAILED);
+}
+
+static bool drop_put(uint8_t value) {
+    uint32_t shift = 8 * (chunk_bytes & 0x3U);
+
+    if (shift == 0) {
+        chunk[chunk_bytes / 4] = 0;
+    }
+    chunk[chunk_bytes / 4] |= (uint32_t)value << shift;
+    chunk_bytes++;
+
+    if (chunk_offset + chunk_bytes == flash.page_size) {
+        page_open = false;
+        next_address = page_address + flash.page_size;
+        return drop_flush();
+    }
+
+    return (chunk_bytes < sizeof(chunk)) || drop_flush();
+}
+
+static bool drop_open_page(uint32_t address) {
+    page_address = address - (address - flash.address) % flash.page_size;
+
+    if (!drop_erase(page_address + flash.page_size)
+        || !drop_operation(OPERATION_PROGRAM)) {
+        return false;
+    }
+
+    page_open = true;
+    chunk_offset = 0;
+    chunk_bytes = 0;
+    return true;
+}
+
+/* Pad the open page with the erased value, which programs it */
+static bool drop_close_page(void) {
+    while (page_open) {
+        if (!drop_put(flash.empty)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool drop_program(uint32_t address, uint8_t value) {
+    if (address - flash.address >= flash.size) {
+        return drop_fail(STATUS_BAD_ADDRESS);
+    }
+
+    if (page_open && address - page_address >= flash.page_size
+        && !drop_close_page()) {
+        return false;
+    }
+
+    if (!page_open) {
+        if (address < next_address) {
+            return drop_fail(STATUS_BAD_ADDRESS);
+        }
+        if (!drop_open_page(address)) {
+            return false;
+        }
+    }
+
+    if (chunk_offset + chunk_bytes > address - page_address) {
+        return drop_fail(STATUS_BAD_ADDRESS);
+    }
+    while (chunk_offset + chunk_bytes < address - page_address) {
+        if (!drop_put(flash.empty)) {
+            return false;
+        }
+    }
+
+    return drop_put(value);
+}
+
+/* Parse one character of an Intel HEX file. A data record is held
+   back until its checksum has been checked. */
+static bool drop_hex(uint8_t c) {
+    int digit;
+    uint16_t index;
+    uint16_t i;
+
+    if (!hex.in_record) {
+        if (c == ':') {
+            hex.in_record = true;
+            hex.low_nibble = false;
+            hex.index = 0;
+            hex.sum = 0;
+            hex.value = 0;
+            return true;
+        }
+        return (c == '\r' || c == '\n' || c == ' ' || c == '\t' || c == 0)
+            || drop_fail(STATUS_BAD_HEX);
+    }
+
+    digit = drop_hex_digit(c);
+    if (digit < 0) {
+        return drop_fail(STATUS_BAD_HEX);
+    }
+
+    if (!hex.low_nibble) {
+        hex.byte = (uint8_t)(digit << 4);
+        hex.low_nibble = true;
+        return true;
+    }
+
+    hex.byte |= (uint8_t)digit;
+    hex.low_nibble = false;
+    hex.sum += hex.byte;
+    index = hex.index++;
+
+    if (index == 0) {
+        hex.count = hex.byte;
+    } else if (index <= 2) {
+        hex.address = (uint16_t)((hex.address << 8) | hex.byte);
+    } else if (index == 3) {
+        hex.type = hex.byte;
+    } else if (index < 4 + hex.count) {
+        hex.data[index - 4] = hex.byte;
+        hex.value = (hex.value << 8) | hex.byte;
+    } else {
+        hex.in_record = false;
+        if (hex.sum != 0) {
+            return drop_fail(STATUS_BAD_HEX);
+        }
+
+        switch (hex.type) {
+            case 0x00:          /* Data */
+                for (i = 0; i < hex.count; i++) {
+                    if (!drop_program(hex.base + hex.address + i,
+                                      hex.data[i])) {
+                        return false;
+                    }
+                }
+                break;
+            case 0x03:          /* Start segment address */
+            case 0x05:          /* Start linear address */
+                break;
+            case 0x01:          /* End of file */
+                done = true;
+                break;
+            case 0x02:          /* Extended segment address */
+                hex.base = hex.value << 4;
+                break;
+            case 0x04:          /* Extended linear address */
+                hex.base = hex.value << 16;
+                break;
+            default:
+                return drop_fail(STATUS_BAD_HEX);
+        }
+    }
+
+    return true;
+}
+
+static bool drop_consume(const uint8_t* data, uint32_t len) {
+    uint32_t count;
+    uint32_t i;
+
+    if (format == FORMAT_ALGO) {
+        /* Skip the header, then load the code */
+        count = (offset < DROP_ALGO_HEADER_SIZE) ? DROP_ALGO_HEADER_SIZE - offset : 0;
+        count = (count < len) ? count : len;
+        data += count;
+        len -= count;
+        offset += count;
+
+        count = (offset < code_end) ? code_end - offset : 0;
+        count = (count < len) ? count : len;
+        if (count > 0) {
+            if (!mem_ap_write_bytes(code_address + offset - DROP_ALGO_HEADER_SIZE,
+                                    data, count)) {
+                return false;
+            }
+            data += count;
+            len -= count;
+            offset += count;
+
+            if (offset == code_end) {
+                if (dap_flash_setup(fields) != DAP_OK) {
+                    return drop_fail(STATUS_BAD_ALGO);
+                }
+                flash.valid = true;
+            }
+        }
+
+        count = (offset < image_start) ? image_start - offset : 0;
+        count = (count < len) ? count : len;
+        data += count;
+        len -= count;
+        offset += count;
+
+        if (len == 0) {
+            return true;
+        }
+
+        /* Anything but an image after the code is padding */
+        format = drop_format(data, len);
+        if (format != FORMAT_HEX && format != FORMAT_BIN) {
+            format = FORMAT_ALGO;
+            done = true;
+            return true;
+        }
+        bin_address = flash.address;
+    }
+
+    if (format == FORMAT_HEX) {
+        for (i = 0; i < len && !done; i++) {
+            if (!drop_hex(data[i])) {
+                return false;
+            }
+        }
+    } else {
+        for (i = 0; i < len; i++) {
+            if (!drop_program(bin_address++, data[i])) {
+                return false;
+            }
+        }
+    }
+
+    offset += len;
+    return true;
+}
+
+void drop_setup(drop_idle_function idle) {
+    idle_callback = idle;
+}
+
+bool drop_detect(const uint8_t* data, uint32_t len) {
+    return drop_format(data, len) != FORMAT_NONE;
+}
+
+bool drop_begin(const uint8_t* data, uint32_t len) {
+    uint8_t detected = drop_format(data, len);
+    bool ok;
+
+    if (detected == FORMAT_NONE || format != FORMAT_NONE) {
+        return false;
+    }
+
+    status = STATUS_BUSY;
+    done = false;
+    offset = 0;
+    page_open = false;
+    next_address = 0;
+    erased_end = 0;
+    operation = OPERATION_NONE;
+    chunk_bytes = 0;
+    bin_address = flash.address;
+    hex.in_record = false;
+    hex.base = 0;
+
+    if (detected == FORMAT_ALGO && !drop_parse_algo(data)) {
+        return drop_fail(STATUS_BAD_ALGO);
+    }
+
+    if (!drop_connect()) {
+        drop_release();
+        return drop_fail(STATUS_NO_TARGET);
+    }
+
+    if (!mem_ap_begin()) {
+        drop_release();
+        return drop_fail(STATUS_NO_TARGET);
+    }
+    ok = drop_halt();
+    ok = mem_ap_end() && ok;
+    if (!ok) {
+        drop_release();
+        return drop_fail(STATUS_NO_TARGET);
+    }
+
+    format = detected;
+    return drop_write(data, len);
+}
+
+bool drop_write(const uint8_t* data, uint32_t len) {
+    bool ok;
+
+    if (format == FORMAT_NONE) {
+        return false;
+    }
+
+    if (!mem_ap_begin()) {
+        drop_release();
+        return drop_fail(STATUS_PROGRAM_FAILED);
+    }
+
+    ok = drop_consume(data, len);
+    ok = mem_ap_end() && ok;
+
+    if (!ok) {
+        drop_release();
+        return drop_fail(STATUS_PROGRAM_FAILED);
+    }
+
+    if (done) {
+        drop_end();
+    }
+
+    return drop_active();
+}
+
+void drop_end(void) {
+    bool ok;
+
+    if (format == FORMAT_NONE) {
+        return;
+    }
+
+    if (!mem_ap_begin()) {
+        drop_release();
+        drop_fail(STATUS_PROGRAM_FAILED);
+        return;
+    }
+
+    if (format == FORMAT_ALGO) {
+        /* No image followed the algorithm */
+        ok = flash.valid || drop_fail(STATUS_BAD_ALGO);
+    } else {
+        ok = drop_close_page()
+          && drop_wait()
+          && drop_operation(OPERATION_NONE)
+          && drop_reset();
+    }
+
+    ok = mem_ap_end() && ok;
+    if (ok) {
+        status = (format == FORMAT_ALGO) ? STATUS_LOADED : STATUS_PROGRAMMED;
+    } else {
+        drop_fail(STATUS_PROGRAM_FAILED);
+    }
+
+    drop_release();
+}
+
+bool drop_active(void) {
+    return format != FORMAT_NONE;
+}
+
+const char* drop_status(void) {
+    return status_text[status];
+}
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef DROP_H_INCLUDED
+#define DROP_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "config.h"
+
+/*
+ * Drag-and-drop programming. A file copied onto the mass storage
+ * volume (see vfs.c) is passed in here as the host writes it, and its
+ * contents go straight into the target's flash through the engine in
+ * flash.c, so the probe never holds more than a page chunk of it.
+ *
+ * Files are told apart by their first bytes:
+ *  - A flash algorithm, as written by tools/dap_flash.py --export: a
+ *    header sector (DROP_ALGO_*), then the algorithm code, which is
+ *    loaded into target RAM. An image may follow in the same file,
+ *    starting at the first sector boundary after the code.
+ *  - An Intel HEX image. Records have to be in ascending address
+ *    order, as objcopy writes them.
+ *  - A raw binary, programmed from the start of the flash. It is only
+ *    recognized by a vector table whose reset vector is in the flash.
+ *
+ * The probe connects to the target and halts it by itself, and resets
+ * it once an image has been programmed. The target is then free to
+ * overwrite the algorithm in its RAM, so the algorithm has to be
+ * copied again before the next image.
+ */
+
+#if MSD_AVAILABLE && !DAP_FLASH_AVAILABLE
+#error "Drag-and-drop programming needs the flash engine"
+#endif
+
+/* Flash algorithm header, little-endian words at these offsets */
+#define DROP_ALGO_MAGIC0        0x34504144U     /* "DAP4" */
+#define DROP_ALGO_MAGIC1        0x4D4C4632U     /* "2FLM" */
+#define DROP_ALGO_LOAD          8U      /* RAM address of the code */
+#define DROP_ALGO_CODE_SIZE     12U
+#define DROP_ALGO_FLASH         16U     /* Flash address and size */
+#define DROP_ALGO_FLASH_SIZE    20U
+#define DROP_ALGO_EMPTY         24U     /* Value of erased bytes */
+#define DROP_ALGO_FIELDS        28U     /* Flash engine SETUP fields */
+#define DROP_ALGO_SECTORS       68U     /* Sector size, flash offset */
+#define DROP_ALGO_REGIONS       4U      /*   pairs; unused ones are 0 */
+#define DROP_ALGO_HEADER_SIZE   512U    /* The code starts here */
+
+/* Called while waiting for the target, e.g. to kick the watchdog */
+typedef void (*drop_idle_function)(void);
+
+extern void drop_setup(drop_idle_function idle);
+
+/* Whether data is the start of a file that can be programmed */
+extern bool drop_detect(const uint8_t* data, uint32_t len);
+
+/* Feed the file in, in order, starting with the data drop_detect()
+   accepted. Both return false once the file is done with, because it
+   ended or failed; drop_end() tells it that it ended otherwise. */
+extern bool drop_begin(const uint8_t* data, uint32_t len);
+extern bool drop_write(const uint8_t* data, uint32_t len);
+extern void drop_end(void);
+
+extern bool drop_active(void);
+
+/* One line about the last file */
+extern const char* drop_status(void);
+
+#endif
@@ -0,0 +1,405 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "DAP/CMSIS_DAP_config.h"
+#include "DAP/CMSIS_DAP.h"
+#include "DAP/mem_ap.h"
+#include "DAP/flash.h"
+
+#include "tick.h"
+
+#if DAP_FLASH_AVAILABLE && (DAP_SWD != 0)
+
+/* Cortex-M debug registers */
+#define DHCSR                   0xE000EDF0U
+#define DCRSR                   0xE000EDF4U
+#define DCRDR                   0xE000EDF8U
+
+#define DHCSR_DBGKEY            0xA05F0000U
+#define DHCSR_C_DEBUGEN         (1U << 0)
+#define DHCSR_C_HALT            (1U << 1)
+#define DHCSR_C_MASKINTS        (1U << 3)
+#define DHCSR_S_REGRDY          (1U << 16)
+#define DHCSR_S_HALT            (1U << 17)
+#define DCRSR_REGWnR            (1U << 16)
+
+#define REG_R0                  0U
+#define REG_R9                  9U
+#define REG_SP                  13U
+#define REG_LR                  14U
+#define REG_PC                  15U
+#define REG_XPSR                16U
+
+#define XPSR_THUMB              0x01000000U
+
+/* DHCSR reads to wait for a call to finish within one request */
+#define FLASH_WAIT_POLLS        256U
+
+/* DHCSR reads to wait for a core register transfer */
+#define FLASH_REGRDY_POLLS      16U
+
+/* Deadline for a call, in get_cycles() counts. It has to stay below
+   2^31 counts, about 29s at 72MHz. */
+#define FLASH_TIMEOUT_CYCLES    (CPU_CLOCK / 1000U * DAP_FLASH_TIMEOUT_MS)
+
+/* Result of a call that was halted at its deadline */
+#define FLASH_RESULT_TIMEOUT    0xFFFFFFFFU
+
+#define FLASH_RESPONSE_SIZE     7U
+#define FLASH_WRITE_HEADER      7U
+#define FLASH_PAGE_HEADER       9U
+#define FLASH_WRITE_MAX_WORDS   ((DAP_PACKET_SIZE - FLASH_WRITE_HEADER) / 4U)
+#define FLASH_PAGE_MAX_WORDS    ((DAP_PACKET_SIZE - FLASH_PAGE_HEADER) / 4U)
+
+enum {
+    ALGO_BREAKPOINT,
+    ALGO_STATIC_BASE,
+    ALGO_STACK_POINTER,
+    ALGO_INIT,
+    ALGO_UNINIT,
+    ALGO_ERASE_SECTOR,
+    ALGO_PROGRAM_PAGE,
+    ALGO_BUFFER0,
+    ALGO_BUFFER1,
+    ALGO_PAGE_SIZE,
+    ALGO_FIELDS
+};
+
+static uint32_t algo[ALGO_FIELDS];
+static bool algo_valid;
+
+static bool running;            /* A call hasn't reached the breakpoint yet */
+static uint32_t deadline;       /* get_cycles() by which it has to */
+static uint32_t result;         /* R0 after the last finished call */
+static uint8_t fill_buffer;     /* Page buffer taking the next page */
+
+static uint32_t flash_u32(const uint8_t* data) {
+    return ((uint32_t)data[0] <<  0)
+         | ((uint32_t)data[1] <<  8)
+         | ((uint32_t)data[2] << 16)
+         | ((uint32_t)data[3] << 24);
+}
+
+static bool flash_read(uint32_t address, uint32_t* value) {
+    return mem_ap_read_words(address, value, 1);
+}
+
+static bool flash_write(uint32_t address, uint32_t value) {
+    return mem_ap_write_words(address, &value, 1);
+}
+
+/* Copy request data into target RAM, a few words at a time */
+static bool flash_write_data(uint32_t address, const uint8_t* data,
+                             uint32_t count) {
+    uint32_t words[FLASH_WRITE_MAX_WORDS];
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        words[i] = flash_u32(&data[4*i]);
+    }
+
+    return mem_ap_write_words(address, words, count);
+}
+
+static bool flash_reg_ready(void) {
+    uint32_t polls = FLASH_REGRDY_POLLS;
+    uint32_t dhcsr;
+
+    while (polls--) {
+        if (!flash_read(DHCSR, &dhcsr)) {
+            return false;
+        }
+        if (dhcsr & DHCSR_S_REGRDY) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool flash_write_reg(uint32_t reg, uint32_t value) {
+    return flash_write(DCRDR, value)
+        && flash_write(DCRSR, DCRSR_REGWnR | reg)
+        && flash_reg_ready();
+}
+
+static bool flash_read_reg(uint32_t reg, uint32_t* value) {
+    return flash_write(DCRSR, reg)
+        && flash_reg_ready()
+        && flash_read(DCRDR, value);
+}
+
+/* Pick up the result once the running call has halted */
+static bool flash_poll(void) {
+    uint32_t dhcsr;
+
+    if (!running) {
+        return true;
+    }
+
+    if (!flash_read(DHCSR, &dhcsr)) {
+        return false;
+    }
+
+    if (dhcsr & DHCSR_S_HALT) {
+        running = false;
+        return flash_read_reg(REG_R0, &result);
+    }
+
+    /* Hung, or spinning in a fault handler: stop it where it is */
+    if ((int32_t)(get_cycles() - deadline) >= 0) {
+        running = false;
+        result = FLASH_RESULT_TIMEOUT;
+        flash_write(DHCSR, DHCSR_DBGKEY | DHCSR_C_DEBUGEN
+                           | DHCSR_C_HALT | DHCSR_C_MASKINTS);
+        return false;
+    }
+
+    return true;
+}
+
+static bool flash_wait(void) {
+    uint32_t polls = FLASH_WAIT_POLLS;
+
+    while (running && polls--) {
+        if (!flash_poll()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Run an algorithm function on the halted core, with interrupts
+   masked, returning to the breakpoint */
+static bool flash_start(uint32_t entry, uint32_t r0, uint32_t r1, uint32_t r2) {
+    uint32_t dhcsr;
+
+    if (running || !flash_read(DHCSR, &dhcsr) || !(dhcsr & DHCSR_S_HALT)) {
+        return false;
+    }
+
+    running = flash_write(DHCSR, DHCSR_DBGKEY | DHCSR_C_DEBUGEN
+                                 | DHCSR_C_HALT | DHCSR_C_MASKINTS)
+           && flash_write_reg(REG_R0 + 0, r0)
+           && flash_write_reg(REG_R0 + 1, r1)
+           && flash_write_reg(REG_R0 + 2, r2)
+           && flash_write_reg(REG_R9, algo[ALGO_STATIC_BASE])
+           && flash_write_reg(REG_SP, algo[ALGO_STACK_POINTER])
+           && flash_write_reg(REG_LR, algo[ALGO_BREAKPOINT] | 0x1U)
+           && flash_write_reg(REG_PC, entry & ~0x1U)
+           && flash_write_reg(REG_XPSR, XPSR_THUMB)
+           && flash_write(DHCSR, DHCSR_DBGKEY | DHCSR_C_DEBUGEN
+                                 | DHCSR_C_MASKINTS);
+    deadline = get_cycles() + FLASH_TIMEOUT_CYCLES;
+
+    return running;
+}
+
+uint32_t dap_flash_setup(const uint32_t* fields) {
+    uint32_t i;
+
+    if (running) {
+        return DAP_ERROR;
+    }
+
+    for (i = 0; i < ALGO_FIELDS; i++) {
+        algo[i] = fields[i];
+    }
+
+    algo_valid = (algo[ALGO_PAGE_SIZE] != 0)
+              && (algo[ALGO_PAGE_SIZE] & 0x3U) == 0;
+    result = 0;
+    fill_buffer = 0;
+
+    return algo_valid ? DAP_OK : DAP_ERROR;
+}
+
+uint32_t dap_flash_call(uint8_t function, uint32_t r0, uint32_t r1, uint32_t r2) {
+    static const uint8_t entries[] = {
+        [DAP_FLASH_INIT] = ALGO_INIT,
+        [DAP_FLASH_UNINIT] = ALGO_UNINIT,
+        [DAP_FLASH_ERASE_SECTOR] = ALGO_ERASE_SECTOR,
+    };
+
+    if (!algo_valid || function >= sizeof(entries)) {
+        return DAP_ERROR;
+    }
+
+    fill_buffer = 0;
+    return flash_start(algo[entries[function]], r0, r1, r2)
+           ? DAP_OK : DAP_ERROR;
+}
+
+uint32_t dap_flash_run(uint32_t entry, uint32_t r0, uint32_t r1, uint32_t r2) {
+    if (!algo_valid) {
+        return DAP_ERROR;
+    }
+
+    return flash_start(entry, r0, r1, r2) ? DAP_OK : DAP_ERROR;
+}
+
+uint32_t dap_flash_page(uint32_t address, uint32_t offset,
+                        const uint32_t* words, uint32_t count) {
+    uint32_t page_size = algo[ALGO_PAGE_SIZE];
+    uint32_t buffer = algo[ALGO_BUFFER0 + fill_buffer];
+
+    if (!algo_valid || (offset & 0x3U) != 0 || offset + 4 * count > page_size) {
+        return DAP_ERROR;
+    }
+
+    if (!mem_ap_write_words(buffer + offset, words, count)) {
+        return DAP_ERROR;
+    }
+
+    if (offset + 4 * count < page_size) {
+        return DAP_OK;
+    }
+
+    /* The other buffer is free once the previous page is done */
+    if (!flash_wait()) {
+        return DAP_ERROR;
+    }
+    if (running) {
+        return DAP_FLASH_BUSY;
+    }
+    if (result != 0
+        || !flash_start(algo[ALGO_PROGRAM_PAGE], address, page_size, buffer)) {
+        return DAP_ERROR;
+    }
+
+    fill_buffer ^= 1;
+    return DAP_OK;
+}
+
+uint32_t dap_flash_status(uint32_t* call_result) {
+    if (!flash_wait()) {
+        return DAP_ERROR;
+    }
+    if (running) {
+        return DAP_FLASH_BUSY;
+    }
+
+    *call_result = result;
+    return DAP_OK;
+}
+
+static uint32_t flash_setup(const uint8_t* request) {
+    uint32_t fields[ALGO_FIELDS];
+    uint32_t i;
+
+    for (i = 0; i < ALGO_FIELDS; i++) {
+        fields[i] = flash_u32(&request[2 + 4*i]);
+    }
+
+    return dap_flash_setup(fields);
+}
+
+static uint32_t flash_call(const uint8_t* request) {
+    return dap_flash_call(request[2], flash_u32(&request[3]),
+                          flash_u32(&request[7]), flash_u32(&request[11]));
+}
+
+static uint32_t flash_page(const uint8_t* request) {
+    uint32_t words[FLASH_PAGE_MAX_WORDS];
+    uint32_t count = request[2];
+    uint32_t offset = ((uint32_t)request[3] << 0)
+                    | ((uint32_t)request[4] << 8);
+    uint32_t i;
+
+    if (count > FLASH_PAGE_MAX_WORDS) {
+        return DAP_ERROR;
+    }
+
+    for (i = 0; i < count; i++) {
+        words[i] = flash_u32(&request[FLASH_PAGE_HEADER + 4*i]);
+    }
+
+    return dap_flash_page(flash_u32(&request[5]), offset, words, count);
+}
+
+uint32_t dap_flash_command(uint8_t* request, uint8_t* response) {
+    uint32_t request_size = 2;
+    uint32_t status = DAP_ERROR;
+    uint32_t count;
+
+    switch (request[1]) {
+        case DAP_FLASH_SETUP:
+            request_size = 2 + 4 * ALGO_FIELDS;
+            break;
+        case DAP_FLASH_WRITE:
+            /* As sent, even when refused, so that the commands after
+               it in a batch are still found */
+            count = request[2];
+            request_size = FLASH_WRITE_HEADER + 4 * count;
+            break;
+        case DAP_FLASH_CALL:
+            request_size = 15;
+            break;
+        case DAP_FLASH_PAGE:
+            count = request[2];
+            request_size = FLASH_PAGE_HEADER + 4 * count;
+            break;
+        default:
+            break;
+    }
+
+    if (request[1] == DAP_FLASH_SETUP) {
+        status = flash_setup(request);
+    } else if (mem_ap_begin()) {
+        switch (request[1]) {
+            case DAP_FLASH_WRITE:
+                status = (request[2] <= FLASH_WRITE_MAX_WORDS
+                          && flash_write_data(flash_u32(&request[3]),
+                                              &request[FLASH_WRITE_HEADER],
+                                              request[2]))
+                         ? DAP_OK : DAP_ERROR;
+                break;
+            case DAP_FLASH_CALL:
+                status = flash_call(request);
+                break;
+            case DAP_FLASH_STATUS:
+                status = flash_wait() ? DAP_OK : DAP_ERROR;
+                break;
+            case DAP_FLASH_PAGE:
+                status = flash_page(request);
+                break;
+            default:
+                break;
+        }
+
+        if (!mem_ap_end()) {
+            status = DAP_ERROR;
+        }
+    }
+
+    response[0] = request[0];
+    response[1] = (uint8_t)status;
+    response[2] = running ? 1 : 0;
+    response[3] = (uint8_t)(result >>  0);
+    response[4] = (uint8_t)(result >>  8);
+    response[5] = (uint8_t)(result >> 16);
+    response[6] = (uint8_t)(result >> 24);
+
+    return ((request_size << 16) | FLASH_RESPONSE_SIZE);
+}
+
+#endif
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef FLASH_H_INCLUDED
+#define FLASH_H_INCLUDED
+
+#include <stdint.h>
+
+#include "config.h"
+
+/*
+ * Vendor command 0x86: program target flash on the probe, with a
+ * CMSIS-Pack flash algorithm (Init, UnInit, EraseSector, ProgramPage)
+ * that the host has loaded into target RAM. The probe calls the
+ * algorithm functions through the core registers, with LR pointing
+ * at a breakpoint, and waits for the core to halt there again.
+ *
+ * Page data is written into one of two page buffers in target RAM.
+ * Once a page is complete, ProgramPage is started on it and the next
+ * page goes into the other buffer while the target programs, so the
+ * host never waits for the flash between pages.
+ *
+ * The core must be halted before the first call. The host's SELECT,
+ * CSW and TAR are put back after every request.
+ */
+
+#if DAP_FLASH_AVAILABLE
+
+/* Sub-commands, in the byte after the command ID */
+#define DAP_FLASH_SETUP         0x00U
+#define DAP_FLASH_WRITE         0x01U
+#define DAP_FLASH_CALL          0x02U
+#define DAP_FLASH_STATUS        0x03U
+#define DAP_FLASH_PAGE          0x04U
+
+/* Functions for DAP_FLASH_CALL */
+#define DAP_FLASH_INIT          0x00U
+#define DAP_FLASH_UNINIT        0x01U
+#define DAP_FLASH_ERASE_SECTOR  0x02U
+
+/* Status: the previous page is still being programmed; send the
+   same request again */
+#define DAP_FLASH_BUSY          0x01U
+
+/* requests:
+     SETUP:  ID, 0, breakpoint, static base, stack pointer, Init,
+             UnInit, EraseSector, ProgramPage, page buffer 0,
+             page buffer 1, page size (4 bytes each)
+     WRITE:  ID, 1, word count, RAM address (4 bytes), data
+     CALL:   ID, 2, function, R0, R1, R2 (4 bytes each)
+     STATUS: ID, 3
+     PAGE:   ID, 4, word count, offset in page (2 bytes),
+             page address (4 bytes), data
+   response: ID, status, running, result of the last finished
+             call (4 bytes)
+   STATUS waits a while for the running call to finish. A call still
+   running DAP_FLASH_TIMEOUT_MS after it started is halted where it
+   is: the request that finds it gives DAP_ERROR, and the call's
+   result is 0xFFFFFFFF. */
+extern uint32_t dap_flash_command(uint8_t* request, uint8_t* response);
+
+/* The same engine for code on the probe itself (see drop.c), called
+   between mem_ap_begin() and mem_ap_end(). fields holds the SETUP
+   request fields in order; the return values are the request status
+   codes. dap_flash_status() gives DAP_FLASH_BUSY while the call is
+   still running and its result once it is done. */
+#define DAP_FLASH_FIELDS        10U
+#define DAP_FLASH_PAGE_SIZE     9U
+
+extern uint32_t dap_flash_setup(const uint32_t* fields);
+extern uint32_t dap_flash_call(uint8_t function,
+                               uint32_t r0, uint32_t r1, uint32_t r2);
+extern uint32_t dap_flash_page(uint32_t address, uint32_t offset,
+                               const uint32_t* words, uint32_t count);
+extern uint32_t dap_flash_status(uint32_t* call_result);
+
+/* Run other code the same way as the algorithm functions, with the
+   algorithm's static base, stack and breakpoint (see crc.c) */
+extern uint32_t dap_flash_run(uint32_t entry,
+                              uint32_t r0, uint32_t r1, uint32_t r2);
+
+#endif
+
+#endif
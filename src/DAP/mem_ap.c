@@ -0,0 +1,352 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "DAP/CMSIS_DAP_config.h"
+#include "DAP/CMSIS_DAP.h"
+#include "DAP/mem_ap.h"
+
+#if (DAP_SWD != 0)
+
+#define AP_CSW                  0x00U
+#define AP_TAR                  0x04U
+#define AP_DRW                  0x0CU
+
+#define CSW_SIZE_MASK           0x07U
+#define CSW_SIZE_8              0x00U
+#define CSW_SIZE_32             0x02U
+#define CSW_ADDRINC_MASK        0x30U
+#define CSW_ADDRINC_SINGLE      0x10U
+
+#define ABORT_CLEAR_ERRORS      0x1EU
+
+/* CTRL/STAT: STICKYORUN, STICKYCMP, STICKYERR and WDATAERR */
+#define CTRL_STAT_ERRORS        0xB2U
+
+#define SELECT_DPBANKSEL        0x0000000FU
+
+/* TAR auto-increment is only guaranteed within a 1KB block */
+#define TAR_BLOCK_SIZE          0x400U
+
+#define AP_READ(reg)            (DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW | (reg))
+#define AP_WRITE(reg)           (DAP_TRANSFER_APnDP | (reg))
+
+/* Words staged per read when fetching unaligned byte ranges */
+#define MEM_AP_STAGING_WORDS    16U
+
+static uint32_t saved_select;
+static uint32_t saved_csw;
+static uint32_t saved_tar;
+static uint32_t current_csw;
+static bool active;
+static bool host_setup;
+static bool failed;
+
+/* Word read in progress, see mem_ap_stream_begin() */
+static struct {
+    uint32_t address;           /* Next word to post */
+    uint32_t posts;             /* Words not posted yet */
+    bool posted;                /* A DRW read result is still in flight */
+    bool write_tar;
+} stream;
+
+static bool mem_ap_transfer(uint32_t request, uint32_t* data) {
+    uint32_t retry = DAP_Data.transfer.retry_count;
+    uint8_t ack;
+
+    if (failed) {
+        return false;
+    }
+
+    do {
+        ack = SWD_Transfer(request, data);
+    } while (ack == DAP_TRANSFER_WAIT && retry--);
+
+    if (ack != DAP_TRANSFER_OK) {
+        failed = true;
+    }
+
+    return !failed;
+}
+
+static bool mem_ap_write_reg(uint32_t request, uint32_t value) {
+    return mem_ap_transfer(request, &value);
+}
+
+/* Clear the sticky errors raised by a failed access */
+static void mem_ap_clear_errors(void) {
+    uint32_t abort = ABORT_CLEAR_ERRORS;
+    failed = false;
+    SWD_Transfer(DP_ABORT, &abort);
+}
+
+static bool mem_ap_set_size(uint32_t size) {
+    uint32_t csw = (saved_csw & ~(CSW_SIZE_MASK | CSW_ADDRINC_MASK))
+                 | CSW_ADDRINC_SINGLE | size;
+
+    if (csw == current_csw) {
+        return !failed;
+    }
+
+    current_csw = csw;
+    return mem_ap_write_reg(AP_WRITE(AP_CSW), csw);
+}
+
+bool mem_ap_begin(void) {
+    uint32_t ctrl_stat = 0;
+    uint32_t select;
+
+    if (DAP_Data.debug_port != DAP_PORT_SWD) {
+        return false;
+    }
+
+    /* The host's DPIDR read has to be the first transaction after its
+       line reset */
+    if (DAP_Data.swd_conf.dpidr_pending) {
+        return false;
+    }
+
+    active = true;
+    host_setup = false;
+    failed = false;
+    saved_select = DAP_Data.swd_conf.select;
+
+    /* Sticky errors the host hasn't seen yet are left alone: the ABORT
+       write that clears what this access causes would clear them too.
+       CTRL/STAT is in DP bank 0, and a SELECT write would fault. */
+    select = saved_select;
+    if ((select & SELECT_DPBANKSEL) && mem_ap_write_reg(DP_SELECT, 0)) {
+        select = 0;
+    }
+    mem_ap_transfer(DP_CTRL_STAT | DAP_TRANSFER_RnW, &ctrl_stat);
+    if (failed || (ctrl_stat & CTRL_STAT_ERRORS)) {
+        failed = false;
+        if (select != saved_select) {
+            mem_ap_write_reg(DP_SELECT, saved_select);
+        }
+        DAP_Data.swd_conf.select = saved_select;
+        active = false;
+        return false;
+    }
+
+    /* AP 0, bank 0; CSW and TAR reads are posted */
+    if (select != 0) {
+        mem_ap_write_reg(DP_SELECT, 0);
+    }
+    mem_ap_transfer(AP_READ(AP_CSW), NULL);
+    mem_ap_transfer(AP_READ(AP_TAR), &saved_csw);
+    mem_ap_transfer(DP_RDBUFF | DAP_TRANSFER_RnW, &saved_tar);
+    current_csw = saved_csw;
+
+    if (failed) {
+        /* Nothing to restore but SELECT */
+        mem_ap_clear_errors();
+        mem_ap_write_reg(DP_SELECT, saved_select);
+        DAP_Data.swd_conf.select = saved_select;
+        active = false;
+        return false;
+    }
+
+    return true;
+}
+
+bool mem_ap_begin_host(void) {
+    if (DAP_Data.debug_port != DAP_PORT_SWD) {
+        return false;
+    }
+
+    active = true;
+    host_setup = true;
+    failed = false;
+    return true;
+}
+
+bool mem_ap_end(void) {
+    bool ok = !failed;
+
+    if (!active) {
+        return false;
+    }
+
+    if (host_setup) {
+        if (failed) {
+            mem_ap_clear_errors();
+        }
+        active = false;
+        return ok;
+    }
+
+    if (failed) {
+        mem_ap_clear_errors();
+        mem_ap_write_reg(DP_SELECT, 0);
+    }
+
+    if (current_csw != saved_csw) {
+        mem_ap_write_reg(AP_WRITE(AP_CSW), saved_csw);
+    }
+    mem_ap_write_reg(AP_WRITE(AP_TAR), saved_tar);
+    mem_ap_write_reg(DP_SELECT, saved_select);
+
+    /* Restore the host's SELECT shadow too, in case a write failed */
+    DAP_Data.swd_conf.select = saved_select;
+    active = false;
+
+    return ok && !failed;
+}
+
+/* Number of accesses of the given size that fit before TAR wraps */
+static uint32_t mem_ap_block_count(uint32_t address, uint32_t count,
+                                   uint32_t bytes) {
+    uint32_t space = (TAR_BLOCK_SIZE - (address & (TAR_BLOCK_SIZE - 1))) / bytes;
+    return (count < space) ? count : space;
+}
+
+bool mem_ap_stream_begin(uint32_t address, uint32_t count, bool write_tar) {
+    stream.address = address;
+    stream.posts = count;
+    stream.posted = false;
+    stream.write_tar = write_tar;
+
+    return host_setup || mem_ap_set_size(CSW_SIZE_32);
+}
+
+/* TAR is written when the stream starts, unless the caller knows it
+   already points there, and again at every 1KB boundary. TAR writes
+   leave RDBUFF alone, so the DRW reads stay posted back to back across
+   them, and across calls, and RDBUFF is only read once at the end. */
+uint32_t mem_ap_stream_read(uint32_t* data, uint32_t max) {
+    uint32_t count = 0;
+
+    while (count < max && !failed && (stream.posts > 0 || stream.posted)) {
+        if (stream.posts == 0) {
+            if (mem_ap_transfer(DP_RDBUFF | DAP_TRANSFER_RnW, &data[count])) {
+                count++;
+            }
+            stream.posted = false;
+            break;
+        }
+
+        if (stream.write_tar || (stream.address & (TAR_BLOCK_SIZE - 1)) == 0) {
+            mem_ap_write_reg(AP_WRITE(AP_TAR), stream.address);
+            stream.write_tar = false;
+        }
+
+        /* Each DRW read returns the previous result */
+        if (mem_ap_transfer(AP_READ(AP_DRW),
+                            stream.posted ? &data[count] : NULL)
+            && stream.posted) {
+            count++;
+        }
+        stream.posted = true;
+        stream.address += 4;
+        stream.posts--;
+    }
+
+    return count;
+}
+
+bool mem_ap_read_words(uint32_t address, uint32_t* data, uint32_t count) {
+    return mem_ap_stream_begin(address, count, true)
+        && mem_ap_stream_read(data, count) == count;
+}
+
+bool mem_ap_write_words(uint32_t address, const uint32_t* data, uint32_t count) {
+    if (!mem_ap_set_size(CSW_SIZE_32)) {
+        return false;
+    }
+
+    while (count > 0 && !failed) {
+        uint32_t block = mem_ap_block_count(address, count, 4);
+        uint32_t i;
+
+        mem_ap_write_reg(AP_WRITE(AP_TAR), address);
+        for (i = 0; i < block; i++) {
+            mem_ap_write_reg(AP_WRITE(AP_DRW), data[i]);
+        }
+
+        address += 4 * block;
+        data += block;
+        count -= block;
+    }
+
+    return !failed;
+}
+
+bool mem_ap_read_bytes(uint32_t address, uint8_t* data, uint32_t count) {
+    uint32_t staging[MEM_AP_STAGING_WORDS];
+
+    while (count > 0 && !failed) {
+        uint32_t offset = address & 0x3U;
+        uint32_t words = (offset + count + 3) / 4;
+        uint32_t bytes;
+        uint32_t i;
+
+        if (words > MEM_AP_STAGING_WORDS) {
+            words = MEM_AP_STAGING_WORDS;
+        }
+
+        if (!mem_ap_read_words(address - offset, staging, words)) {
+            break;
+        }
+
+        bytes = 4 * words - offset;
+        if (bytes > count) {
+            bytes = count;
+        }
+
+        for (i = 0; i < bytes; i++) {
+            uint32_t index = offset + i;
+            data[i] = (uint8_t)(staging[index / 4] >> (8 * (index & 0x3U)));
+        }
+
+        address += bytes;
+        data += bytes;
+        count -= bytes;
+    }
+
+    return !failed;
+}
+
+/* Byte writes use 8-bit accesses on the byte lane that matches the
+   address, so that neighbouring bytes are never rewritten. */
+bool mem_ap_write_bytes(uint32_t address, const uint8_t* data, uint32_t count) {
+    if (!mem_ap_set_size(CSW_SIZE_8)) {
+        return false;
+    }
+
+    while (count > 0 && !failed) {
+        uint32_t block = mem_ap_block_count(address, count, 1);
+        uint32_t i;
+
+        mem_ap_write_reg(AP_WRITE(AP_TAR), address);
+        for (i = 0; i < block; i++) {
+            uint32_t lane = 8 * ((address + i) & 0x3U);
+            mem_ap_write_reg(AP_WRITE(AP_DRW), (uint32_t)data[i] << lane);
+        }
+
+        address += block;
+        data += block;
+        count -= block;
+    }
+
+    return !failed;
+}
+
+#endif
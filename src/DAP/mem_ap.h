@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef MEM_AP_H_INCLUDED
+#define MEM_AP_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * MEM-AP access for engines that run on the probe between host
+ * commands. mem_ap_begin() saves the host's SELECT, CSW and TAR and
+ * mem_ap_end() puts them back, so that a debugger caching them never
+ * notices. All accesses go to AP 0.
+ *
+ * mem_ap_begin() refuses while the host has yet to read DPIDR after a
+ * line reset, an SWD sequence or DAP_Connect, since that read has to
+ * be the first transaction, and while CTRL/STAT holds sticky errors
+ * the host hasn't cleared.
+ *
+ * mem_ap_end() must follow every successful mem_ap_begin(). The access
+ * functions return false once any transfer fails; the error sticks
+ * until mem_ap_end(), which also clears the sticky error flags that
+ * the failed access raised.
+ */
+
+extern bool mem_ap_begin(void);
+extern bool mem_ap_end(void);
+
+extern bool mem_ap_read_words(uint32_t address, uint32_t* data, uint32_t count);
+extern bool mem_ap_write_words(uint32_t address, const uint32_t* data, uint32_t count);
+extern bool mem_ap_read_bytes(uint32_t address, uint8_t* data, uint32_t count);
+extern bool mem_ap_write_bytes(uint32_t address, const uint8_t* data, uint32_t count);
+
+/* Like mem_ap_begin(), for commands that run on the host's own AP
+   setup: nothing is saved or restored, SELECT must already pick bank 0
+   of AP 0 and CSW must be set up for 32-bit accesses with single
+   auto-increment. Only the stream functions below may be used. */
+extern bool mem_ap_begin_host(void);
+
+/* Word reads that can be spread over several calls, with the DRW reads
+   kept posted in between. With write_tar false, TAR must already hold
+   address, as left behind by a previous read that ended there. No
+   other access may run until all count words have been read. */
+extern bool mem_ap_stream_begin(uint32_t address, uint32_t count, bool write_tar);
+
+/* Read up to max words of the stream; returns how many were read,
+   fewer than max only at the end of the stream or after a failure */
+extern uint32_t mem_ap_stream_read(uint32_t* data, uint32_t max);
+
+#endif
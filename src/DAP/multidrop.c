@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "DAP/CMSIS_DAP_config.h"
+#include "DAP/CMSIS_DAP.h"
+#include "DAP/multidrop.h"
+
+#if DAP_MULTIDROP_AVAILABLE && (DAP_SWD != 0)
+
+#define MULTIDROP_REQUEST_SIZE  6U
+#define MULTIDROP_RESPONSE_SIZE 11U
+
+struct multidrop_target {
+    uint32_t targetsel;
+    uint32_t select;
+    uint32_t ctrl_stat;
+    bool valid;
+};
+
+static struct multidrop_target targets[DAP_MULTIDROP_TARGETS];
+static uint32_t next_slot;
+
+/* Line reset (56 ones), idle cycles, then the TARGETSEL write request */
+static uint8_t targetsel_sequence[] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x99,
+};
+
+static uint32_t multidrop_u32(const uint8_t* data) {
+    return ((uint32_t)data[0] <<  0)
+         | ((uint32_t)data[1] <<  8)
+         | ((uint32_t)data[2] << 16)
+         | ((uint32_t)data[3] << 24);
+}
+
+static struct multidrop_target* multidrop_find(uint32_t targetsel) {
+    uint32_t i;
+
+    for (i = 0; i < DAP_MULTIDROP_TARGETS; i++) {
+        if (targets[i].valid && targets[i].targetsel == targetsel) {
+            return &targets[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Remember the state of the target selected now, if it is known */
+static void multidrop_save(void) {
+    struct multidrop_target* target;
+
+    if (!DAP_Data.swd_conf.target_known) {
+        return;
+    }
+
+    target = multidrop_find(DAP_Data.swd_conf.targetsel);
+    if (!target) {
+        target = &targets[next_slot];
+        next_slot = (next_slot + 1) % DAP_MULTIDROP_TARGETS;
+    }
+
+    target->targetsel = DAP_Data.swd_conf.targetsel;
+    target->select = DAP_Data.swd_conf.select;
+    target->ctrl_stat = DAP_Data.swd_conf.ctrl_stat;
+    target->valid = true;
+}
+
+/* Nobody drives the line between the TARGETSEL request and its data,
+   where the turnarounds and ACK would be */
+static uint8_t multidrop_select(uint32_t targetsel, uint32_t* dpidr) {
+    uint8_t data[5];
+    uint8_t ack;
+    uint32_t parity = targetsel;
+
+    parity ^= parity >> 16;
+    parity ^= parity >> 8;
+    parity ^= parity >> 4;
+    parity ^= parity >> 2;
+    parity ^= parity >> 1;
+
+    data[0] = (uint8_t)(targetsel >>  0);
+    data[1] = (uint8_t)(targetsel >>  8);
+    data[2] = (uint8_t)(targetsel >> 16);
+    data[3] = (uint8_t)(targetsel >> 24);
+    data[4] = (uint8_t)(parity & 0x1U);
+
+    SWJ_Sequence(8 * sizeof(targetsel_sequence), targetsel_sequence);
+    PIN_SWDIO_OUT_DISABLE();
+    SWD_Sequence(SWD_SEQUENCE_DIN | (2 * DAP_Data.swd_conf.turnaround + 3),
+                 NULL, &ack);
+    PIN_SWDIO_OUT_ENABLE();
+    SWD_Sequence(33, data, NULL);
+
+    /* The selected target only answers other requests once DPIDR has
+       been read */
+    return SWD_Transfer(DP_IDCODE | DAP_TRANSFER_RnW, dpidr);
+}
+
+uint32_t dap_multidrop_command(uint8_t* request, uint8_t* response) {
+    uint32_t targetsel = multidrop_u32(&request[2]);
+    struct multidrop_target* target;
+    uint32_t dpidr = 0;
+    uint32_t ctrl_stat = 0;
+    uint8_t status = DAP_ERROR;
+    uint8_t flags = 0;
+
+    if (DAP_Data.debug_port == DAP_PORT_SWD) {
+        multidrop_save();
+        target = multidrop_find(targetsel);
+        if (target && (request[1] & DAP_MULTIDROP_FORGET)) {
+            target->valid = false;
+            target = NULL;
+        }
+
+        DAP_Data.swd_conf.target_known = 0;
+        if (multidrop_select(targetsel, &dpidr) == DAP_TRANSFER_OK) {
+            /* SELECT need not survive the line reset */
+            DAP_Data.swd_conf.select = 0;
+            DAP_Data.swd_conf.ctrl_stat = 0;
+            status = DAP_OK;
+            if (target) {
+                if (SWD_Transfer(DP_SELECT, &target->select) == DAP_TRANSFER_OK) {
+                    ctrl_stat = target->ctrl_stat;
+                    DAP_Data.swd_conf.ctrl_stat = ctrl_stat;
+                    flags = DAP_MULTIDROP_RESTORED;
+                } else {
+                    status = DAP_ERROR;
+                }
+            }
+        }
+
+        if (status == DAP_OK) {
+            DAP_Data.swd_conf.targetsel = targetsel;
+            DAP_Data.swd_conf.target_known = 1;
+        }
+    }
+
+    response[0] = request[0];
+    response[1] = status;
+    response[2] = flags;
+    response[3] = (uint8_t)(dpidr >>  0);
+    response[4] = (uint8_t)(dpidr >>  8);
+    response[5] = (uint8_t)(dpidr >> 16);
+    response[6] = (uint8_t)(dpidr >> 24);
+    response[7] = (uint8_t)(ctrl_stat >>  0);
+    response[8] = (uint8_t)(ctrl_stat >>  8);
+    response[9] = (uint8_t)(ctrl_stat >> 16);
+    response[10] = (uint8_t)(ctrl_stat >> 24);
+
+    return ((MULTIDROP_REQUEST_SIZE << 16) | MULTIDROP_RESPONSE_SIZE);
+}
+
+#endif
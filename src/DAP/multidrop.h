@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef MULTIDROP_H_INCLUDED
+#define MULTIDROP_H_INCLUDED
+
+#include <stdint.h>
+
+#include "config.h"
+
+/*
+ * Vendor command 0x88: switch to another target on an SWD multi-drop
+ * (SWDv2) bus. The probe sends the line reset, the TARGETSEL write and
+ * the DPIDR read that has to follow it, and remembers the SELECT and
+ * CTRL/STAT last written to up to DAP_MULTIDROP_TARGETS targets. When
+ * the new target has been selected through this command before, its
+ * SELECT is written back and its CTRL/STAT returned with the
+ * DAP_MULTIDROP_RESTORED flag, so the debugger can carry on without
+ * clearing errors and powering up the debug domain again.
+ *
+ * A line reset or SWD sequence sent by the debugger may select another
+ * target behind the probe's back; the state in effect at that point is
+ * not remembered. DAP_MULTIDROP_FORGET drops what the probe knows about
+ * the new target, e.g. after it was reset.
+ */
+
+#if DAP_MULTIDROP_AVAILABLE
+
+#define DAP_MULTIDROP_FORGET    0x01U   /* Request flag */
+#define DAP_MULTIDROP_RESTORED  0x01U   /* Response flag */
+
+#define DAP_MULTIDROP_TARGETS   4U
+
+/* request:  ID, flags, TARGETSEL (4 bytes)
+   response: ID, status, flags, DPIDR (4 bytes), CTRL/STAT (4 bytes) */
+extern uint32_t dap_multidrop_command(uint8_t* request, uint8_t* response);
+
+#endif
+
+#endif
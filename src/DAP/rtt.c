@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "DAP/CMSIS_DAP_config.h"
+#include "DAP/CMSIS_DAP.h"
+#include "DAP/mem_ap.h"
+#include "DAP/rtt.h"
+
+#include "config.h"
+
+#if RTT_AVAILABLE
+
+/* SEGGER_RTT_CB: char acID[16]; int MaxNumUpBuffers; int MaxNumDownBuffers;
+   followed by the up and then the down buffer descriptors */
+#define RTT_CB_MAX_UP           16U
+#define RTT_CB_MAX_DOWN         20U
+#define RTT_CB_BUFFERS          24U
+
+/* SEGGER_RTT_BUFFER: sName, pBuffer, SizeOfBuffer, WrOff, RdOff, Flags */
+#define RTT_DESC_SIZE           24U
+#define RTT_DESC_BUFFER         4U
+#define RTT_DESC_WROFF          12U
+#define RTT_DESC_RDOFF          16U
+
+#define RTT_MAX_BUFFERS         32U
+
+/* Bytes of target RAM searched per update, so that a search never
+   holds up a host command for long */
+#define RTT_SEARCH_CHUNK        256U
+
+/* Largest read from or write to the target per update */
+#define RTT_TRANSFER_SIZE       64U
+
+static const char rtt_id[] = "SEGGER RTT";
+
+struct rtt_buffer {
+    uint32_t desc;              /* Address of the descriptor */
+    uint32_t data;              /* pBuffer */
+    uint32_t size;              /* SizeOfBuffer */
+};
+
+static RTTSendFunction rtt_send_callback = NULL;
+static RTTRecvFunction rtt_recv_callback = NULL;
+
+static uint8_t state;
+static uint32_t search_address;
+static uint32_t search_size;
+static uint32_t search_offset;
+
+static uint32_t control_block;
+static struct rtt_buffer up;
+static struct rtt_buffer down;
+
+/* Up-buffer data read from the target but not yet accepted by send */
+static uint8_t pending[RTT_TRANSFER_SIZE];
+static uint16_t pending_len;
+static uint16_t pending_offset;
+
+static void rtt_restart_search(void) {
+    search_offset = 0;
+    state = RTT_STATE_SEARCHING;
+}
+
+void rtt_setup(RTTSendFunction send_cb, RTTRecvFunction recv_cb) {
+    rtt_send_callback = send_cb;
+    rtt_recv_callback = recv_cb;
+    state = RTT_STATE_STOPPED;
+}
+
+void rtt_start(uint32_t address, uint32_t size) {
+    search_address = address & ~0x3U;
+    search_size = size & ~0x3U;
+    control_block = 0;
+    pending_len = 0;
+    pending_offset = 0;
+    rtt_restart_search();
+}
+
+void rtt_stop(void) {
+    state = RTT_STATE_STOPPED;
+}
+
+uint8_t rtt_state(void) {
+    return state;
+}
+
+uint32_t rtt_control_block(void) {
+    return (state == RTT_STATE_RUNNING) ? control_block : 0;
+}
+
+static bool rtt_read_buffer(struct rtt_buffer* buffer, uint32_t desc) {
+    uint32_t words[2];
+
+    buffer->desc = desc;
+    if (!mem_ap_read_words(desc + RTT_DESC_BUFFER, words, 2)) {
+        return false;
+    }
+
+    buffer->data = words[0];
+    buffer->size = words[1];
+    return true;
+}
+
+/* Check a candidate control block and cache buffer 0 of each direction */
+static bool rtt_attach(uint32_t address) {
+    uint32_t counts[2];
+
+    if (!mem_ap_read_words(address + RTT_CB_MAX_UP, counts, 2)
+        || counts[0] == 0 || counts[0] > RTT_MAX_BUFFERS
+        || counts[1] > RTT_MAX_BUFFERS) {
+        return false;
+    }
+
+    if (!rtt_read_buffer(&up, address + RTT_CB_BUFFERS) || up.size == 0) {
+        return false;
+    }
+
+    down.size = 0;
+    if (counts[1] > 0) {
+        uint32_t desc = address + RTT_CB_BUFFERS + RTT_DESC_SIZE * counts[0];
+        if (!rtt_read_buffer(&down, desc)) {
+            return false;
+        }
+    }
+
+    control_block = address;
+    return true;
+}
+
+static void rtt_search(void) {
+    /* Room to match an ID that straddles the end of the chunk */
+    static uint8_t chunk[RTT_SEARCH_CHUNK + sizeof(rtt_id)];
+    uint32_t length = search_size - search_offset;
+    uint32_t address = search_address + search_offset;
+    uint32_t i;
+
+    if (length > RTT_SEARCH_CHUNK + sizeof(rtt_id)) {
+        length = RTT_SEARCH_CHUNK + sizeof(rtt_id);
+    }
+
+    search_offset += RTT_SEARCH_CHUNK;
+    if (search_offset >= search_size) {
+        search_offset = 0;
+    }
+
+    if (length < sizeof(rtt_id) || !mem_ap_read_bytes(address, chunk, length)) {
+        return;
+    }
+
+    /* The control block is word-aligned */
+    for (i = 0; i + sizeof(rtt_id) <= length && i < RTT_SEARCH_CHUNK; i += 4) {
+        if (memcmp(&chunk[i], rtt_id, sizeof(rtt_id)) == 0
+            && rtt_attach(address + i)) {
+            state = RTT_STATE_RUNNING;
+            return;
+        }
+    }
+}
+
+/* Read WrOff and RdOff, dropping back to searching if they are bogus,
+   e.g. because the target was reset and the block is gone */
+static bool rtt_read_offsets(const struct rtt_buffer* buffer,
+                             uint32_t* offsets) {
+    if (!mem_ap_read_words(buffer->desc + RTT_DESC_WROFF, offsets, 2)) {
+        return false;
+    }
+
+    if (offsets[0] >= buffer->size || offsets[1] >= buffer->size) {
+        rtt_restart_search();
+        return false;
+    }
+
+    return true;
+}
+
+static bool rtt_poll_up(void) {
+    uint32_t offsets[2];
+    uint32_t count;
+
+    if (pending_len == 0) {
+        if (!rtt_read_offsets(&up, offsets) || offsets[0] == offsets[1]) {
+            return false;
+        }
+
+        /* Only the contiguous part; the rest comes on the next poll */
+        if (offsets[0] > offsets[1]) {
+            count = offsets[0] - offsets[1];
+        } else {
+            count = up.size - offsets[1];
+        }
+        if (count > RTT_TRANSFER_SIZE) {
+            count = RTT_TRANSFER_SIZE;
+        }
+
+        if (!mem_ap_read_bytes(up.data + offsets[1], pending, count)) {
+            return false;
+        }
+
+        offsets[1] = (offsets[1] + count) % up.size;
+        if (!mem_ap_write_words(up.desc + RTT_DESC_RDOFF, &offsets[1], 1)) {
+            return false;
+        }
+
+        pending_len = (uint16_t)count;
+        pending_offset = 0;
+    }
+
+    if (rtt_send_callback) {
+        size_t sent = rtt_send_callback(&pending[pending_offset],
+                                        pending_len - pending_offset);
+        pending_offset += (uint16_t)sent;
+        if (pending_offset == pending_len) {
+            pending_len = 0;
+        }
+    } else {
+        pending_len = 0;
+    }
+
+    return true;
+}
+
+static bool rtt_poll_down(void) {
+    uint8_t data[RTT_TRANSFER_SIZE];
+    uint32_t offsets[2];
+    uint32_t space;
+    uint32_t count;
+
+    if (down.size == 0 || !rtt_recv_callback
+        || !rtt_read_offsets(&down, offsets)) {
+        return false;
+    }
+
+    /* One slot stays empty to tell a full buffer from an empty one */
+    space = (offsets[1] + down.size - offsets[0] - 1) % down.size;
+    if (space > down.size - offsets[0]) {
+        space = down.size - offsets[0];
+    }
+    if (space > RTT_TRANSFER_SIZE) {
+        space = RTT_TRANSFER_SIZE;
+    }
+
+    count = (space > 0) ? rtt_recv_callback(data, space) : 0;
+    if (count == 0) {
+        return false;
+    }
+
+    if (!mem_ap_write_bytes(down.data + offsets[0], data, count)) {
+        return false;
+    }
+
+    offsets[0] = (offsets[0] + count) % down.size;
+    return mem_ap_write_words(down.desc + RTT_DESC_WROFF, &offsets[0], 1);
+}
+
+bool rtt_update(void) {
+    bool active = false;
+
+    if (state == RTT_STATE_STOPPED || !mem_ap_begin()) {
+        return false;
+    }
+
+    if (state == RTT_STATE_SEARCHING) {
+        rtt_search();
+    } else {
+        active = rtt_poll_up();
+        if (state == RTT_STATE_RUNNING) {
+            active = rtt_poll_down() || active;
+        }
+    }
+
+    if (!mem_ap_end() && state == RTT_STATE_RUNNING) {
+        rtt_restart_search();
+    }
+
+    return active;
+}
+
+#endif
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RTT_H_INCLUDED
+#define RTT_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * SEGGER RTT polled from the probe. Once started, the engine searches
+ * target RAM for the RTT control block and then moves data between the
+ * target's up/down buffer 0 and a local byte stream (the virtual CDC
+ * port on the firmware), so that the host only sees a serial port.
+ */
+
+typedef size_t (*RTTSendFunction)(const uint8_t* data, size_t len);
+typedef size_t (*RTTRecvFunction)(uint8_t* data, size_t max_bytes);
+
+enum {
+    RTT_STATE_STOPPED,
+    RTT_STATE_SEARCHING,
+    RTT_STATE_RUNNING,
+};
+
+/* Up-buffer data goes to send_cb; down-buffer data comes from recv_cb */
+extern void rtt_setup(RTTSendFunction send_cb, RTTRecvFunction recv_cb);
+extern void rtt_start(uint32_t search_address, uint32_t search_size);
+extern void rtt_stop(void);
+extern uint8_t rtt_state(void);
+extern uint32_t rtt_control_block(void);
+
+/* Do one step of searching or polling; returns true if data moved */
+extern bool rtt_update(void);
+
+#endif
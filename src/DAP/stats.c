@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "DAP/CMSIS_DAP_config.h"
+#include "DAP/CMSIS_DAP.h"
+#include "DAP/stats.h"
+
+#if DAP_STATS_AVAILABLE
+
+/*
+ * Page 0 is the summary:
+ *   CPU clock (4), WAIT acks (4), FAULT acks (4), IN endpoint busy (4),
+ *   queue high-water mark (1), queue size (1)
+ * Pages 1 and up list DAP_STATS_PER_PAGE command buckets each:
+ *   command ID (1, 0x80 for the vendor bucket), count (4), cycles (4)
+ * All values are little-endian.
+ */
+
+#define DAP_STATS_HEADER        3
+#define DAP_STATS_ENTRY         9
+#define DAP_STATS_PER_PAGE      ((DAP_PACKET_SIZE - DAP_STATS_HEADER) / DAP_STATS_ENTRY)
+#define DAP_STATS_PAGES         (1 + (DAP_STATS_COMMANDS + DAP_STATS_PER_PAGE - 1) / DAP_STATS_PER_PAGE)
+
+struct dap_stats dap_stats;
+
+static uint8_t* put_u32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)(value >>  0);
+    out[1] = (uint8_t)(value >>  8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+    return out + 4;
+}
+
+uint32_t dap_stats_report(uint8_t* request, uint8_t* response) {
+    uint8_t page = request[1];
+    bool clear = (request[2] & 0x01) != 0;
+    uint8_t* out = &response[DAP_STATS_HEADER];
+
+    response[0] = request[0];
+    response[1] = DAP_OK;
+    response[2] = DAP_STATS_PAGES;
+
+    if (page == 0) {
+        out = put_u32(out, CPU_CLOCK);
+        out = put_u32(out, dap_stats.ack_wait);
+        out = put_u32(out, dap_stats.ack_fault);
+        out = put_u32(out, dap_stats.in_busy);
+        *out++ = dap_stats.queue_high_water;
+        *out++ = DAP_PACKET_QUEUE_SIZE;
+    } else if (page < DAP_STATS_PAGES) {
+        uint32_t index = (page - 1) * DAP_STATS_PER_PAGE;
+        uint32_t end = index + DAP_STATS_PER_PAGE;
+        if (end > DAP_STATS_COMMANDS) {
+            end = DAP_STATS_COMMANDS;
+        }
+
+        for (; index < end; index++) {
+            *out++ = (index == DAP_STATS_VENDOR) ? ID_DAP_Vendor0
+                                                 : (uint8_t)index;
+            out = put_u32(out, dap_stats.command_count[index]);
+            out = put_u32(out, dap_stats.command_cycles[index]);
+        }
+    } else {
+        response[1] = DAP_ERROR;
+    }
+
+    if (clear) {
+        memset(&dap_stats, 0, sizeof(dap_stats));
+    }
+
+    return ((3 << 16) | (uint32_t)(out - response));
+}
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef STATS_H_INCLUDED
+#define STATS_H_INCLUDED
+
+#include <stdint.h>
+
+#include "DAP/CMSIS_DAP.h"
+#include "config.h"
+
+/*
+ * Counters for profiling the probe, read out with vendor command 0x82.
+ * The standard command IDs up to DAP_UART_Status (0x23, CMSIS-DAP 2.1)
+ * get a bucket each; all vendor commands share the bucket after them,
+ * which is reported as command 0x80. Cycle counts are in CPU clocks and
+ * wrap around.
+ */
+
+#define DAP_STATS_STANDARD      0x24
+#define DAP_STATS_VENDOR        DAP_STATS_STANDARD
+#define DAP_STATS_COMMANDS      (DAP_STATS_STANDARD + 1)
+
+#if DAP_STATS_AVAILABLE
+
+struct dap_stats {
+    uint32_t command_count[DAP_STATS_COMMANDS];
+    uint32_t command_cycles[DAP_STATS_COMMANDS];
+    uint32_t ack_wait;
+    uint32_t ack_fault;
+    uint32_t in_busy;
+    uint8_t queue_high_water;
+};
+
+extern struct dap_stats dap_stats;
+
+static inline void dap_stats_command(uint8_t id, uint32_t cycles) {
+    uint8_t index = (id >= ID_DAP_Vendor0) ? DAP_STATS_VENDOR : id;
+    if (index < DAP_STATS_STANDARD || index == DAP_STATS_VENDOR) {
+        dap_stats.command_count[index]++;
+        dap_stats.command_cycles[index] += cycles;
+    }
+}
+
+static inline void dap_stats_ack(uint8_t ack) {
+    if (ack == DAP_TRANSFER_WAIT) {
+        dap_stats.ack_wait++;
+    } else if (ack == DAP_TRANSFER_FAULT) {
+        dap_stats.ack_fault++;
+    }
+}
+
+static inline void dap_stats_queue_depth(uint8_t depth) {
+    if (depth > dap_stats.queue_high_water) {
+        dap_stats.queue_high_water = depth;
+    }
+}
+
+static inline void dap_stats_in_busy(void) {
+    dap_stats.in_busy++;
+}
+
+/* Vendor command handler:
+   request:  ID, page, flags (bit 0: clear all counters afterwards)
+   response: ID, status, number of pages, then the page contents */
+extern uint32_t dap_stats_report(uint8_t* request, uint8_t* response);
+
+#else
+
+static inline void dap_stats_command(uint8_t id, uint32_t cycles) {
+    (void)id;
+    (void)cycles;
+}
+
+static inline void dap_stats_ack(uint8_t ack) {
+    (void)ack;
+}
+
+static inline void dap_stats_queue_depth(uint8_t depth) {
+    (void)depth;
+}
+
+static inline void dap_stats_in_busy(void) {
+}
+
+#endif
+
+#endif
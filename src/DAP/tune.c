@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "DAP/CMSIS_DAP_config.h"
+#include "DAP/CMSIS_DAP.h"
+#include "DAP/mem_ap.h"
+#include "DAP/tune.h"
+
+#if DAP_CLOCK_TUNE_AVAILABLE && (DAP_SWD != 0)
+
+#define TUNE_DEFAULT_ITERATIONS 32U
+#define TUNE_DEFAULT_MIN_CLOCK  100000U
+
+#define AP_TAR                  0x04U
+#define ABORT_CLEAR_ERRORS      0x1EU
+
+#define AP_READ(reg)            (DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW | (reg))
+#define AP_WRITE(reg)           (DAP_TRANSFER_APnDP | (reg))
+
+/* Clock of a delay loop setting, rounded up; measured at startup
+   where the board calibrates the delay loops */
+static uint32_t tune_clock(bool fast, uint32_t delay) {
+    uint32_t period = SWJ_ClockPeriod(fast ? 1 : 0, delay);
+    return (CPU_CLOCK * SWJ_PERIOD_SCALE + period - 1) / period;
+}
+
+/* Switch the transfers over to a delay loop setting */
+static void tune_apply(bool fast, uint32_t delay) {
+    DAP_Data.fast_clock = fast ? 1 : 0;
+    DAP_Data.clock_delay = fast ? 1 : delay;
+    DAP_Data.clock_actual = tune_clock(fast, delay);
+#if (DAP_SWD_TIMER != 0)
+    DAP_Data.timer_clock = 0;
+#endif
+#if (DAP_SWD_SPI != 0)
+    DAP_Data.spi_clock = 0;
+#endif
+    SWD_TransferSelect();
+}
+
+static bool tune_transfer(uint32_t request, uint32_t* data) {
+    uint32_t retry = DAP_Data.transfer.retry_count;
+    uint8_t ack;
+
+    do {
+        ack = SWD_Transfer(request, data);
+    } while (ack == DAP_TRANSFER_WAIT && retry--);
+
+    return ack == DAP_TRANSFER_OK;
+}
+
+static bool tune_write(uint32_t request, uint32_t value) {
+    return tune_transfer(request, &value);
+}
+
+/* Bring the target back after a failed setting: line reset, IDCODE,
+   clear the sticky errors and select AP 0 bank 0 again */
+static bool tune_recover(void) {
+    static uint8_t line_reset[7] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+    };
+    static uint8_t idle = 0x00;
+    uint32_t idcode;
+
+    SWJ_Sequence(51, line_reset);
+    SWJ_Sequence(8, &idle);
+
+    return tune_transfer(DP_IDCODE | DAP_TRANSFER_RnW, &idcode)
+        && tune_write(DP_ABORT, ABORT_CLEAR_ERRORS)
+        && tune_write(DP_SELECT, 0);
+}
+
+/* Run the test pattern at the current setting */
+static bool tune_check(uint32_t idcode, uint32_t iterations) {
+    uint32_t i;
+
+    for (i = 0; i < iterations; i++) {
+        uint32_t pattern = (0xAAAAAAAAU ^ (i * 0x9E3779B9U)) & ~0x3U;
+        uint32_t value;
+
+        if (!tune_transfer(DP_IDCODE | DAP_TRANSFER_RnW, &value)
+            || value != idcode) {
+            return false;
+        }
+
+        /* The TAR read is posted; RDBUFF returns it */
+        if (!tune_write(AP_WRITE(AP_TAR), pattern)
+            || !tune_transfer(AP_READ(AP_TAR), NULL)
+            || !tune_transfer(DP_RDBUFF | DAP_TRANSFER_RnW, &value)
+            || value != pattern) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint32_t dap_tune_clock(uint8_t* request, uint8_t* response) {
+    uint32_t iterations = request[1];
+    uint32_t min_clock = ((uint32_t)request[2] <<  0)
+                       | ((uint32_t)request[3] <<  8)
+                       | ((uint32_t)request[4] << 16)
+                       | ((uint32_t)request[5] << 24);
+    uint32_t host_clock = DAP_Data.clock_request;
+    uint32_t idcode;
+    uint32_t clock = 0;
+    uint32_t delay = 1;
+    uint8_t steps = 0;
+    bool fast = true;
+    bool started;
+    bool found = false;
+    bool failed = false;
+
+    if (iterations == 0) {
+        iterations = TUNE_DEFAULT_ITERATIONS;
+    }
+    if (min_clock == 0) {
+        min_clock = TUNE_DEFAULT_MIN_CLOCK;
+    }
+
+    /* The reference IDCODE is read at the clock the host chose */
+    started = mem_ap_begin();
+    if (started && !tune_transfer(DP_IDCODE | DAP_TRANSFER_RnW, &idcode)) {
+        mem_ap_end();
+        started = false;
+    }
+
+    while (started && steps < 0xFF) {
+        clock = tune_clock(fast, delay);
+        if (!fast && clock < min_clock) {
+            break;
+        }
+
+        tune_apply(fast, delay);
+        steps++;
+
+        if ((!failed || tune_recover()) && tune_check(idcode, iterations)) {
+            found = true;
+            break;
+        }
+        failed = true;
+
+        if (fast) {
+            fast = false;
+        } else {
+            delay += (delay >= 4) ? delay / 4 : 1;
+        }
+    }
+
+    if (started) {
+        /* Keep the exact delay loop setting that passed; going through
+           SWJ_SetClock() could switch a slow enough clock over to the
+           timer, which was never tested */
+        if (found) {
+            DAP_Data.clock_request = clock;
+        } else {
+            SWJ_SetClock(host_clock);
+            if (failed) {
+                tune_recover();
+            }
+        }
+        mem_ap_end();
+    }
+
+    response[0] = request[0];
+    response[1] = found ? DAP_OK : DAP_ERROR;
+    response[2] = steps;
+    response[3] = (found && fast) ? 1 : 0;
+    response[4] = found ? (uint8_t)(delay >> 0) : 0;
+    response[5] = found ? (uint8_t)(delay >> 8) : 0;
+    if (!found) {
+        clock = 0;
+    }
+    response[6] = (uint8_t)(clock >>  0);
+    response[7] = (uint8_t)(clock >>  8);
+    response[8] = (uint8_t)(clock >> 16);
+    response[9] = (uint8_t)(clock >> 24);
+
+    return ((6 << 16) | 10);
+}
+
+#endif
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef TUNE_H_INCLUDED
+#define TUNE_H_INCLUDED
+
+#include <stdint.h>
+
+#include "config.h"
+
+/*
+ * Vendor command 0x84: search for the fastest SWD clock that the target
+ * connection handles without errors. Starting with the fast clock and
+ * then lengthening the clock delay step by step, each setting must pass
+ * a number of IDCODE reads and TAR write/read-back round trips without
+ * a single failed ACK, parity error or wrong value. The first setting
+ * that does is kept.
+ *
+ * The debugger must have connected and powered up the debug domain;
+ * the host's SELECT and TAR are put back afterwards.
+ */
+
+#if DAP_CLOCK_TUNE_AVAILABLE
+
+/* request:  ID, iterations per setting (0: default),
+             slowest clock to try in Hz (4 bytes, 0: default)
+   response: ID, status, settings tried, fast clock flag,
+             clock delay (2 bytes), clock in Hz (4 bytes)
+   The clock is rounded up so that DAP_SWJ_Clock selects the same
+   setting again. */
+extern uint32_t dap_tune_clock(uint8_t* request, uint8_t* response);
+
+#endif
+
+#endif
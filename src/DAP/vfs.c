@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "DAP/drop.h"
+#include "DAP/vfs.h"
+
+#if MSD_AVAILABLE
+
+/* 8MB in 4KB clusters is still small enough for FAT12 */
+#define SECTORS_PER_CLUSTER     8U
+#define RESERVED_SECTORS        1U
+#define FAT_COUNT               2U
+#define FAT_SECTORS             6U
+#define ROOT_ENTRIES            64U
+#define ROOT_SECTORS            (ROOT_ENTRIES * 32U / VFS_SECTOR_SIZE)
+
+#define FAT_START               RESERVED_SECTORS
+#define ROOT_START              (FAT_START + FAT_COUNT * FAT_SECTORS)
+#define DATA_START              (ROOT_START + ROOT_SECTORS)
+
+#define CLUSTER_SIZE            (SECTORS_PER_CLUSTER * VFS_SECTOR_SIZE)
+#define CLUSTER_COUNT           ((VFS_SECTOR_COUNT - DATA_START) / SECTORS_PER_CLUSTER)
+
+#if CLUSTER_COUNT + 2 > FAT_SECTORS * VFS_SECTOR_SIZE * 2 / 3
+#error "The FAT is too small for the volume"
+#endif
+
+/* Directory entries */
+#define ENTRY_SIZE              32U
+#define ENTRY_ATTR              11U
+#define ENTRY_DATE              24U
+#define ENTRY_CLUSTER           26U
+#define ENTRY_FILE_SIZE         28U
+
+#define ATTR_READ_ONLY          0x01U
+#define ATTR_VOLUME_ID          0x08U
+#define ATTR_DIRECTORY          0x10U
+#define ATTR_LONG_NAME          0x0FU
+#define ENTRY_DELETED           0xE5U
+
+/* 2016-01-01 */
+#define FAT_DATE                ((36U << 9) | (1U << 5) | 1U)
+
+#define README_CLUSTER          2U
+#define STATUS_CLUSTER          3U
+
+/* Directory entries seen pointing at files copied on */
+#define KNOWN_FILES             8U
+
+static const char readme[] =
+    "Copy a flash algorithm file made by tools/dap_flash.py --export onto\r\n"
+    "this drive, then a .hex or .bin image to program it into the target.\r\n"
+    "STATUS.TXT tells how the last file went.\r\n";
+
+static const char status_line_end[] = "\r\n";
+
+static struct {
+    uint16_t cluster;
+    uint32_t size;
+} known[KNOWN_FILES];
+static uint8_t known_next;
+
+/* The file being passed to drop.c */
+static uint32_t next_lba;       /* Its next sector */
+static uint16_t file_cluster;
+static uint32_t file_received;
+static bool file_open;
+
+static bool written;            /* Since the last vfs_update() */
+static uint32_t last_write_ms;
+static volatile bool changed;
+
+static void vfs_put_u16(uint8_t* data, uint32_t value) {
+    data[0] = (uint8_t)(value >> 0);
+    data[1] = (uint8_t)(value >> 8);
+}
+
+static void vfs_put_u32(uint8_t* data, uint32_t value) {
+    vfs_put_u16(&data[0], value & 0xFFFFU);
+    vfs_put_u16(&data[2], value >> 16);
+}
+
+static uint32_t vfs_get_u32(const uint8_t* data) {
+    return ((uint32_t)data[0] <<  0)
+         | ((uint32_t)data[1] <<  8)
+         | ((uint32_t)data[2] << 16)
+         | ((uint32_t)data[3] << 24);
+}
+
+static uint32_t vfs_status_size(void) {
+    return strlen(drop_status()) + sizeof(status_line_end) - 1;
+}
+
+static void vfs_name(uint8_t* entry, const char* name) {
+    memset(entry, ' ', 11);
+    memcpy(entry, name, strlen(name));
+}
+
+static void vfs_boot_sector(uint8_t* data) {
+    static const uint8_t jump[] = { 0xEB, 0x3C, 0x90 };
+
+    memcpy(&data[0], jump, sizeof(jump));
+    memcpy(&data[3], "MSDOS5.0", 8);
+    vfs_put_u16(&data[11], VFS_SECTOR_SIZE);
+    data[13] = SECTORS_PER_CLUSTER;
+    vfs_put_u16(&data[14], RESERVED_SECTORS);
+    data[16] = FAT_COUNT;
+    vfs_put_u16(&data[17], ROOT_ENTRIES);
+    vfs_put_u16(&data[19], VFS_SECTOR_COUNT);
+    data[21] = 0xF8;                    /* Fixed disk */
+    vfs_put_u16(&data[22], FAT_SECTORS);
+    vfs_put_u16(&data[24], 63);         /* Sectors per track */
+    vfs_put_u16(&data[26], 255);        /* Heads */
+    data[36] = 0x80;                    /* Drive number */
+    data[38] = 0x29;                    /* Extended boot signature */
+    vfs_put_u32(&data[39], 0xDA420001U);
+    vfs_name(&data[43], PRODUCT_NAME);
+    memcpy(&data[54], "FAT12   ", 8);
+    data[510] = 0x55;
+    data[511] = 0xAA;
+}
+
+/* Only the media descriptor and the two files are allocated */
+static uint32_t vfs_fat_entry(uint32_t cluster) {
+    switch (cluster) {
+        case 0:
+            return 0xFF8U;
+        case 1:
+        case README_CLUSTER:
+        case STATUS_CLUSTER:
+            return 0xFFFU;
+        default:
+            return 0;
+    }
+}
+
+static void vfs_fat_sector(uint32_t sector, uint8_t* data) {
+    uint32_t i;
+
+    /* Two 12-bit entries in every three bytes */
+    for (i = 0; i < VFS_SECTOR_SIZE; i++) {
+        uint32_t byte = sector * VFS_SECTOR_SIZE + i;
+        uint32_t pair = (byte / 3) * 2;
+        uint32_t packed = vfs_fat_entry(pair) | (vfs_fat_entry(pair + 1) << 12);
+        data[i] = (uint8_t)(packed >> (8 * (byte % 3)));
+    }
+}
+
+static void vfs_file_entry(uint8_t* entry, const char* name,
+                           uint32_t cluster, uint32_t size) {
+    vfs_name(entry, name);
+    entry[ENTRY_ATTR] = ATTR_READ_ONLY;
+    vfs_put_u16(&entry[ENTRY_DATE], FAT_DATE);
+    vfs_put_u16(&entry[ENTRY_CLUSTER], cluster);
+    vfs_put_u32(&entry[ENTRY_FILE_SIZE], size);
+}
+
+static void vfs_root_sector(uint8_t* data) {
+    vfs_name(&data[0], PRODUCT_NAME);
+    data[ENTRY_ATTR] = ATTR_VOLUME_ID;
+    vfs_put_u16(&data[ENTRY_DATE], FAT_DATE);
+
+    vfs_file_entry(&data[ENTRY_SIZE], "README  TXT",
+                   README_CLUSTER, sizeof(readme) - 1);
+    vfs_file_entry(&data[2 * ENTRY_SIZE], "STATUS  TXT",
+                   STATUS_CLUSTER, vfs_status_size());
+}
+
+void vfs_read_sector(uint32_t lba, uint8_t* data) {
+    memset(data, 0, VFS_SECTOR_SIZE);
+
+    if (lba == 0) {
+        vfs_boot_sector(data);
+    } else if (lba >= FAT_START && lba < ROOT_START) {
+        vfs_fat_sector((lba - FAT_START) % FAT_SECTORS, data);
+    } else if (lba == ROOT_START) {
+        vfs_root_sector(data);
+    } else if (lba == DATA_START + (README_CLUSTER - 2) * SECTORS_PER_CLUSTER) {
+        memcpy(data, readme, sizeof(readme) - 1);
+    } else if (lba == DATA_START + (STATUS_CLUSTER - 2) * SECTORS_PER_CLUSTER) {
+        const char* status = drop_status();
+        memcpy(data, status, strlen(status));
+        memcpy(&data[strlen(status)], status_line_end,
+               sizeof(status_line_end) - 1);
+    }
+}
+
+static uint32_t vfs_known_size(uint16_t cluster) {
+    uint32_t i;
+
+    for (i = 0; i < KNOWN_FILES; i++) {
+        if (known[i].cluster == cluster && cluster != 0) {
+            return known[i].size;
+        }
+    }
+
+    return 0;
+}
+
+/* Note where the host put its files and how long they are */
+static void vfs_scan_root(const uint8_t* data) {
+    uint32_t i;
+
+    for (i = 0; i < VFS_SECTOR_SIZE; i += ENTRY_SIZE) {
+        const uint8_t* entry = &data[i];
+        uint16_t cluster = (uint16_t)(entry[ENTRY_CLUSTER]
+                                      | (entry[ENTRY_CLUSTER + 1] << 8));
+        uint32_t size = vfs_get_u32(&entry[ENTRY_FILE_SIZE]);
+        uint32_t slot;
+
+        if (entry[0] == 0 || entry[0] == ENTRY_DELETED
+            || (entry[ENTRY_ATTR] & (ATTR_VOLUME_ID | ATTR_DIRECTORY))
+            || entry[ENTRY_ATTR] == ATTR_LONG_NAME
+            || cluster <= STATUS_CLUSTER || size == 0) {
+            continue;
+        }
+
+        for (slot = 0; slot < KNOWN_FILES; slot++) {
+            if (known[slot].cluster == cluster) {
+                break;
+            }
+        }
+        if (slot == KNOWN_FILES) {
+            slot = known_next;
+            known_next = (known_next + 1) % KNOWN_FILES;
+        }
+        known[slot].cluster = cluster;
+        known[slot].size = size;
+    }
+}
+
+static void vfs_file_done(void) {
+    file_open = false;
+    changed = true;
+}
+
+void vfs_write_sector(uint32_t lba, const uint8_t* data) {
+    uint32_t len = VFS_SECTOR_SIZE;
+    uint32_t size;
+
+    written = true;
+
+    if (lba >= ROOT_START && lba < DATA_START) {
+        vfs_scan_root(data);
+        size = vfs_known_size(file_cluster);
+        if (file_open && size > 0 && file_received >= size) {
+            drop_end();
+            vfs_file_done();
+        }
+        return;
+    }
+
+    if (lba < DATA_START || lba >= VFS_SECTOR_COUNT) {
+        return;
+    }
+
+    if (lba == next_lba) {
+        /* The rest of a file that's over already */
+        if (!file_open) {
+            next_lba++;
+            return;
+        }
+    } else if (!file_open && drop_detect(data, len)) {
+        file_cluster = (uint16_t)((lba - DATA_START) / SECTORS_PER_CLUSTER + 2);
+        file_received = 0;
+        file_open = true;
+    } else {
+        return;
+    }
+
+    size = vfs_known_size(file_cluster);
+    if (size > 0 && size - file_received < len) {
+        len = size - file_received;
+    }
+
+    if (file_received == 0) {
+        file_open = drop_begin(data, len);
+    } else {
+        file_open = drop_write(data, len);
+    }
+
+    file_received += len;
+    next_lba = lba + 1;
+
+    if (file_open && size > 0 && file_received >= size) {
+        drop_end();
+        file_open = false;
+    }
+    if (!file_open) {
+        vfs_file_done();
+    }
+}
+
+bool vfs_update(uint32_t now_ms) {
+    if (written) {
+        written = false;
+        last_write_ms = now_ms;
+    } else if (file_open && now_ms - last_write_ms >= VFS_IDLE_TIMEOUT_MS) {
+        drop_end();
+        vfs_file_done();
+    }
+
+    return file_open;
+}
+
+bool vfs_media_changed(void) {
+    bool result = changed;
+    changed = false;
+    return result;
+}
+
+#endif
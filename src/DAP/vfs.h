@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef VFS_H_INCLUDED
+#define VFS_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "config.h"
+
+/*
+ * The FAT12 volume behind the mass storage interface. Nothing is
+ * stored: every sector is made up when it is read, and the volume
+ * always holds just README.TXT and STATUS.TXT, the latter with the
+ * outcome of the last file copied on.
+ *
+ * Sectors written to the data area are handed to drop.c, starting
+ * with the first one that drop_detect() accepts and going on with the
+ * sectors right after it; new files are allocated contiguously on an
+ * empty FAT volume. The file ends when the directory entry pointing
+ * at it says so, when drop.c has seen its end, or when no sector has
+ * come for VFS_IDLE_TIMEOUT_MS. Other writes are ignored.
+ */
+
+#define VFS_SECTOR_SIZE         512U
+#define VFS_SECTOR_COUNT        16384U
+#define VFS_IDLE_TIMEOUT_MS     1500U
+
+/* Reads are cheap enough to answer from the USB interrupt. Writes
+   may have to wait for the target to erase and program its flash, and
+   belong in the main loop. */
+extern void vfs_read_sector(uint32_t lba, uint8_t* data);
+extern void vfs_write_sector(uint32_t lba, const uint8_t* data);
+
+/* End a file that has stopped coming in; returns true while a file
+   is being programmed */
+extern bool vfs_update(uint32_t now_ms);
+
+/* Whether the contents changed since the last call, so that the host
+   has to read them again */
+extern bool vfs_media_changed(void);
+
+#endif
@@ -29,12 +29,19 @@
 #include "USB/cdc.h"
 #include "USB/vcdc.h"
 #include "USB/dfu.h"
+#include "USB/msc.h"
 
 #include "DAP/app.h"
+#include "DAP/rtt.h"
+#include "DAP/capture.h"
+#include "DAP/drop.h"
+#include "DAP/vfs.h"
 #include "DAP/CMSIS_DAP_config.h"
+#include "DAP/CMSIS_DAP.h"
 #include "DFU/DFU.h"
 
 #include "tick.h"
+#include "sched.h"
 #include "retarget.h"
 #include "console.h"
 
@@ -59,16 +66,151 @@ static inline void wait_ms(uint32_t duration_ms) {
     }
 }
 
-static uint32_t usb_timer = 0;
+/* The activity LED stays on for a while after the last USB transfer,
+   DAP command or RTT/capture data */
+#define LED_ACTIVITY_MS 50
+static volatile bool activity = false;
+static uint32_t led_off_time = 0;
+
+/* Also called from USB callbacks, which run in the USB interrupt */
 static void on_usb_activity(void) {
-    usb_timer = 1000;
+    activity = true;
 }
 
-static bool do_reset_to_dfu = false;
+/* Poll RTT every millisecond while idle, or right away while it has
+   data flowing */
+#define RTT_POLL_INTERVAL_MS 1
+static uint32_t rtt_next_poll = 0;
+
+static volatile bool do_reset_to_dfu = false;
 static void on_dfu_request(void) {
     do_reset_to_dfu = true;
 }
 
+/* How long DAP requests may run back to back before the other tasks
+   get a turn; a request is never split, so a long one overruns it */
+#define DAP_TASK_BUDGET_US 2000
+#define BACKGROUND_TASK_BUDGET_US 500
+
+/* Set while DAP requests keep coming or a chained response is being
+   sent, so that RTT and mass storage keep off the SWD port */
+static bool dap_busy = false;
+
+static bool dap_task(void) {
+    bool active = DAP_app_update();
+    dap_busy = active || DAP_app_chaining();
+    if (active) {
+        on_usb_activity();
+    } else if (!dap_busy && do_reset_to_dfu && DFU_AVAILABLE) {
+        /* Blink 3 times to indicate reset */
+        int x;
+        for (x=0; x < 3; x++) {
+            iwdg_reset();
+            led_num(7);
+            wait_ms(150);
+            led_num(0);
+            wait_ms(150);
+            iwdg_reset();
+        }
+
+        DFU_reset_and_jump_to_bootloader();
+    }
+
+    return active;
+}
+
+/* Pass captured DAP traffic on to the virtual CDC port */
+static bool capture_task(void) {
+    if (!DAP_CAPTURE_AVAILABLE || !capture_update()) {
+        return false;
+    }
+
+    on_usb_activity();
+    sched_post(SCHED_EVENT_VCDC);
+    return true;
+}
+
+/* Poll the target's RTT buffers between DAP commands */
+static bool rtt_task(void) {
+    if (!RTT_AVAILABLE || dap_busy
+        || (int32_t)(millis() - rtt_next_poll) < 0) {
+        return false;
+    }
+
+    if (!rtt_update()) {
+        rtt_next_poll = millis() + RTT_POLL_INTERVAL_MS;
+        return false;
+    }
+
+    on_usb_activity();
+    sched_post(SCHED_EVENT_VCDC);
+    return true;
+}
+
+/* Program dropped files between DAP commands. A sector is written in
+   one call, including any erase and programming it takes, so this can
+   hold the CPU for longer than its budget; the USB and UART transfers
+   carry on from their interrupts meanwhile. */
+static bool msd_task(void) {
+    if (!MSD_AVAILABLE || dap_busy) {
+        return false;
+    }
+
+    bool written = msc_update();
+    if (vfs_update(millis()) || written) {
+        on_usb_activity();
+    }
+
+    /* Another sector may have come in while this one was written */
+    return written;
+}
+
+/* Catch up on serial data the interrupts couldn't send */
+static bool serial_task(void) {
+    bool active = false;
+
+    cmp_usb_disable_interrupts();
+    if (CDC_AVAILABLE && cdc_uart_app_update()) {
+        active = true;
+    }
+
+    if (VCDC_AVAILABLE && vcdc_app_update()) {
+        active = true;
+    }
+    cmp_usb_enable_interrupts();
+
+    return active;
+}
+
+static bool led_task(void) {
+    if (activity) {
+        activity = false;
+        led_off_time = millis() + LED_ACTIVITY_MS;
+        LED_ACTIVITY_OUT(1);
+    } else if ((int32_t)(millis() - led_off_time) >= 0) {
+        LED_ACTIVITY_OUT(0);
+    }
+
+    return false;
+}
+
+/* In order of priority. The DAP task also polls SWO streaming, and
+   the tick lets every task notice timeouts and missed events. */
+static struct sched_task tasks[] = {
+    { &dap_task,        SCHED_EVENT_USB | SCHED_EVENT_UART | SCHED_EVENT_TICK,
+                        DAP_TASK_BUDGET_US, false },
+    { &capture_task,    SCHED_EVENT_USB | SCHED_EVENT_TICK,
+                        BACKGROUND_TASK_BUDGET_US, false },
+    { &rtt_task,        SCHED_EVENT_USB | SCHED_EVENT_TICK,
+                        BACKGROUND_TASK_BUDGET_US, false },
+    { &msd_task,        SCHED_EVENT_USB | SCHED_EVENT_TICK,
+                        BACKGROUND_TASK_BUDGET_US, false },
+    { &serial_task,     SCHED_EVENT_USB | SCHED_EVENT_UART | SCHED_EVENT_TICK
+                        | SCHED_EVENT_VCDC,
+                        0, false },
+    { &led_task,        SCHED_EVENT_TICK, 0, false },
+};
+
 int main(void) {
     if (DFU_AVAILABLE) {
         DFU_maybe_jump_to_bootloader();
@@ -117,7 +259,26 @@ int main(void) {
         dfu_setup(usbd_dev, &on_dfu_request);
     }
 
+    if (RTT_AVAILABLE) {
+        rtt_setup(&vcdc_send_buffered, &vcdc_recv_buffered);
+    }
+
+    if (DAP_CAPTURE_AVAILABLE) {
+        capture_setup(&vcdc_send_buffered);
+    }
+
+    if (MSD_AVAILABLE) {
+        /* Erasing can take longer than the watchdog period */
+        drop_setup(&iwdg_reset);
+        msc_setup(usbd_dev);
+    }
+
     tick_start();
+#if (SWJ_CLOCK_CALIBRATE != 0)
+    /* The debug port is still off; SysTick times the SWCLK loops */
+    SWJ_CalibrateClock();
+#endif
+    cmp_usb_enable_interrupts();
 
     /* Enable the watchdog to enable DFU recovery from bad firmware images */
     iwdg_set_period_ms(1000);
@@ -125,41 +286,7 @@ int main(void) {
 
     while (1) {
         iwdg_reset();
-        usbd_poll(usbd_dev);
-
-        if (CDC_AVAILABLE) {
-            cdc_uart_app_update();
-        }
-
-        if (VCDC_AVAILABLE) {
-            vcdc_app_update();
-        }
-
-        // Handle DAP
-        bool dap_active = DAP_app_update();
-        if (dap_active) {
-            usb_timer = 1000;
-        } else if (do_reset_to_dfu && DFU_AVAILABLE) {
-            /* Blink 3 times to indicate reset */
-            int x;
-            for (x=0; x < 3; x++) {
-                iwdg_reset();
-                led_num(7);
-                wait_ms(150);
-                led_num(0);
-                wait_ms(150);
-                iwdg_reset();
-            }
-
-            DFU_reset_and_jump_to_bootloader();
-        }
-
-        if (usb_timer > 0) {
-            usb_timer--;
-            LED_ACTIVITY_OUT(1);
-        } else {
-            LED_ACTIVITY_OUT(0);
-        }
+        sched_run(tasks, sizeof(tasks) / sizeof(tasks[0]));
     }
 
     return 0;
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include <libopencm3/usb/usbd.h>
+
+#include "composite_usb_conf.h"
+#include "bulk.h"
+
+#include "config.h"
+
+#if DAP_BULK_AVAILABLE
+
+/* User callbacks */
+static HostOutFunction bulk_packet_out_callback = NULL;
+static HostOutBufferFunction bulk_packet_buffer_callback = NULL;
+static GenericCallback bulk_packet_sent_callback = NULL;
+
+static usbd_device* bulk_usbd_dev = NULL;
+
+/* The previous packet was sent to the host */
+static void bulk_data_in(usbd_device *usbd_dev, uint8_t ep) {
+    (void)usbd_dev;
+    (void)ep;
+
+    if (bulk_packet_sent_callback != NULL) {
+        bulk_packet_sent_callback();
+    }
+}
+
+/* Receive data from the host */
+static void bulk_data_out(usbd_device *usbd_dev, uint8_t ep) {
+    uint8_t* buf = NULL;
+    uint16_t len;
+
+    if (bulk_packet_buffer_callback != NULL) {
+        buf = bulk_packet_buffer_callback();
+    }
+
+    if (buf == NULL) {
+        /* Nowhere to put it; drop it to clear the endpoint */
+        uint8_t discard[USB_DAP_BULK_MAX_PACKET_SIZE];
+        usbd_ep_read_packet(usbd_dev, ep, (void*)discard, sizeof(discard));
+        return;
+    }
+
+    len = usbd_ep_read_packet(usbd_dev, ep, (void*)buf,
+                              USB_DAP_BULK_MAX_PACKET_SIZE);
+    if (len > 0 && (bulk_packet_out_callback != NULL)) {
+        bulk_packet_out_callback(buf, len);
+    }
+}
+
+static void bulk_set_config(usbd_device* usbd_dev, uint16_t wValue) {
+    (void)wValue;
+
+    usbd_ep_setup(usbd_dev, ENDP_DAP_BULK_OUT, USB_ENDPOINT_ATTR_BULK,
+                  USB_DAP_BULK_MAX_PACKET_SIZE, &bulk_data_out);
+    usbd_ep_setup(usbd_dev, ENDP_DAP_BULK_IN, USB_ENDPOINT_ATTR_BULK,
+                  USB_DAP_BULK_MAX_PACKET_SIZE, &bulk_data_in);
+#if SWO_AVAILABLE
+    usbd_ep_setup(usbd_dev, ENDP_DAP_SWO_IN, USB_ENDPOINT_ATTR_BULK,
+                  USB_DAP_BULK_MAX_PACKET_SIZE, NULL);
+#endif
+}
+
+void bulk_setup(usbd_device* usbd_dev,
+                GenericCallback packet_sent_cb,
+                HostOutBufferFunction packet_buffer_cb,
+                HostOutFunction packet_recv_cb) {
+    bulk_usbd_dev = usbd_dev;
+    bulk_packet_out_callback = packet_recv_cb;
+    bulk_packet_buffer_callback = packet_buffer_cb;
+    bulk_packet_sent_callback = packet_sent_cb;
+
+    cmp_usb_register_set_config_callback(bulk_set_config);
+}
+
+bool bulk_send_packet(const uint8_t* packet, size_t len) {
+    uint16_t sent = usbd_ep_write_packet(bulk_usbd_dev, ENDP_DAP_BULK_IN,
+                                         (const void*)packet,
+                                         (uint16_t)len);
+    return (sent != 0);
+}
+
+void bulk_pause_receive(bool pause) {
+    if (cmp_usb_configured()) {
+        usbd_ep_nak_set(bulk_usbd_dev, ENDP_DAP_BULK_OUT, pause ? 1 : 0);
+    }
+}
+
+#if SWO_AVAILABLE
+bool bulk_send_trace(const uint8_t* data, size_t len) {
+    if (!cmp_usb_configured()) {
+        return false;
+    }
+    uint16_t sent = usbd_ep_write_packet(bulk_usbd_dev, ENDP_DAP_SWO_IN,
+                                         (const void*)data,
+                                         (uint16_t)len);
+    return (sent != 0);
+}
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef BULK_H_INCLUDED
+#define BULK_H_INCLUDED
+
+#include "usb_common.h"
+
+/* Same zero-copy scheme as hid_setup() */
+extern void bulk_setup(usbd_device* usbd_dev,
+                       GenericCallback packet_sent_cb,
+                       HostOutBufferFunction packet_buffer_cb,
+                       HostOutFunction packet_recv_cb);
+
+extern bool bulk_send_packet(const uint8_t* packet, size_t len);
+
+/* NAK OUT packets until unpaused */
+extern void bulk_pause_receive(bool pause);
+
+/* Stream SWO trace data on the optional third endpoint */
+extern bool bulk_send_trace(const uint8_t* data, size_t len);
+
+#endif
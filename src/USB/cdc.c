@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <libopencm3/cm3/cortex.h>
 #include <libopencm3/usb/usbd.h>
 #include <libopencm3/usb/cdc.h>
 
@@ -29,6 +30,10 @@
 
 #if CDC_AVAILABLE
 
+#if (CONSOLE_TX_BLOCK_SIZE < USB_CDC_MAX_PACKET_SIZE)
+#error "CONSOLE_TX_BUFFER_SIZE must hold two CDC packets"
+#endif
+
 /* Descriptors */
 const struct cdc_acm_functional_descriptors cdc_acm_functional_descriptors = {
     .header = {
@@ -62,7 +67,8 @@ const struct cdc_acm_functional_descriptors cdc_acm_functional_descriptors = {
 
 /* User callbacks */
 static HostOutFunction cdc_rx_callback = NULL;
-static HostInFunction cdc_tx_callback = NULL;
+static HostOutBufferFunction cdc_rx_buffer_callback = NULL;
+static GenericCallback cdc_tx_callback = NULL;
 static SetControlLineStateFunction cdc_set_control_line_state_callback = NULL;
 static SetLineCodingFunction cdc_set_line_coding_callback = NULL;
 static GetLineCodingFunction cdc_get_line_coding_callback = NULL;
@@ -145,19 +151,56 @@ static int cdc_control_class_request(usbd_device *usbd_dev,
 
 /* Receive data from the host */
 static void cdc_bulk_data_out(usbd_device *usbd_dev, uint8_t ep) {
-    uint8_t buf[USB_CDC_MAX_PACKET_SIZE];
-    uint16_t len = usbd_ep_read_packet(usbd_dev, ep, (void*)buf, sizeof(buf));
+    uint8_t* buf = NULL;
+    uint16_t len;
+
+    if (cdc_rx_buffer_callback != NULL) {
+        buf = cdc_rx_buffer_callback();
+    }
+
+    if (buf == NULL) {
+        /* Nowhere to put it; drop it to clear the endpoint */
+        uint8_t discard[USB_CDC_MAX_PACKET_SIZE];
+        usbd_ep_read_packet(usbd_dev, ep, (void*)discard, sizeof(discard));
+        return;
+    }
+
+    len = usbd_ep_read_packet(usbd_dev, ep, (void*)buf, USB_CDC_MAX_PACKET_SIZE);
     if (len > 0 && (cdc_rx_callback != NULL)) {
         cdc_rx_callback(buf, len);
     }
 }
 
+/* The host only sees the end of a transfer at a short packet, so a
+   full packet that isn't followed by another right away is ended with
+   a zero-length one */
+static volatile bool cdc_tx_full = false;
+static volatile bool cdc_tx_sent = false;
+
+/* The previous packet was sent to the host */
+static void cdc_bulk_data_in(usbd_device *usbd_dev, uint8_t ep) {
+    bool full = cdc_tx_full;
+    (void)ep;
+
+    cdc_tx_full = false;
+    cdc_tx_sent = false;
+    if (cdc_tx_callback != NULL) {
+        cdc_tx_callback();
+    }
+
+    if (full && !cdc_tx_sent) {
+        usbd_ep_write_packet(usbd_dev, ENDP_CDC_DATA_IN, NULL, 0);
+    }
+}
+
 static void cdc_set_config(usbd_device *usbd_dev, uint16_t wValue) {
     (void)wValue;
 
     usbd_ep_setup(usbd_dev, ENDP_CDC_DATA_OUT, USB_ENDPOINT_ATTR_BULK, 64,
                   cdc_bulk_data_out);
-    usbd_ep_setup(usbd_dev, ENDP_CDC_DATA_IN, USB_ENDPOINT_ATTR_BULK, 64, NULL);
+    usbd_ep_setup(usbd_dev, ENDP_CDC_DATA_IN, USB_ENDPOINT_ATTR_BULK, 64,
+                  cdc_bulk_data_in);
+    cdc_tx_full = false;
     usbd_ep_setup(usbd_dev, ENDP_CDC_COMM_IN, USB_ENDPOINT_ATTR_INTERRUPT, 16, NULL);
 
     cmp_usb_register_control_class_callback(INTF_CDC_DATA, cdc_control_class_request);
@@ -167,13 +210,15 @@ static void cdc_set_config(usbd_device *usbd_dev, uint16_t wValue) {
 static usbd_device* cdc_usbd_dev;
 
 void cdc_setup(usbd_device* usbd_dev,
-               HostInFunction cdc_tx_cb,
+               GenericCallback cdc_tx_cb,
+               HostOutBufferFunction cdc_rx_buffer_cb,
                HostOutFunction cdc_rx_cb,
                SetControlLineStateFunction set_control_line_state_cb,
                SetLineCodingFunction set_line_coding_cb,
                GetLineCodingFunction get_line_coding_cb) {
     cdc_usbd_dev = usbd_dev;
     cdc_tx_callback = cdc_tx_cb;
+    cdc_rx_buffer_callback = cdc_rx_buffer_cb;
     cdc_rx_callback = cdc_rx_cb;
     cdc_set_control_line_state_callback = set_control_line_state_cb,
     cdc_set_line_coding_callback = set_line_coding_cb;
@@ -189,9 +234,19 @@ bool cdc_send_data(const uint8_t* data, size_t len) {
     uint16_t sent = usbd_ep_write_packet(cdc_usbd_dev, ENDP_CDC_DATA_IN,
                                          (const void*)data,
                                          (uint16_t)len);
+    if (sent != 0) {
+        cdc_tx_full = (sent == USB_CDC_MAX_PACKET_SIZE);
+        cdc_tx_sent = true;
+    }
     return (sent != 0);
 }
 
+void cdc_pause_receive(bool pause) {
+    if (cmp_usb_configured()) {
+        usbd_ep_nak_set(cdc_usbd_dev, ENDP_CDC_DATA_OUT, pause ? 1 : 0);
+    }
+}
+
 /* CDC-ACM USB UART bridge functionality */
 
 // User callbacks
@@ -257,18 +312,95 @@ static bool cdc_uart_get_line_coding(struct usb_cdc_line_coding* line_coding) {
     return true;
 }
 
+/*
+  The bridge is driven from interrupts: packets from the host are read
+  straight into a free UART transmit block, and received UART data is
+  sent straight out of the UART receive buffer whenever the UART
+  reports new data or the previous IN packet was collected. Only full
+  packets go out right away; a short one is held back for up to
+  CDC_LATENCY_MS frames in case more data follows, like the latency
+  timer of FTDI chips, so that a stream of small writes doesn't take
+  one packet each.
+*/
+static volatile bool cdc_uart_paused = false;
+static volatile uint8_t cdc_uart_frames_waited = 0;
+
+static uint8_t* cdc_uart_receive_buffer(void) {
+    uint8_t* buf = console_tx_reserve();
+
+    /* The other block is still going out, so this is the last free one.
+       NAK the host before reading the packet that fills it. */
+    if (buf != NULL && console_tx_busy()) {
+        cdc_uart_paused = true;
+        cdc_pause_receive(true);
+    }
+
+    return buf;
+}
+
 static void cdc_uart_on_host_tx(uint8_t* data, uint16_t len) {
-    console_send_buffered(data, (size_t)len);
+    (void)data;
+    console_tx_commit(len);
     if (cdc_uart_rx_callback) {
         cdc_uart_rx_callback();
     }
 }
 
-static void cdc_uart_on_host_rx(uint8_t* data, uint16_t* len) {
-    *len = (uint16_t)console_recv_buffered(data, USB_CDC_MAX_PACKET_SIZE);
+static void cdc_uart_on_uart_tx(void) {
+    if (cdc_uart_paused && console_tx_reserve() != NULL) {
+        cdc_uart_paused = false;
+        cdc_pause_receive(false);
+    }
+}
+
+static bool cdc_uart_flush(void) {
+    const uint8_t* data;
+    size_t len = console_rx_peek(&data);
+
+    if (len == 0 || !cmp_usb_configured()) {
+        return false;
+    }
+
+    if (console_rx_pending() < USB_CDC_MAX_PACKET_SIZE
+        && cdc_uart_frames_waited < CDC_LATENCY_MS) {
+        return false;
+    }
+
+    if (len > USB_CDC_MAX_PACKET_SIZE) {
+        len = USB_CDC_MAX_PACKET_SIZE;
+    }
+
+    if (!cdc_send_data(data, len)) {
+        return false;
+    }
+
+    console_rx_consume(len);
+    cdc_uart_frames_waited = 0;
     if (cdc_uart_tx_callback) {
         cdc_uart_tx_callback();
     }
+    return true;
+}
+
+static void cdc_uart_on_uart_rx(void) {
+    cdc_uart_flush();
+}
+
+static void cdc_uart_on_host_rx(void) {
+    cdc_uart_flush();
+}
+
+/* Ages the data waiting for a full packet */
+static void cdc_uart_on_sof(void) {
+    if (console_rx_pending() == 0) {
+        cdc_uart_frames_waited = 0;
+        return;
+    }
+
+    if (cdc_uart_frames_waited < CDC_LATENCY_MS) {
+        cdc_uart_frames_waited++;
+    }
+    cdc_uart_flush();
 }
 
 void cdc_uart_app_setup(usbd_device* usbd_dev,
@@ -277,29 +409,19 @@ void cdc_uart_app_setup(usbd_device* usbd_dev,
     cdc_uart_tx_callback = cdc_tx_cb;
     cdc_uart_rx_callback = cdc_rx_cb;
 
-    cdc_setup(usbd_dev, &cdc_uart_on_host_rx, &cdc_uart_on_host_tx,
-              NULL, &cdc_uart_set_line_coding, &cdc_uart_get_line_coding);
+    cdc_setup(usbd_dev, &cdc_uart_on_host_rx, &cdc_uart_receive_buffer,
+              &cdc_uart_on_host_tx, NULL,
+              &cdc_uart_set_line_coding, &cdc_uart_get_line_coding);
+    console_set_callbacks(&cdc_uart_on_uart_rx, &cdc_uart_on_uart_tx);
+    cmp_usb_register_sof_callback(&cdc_uart_on_sof);
 }
 
+/* Catch up on anything the interrupts couldn't send, e.g. data that
+   arrived before the host configured the device */
 bool cdc_uart_app_update(void) {
-    bool active = false;
-    static uint16_t packet_len = 0;
-    static uint8_t packet_buffer[USB_CDC_MAX_PACKET_SIZE];
-
-    if (packet_len < USB_CDC_MAX_PACKET_SIZE) {
-        uint16_t max_bytes = (USB_CDC_MAX_PACKET_SIZE- packet_len);
-        packet_len += console_recv_buffered(&packet_buffer[packet_len], max_bytes);
-    }
-
-    if (packet_len > 0 && cmp_usb_configured()) {
-        if (cdc_send_data(packet_buffer, packet_len)) {
-            active = true;
-            packet_len = 0;
-            if (cdc_uart_tx_callback) {
-                cdc_uart_tx_callback();
-            }
-        }
-    }
+    uint32_t masked = cm_mask_interrupts(1);
+    bool active = cdc_uart_flush();
+    cm_mask_interrupts(masked);
 
     return active;
 }
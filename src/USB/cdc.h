@@ -31,13 +31,15 @@ typedef bool (*GetLineCodingFunction)(struct usb_cdc_line_coding* line_coding);
 extern const struct cdc_acm_functional_descriptors cdc_acm_functional_descriptors;
 
 extern void cdc_setup(usbd_device* usbd_dev,
-                      HostInFunction cdc_tx_cb,
+                      GenericCallback cdc_tx_cb,
+                      HostOutBufferFunction cdc_rx_buffer_cb,
                       HostOutFunction cdc_rx_cb,
                       SetControlLineStateFunction set_control_line_state_cb,
                       SetLineCodingFunction set_line_coding_cb,
                       GetLineCodingFunction get_line_coding_cb);
 
 extern bool cdc_send_data(const uint8_t* data, size_t len);
+extern void cdc_pause_receive(bool pause);
 
 extern void cdc_uart_app_setup(usbd_device* usbd_dev,
                                GenericCallback cdc_tx_cb,
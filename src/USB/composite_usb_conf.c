@@ -20,6 +20,7 @@
 #include <stdint.h>
 #include <string.h>
 
+#include <libopencm3/cm3/nvic.h>
 #include <libopencm3/usb/cdc.h>
 #include <libopencm3/usb/hid.h>
 #include <libopencm3/usb/dfu.h>
@@ -34,13 +35,20 @@
 #include "dfu.h"
 #include "cdc.h"
 #include "vcdc.h"
+#include "winusb.h"
 
 #include "config.h"
+#include "sched.h"
 
 static const struct usb_device_descriptor dev = {
     .bLength = USB_DT_DEVICE_SIZE,
     .bDescriptorType = USB_DT_DEVICE,
+#if DAP_BULK_AVAILABLE
+    /* USB 2.1 so that Windows asks for the BOS descriptor */
+    .bcdUSB = 0x0210,
+#else
     .bcdUSB = 0x0200,
+#endif
     .bDeviceClass = USB_CLASS_MISCELLANEOUS_DEVICE,
     .bDeviceSubClass = USB_MISC_SUBCLASS_COMMON,
     .bDeviceProtocol = USB_MISC_PROTOCOL_INTERFACE_ASSOCIATION_DESCRIPTOR,
@@ -261,6 +269,93 @@ static const struct usb_interface_descriptor hid_iface = {
     .extralen = sizeof(hid_function),
 };
 
+#if DAP_BULK_AVAILABLE
+
+static const struct usb_endpoint_descriptor dap_bulk_endpoints[] = {
+    {
+        .bLength = USB_DT_ENDPOINT_SIZE,
+        .bDescriptorType = USB_DT_ENDPOINT,
+        .bEndpointAddress = ENDP_DAP_BULK_OUT,
+        .bmAttributes = USB_ENDPOINT_ATTR_BULK,
+        .wMaxPacketSize = USB_DAP_BULK_MAX_PACKET_SIZE,
+        .bInterval = 0,
+    },
+    {
+        .bLength = USB_DT_ENDPOINT_SIZE,
+        .bDescriptorType = USB_DT_ENDPOINT,
+        .bEndpointAddress = ENDP_DAP_BULK_IN,
+        .bmAttributes = USB_ENDPOINT_ATTR_BULK,
+        .wMaxPacketSize = USB_DAP_BULK_MAX_PACKET_SIZE,
+        .bInterval = 0,
+    },
+#if SWO_AVAILABLE
+    /* Optional third endpoint for streaming SWO trace data */
+    {
+        .bLength = USB_DT_ENDPOINT_SIZE,
+        .bDescriptorType = USB_DT_ENDPOINT,
+        .bEndpointAddress = ENDP_DAP_SWO_IN,
+        .bmAttributes = USB_ENDPOINT_ATTR_BULK,
+        .wMaxPacketSize = USB_DAP_BULK_MAX_PACKET_SIZE,
+        .bInterval = 0,
+    },
+#endif
+};
+
+/* CMSIS-DAP v2 hosts identify the interface by "CMSIS-DAP" in its name */
+static const struct usb_interface_descriptor dap_bulk_iface = {
+    .bLength = USB_DT_INTERFACE_SIZE,
+    .bDescriptorType = USB_DT_INTERFACE,
+    .bInterfaceNumber = INTF_DAP_BULK,
+    .bAlternateSetting = 0,
+    .bNumEndpoints = sizeof(dap_bulk_endpoints)/sizeof(dap_bulk_endpoints[0]),
+    .bInterfaceClass = 0xFF,
+    .bInterfaceSubClass = 0,
+    .bInterfaceProtocol = 0,
+    .iInterface = 10,
+
+    .endpoint = dap_bulk_endpoints,
+};
+
+#endif
+
+#if MSD_AVAILABLE
+
+static const struct usb_endpoint_descriptor msc_endpoints[] = {
+    {
+        .bLength = USB_DT_ENDPOINT_SIZE,
+        .bDescriptorType = USB_DT_ENDPOINT,
+        .bEndpointAddress = ENDP_MSD_OUT,
+        .bmAttributes = USB_ENDPOINT_ATTR_BULK,
+        .wMaxPacketSize = USB_MSC_MAX_PACKET_SIZE,
+        .bInterval = 0,
+    },
+    {
+        .bLength = USB_DT_ENDPOINT_SIZE,
+        .bDescriptorType = USB_DT_ENDPOINT,
+        .bEndpointAddress = ENDP_MSD_IN,
+        .bmAttributes = USB_ENDPOINT_ATTR_BULK,
+        .wMaxPacketSize = USB_MSC_MAX_PACKET_SIZE,
+        .bInterval = 0,
+    },
+};
+
+/* Mass storage, SCSI transparent command set, bulk-only transport */
+static const struct usb_interface_descriptor msc_iface = {
+    .bLength = USB_DT_INTERFACE_SIZE,
+    .bDescriptorType = USB_DT_INTERFACE,
+    .bInterfaceNumber = INTF_MSC,
+    .bAlternateSetting = 0,
+    .bNumEndpoints = 2,
+    .bInterfaceClass = 0x08,
+    .bInterfaceSubClass = 0x06,
+    .bInterfaceProtocol = 0x50,
+    .iInterface = 11,
+
+    .endpoint = msc_endpoints,
+};
+
+#endif
+
 #if DFU_AVAILABLE
 
 static const struct usb_interface_descriptor dfu_iface = {
@@ -319,7 +414,21 @@ static const struct usb_interface interfaces[] = {
     {
         .num_altsetting = 1,
         .altsetting = &dfu_iface,
-    }
+    },
+#endif
+#if DAP_BULK_AVAILABLE
+    /* CMSIS-DAP v2 bulk interface */
+    {
+        .num_altsetting = 1,
+        .altsetting = &dap_bulk_iface,
+    },
+#endif
+#if MSD_AVAILABLE
+    /* Drag-and-drop programming interface */
+    {
+        .num_altsetting = 1,
+        .altsetting = &msc_iface,
+    },
 #endif
 };
 
@@ -348,6 +457,8 @@ static const char *usb_strings[] = {
     (PRODUCT_NAME " DFU"),
     "SLCAN CDC Control",
     "SLCAN CDC Data",
+    (PRODUCT_NAME " CMSIS-DAP v2"),
+    (PRODUCT_NAME " Drag-n-Drop"),
 };
 
 void cmp_set_usb_serial_number(const char* serial) {
@@ -385,6 +496,10 @@ static uint8_t num_control_class_callbacks;
 static usbd_set_config_callback set_config_callbacks[USB_MAX_SET_CONFIG_CALLBACKS];
 static uint8_t num_set_config_callbacks;
 
+/* Start-of-frame handlers */
+static usbd_sof_callback sof_callbacks[USB_MAX_SOF_CALLBACKS];
+static uint8_t num_sof_callbacks;
+
 void cmp_usb_register_control_class_callback(uint16_t interface,
                                              usbd_control_callback callback) {
     if (num_control_class_callbacks < USB_MAX_CONTROL_CLASS_CALLBACKS) {
@@ -451,6 +566,21 @@ static void cmp_usb_set_config(usbd_device* usbd_dev, uint16_t wValue) {
     }
 }
 
+void cmp_usb_register_sof_callback(usbd_sof_callback callback) {
+    if (callback && num_sof_callbacks < USB_MAX_SOF_CALLBACKS) {
+        sof_callbacks[num_sof_callbacks++] = callback;
+    }
+}
+
+static void cmp_usb_handle_sof(void) {
+    uint8_t i;
+    for (i=0; i < num_sof_callbacks; i++) {
+        sof_callbacks[i]();
+    }
+}
+
+static usbd_device* cmp_usbd_dev = NULL;
+
 usbd_device* cmp_usb_setup(void) {
     int num_strings = sizeof(usb_strings)/sizeof(const char*);
 
@@ -458,7 +588,30 @@ usbd_device* cmp_usb_setup(void) {
     usbd_device* usbd_dev = usbd_init(driver, &dev, &config,
                                       usb_strings, num_strings,
                                       usbd_control_buffer, sizeof(usbd_control_buffer));
+    cmp_usbd_dev = usbd_dev;
     usbd_register_set_config_callback(usbd_dev, cmp_usb_set_config);
     usbd_register_reset_callback(usbd_dev, cmp_usb_handle_reset);
+    usbd_register_sof_callback(usbd_dev, cmp_usb_handle_sof);
+#if DAP_BULK_AVAILABLE
+    winusb_setup(usbd_dev);
+#endif
     return usbd_dev;
 }
+
+/* USB events are serviced from the USB interrupt so that packets keep
+   moving while the main loop is busy with a long SWD transfer. Code
+   outside the interrupt must mask it while touching endpoints or state
+   shared with the endpoint callbacks. The main loop is woken up to
+   act on whatever the callbacks left for it. */
+void USB_IRQ_NAME(void) {
+    usbd_poll(cmp_usbd_dev);
+    sched_post(SCHED_EVENT_USB);
+}
+
+void cmp_usb_enable_interrupts(void) {
+    nvic_enable_irq(USB_NVIC_LINE);
+}
+
+void cmp_usb_disable_interrupts(void) {
+    nvic_disable_irq(USB_NVIC_LINE);
+}
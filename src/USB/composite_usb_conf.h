@@ -25,6 +25,8 @@
 #define USB_CDC_MAX_PACKET_SIZE 64
 #define USB_VCDC_MAX_PACKET_SIZE 64
 #define USB_HID_MAX_PACKET_SIZE 64
+#define USB_DAP_BULK_MAX_PACKET_SIZE 64
+#define USB_MSC_MAX_PACKET_SIZE 64
 #define USB_SERIAL_NUM_LENGTH   24
 
 #define ENDP_CDC_DATA_OUT       0x01
@@ -35,6 +37,16 @@
 #define ENDP_VCDC_DATA_OUT       0x05
 #define ENDP_VCDC_DATA_IN        0x86
 #define ENDP_VCDC_COMM_IN        0x87
+#define ENDP_DAP_BULK_OUT       0x06
+#define ENDP_DAP_BULK_IN        0x81
+#define ENDP_DAP_SWO_IN         0x85
+/* Shares its endpoint numbers with the virtual CDC port */
+#define ENDP_MSD_OUT            0x07
+#define ENDP_MSD_IN             0x87
+
+#if MSD_AVAILABLE && VCDC_AVAILABLE
+#error "The mass storage interface needs the virtual CDC port's endpoints"
+#endif
 
 enum {
     INTF_HID,
@@ -49,10 +61,17 @@ enum {
 #if DFU_AVAILABLE
     INTF_DFU,
 #endif
+#if DAP_BULK_AVAILABLE
+    INTF_DAP_BULK,
+#endif
+#if MSD_AVAILABLE
+    INTF_MSC,
+#endif
 };
 
 #define USB_MAX_CONTROL_CLASS_CALLBACKS 8
 #define USB_MAX_SET_CONFIG_CALLBACKS    8
+#define USB_MAX_SOF_CALLBACKS           4
 
 extern void cmp_set_usb_serial_number(const char* serial);
 extern usbd_device* cmp_usb_setup(void);
@@ -60,5 +79,10 @@ extern bool cmp_usb_configured(void);
 extern void cmp_usb_register_control_class_callback(uint16_t interface,
                                                     usbd_control_callback callback);
 extern void cmp_usb_register_set_config_callback(usbd_set_config_callback callback);
+/* Called from the USB interrupt at every start of frame, once a
+   millisecond while the bus is active */
+extern void cmp_usb_register_sof_callback(usbd_sof_callback callback);
+extern void cmp_usb_enable_interrupts(void);
+extern void cmp_usb_disable_interrupts(void);
 
 #endif
@@ -61,7 +61,8 @@ const struct full_usb_hid_descriptor hid_function = {
 
 /* User callbacks */
 static HostOutFunction hid_report_out_callback = NULL;
-static HostInFunction hid_report_in_callback = NULL;
+static HostOutBufferFunction hid_report_buffer_callback = NULL;
+static GenericCallback hid_report_sent_callback = NULL;
 
 static usbd_device* hid_usbd_dev = NULL;
 
@@ -140,22 +141,33 @@ static int hid_control_class_request(usbd_device *usbd_dev,
     return status;
 }
 
-/* Handle sending a report to the host */
+/* The previous report was sent to the host */
 static void hid_interrupt_in(usbd_device *usbd_dev, uint8_t ep) {
-    if (hid_report_in_callback != NULL) {
-        uint8_t buf[USB_HID_MAX_PACKET_SIZE];
-        uint16_t len = 0;
-        hid_report_in_callback(buf, &len);
-        if (len > 0) {
-            usbd_ep_write_packet(usbd_dev, ep, (const void*)buf, len);
-        }
+    (void)usbd_dev;
+    (void)ep;
+
+    if (hid_report_sent_callback != NULL) {
+        hid_report_sent_callback();
     }
 }
 
 /* Receive data from the host */
 static void hid_interrupt_out(usbd_device *usbd_dev, uint8_t ep) {
-    uint8_t buf[USB_HID_MAX_PACKET_SIZE];
-    uint16_t len = usbd_ep_read_packet(usbd_dev, ep, (void*)buf, sizeof(buf));
+    uint8_t* buf = NULL;
+    uint16_t len;
+
+    if (hid_report_buffer_callback != NULL) {
+        buf = hid_report_buffer_callback();
+    }
+
+    if (buf == NULL) {
+        /* Nowhere to put it; drop it to clear the endpoint */
+        uint8_t discard[USB_HID_MAX_PACKET_SIZE];
+        usbd_ep_read_packet(usbd_dev, ep, (void*)discard, sizeof(discard));
+        return;
+    }
+
+    len = usbd_ep_read_packet(usbd_dev, ep, (void*)buf, USB_HID_MAX_PACKET_SIZE);
     if (len > 0 && (hid_report_out_callback != NULL)) {
         hid_report_out_callback(buf, len);
     }
@@ -178,11 +190,13 @@ static void hid_set_config(usbd_device* usbd_dev, uint16_t wValue) {
 }
 
 void hid_setup(usbd_device* usbd_dev,
-               HostInFunction report_send_cb,
+               GenericCallback report_sent_cb,
+               HostOutBufferFunction report_buffer_cb,
                HostOutFunction report_recv_cb) {
     hid_usbd_dev = usbd_dev;
     hid_report_out_callback = report_recv_cb;
-    hid_report_in_callback = report_send_cb;
+    hid_report_buffer_callback = report_buffer_cb;
+    hid_report_sent_callback = report_sent_cb;
 
     cmp_usb_register_set_config_callback(hid_set_config);
 }
@@ -193,3 +207,9 @@ bool hid_send_report(const uint8_t* report, size_t len) {
                                          (uint16_t)len);
     return (sent != 0);
 }
+
+void hid_pause_receive(bool pause) {
+    if (cmp_usb_configured()) {
+        usbd_ep_nak_set(hid_usbd_dev, ENDP_HID_REPORT_OUT, pause ? 1 : 0);
+    }
+}
@@ -24,10 +24,17 @@
 
 extern const struct full_usb_hid_descriptor hid_function;
 
+/* OUT reports are read straight into the buffer returned by
+   report_buffer_cb and then passed to report_recv_cb. report_sent_cb
+   is called whenever the IN endpoint is free for the next report. */
 extern void hid_setup(usbd_device* usbd_dev,
-                      HostInFunction report_send_cb,
+                      GenericCallback report_sent_cb,
+                      HostOutBufferFunction report_buffer_cb,
                       HostOutFunction report_recv_cb);
 
 extern bool hid_send_report(const uint8_t* report, size_t len);
 
+/* NAK OUT reports until unpaused */
+extern void hid_pause_receive(bool pause);
+
 #endif
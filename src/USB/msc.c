@@ -0,0 +1,457 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <string.h>
+
+#include <libopencm3/usb/usbd.h>
+
+#include "composite_usb_conf.h"
+#include "msc.h"
+
+#include "DAP/vfs.h"
+
+#include "config.h"
+
+#if MSD_AVAILABLE
+
+#define MSC_REQ_RESET           0xFF
+#define MSC_REQ_GET_MAX_LUN     0xFE
+
+#define MSC_CBW_SIGNATURE       0x43425355U     /* "USBC" */
+#define MSC_CSW_SIGNATURE       0x53425355U     /* "USBS" */
+#define MSC_CBW_SIZE            31U
+#define MSC_CSW_SIZE            13U
+#define MSC_CBW_FLAG_IN         0x80
+
+#define MSC_CSW_PASSED          0x00
+#define MSC_CSW_FAILED          0x01
+
+#define SCSI_TEST_UNIT_READY            0x00
+#define SCSI_REQUEST_SENSE              0x03
+#define SCSI_INQUIRY                    0x12
+#define SCSI_MODE_SENSE_6               0x1A
+#define SCSI_START_STOP_UNIT            0x1B
+#define SCSI_PREVENT_ALLOW_REMOVAL      0x1E
+#define SCSI_READ_FORMAT_CAPACITIES     0x23
+#define SCSI_READ_CAPACITY_10           0x25
+#define SCSI_READ_10                    0x28
+#define SCSI_WRITE_10                   0x2A
+#define SCSI_VERIFY_10                  0x2F
+#define SCSI_SYNCHRONIZE_CACHE_10       0x35
+#define SCSI_MODE_SENSE_10              0x5A
+
+#define SENSE_NONE                      0x00
+#define SENSE_ILLEGAL_REQUEST           0x05
+#define SENSE_UNIT_ATTENTION            0x06
+
+#define ASC_INVALID_COMMAND             0x20
+#define ASC_LBA_OUT_OF_RANGE            0x21
+#define ASC_MEDIUM_CHANGED              0x28
+
+enum {
+    MSC_STATE_CBW,      /* Waiting for a command */
+    MSC_STATE_IN,       /* Sending the response in the buffer */
+    MSC_STATE_READ,     /* Sending sectors */
+    MSC_STATE_WRITE,    /* Receiving sectors */
+    MSC_STATE_DISCARD,  /* Receiving data nobody asked for */
+    MSC_STATE_CSW,      /* Sending the status */
+};
+
+static usbd_device* msc_usbd_dev = NULL;
+
+static uint8_t state = MSC_STATE_CBW;
+
+/* Current command */
+static uint32_t tag;
+static uint32_t residue;
+static uint8_t csw_status;
+
+/* Sector or response being moved */
+static uint8_t buffer[VFS_SECTOR_SIZE] __attribute__ ((aligned (4)));
+static uint16_t buffer_len;
+static uint16_t buffer_offset;
+static bool short_sent;
+static uint32_t lba;
+static uint32_t blocks;
+
+/* Set once a written sector is complete, until msc_update() is done
+   with it; the OUT endpoint is NAKed meanwhile */
+static volatile bool write_pending = false;
+
+static uint8_t sense_key = SENSE_NONE;
+static uint8_t sense_asc = 0;
+
+static uint32_t get_be32(const uint8_t* data) {
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16)
+         | ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+}
+
+static uint16_t get_be16(const uint8_t* data) {
+    return (uint16_t)(((uint16_t)data[0] << 8) | data[1]);
+}
+
+static uint32_t get_le32(const uint8_t* data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8)
+         | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static void put_be32(uint8_t* data, uint32_t value) {
+    data[0] = (uint8_t)(value >> 24);
+    data[1] = (uint8_t)(value >> 16);
+    data[2] = (uint8_t)(value >> 8);
+    data[3] = (uint8_t)value;
+}
+
+static void put_le32(uint8_t* data, uint32_t value) {
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    data[2] = (uint8_t)(value >> 16);
+    data[3] = (uint8_t)(value >> 24);
+}
+
+static void msc_sense(uint8_t key, uint8_t asc) {
+    sense_key = key;
+    sense_asc = asc;
+    csw_status = MSC_CSW_FAILED;
+}
+
+static void msc_consume(uint32_t len) {
+    residue = (len < residue) ? (residue - len) : 0;
+}
+
+static void msc_send_csw(void) {
+    uint8_t csw[MSC_CSW_SIZE];
+    put_le32(&csw[0], MSC_CSW_SIGNATURE);
+    put_le32(&csw[4], tag);
+    put_le32(&csw[8], residue);
+    csw[12] = csw_status;
+
+    state = MSC_STATE_CSW;
+    usbd_ep_write_packet(msc_usbd_dev, ENDP_MSD_IN, csw, sizeof(csw));
+}
+
+/* Send the next packet of data, then the status once it is all sent.
+   If there is less data than the host asked for, a short or
+   zero-length packet ends it early. */
+static void msc_send_next(void) {
+    if (buffer_offset == buffer_len && state == MSC_STATE_READ && blocks > 0) {
+        vfs_read_sector(lba, buffer);
+        buffer_len = VFS_SECTOR_SIZE;
+        buffer_offset = 0;
+        lba++;
+        blocks--;
+    }
+
+    uint16_t len = buffer_len - buffer_offset;
+    if (len > USB_MSC_MAX_PACKET_SIZE) {
+        len = USB_MSC_MAX_PACKET_SIZE;
+    }
+
+    if (len == 0 && (residue == 0 || short_sent)) {
+        msc_send_csw();
+        return;
+    }
+
+    usbd_ep_write_packet(msc_usbd_dev, ENDP_MSD_IN,
+                         &buffer[buffer_offset], len);
+    buffer_offset += len;
+    msc_consume(len);
+    if (len < USB_MSC_MAX_PACKET_SIZE) {
+        short_sent = true;
+    }
+}
+
+static uint16_t msc_inquiry(void) {
+    static const char product[] = "Drag-n-Drop     ";
+    size_t vendor_len = strlen(PRODUCT_NAME);
+    if (vendor_len > 8) {
+        vendor_len = 8;
+    }
+
+    memset(buffer, ' ', 36);
+    buffer[0] = 0x00;           /* Direct access block device */
+    buffer[1] = 0x80;           /* Removable */
+    buffer[2] = 0x02;           /* SPC-2 */
+    buffer[3] = 0x02;           /* Response data format */
+    buffer[4] = 36 - 5;
+    buffer[5] = 0x00;
+    buffer[6] = 0x00;
+    buffer[7] = 0x00;
+    memcpy(&buffer[8], PRODUCT_NAME, vendor_len);
+    memcpy(&buffer[16], product, 16);
+    memcpy(&buffer[32], "1.10", 4);
+    return 36;
+}
+
+static uint16_t msc_request_sense(void) {
+    memset(buffer, 0, 18);
+    buffer[0] = 0x70;           /* Current error, fixed format */
+    buffer[2] = sense_key;
+    buffer[7] = 18 - 8;
+    buffer[12] = sense_asc;
+
+    sense_key = SENSE_NONE;
+    sense_asc = 0;
+    return 18;
+}
+
+/* Check the LBA and block count of a READ(10) or WRITE(10) and limit
+   the count to what the host is moving */
+static bool msc_blocks(const uint8_t* cb) {
+    lba = get_be32(&cb[2]);
+    blocks = get_be16(&cb[7]);
+    if (lba > VFS_SECTOR_COUNT || blocks > VFS_SECTOR_COUNT - lba) {
+        msc_sense(SENSE_ILLEGAL_REQUEST, ASC_LBA_OUT_OF_RANGE);
+        blocks = 0;
+        return false;
+    }
+
+    if (blocks > residue / VFS_SECTOR_SIZE) {
+        blocks = residue / VFS_SECTOR_SIZE;
+    }
+    return true;
+}
+
+static void msc_command(const uint8_t* cb, bool in) {
+    uint16_t len = 0;
+
+    csw_status = MSC_CSW_PASSED;
+    state = MSC_STATE_IN;
+
+    switch (cb[0]) {
+        case SCSI_TEST_UNIT_READY: {
+            if (vfs_media_changed()) {
+                msc_sense(SENSE_UNIT_ATTENTION, ASC_MEDIUM_CHANGED);
+            }
+            break;
+        }
+        case SCSI_REQUEST_SENSE: {
+            len = msc_request_sense();
+            break;
+        }
+        case SCSI_INQUIRY: {
+            len = msc_inquiry();
+            break;
+        }
+        case SCSI_MODE_SENSE_6: {
+            /* No pages, no block descriptors, not write protected */
+            memset(buffer, 0, 4);
+            buffer[0] = 4 - 1;
+            len = 4;
+            break;
+        }
+        case SCSI_MODE_SENSE_10: {
+            memset(buffer, 0, 8);
+            buffer[1] = 8 - 2;
+            len = 8;
+            break;
+        }
+        case SCSI_READ_CAPACITY_10: {
+            put_be32(&buffer[0], VFS_SECTOR_COUNT - 1);
+            put_be32(&buffer[4], VFS_SECTOR_SIZE);
+            len = 8;
+            break;
+        }
+        case SCSI_READ_FORMAT_CAPACITIES: {
+            memset(buffer, 0, 12);
+            buffer[3] = 8;
+            put_be32(&buffer[4], VFS_SECTOR_COUNT);
+            put_be32(&buffer[8], VFS_SECTOR_SIZE);
+            buffer[8] = 0x02;   /* Formatted media */
+            len = 12;
+            break;
+        }
+        case SCSI_READ_10: {
+            if (in && msc_blocks(cb)) {
+                state = MSC_STATE_READ;
+            }
+            break;
+        }
+        case SCSI_WRITE_10: {
+            if (!in && msc_blocks(cb) && blocks > 0) {
+                state = MSC_STATE_WRITE;
+                buffer_offset = 0;
+                return;
+            }
+            break;
+        }
+        case SCSI_START_STOP_UNIT:
+        case SCSI_PREVENT_ALLOW_REMOVAL:
+        case SCSI_VERIFY_10:
+        case SCSI_SYNCHRONIZE_CACHE_10: {
+            break;
+        }
+        default: {
+            msc_sense(SENSE_ILLEGAL_REQUEST, ASC_INVALID_COMMAND);
+            break;
+        }
+    }
+
+    if (!in) {
+        len = 0;
+    } else if (len > residue) {
+        len = (uint16_t)residue;
+    }
+
+    buffer_len = len;
+    buffer_offset = 0;
+    short_sent = false;
+
+    if (residue == 0) {
+        msc_send_csw();
+    } else if (in) {
+        msc_send_next();
+    } else {
+        state = MSC_STATE_DISCARD;
+    }
+}
+
+/* The previous packet was sent to the host */
+static void msc_data_in(usbd_device *usbd_dev, uint8_t ep) {
+    (void)usbd_dev;
+    (void)ep;
+
+    if (state == MSC_STATE_CSW) {
+        state = MSC_STATE_CBW;
+    } else if (state == MSC_STATE_IN || state == MSC_STATE_READ) {
+        msc_send_next();
+    }
+}
+
+/* Receive a command or data from the host */
+static void msc_data_out(usbd_device *usbd_dev, uint8_t ep) {
+    uint16_t len;
+
+    if (state == MSC_STATE_WRITE) {
+        len = usbd_ep_read_packet(usbd_dev, ep, &buffer[buffer_offset],
+                                  USB_MSC_MAX_PACKET_SIZE);
+        buffer_offset += len;
+        msc_consume(len);
+        if (buffer_offset >= VFS_SECTOR_SIZE) {
+            /* Hold off the host until the sector is written */
+            write_pending = true;
+            usbd_ep_nak_set(usbd_dev, ENDP_MSD_OUT, 1);
+        }
+        return;
+    }
+
+    uint8_t packet[USB_MSC_MAX_PACKET_SIZE];
+    len = usbd_ep_read_packet(usbd_dev, ep, packet, sizeof(packet));
+
+    if (state == MSC_STATE_DISCARD) {
+        msc_consume(len);
+        if (residue == 0) {
+            msc_send_csw();
+        }
+    } else if (state == MSC_STATE_CBW && len == MSC_CBW_SIZE
+               && get_le32(&packet[0]) == MSC_CBW_SIGNATURE) {
+        tag = get_le32(&packet[4]);
+        residue = get_le32(&packet[8]);
+        msc_command(&packet[15], (packet[12] & MSC_CBW_FLAG_IN) != 0);
+    }
+}
+
+bool msc_update(void) {
+    if (!write_pending) {
+        return false;
+    }
+
+    /* The OUT endpoint is NAKed, so the interrupt leaves the sector
+       alone while it is written */
+    vfs_write_sector(lba, buffer);
+
+    cmp_usb_disable_interrupts();
+    write_pending = false;
+    if (state == MSC_STATE_WRITE) {
+        lba++;
+        blocks--;
+        buffer_offset = 0;
+        if (blocks == 0) {
+            if (residue > 0) {
+                state = MSC_STATE_DISCARD;
+            } else {
+                msc_send_csw();
+            }
+        }
+    }
+    usbd_ep_nak_set(msc_usbd_dev, ENDP_MSD_OUT, 0);
+    cmp_usb_enable_interrupts();
+
+    return true;
+}
+
+static int msc_control_class_request(usbd_device *usbd_dev,
+                                     struct usb_setup_data *req,
+                                     uint8_t **buf, uint16_t *len,
+                                     usbd_control_complete_callback* complete) {
+    (void)complete;
+
+    if (req->wIndex != INTF_MSC) {
+        return USBD_REQ_NEXT_CALLBACK;
+    }
+    int status = USBD_REQ_NOTSUPP;
+
+    switch (req->bRequest) {
+        case MSC_REQ_GET_MAX_LUN: {
+            /* Only LUN 0 */
+            (*buf)[0] = 0;
+            *len = 1;
+            status = USBD_REQ_HANDLED;
+            break;
+        }
+        case MSC_REQ_RESET: {
+            state = MSC_STATE_CBW;
+            sense_key = SENSE_NONE;
+            sense_asc = 0;
+            if (!write_pending) {
+                usbd_ep_nak_set(usbd_dev, ENDP_MSD_OUT, 0);
+            }
+            status = USBD_REQ_HANDLED;
+            break;
+        }
+        default: {
+            status = USBD_REQ_NOTSUPP;
+            break;
+        }
+    }
+
+    return status;
+}
+
+static void msc_set_config(usbd_device* usbd_dev, uint16_t wValue) {
+    (void)wValue;
+
+    usbd_ep_setup(usbd_dev, ENDP_MSD_OUT, USB_ENDPOINT_ATTR_BULK,
+                  USB_MSC_MAX_PACKET_SIZE, &msc_data_out);
+    usbd_ep_setup(usbd_dev, ENDP_MSD_IN, USB_ENDPOINT_ATTR_BULK,
+                  USB_MSC_MAX_PACKET_SIZE, &msc_data_in);
+
+    state = MSC_STATE_CBW;
+    if (write_pending) {
+        usbd_ep_nak_set(usbd_dev, ENDP_MSD_OUT, 1);
+    }
+
+    cmp_usb_register_control_class_callback(INTF_MSC, msc_control_class_request);
+}
+
+void msc_setup(usbd_device* usbd_dev) {
+    msc_usbd_dev = usbd_dev;
+    cmp_usb_register_set_config_callback(msc_set_config);
+}
+
+#endif
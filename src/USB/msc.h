@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef MSC_H_INCLUDED
+#define MSC_H_INCLUDED
+
+#include "usb_common.h"
+
+/*
+ * USB mass storage, bulk-only transport with the SCSI transparent
+ * command set, for the drag-and-drop volume in DAP/vfs.c. Commands
+ * and reads are handled from the USB interrupt; each sector written
+ * by the host is held with the OUT endpoint NAKed until msc_update()
+ * has passed it on from the main loop.
+ */
+
+extern void msc_setup(usbd_device* usbd_dev);
+
+/* Pass on a written sector; returns true if there was one */
+extern bool msc_update(void);
+
+#endif
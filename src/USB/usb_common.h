@@ -28,4 +28,7 @@ typedef void (*GenericCallback)(void);
 typedef void (*HostOutFunction)(uint8_t* data, uint16_t len);
 typedef void (*HostInFunction)(uint8_t* data, uint16_t* len);
 
+/* Returns the buffer to read the next OUT packet into, or NULL to drop it */
+typedef uint8_t* (*HostOutBufferFunction)(void);
+
 #endif
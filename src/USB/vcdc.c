@@ -59,14 +59,16 @@ const struct cdc_acm_functional_descriptors vcdc_acm_functional_descriptors = {
 static uint8_t vcdc_tx_buffer[VCDC_TX_BUFFER_SIZE];
 static uint8_t vcdc_rx_buffer[VCDC_RX_BUFFER_SIZE];
 
-static uint16_t vcdc_tx_head = 0;
-static uint16_t vcdc_tx_tail = 0;
+/* Filled from the main loop, emptied from the USB interrupt */
+static volatile uint16_t vcdc_tx_head = 0;
+static volatile uint16_t vcdc_tx_tail = 0;
 
 static uint16_t vcdc_rx_head = 0;
 static uint16_t vcdc_rx_tail = 0;
 
-static bool vcdc_tx_buffer_empty(void) {
-    return vcdc_tx_head == vcdc_tx_tail;
+static uint16_t vcdc_tx_buffer_count(void) {
+    return (uint16_t)((vcdc_tx_tail + VCDC_TX_BUFFER_SIZE - vcdc_tx_head)
+                      % VCDC_TX_BUFFER_SIZE);
 }
 
 static bool vcdc_tx_buffer_full(void) {
@@ -78,12 +80,6 @@ static void vcdc_tx_buffer_put(uint8_t data) {
     vcdc_tx_tail = (vcdc_tx_tail + 1) % VCDC_TX_BUFFER_SIZE;
 }
 
-static uint8_t vcdc_tx_buffer_get(void) {
-    uint8_t data = vcdc_tx_buffer[vcdc_tx_head];
-    vcdc_tx_head = (vcdc_tx_head + 1) % VCDC_TX_BUFFER_SIZE;
-    return data;
-}
-
 static bool vcdc_rx_buffer_empty(void) {
     return vcdc_rx_head == vcdc_rx_tail;
 }
@@ -125,6 +121,61 @@ size_t vcdc_send_buffered(const uint8_t* data, size_t num_bytes) {
 static GenericCallback vcdc_rx_callback = NULL;
 static GenericCallback vcdc_tx_callback = NULL;
 
+static usbd_device* vcdc_usbd_dev;
+
+/*
+  Queued data goes out from the USB interrupt: the next packet is sent
+  when the previous one has been collected. Only full packets go out
+  right away; a short one is held back for up to VCDC_LATENCY_MS frames
+  in case more data follows, so that RTT output and printf()s written a
+  few bytes at a time share packets. The host only sees the end of a
+  transfer at a short packet, so a full packet that nothing follows is
+  ended with a zero-length one.
+*/
+static volatile bool vcdc_tx_busy = false;
+static volatile bool vcdc_tx_full = false;
+static volatile uint8_t vcdc_tx_frames_waited = 0;
+
+/* Runs in the USB interrupt, or with it masked */
+static bool vcdc_tx_kick(void) {
+    uint8_t buf[USB_VCDC_MAX_PACKET_SIZE];
+    uint16_t count = vcdc_tx_buffer_count();
+    uint16_t head = vcdc_tx_head;
+    uint16_t i;
+
+    if (vcdc_tx_busy || count == 0 || !cmp_usb_configured()) {
+        return false;
+    }
+
+    if (count < sizeof(buf) && vcdc_tx_frames_waited < VCDC_LATENCY_MS) {
+        return false;
+    }
+
+    if (count > sizeof(buf)) {
+        count = sizeof(buf);
+    }
+
+    for (i=0; i < count; i++) {
+        buf[i] = vcdc_tx_buffer[head];
+        head = (head + 1) % VCDC_TX_BUFFER_SIZE;
+    }
+
+    if (usbd_ep_write_packet(vcdc_usbd_dev, ENDP_VCDC_DATA_IN,
+                             (const void*)buf, count) == 0) {
+        return false;
+    }
+
+    vcdc_tx_head = head;
+    vcdc_tx_busy = true;
+    vcdc_tx_full = (count == sizeof(buf));
+    vcdc_tx_frames_waited = 0;
+    if (vcdc_tx_callback != NULL) {
+        vcdc_tx_callback();
+    }
+
+    return true;
+}
+
 static int vcdc_control_class_request(usbd_device *usbd_dev,
                                      struct usb_setup_data *req,
                                      uint8_t **buf, uint16_t *len,
@@ -191,25 +242,34 @@ static void vcdc_bulk_data_out(usbd_device *usbd_dev, uint8_t ep) {
     }
 }
 
-/* Send (more) data to the host */
-/*
+/* The previous packet was sent to the host; send more */
 static void vcdc_bulk_data_in(usbd_device *usbd_dev, uint8_t ep) {
-    uint8_t buf[USB_VCDC_MAX_PACKET_SIZE];
+    (void)ep;
+
+    vcdc_tx_busy = false;
+    if (vcdc_tx_full && vcdc_tx_buffer_count() == 0) {
+        vcdc_tx_full = false;
+        vcdc_tx_busy = true;
+        usbd_ep_write_packet(usbd_dev, ENDP_VCDC_DATA_IN, NULL, 0);
+        return;
+    }
 
-    size_t i;
-    for (i=0; i < sizeof(buf) && !vcdc_tx_buffer_empty(); i++) {
-        buf[i] = vcdc_tx_buffer_get();
+    vcdc_tx_full = false;
+    vcdc_tx_kick();
+}
+
+/* Ages the data waiting for a full packet */
+static void vcdc_on_sof(void) {
+    if (vcdc_tx_buffer_count() == 0) {
+        vcdc_tx_frames_waited = 0;
+        return;
     }
 
-    if (i > 0) {
-        vcdc_send_data(buf, i);
-    
-        if (vcdc_rx_callback != NULL) {
-            vcdc_tx_callback();
-        }
+    if (vcdc_tx_frames_waited < VCDC_LATENCY_MS) {
+        vcdc_tx_frames_waited++;
     }
+    vcdc_tx_kick();
 }
-*/
 
 static void vcdc_set_config(usbd_device *usbd_dev, uint16_t wValue) {
     (void)wValue;
@@ -217,8 +277,9 @@ static void vcdc_set_config(usbd_device *usbd_dev, uint16_t wValue) {
     usbd_ep_setup(usbd_dev, ENDP_VCDC_DATA_OUT, USB_ENDPOINT_ATTR_BULK, 64,
                   vcdc_bulk_data_out);
     usbd_ep_setup(usbd_dev, ENDP_VCDC_DATA_IN, USB_ENDPOINT_ATTR_BULK, 64,
-                  //vcdc_bulk_data_in);
-                  NULL);
+                  vcdc_bulk_data_in);
+    vcdc_tx_busy = false;
+    vcdc_tx_full = false;
     usbd_ep_setup(usbd_dev, ENDP_VCDC_COMM_IN, USB_ENDPOINT_ATTR_INTERRUPT, 16, NULL);
 
     usbd_register_control_callback(
@@ -228,8 +289,6 @@ static void vcdc_set_config(usbd_device *usbd_dev, uint16_t wValue) {
         vcdc_control_class_request);
 }
 
-static usbd_device* vcdc_usbd_dev;
-
 void vcdc_app_setup(usbd_device* usbd_dev,
                     GenericCallback vcdc_tx_cb,
                     GenericCallback vcdc_rx_cb) {
@@ -238,33 +297,13 @@ void vcdc_app_setup(usbd_device* usbd_dev,
     vcdc_rx_callback = vcdc_rx_cb;
 
     usbd_register_set_config_callback(usbd_dev, vcdc_set_config);
+    cmp_usb_register_sof_callback(&vcdc_on_sof);
 }
 
+/* Start on data queued since the endpoint went idle; called with the
+   USB interrupt masked */
 bool vcdc_app_update(void) {
-    bool active = false;
-    static uint16_t packet_len = 0;
-    static uint8_t packet_buffer[USB_VCDC_MAX_PACKET_SIZE];
-
-    while (packet_len < USB_VCDC_MAX_PACKET_SIZE && !vcdc_tx_buffer_empty()) {
-        packet_buffer[packet_len] = vcdc_tx_buffer_get();
-        packet_len++;
-    }
-
-    if (packet_len > 0 && cmp_usb_configured()) {
-        uint16_t sent = usbd_ep_write_packet(vcdc_usbd_dev, ENDP_VCDC_DATA_IN,
-                                             (const void*)packet_buffer,
-                                             packet_len);
-        
-        if (sent != 0) {
-            packet_len = 0;
-            active = true;
-            if (vcdc_tx_callback != NULL) {
-                vcdc_tx_callback();
-            }
-        }
-    }
-    
-    return active;
+    return vcdc_tx_kick();
 }
 
 #endif
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <libopencm3/usb/usbd.h>
+
+#include "composite_usb_conf.h"
+#include "winusb.h"
+
+#include "config.h"
+
+#if DAP_BULK_AVAILABLE
+
+/*
+ * Windows 8.1 and later read the BOS descriptor of any USB 2.1 device
+ * and, if it advertises MS OS 2.0 support, fetch the descriptor set
+ * below with a vendor request. The set binds WinUSB to the CMSIS-DAP
+ * bulk interface and registers the CMSIS-DAP v2 interface GUID so that
+ * debuggers can find it without a driver package.
+ */
+
+struct winusb_descriptor_set {
+    struct msos20_set_header_descriptor header;
+    struct msos20_config_subset_header_descriptor config;
+    struct msos20_function_subset_header_descriptor function;
+    struct msos20_compatible_id_descriptor compatible_id;
+    struct msos20_guid_property_descriptor guid;
+} __attribute__((packed));
+
+static const struct winusb_descriptor_set winusb_descriptor_set = {
+    .header = {
+        .wLength = sizeof(struct msos20_set_header_descriptor),
+        .wDescriptorType = MS_OS_20_SET_HEADER_DESCRIPTOR,
+        .dwWindowsVersion = MS_OS_20_WINDOWS_VERSION_8_1,
+        .wTotalLength = sizeof(struct winusb_descriptor_set),
+    },
+    .config = {
+        .wLength = sizeof(struct msos20_config_subset_header_descriptor),
+        .wDescriptorType = MS_OS_20_SUBSET_HEADER_CONFIGURATION,
+        .bConfigurationValue = 0,
+        .bReserved = 0,
+        .wTotalLength = sizeof(struct winusb_descriptor_set)
+                      - sizeof(struct msos20_set_header_descriptor),
+    },
+    .function = {
+        .wLength = sizeof(struct msos20_function_subset_header_descriptor),
+        .wDescriptorType = MS_OS_20_SUBSET_HEADER_FUNCTION,
+        .bFirstInterface = INTF_DAP_BULK,
+        .bReserved = 0,
+        .wSubsetLength = sizeof(struct winusb_descriptor_set)
+                       - sizeof(struct msos20_set_header_descriptor)
+                       - sizeof(struct msos20_config_subset_header_descriptor),
+    },
+    .compatible_id = {
+        .wLength = sizeof(struct msos20_compatible_id_descriptor),
+        .wDescriptorType = MS_OS_20_FEATURE_COMPATIBLE_ID,
+        .CompatibleID = { 'W', 'I', 'N', 'U', 'S', 'B', 0, 0 },
+        .SubCompatibleID = { 0, 0, 0, 0, 0, 0, 0, 0 },
+    },
+    .guid = {
+        .wLength = sizeof(struct msos20_guid_property_descriptor),
+        .wDescriptorType = MS_OS_20_FEATURE_REG_PROPERTY,
+        .wPropertyDataType = MS_OS_20_REG_MULTI_SZ,
+        .wPropertyNameLength = 2 * MS_OS_20_GUID_PROPERTY_NAME_LENGTH,
+        .PropertyName = {
+            'D', 'e', 'v', 'i', 'c', 'e', 'I', 'n', 't', 'e',
+            'r', 'f', 'a', 'c', 'e', 'G', 'U', 'I', 'D', 's',            0
+        },
+        .wPropertyDataLength = 2 * (MS_OS_20_GUID_STRING_LENGTH + 2),
+        .PropertyData = {
+            '{', 'C', 'D', 'B', '3', 'B', '5', 'A', 'D', '-',
+            '2', '9', '3', 'B', '-', '4', '6', '6', '3', '-',
+            'A', 'A', '3', '6', '-', '1', 'A', 'A', 'E', '4',
+            '6', '4', '6', '3', '7', '7', '6', '}',            0, 0
+        },
+    },
+};
+
+static const struct {
+    struct usb_bos_descriptor bos;
+    struct msos20_platform_descriptor msos20;
+} __attribute__((packed)) winusb_bos_descriptor = {
+    .bos = {
+        .bLength = USB_DT_BOS_SIZE,
+        .bDescriptorType = USB_DT_BOS,
+        .wTotalLength = sizeof(winusb_bos_descriptor),
+        .bNumDeviceCaps = 1,
+    },
+    .msos20 = {
+        .platform = {
+            .bLength = sizeof(struct msos20_platform_descriptor),
+            .bDescriptorType = USB_DT_DEVICE_CAPABILITY,
+            .bDevCapabilityType = USB_DC_PLATFORM,
+            .bReserved = 0,
+            .PlatformCapabilityUUID = MS_OS_20_PLATFORM_CAPABILITY_UUID,
+        },
+        .dwWindowsVersion = MS_OS_20_WINDOWS_VERSION_8_1,
+        .wMSOSDescriptorSetTotalLength = sizeof(struct winusb_descriptor_set),
+        .bMS_VendorCode = WINUSB_MS_VENDOR_CODE,
+        .bAltEnumCode = 0,
+    },
+};
+
+/* Handles both GET_DESCRIPTOR(BOS) and the MS OS 2.0 vendor request,
+   so that only one of the few user control callback slots is used. */
+static int winusb_control_device_request(usbd_device *usbd_dev,
+                                         struct usb_setup_data *req,
+                                         uint8_t **buf, uint16_t *len,
+                                         usbd_control_complete_callback* complete) {
+    (void)complete;
+    (void)usbd_dev;
+
+    const void* descriptor = NULL;
+    uint16_t descriptor_len = 0;
+    uint8_t type = req->bmRequestType & USB_REQ_TYPE_TYPE;
+
+    if (type == USB_REQ_TYPE_STANDARD
+        && req->bRequest == USB_REQ_GET_DESCRIPTOR
+        && ((req->wValue >> 8) & 0xFF) == USB_DT_BOS) {
+        descriptor = &winusb_bos_descriptor;
+        descriptor_len = sizeof(winusb_bos_descriptor);
+    } else if (type == USB_REQ_TYPE_VENDOR
+               && req->bRequest == WINUSB_MS_VENDOR_CODE) {
+        if (req->wIndex != MS_OS_20_DESCRIPTOR_INDEX) {
+            return USBD_REQ_NOTSUPP;
+        }
+        descriptor = &winusb_descriptor_set;
+        descriptor_len = sizeof(winusb_descriptor_set);
+    } else {
+        return USBD_REQ_NEXT_CALLBACK;
+    }
+
+    *buf = (uint8_t*)descriptor;
+    if (*len > descriptor_len) {
+        *len = descriptor_len;
+    }
+
+    return USBD_REQ_HANDLED;
+}
+
+static void winusb_register_callbacks(usbd_device* usbd_dev) {
+    usbd_register_control_callback(
+        usbd_dev,
+        USB_REQ_TYPE_DEVICE,
+        USB_REQ_TYPE_RECIPIENT,
+        winusb_control_device_request);
+}
+
+/* Control callbacks are flushed on every SET_CONFIGURATION */
+static void winusb_set_config(usbd_device* usbd_dev, uint16_t wValue) {
+    (void)wValue;
+    winusb_register_callbacks(usbd_dev);
+}
+
+void winusb_setup(usbd_device* usbd_dev) {
+    /* The BOS descriptor is requested before the device is configured */
+    winusb_register_callbacks(usbd_dev);
+    cmp_usb_register_set_config_callback(winusb_set_config);
+}
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef WINUSB_DEFS_H_INCLUDED
+#define WINUSB_DEFS_H_INCLUDED
+
+#include <stdint.h>
+
+/* Binary Device Object Store (BOS) descriptors, from the USB 3.1 spec */
+#ifndef USB_DT_BOS
+#define USB_DT_BOS                          0x0F
+#endif
+#ifndef USB_DT_DEVICE_CAPABILITY
+#define USB_DT_DEVICE_CAPABILITY            0x10
+#endif
+
+#define USB_DC_PLATFORM                     0x05
+
+struct usb_bos_descriptor {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint16_t wTotalLength;
+    uint8_t bNumDeviceCaps;
+} __attribute__((packed));
+
+#define USB_DT_BOS_SIZE sizeof(struct usb_bos_descriptor)
+
+struct usb_platform_capability_descriptor {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDevCapabilityType;
+    uint8_t bReserved;
+    uint8_t PlatformCapabilityUUID[16];
+} __attribute__((packed));
+
+/* Microsoft OS 2.0 descriptors */
+#define MS_OS_20_WINDOWS_VERSION_8_1        0x06030000
+#define MS_OS_20_DESCRIPTOR_INDEX           0x07
+
+#define MS_OS_20_SET_HEADER_DESCRIPTOR      0x00
+#define MS_OS_20_SUBSET_HEADER_CONFIGURATION 0x01
+#define MS_OS_20_SUBSET_HEADER_FUNCTION     0x02
+#define MS_OS_20_FEATURE_COMPATIBLE_ID      0x03
+#define MS_OS_20_FEATURE_REG_PROPERTY       0x04
+
+#define MS_OS_20_REG_MULTI_SZ               0x07
+
+/* {D8DD60DF-4589-4CC7-9CD2-659D9E648A9F} */
+#define MS_OS_20_PLATFORM_CAPABILITY_UUID {                 \
+    0xDF, 0x60, 0xDD, 0xD8, 0x89, 0x45, 0xC7, 0x4C,         \
+    0x9C, 0xD2, 0x65, 0x9D, 0x9E, 0x64, 0x8A, 0x9F          \
+}
+
+struct msos20_platform_descriptor {
+    struct usb_platform_capability_descriptor platform;
+    uint32_t dwWindowsVersion;
+    uint16_t wMSOSDescriptorSetTotalLength;
+    uint8_t bMS_VendorCode;
+    uint8_t bAltEnumCode;
+} __attribute__((packed));
+
+struct msos20_set_header_descriptor {
+    uint16_t wLength;
+    uint16_t wDescriptorType;
+    uint32_t dwWindowsVersion;
+    uint16_t wTotalLength;
+} __attribute__((packed));
+
+struct msos20_config_subset_header_descriptor {
+    uint16_t wLength;
+    uint16_t wDescriptorType;
+    uint8_t bConfigurationValue;
+    uint8_t bReserved;
+    uint16_t wTotalLength;
+} __attribute__((packed));
+
+struct msos20_function_subset_header_descriptor {
+    uint16_t wLength;
+    uint16_t wDescriptorType;
+    uint8_t bFirstInterface;
+    uint8_t bReserved;
+    uint16_t wSubsetLength;
+} __attribute__((packed));
+
+struct msos20_compatible_id_descriptor {
+    uint16_t wLength;
+    uint16_t wDescriptorType;
+    uint8_t CompatibleID[8];
+    uint8_t SubCompatibleID[8];
+} __attribute__((packed));
+
+/* Registry property holding a single interface GUID string. Names and
+   values are stored as null-terminated UTF-16LE. */
+#define MS_OS_20_GUID_PROPERTY_NAME_LENGTH  21
+#define MS_OS_20_GUID_STRING_LENGTH         38
+
+struct msos20_guid_property_descriptor {
+    uint16_t wLength;
+    uint16_t wDescriptorType;
+    uint16_t wPropertyDataType;
+    uint16_t wPropertyNameLength;
+    uint16_t PropertyName[MS_OS_20_GUID_PROPERTY_NAME_LENGTH];
+    uint16_t wPropertyDataLength;
+    uint16_t PropertyData[MS_OS_20_GUID_STRING_LENGTH + 2];
+} __attribute__((packed));
+
+#endif
@@ -16,14 +16,108 @@
  * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <string.h>
+
+#include <libopencm3/cm3/cortex.h>
 #include <libopencm3/cm3/nvic.h>
+#include <libopencm3/stm32/dma.h>
+#include <libopencm3/stm32/rcc.h>
 
 #include "console.h"
+#include "sched.h"
 #include "target.h"
 
+#if SWO_AVAILABLE
+#include "swo_uart.h"
+#endif
+
+#if ((CONSOLE_RX_BUFFER_SIZE & (CONSOLE_RX_BUFFER_SIZE - 1)) != 0)
+#error "CONSOLE_RX_BUFFER_SIZE must be a power of 2"
+#endif
+
+#ifdef USART_RDR
+#define CONSOLE_USART_RX_DATA USART_RDR(CONSOLE_USART)
+#define CONSOLE_USART_TX_DATA USART_TDR(CONSOLE_USART)
+#else
+#define CONSOLE_USART_RX_DATA USART_DR(CONSOLE_USART)
+#define CONSOLE_USART_TX_DATA USART_DR(CONSOLE_USART)
+#endif
+
+/*
+  Both directions are moved by DMA. Received bytes go into a circular
+  buffer; the half-transfer, transfer-complete and idle-line events
+  tell the serial bridge that there is something to pick up. Bytes to
+  send are collected in two blocks: one is being sent by DMA while the
+  other is being filled, either by console_send_buffered() or by the
+  USB serial bridge reading a packet straight into it.
+
+  The USB, UART and DMA interrupts all run at the same priority, so
+  they never preempt each other; code outside of them masks interrupts
+  while it touches the buffers.
+*/
+
+static uint8_t console_rx_buffer[CONSOLE_RX_BUFFER_SIZE];
+static uint8_t console_tx_blocks[2][CONSOLE_TX_BLOCK_SIZE];
+
+/* Free-running byte counts; only their difference matters */
+static volatile uint32_t console_rx_wraps = 0;
+static uint32_t console_rx_out = 0;
+static volatile bool console_rx_running = false;
+
+static volatile uint16_t console_tx_lengths[2];
+static volatile uint8_t console_tx_fill = 0;
+static volatile bool console_tx_sending = false;
+
+static ConsoleCallback console_rx_callback = NULL;
+static ConsoleCallback console_tx_callback = NULL;
+
+static bool console_echo_input = false;
+
+static void console_rx_dma_start(void) {
+    dma_channel_reset(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL);
+    dma_set_peripheral_address(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL,
+                               (uint32_t)&CONSOLE_USART_RX_DATA);
+    dma_set_memory_address(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL,
+                           (uint32_t)console_rx_buffer);
+    dma_set_number_of_data(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL,
+                           CONSOLE_RX_BUFFER_SIZE);
+    dma_set_read_from_peripheral(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL);
+    dma_enable_memory_increment_mode(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL);
+    dma_set_peripheral_size(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL, DMA_CCR_PSIZE_8BIT);
+    dma_set_memory_size(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL, DMA_CCR_MSIZE_8BIT);
+    dma_set_priority(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL, DMA_CCR_PL_VERY_HIGH);
+    dma_enable_circular_mode(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL);
+    dma_enable_half_transfer_interrupt(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL);
+    dma_enable_transfer_complete_interrupt(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL);
+
+    console_rx_wraps = 0;
+    console_rx_out = 0;
+    console_rx_running = true;
+
+    dma_enable_channel(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL);
+}
+
+static void console_tx_dma_setup(void) {
+    dma_channel_reset(CONSOLE_DMA, CONSOLE_TX_DMA_CHANNEL);
+    dma_set_peripheral_address(CONSOLE_DMA, CONSOLE_TX_DMA_CHANNEL,
+                               (uint32_t)&CONSOLE_USART_TX_DATA);
+    dma_set_read_from_memory(CONSOLE_DMA, CONSOLE_TX_DMA_CHANNEL);
+    dma_enable_memory_increment_mode(CONSOLE_DMA, CONSOLE_TX_DMA_CHANNEL);
+    dma_set_peripheral_size(CONSOLE_DMA, CONSOLE_TX_DMA_CHANNEL, DMA_CCR_PSIZE_8BIT);
+    dma_set_memory_size(CONSOLE_DMA, CONSOLE_TX_DMA_CHANNEL, DMA_CCR_MSIZE_8BIT);
+    dma_set_priority(CONSOLE_DMA, CONSOLE_TX_DMA_CHANNEL, DMA_CCR_PL_HIGH);
+    dma_enable_transfer_complete_interrupt(CONSOLE_DMA, CONSOLE_TX_DMA_CHANNEL);
+
+    console_tx_lengths[0] = 0;
+    console_tx_lengths[1] = 0;
+    console_tx_fill = 0;
+    console_tx_sending = false;
+}
+
 void console_setup(uint32_t baudrate) {
     /* Setup GPIO */
     target_console_init();
+    rcc_periph_clock_enable(CONSOLE_DMA_CLOCK);
 
     usart_set_baudrate(CONSOLE_USART, baudrate);
     usart_set_databits(CONSOLE_USART, 8);
@@ -32,10 +126,23 @@ void console_setup(uint32_t baudrate) {
     usart_set_mode(CONSOLE_USART, CONSOLE_USART_MODE);
     usart_set_flow_control(CONSOLE_USART, USART_FLOWCONTROL_NONE);
 
+    USART_CR3(CONSOLE_USART) |= USART_CR3_DMAR | USART_CR3_DMAT;
+#ifdef USART_CR3_OVRDIS
+    /* Keep receiving even if a byte was missed */
+    USART_CR3(CONSOLE_USART) |= USART_CR3_OVRDIS;
+#endif
+    USART_CR1(CONSOLE_USART) |= USART_CR1_IDLEIE;
+
+    console_tx_dma_setup();
+    console_rx_dma_start();
+
     usart_enable(CONSOLE_USART);
-    usart_enable_rx_interrupt(CONSOLE_USART);
 
     nvic_enable_irq(CONSOLE_USART_NVIC_LINE);
+    nvic_enable_irq(CONSOLE_DMA_NVIC_LINE);
+#ifdef CONSOLE_TX_DMA_NVIC_LINE
+    nvic_enable_irq(CONSOLE_TX_DMA_NVIC_LINE);
+#endif
 }
 
 void console_reconfigure(uint32_t baudrate, uint32_t databits, uint32_t stopbits,
@@ -55,78 +162,170 @@ void console_reconfigure(uint32_t baudrate, uint32_t databits, uint32_t stopbits
     usart_enable(CONSOLE_USART);
 }
 
-static volatile uint8_t console_tx_buffer[CONSOLE_TX_BUFFER_SIZE];
-static volatile uint8_t console_rx_buffer[CONSOLE_RX_BUFFER_SIZE];
-
-static volatile uint16_t console_tx_head = 0;
-static volatile uint16_t console_tx_tail = 0;
+void console_set_callbacks(ConsoleCallback rx_cb, ConsoleCallback tx_cb) {
+    console_rx_callback = rx_cb;
+    console_tx_callback = tx_cb;
+}
 
-static volatile uint16_t console_rx_head = 0;
-static volatile uint16_t console_rx_tail = 0;
+/* Total number of bytes received since reception was started */
+static uint32_t console_rx_count(void) {
+    uint32_t remaining;
+    uint32_t wraps;
+
+    /* Same as swo_uart_count(): retry if the DMA wrapped while we looked */
+    do {
+        remaining = DMA_CNDTR(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL);
+        wraps = console_rx_wraps;
+        if (dma_get_interrupt_flag(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL, DMA_TCIF)) {
+            wraps++;
+        }
+    } while ((DMA_CNDTR(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL) > remaining)
+             || (wraps < console_rx_wraps));
 
-static bool console_tx_buffer_empty(void) {
-    return console_tx_head == console_tx_tail;
+    return wraps * CONSOLE_RX_BUFFER_SIZE + (CONSOLE_RX_BUFFER_SIZE - remaining);
 }
 
-static bool console_tx_buffer_full(void) {
-    return console_tx_head == ((console_tx_tail + 1) % CONSOLE_TX_BUFFER_SIZE);
+size_t console_rx_peek(const uint8_t** data) {
+    uint32_t count;
+    uint32_t offset;
+
+    if (!console_rx_running) {
+        return 0;
+    }
+
+    count = console_rx_count() - console_rx_out;
+    if (count > CONSOLE_RX_BUFFER_SIZE) {
+        /* The DMA lapped the reader; keep the newest half */
+        console_rx_out += count - CONSOLE_RX_BUFFER_SIZE/2;
+        count = CONSOLE_RX_BUFFER_SIZE/2;
+    }
+
+    offset = console_rx_out & (CONSOLE_RX_BUFFER_SIZE - 1);
+    if (count > CONSOLE_RX_BUFFER_SIZE - offset) {
+        count = CONSOLE_RX_BUFFER_SIZE - offset;
+    }
+
+    *data = &console_rx_buffer[offset];
+    return count;
 }
 
-static void console_tx_buffer_put(uint8_t data) {
-    console_tx_buffer[console_tx_tail] = data;
-    console_tx_tail = (console_tx_tail + 1) % CONSOLE_TX_BUFFER_SIZE;
+size_t console_rx_pending(void) {
+    uint32_t count;
+
+    if (!console_rx_running) {
+        return 0;
+    }
+
+    count = console_rx_count() - console_rx_out;
+    if (count > CONSOLE_RX_BUFFER_SIZE) {
+        /* Lapped; console_rx_peek() will keep the newest half */
+        count = CONSOLE_RX_BUFFER_SIZE/2;
+    }
+
+    return count;
 }
 
-static uint8_t console_tx_buffer_get(void) {
-    uint8_t data = console_tx_buffer[console_tx_head];
-    console_tx_head = (console_tx_head + 1) % CONSOLE_TX_BUFFER_SIZE;
-    return data;
+void console_rx_consume(size_t num_bytes) {
+    if (console_echo_input) {
+        const uint8_t* data = &console_rx_buffer[console_rx_out & (CONSOLE_RX_BUFFER_SIZE - 1)];
+        size_t i;
+        for (i = 0; i < num_bytes; i++) {
+            if (data[i] == '\r') {
+                console_send_buffered((const uint8_t*)"\r\n", 2);
+            } else {
+                console_send_buffered(&data[i], 1);
+            }
+        }
+    }
+
+    console_rx_out += num_bytes;
 }
 
-static bool console_rx_buffer_empty(void) {
-    return console_rx_head == console_rx_tail;
+/* Start sending the filled block if the DMA channel is free */
+static void console_tx_kick(void) {
+    uint8_t block = console_tx_fill;
+    if (console_tx_sending || console_tx_lengths[block] == 0) {
+        return;
+    }
+
+    dma_disable_channel(CONSOLE_DMA, CONSOLE_TX_DMA_CHANNEL);
+    dma_set_memory_address(CONSOLE_DMA, CONSOLE_TX_DMA_CHANNEL,
+                           (uint32_t)console_tx_blocks[block]);
+    dma_set_number_of_data(CONSOLE_DMA, CONSOLE_TX_DMA_CHANNEL,
+                           console_tx_lengths[block]);
+    console_tx_sending = true;
+    console_tx_fill = block ^ 1;
+    dma_enable_channel(CONSOLE_DMA, CONSOLE_TX_DMA_CHANNEL);
 }
 
-static bool console_rx_buffer_full(void) {
-    return console_rx_head == ((console_rx_tail + 1) % CONSOLE_RX_BUFFER_SIZE);
+bool console_tx_busy(void) {
+    return console_tx_sending;
 }
 
-static void console_rx_buffer_put(uint8_t data) {
-    console_rx_buffer[console_rx_tail] = data;
-    console_rx_tail = (console_rx_tail + 1) % CONSOLE_RX_BUFFER_SIZE;
+uint8_t* console_tx_reserve(void) {
+    if (console_tx_lengths[console_tx_fill] != 0) {
+        return NULL;
+    }
+
+    return console_tx_blocks[console_tx_fill];
 }
 
-static uint8_t console_rx_buffer_get(void) {
-    uint8_t data = console_rx_buffer[console_rx_head];
-    console_rx_head = (console_rx_head + 1) % CONSOLE_RX_BUFFER_SIZE;
-    return data;
+void console_tx_commit(size_t num_bytes) {
+    console_tx_lengths[console_tx_fill] = (uint16_t)num_bytes;
+    console_tx_kick();
 }
 
 size_t console_send_buffered(const uint8_t* data, size_t num_bytes) {
     size_t bytes_written = 0;
+    uint32_t masked = cm_mask_interrupts(1);
 
-    while (!console_tx_buffer_full() && (bytes_written < num_bytes)) {
-        console_tx_buffer_put(data[bytes_written++]);
-    }
+    while (bytes_written < num_bytes) {
+        uint8_t block = console_tx_fill;
+        size_t len = console_tx_lengths[block];
+        size_t count = num_bytes - bytes_written;
 
-    if (!console_tx_buffer_empty()) {
-        usart_enable_tx_interrupt(CONSOLE_USART);
+        if (len == CONSOLE_TX_BLOCK_SIZE) {
+            break;
+        }
+
+        if (count > CONSOLE_TX_BLOCK_SIZE - len) {
+            count = CONSOLE_TX_BLOCK_SIZE - len;
+        }
+
+        memcpy(&console_tx_blocks[block][len], &data[bytes_written], count);
+        console_tx_lengths[block] = (uint16_t)(len + count);
+        bytes_written += count;
+        console_tx_kick();
     }
 
+    cm_mask_interrupts(masked);
     return bytes_written;
 }
 
 size_t console_recv_buffered(uint8_t* data, size_t max_bytes) {
     size_t bytes_read = 0;
-    while (!console_rx_buffer_empty() && (bytes_read < max_bytes)) {
-        data[bytes_read++] = console_rx_buffer_get();
+    uint32_t masked = cm_mask_interrupts(1);
+
+    while (bytes_read < max_bytes) {
+        const uint8_t* buffered;
+        size_t count = console_rx_peek(&buffered);
+        if (count == 0) {
+            break;
+        }
+
+        if (count > max_bytes - bytes_read) {
+            count = max_bytes - bytes_read;
+        }
+
+        memcpy(&data[bytes_read], buffered, count);
+        console_rx_consume(count);
+        bytes_read += count;
     }
 
+    cm_mask_interrupts(masked);
     return bytes_read;
 }
 
-static bool console_echo_input = false;
-
 void console_set_echo(bool enable) {
     console_echo_input = enable;
 }
@@ -139,28 +338,96 @@ uint8_t console_recv_blocking(void) {
     return usart_recv_blocking(CONSOLE_USART);
 }
 
-void CONSOLE_USART_IRQ_NAME(void) {
-    if (usart_get_interrupt_source(CONSOLE_USART, USART_SR_RXNE)) {
-        uint8_t received_byte = (uint8_t)usart_recv(CONSOLE_USART);
-        if (!console_rx_buffer_full()) {
-            console_rx_buffer_put(received_byte);
-        }
+void console_suspend(void) {
+    uint32_t masked = cm_mask_interrupts(1);
 
-        if (console_echo_input) {
-            if (received_byte == '\r') {
-                console_send_buffered((const uint8_t*)"\r\n", 2);
-            } else {
-                console_send_buffered(&received_byte, 1);
-            }
-        }
+    console_rx_running = false;
+    dma_disable_channel(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL);
+    dma_disable_channel(CONSOLE_DMA, CONSOLE_TX_DMA_CHANNEL);
+    console_tx_dma_setup();
+
+    cm_mask_interrupts(masked);
+}
+
+void console_resume(void) {
+    uint32_t masked = cm_mask_interrupts(1);
+
+    console_rx_dma_start();
+
+    cm_mask_interrupts(masked);
+}
+
+static void console_rx_dma_isr(void) {
+    bool event = false;
+
+    if (dma_get_interrupt_flag(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL, DMA_HTIF)) {
+        dma_clear_interrupt_flags(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL, DMA_HTIF);
+        event = true;
+    }
+
+    if (dma_get_interrupt_flag(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL, DMA_TCIF)) {
+        dma_clear_interrupt_flags(CONSOLE_DMA, CONSOLE_RX_DMA_CHANNEL, DMA_TCIF);
+        console_rx_wraps++;
+        event = true;
+    }
+
+    if (event && console_rx_callback) {
+        console_rx_callback();
+    }
+}
+
+static void console_tx_dma_isr(void) {
+    if (!dma_get_interrupt_flag(CONSOLE_DMA, CONSOLE_TX_DMA_CHANNEL, DMA_TCIF)) {
+        return;
+    }
+
+    dma_clear_interrupt_flags(CONSOLE_DMA, CONSOLE_TX_DMA_CHANNEL, DMA_TCIF);
+    console_tx_lengths[console_tx_fill ^ 1] = 0;
+    console_tx_sending = false;
+    console_tx_kick();
+
+    if (console_tx_callback) {
+        console_tx_callback();
+    }
+}
+
+void CONSOLE_DMA_IRQ_NAME(void) {
+    sched_post(SCHED_EVENT_UART);
+
+    if (console_rx_running) {
+        console_rx_dma_isr();
+    }
+#if SWO_AVAILABLE
+    else {
+        /* SWO capture has borrowed the receive channel */
+        swo_uart_dma_isr();
     }
+#endif
 
-    if (usart_get_interrupt_source(CONSOLE_USART, USART_SR_TXE)) {
-        if (!console_tx_buffer_empty()) {
-            usart_word_t buffered_byte = console_tx_buffer_get();
-            usart_send(CONSOLE_USART, buffered_byte);
-        } else {
-            usart_disable_tx_interrupt(CONSOLE_USART);
+#ifndef CONSOLE_TX_DMA_IRQ_NAME
+    console_tx_dma_isr();
+#endif
+}
+
+#ifdef CONSOLE_TX_DMA_IRQ_NAME
+void CONSOLE_TX_DMA_IRQ_NAME(void) {
+    sched_post(SCHED_EVENT_UART);
+    console_tx_dma_isr();
+}
+#endif
+
+void CONSOLE_USART_IRQ_NAME(void) {
+    sched_post(SCHED_EVENT_UART);
+
+    if (usart_get_interrupt_source(CONSOLE_USART, USART_SR_IDLE)) {
+#ifdef USART_ICR_IDLECF
+        USART_ICR(CONSOLE_USART) = USART_ICR_IDLECF;
+#else
+        /* Cleared by reading DR after SR; the DMA already took the data */
+        (void)USART_DR(CONSOLE_USART);
+#endif
+        if (console_rx_running && console_rx_callback) {
+            console_rx_callback();
         }
     }
 }
@@ -19,11 +19,17 @@
 #ifndef CONSOLE_H_INCLUDED
 #define CONSOLE_H_INCLUDED
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <libopencm3/stm32/usart.h>
 
 #include "config.h"
 
+/* Data is sent from two blocks, one going out while the other fills */
+#define CONSOLE_TX_BLOCK_SIZE (CONSOLE_TX_BUFFER_SIZE/2)
+
+typedef void (*ConsoleCallback)(void);
+
 extern void console_setup(uint32_t baudrate);
 extern void console_reconfigure(uint32_t baudrate, uint32_t databits,
                                 uint32_t stopbits, uint32_t parity);
@@ -35,4 +41,27 @@ extern size_t console_recv_buffered(uint8_t* data, size_t max_bytes);
 
 extern void console_set_echo(bool enable);
 
+/* Called from interrupt context when data was received (after the line
+   went idle or the buffer filled halfway) and when a block was sent */
+extern void console_set_callbacks(ConsoleCallback rx_cb, ConsoleCallback tx_cb);
+
+/* Zero-copy access to the receive buffer. Returns the number of
+   contiguous bytes available at *data; consume them when done. */
+extern size_t console_rx_peek(const uint8_t** data);
+extern void console_rx_consume(size_t num_bytes);
+
+/* Number of bytes waiting, including any past the end of the buffer
+   that console_rx_peek() only returns after a wrap */
+extern size_t console_rx_pending(void);
+
+/* Zero-copy sending: reserve an empty block of CONSOLE_TX_BLOCK_SIZE
+   bytes, fill it, then commit it. Returns NULL if no block is free. */
+extern uint8_t* console_tx_reserve(void);
+extern void console_tx_commit(size_t num_bytes);
+extern bool console_tx_busy(void);
+
+/* Hand the UART and its receive DMA channel to SWO capture and back */
+extern void console_suspend(void);
+extern void console_resume(void);
+
 #endif
@@ -0,0 +1,69 @@
+## Copyright (c) 2026, agent
+##
+## Permission to use, copy, modify, and/or distribute this software
+## for any purpose with or without fee is hereby granted, provided
+## that the above copyright notice and this permission notice
+## appear in all copies.
+##
+## THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+## WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+## WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+## AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+## CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+## LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+## NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+## CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+## Native build of the CMSIS-DAP core against the simulated SWD target
+## in host/. Used for benchmarking; see host/bench.c.
+
+Q		:= @
+ifeq ($(V),1)
+Q		:=
+endif
+
+CC		?= cc
+INCLUDE_DIR	= ./host/include
+
+###############################################################################
+# C flags
+
+CFLAGS		+= -O2 -g -std=gnu99
+CFLAGS		+= -Wextra -Wshadow -Wimplicit-function-declaration
+CFLAGS		+= -Wredundant-decls -Wmissing-prototypes -Wstrict-prototypes
+CFLAGS		+= -fno-common
+
+###############################################################################
+# C preprocessor flags
+
+CPPFLAGS	+= -MD
+CPPFLAGS	+= -Wall -Wundef
+CPPFLAGS	+= -I$(INCLUDE_DIR) $(DEFS)
+
+###############################################################################
+
+.DEFAULT_GOAL := $(BINARY)-host
+
+$(BINARY)-host: $(OBJS)
+	@printf "  LD      $@\n"
+	$(Q)$(CC) $(LDFLAGS) $(OBJS) $(LDLIBS) -o $@
+
+%.o: %.c
+	@printf "  CC      $(*).c\n"
+	$(Q)$(CC) $(CFLAGS) $(CPPFLAGS) -o $(*).o -c $(*).c
+
+bench: $(BINARY)-host
+	$(Q)./$(BINARY)-host
+
+check: $(BINARY)-host
+	$(Q)./$(BINARY)-host --check
+
+replay: $(BINARY)-host
+	$(Q)./$(BINARY)-host --replay $(CAPTURE)
+
+clean::
+	$(Q)$(RM) $(BINARY)-host
+
+.PHONY: bench check replay clean
+
+-include $(OBJS:.o=.d)
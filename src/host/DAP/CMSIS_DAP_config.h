@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+    CMSIS-DAP I/O configuration for the host build.
+
+    Instead of toggling GPIO registers, every pin access is forwarded to
+    the bit-level SWD target model in host/swd_sim.c. The timing
+    parameters mirror the dap42 STM32F042 configuration so that the
+    clock delay calculations match the real firmware.
+*/
+
+#ifndef __DAP_CONFIG_H__
+#define __DAP_CONFIG_H__
+
+#include <stdint.h>
+#include "swd_sim.h"
+#include "config.h"
+
+#define CPU_CLOCK               48000000        ///< Specifies the CPU Clock in Hz
+#define IO_PORT_WRITE_CYCLES    2               ///< I/O Cycles: 2=default, 1=Cortex-M0+ fast I/0
+#define SWJ_CLOCK_CALIBRATE     0               ///< No CPU cycles to measure on the host
+
+#define DAP_SWD                 1               ///< SWD Mode:  1 = available, 0 = not available
+#define DAP_SWD_SPI             1               ///< SWD over SPI: 1 = enabled, 0 = bit-bang only
+#define DAP_SWD_TIMER           1               ///< SWD timer pacing: 1 = enabled, 0 = delay loops only
+#define DAP_SWD_CACHE           1               ///< SWD register cache: 1 = enabled, 0 = disabled
+#define DAP_JTAG                0               ///< JTAG Mode: 0 = not available
+#define DAP_JTAG_DEV_CNT        8               ///< Maximum number of JTAG devices on scan chain
+#define DAP_DEFAULT_PORT        1               ///< Default JTAG/SWJ Port Mode: 1 = SWD, 2 = JTAG.
+#define DAP_DEFAULT_SWJ_CLOCK   10000000        ///< Default SWD/JTAG clock frequency in Hz.
+
+#define DAP_PACKET_SIZE         64              ///< USB: 64 = Full-Speed, 1024 = High-Speed.
+#define DAP_PACKET_COUNT        12              ///< Buffers: 64 = Full-Speed, 4 = High-Speed.
+
+#define DAP_PACKET_QUEUE_SIZE (DAP_PACKET_COUNT+8)
+
+#define SWO_UART                SWO_AVAILABLE   ///< SWO UART:  1 = available, 0 = not available
+#define SWO_BUFFER_SIZE         512             ///< SWO Trace Buffer Size in bytes (must be 2^n)
+#define SWO_STREAM              (SWO_UART && DAP_BULK_AVAILABLE)
+#define TIMESTAMP_CLOCK         CPU_CLOCK       ///< Timestamp clock in Hz (0 = timestamps not supported).
+
+#define TARGET_DEVICE_FIXED     0               ///< Target Device: 1 = known, 0 = unknown;
+
+/*
+SWD functionality
+*/
+
+static __inline void PORT_SWD_SETUP (void)
+{
+  swd_sim_swdio_out(1);
+  swd_sim_swclk(1);
+  swd_sim_swdio_oe(1);
+}
+
+static __inline void PORT_OFF (void)
+{
+  swd_sim_swdio_oe(0);
+  swd_sim_swclk(0);
+}
+
+static __inline void PIN_SWCLK_TCK_SET (void)
+{
+  swd_sim_swclk(1);
+}
+
+static __inline void PIN_SWCLK_TCK_CLR (void)
+{
+  swd_sim_swclk(0);
+}
+
+static __inline uint32_t PIN_SWDIO_TMS_IN  (void)
+{
+  return swd_sim_swdio_in();
+}
+
+static __inline void PIN_SWDIO_TMS_SET (void)
+{
+  swd_sim_swdio_out(1);
+}
+
+static __inline void PIN_SWDIO_TMS_CLR (void)
+{
+  swd_sim_swdio_out(0);
+}
+
+static __inline uint32_t PIN_SWDIO_IN (void)
+{
+  return swd_sim_swdio_in();
+}
+
+static __inline void PIN_SWDIO_OUT (uint32_t bit)
+{
+  swd_sim_swdio_out(bit & 1);
+}
+
+static __inline void     PIN_SWDIO_OUT_ENABLE  (void)
+{
+  swd_sim_swdio_oe(1);
+}
+
+static __inline void     PIN_SWDIO_OUT_DISABLE (void)
+{
+  swd_sim_swdio_oe(0);
+}
+
+/*
+SWD data phases shifted by the simulated SPI peripheral
+*/
+
+static __inline uint32_t SWD_SPI_SET_CLOCK (uint32_t clock)
+{
+  // Same limits as an SPI on the 48MHz APB: prescalers from /2 to /256
+  return (clock >= CPU_CLOCK/256) ? 1 : 0;
+}
+
+static __inline void SWD_SPI_WRITE (uint32_t data, uint32_t bits)
+{
+  swd_sim_swdio_oe(1);
+  swd_sim_spi_shift(data, bits);
+}
+
+static __inline uint32_t SWD_SPI_READ (uint32_t bits)
+{
+  return swd_sim_spi_shift(0, bits);
+}
+
+/*
+SWD bit timing paced by the simulated timer
+*/
+
+#define SWD_TIMER_CLOCK         CPU_CLOCK
+#define SWD_TIMER_MIN_TICKS     24              // Not measured: SWJ_CLOCK_CALIBRATE is off
+
+static __inline uint32_t SWD_TIMER_SET_PERIOD (uint32_t ticks)
+{
+  return swd_sim_timer_set_period(ticks);
+}
+
+static __inline void SWD_TIMER_START (void)
+{
+  swd_sim_timer_start();
+}
+
+static __inline void SWD_TIMER_WAIT (void)
+{
+  swd_sim_timer_wait();
+}
+
+#if (TIMESTAMP_CLOCK != 0)
+#include "tick.h"
+
+static __inline uint32_t TIMESTAMP_GET (void)
+{
+  return get_cycles();
+}
+#endif
+
+/*
+JTAG-only functionality (not used in this application)
+*/
+
+static __inline void PORT_JTAG_SETUP (void) {}
+
+static __inline uint32_t PIN_TDI_IN  (void) {  return 0; }
+
+static __inline void     PIN_TDI_OUT (uint32_t bit) { (void)bit; }
+
+static __inline uint32_t PIN_TDO_IN (void) {  return 0; }
+
+static __inline uint32_t PIN_nTRST_IN (void) {  return 0; }
+
+static __inline void     PIN_nTRST_OUT  (uint32_t bit) { (void)bit; }
+
+/*
+other functionality not applicable to this application
+*/
+static __inline uint32_t PIN_SWCLK_TCK_IN  (void) {
+  return swd_sim_swclk_in();
+}
+
+static __inline uint32_t PIN_nRESET_IN  (void) {
+  return swd_sim_nreset_in();
+}
+
+static __inline void PIN_nRESET_OUT (uint32_t bit) {
+  swd_sim_nreset_out(bit & 0x1);
+}
+
+static __inline void LED_CONNECTED_OUT (uint32_t bit) { (void)bit; }
+
+static __inline void LED_RUNNING_OUT (uint32_t bit) { (void)bit; }
+
+static __inline void LED_ACTIVITY_OUT (uint32_t bit) { (void)bit; }
+
+static __inline void DAP_SETUP (void) {
+  swd_sim_nreset_out(1);
+}
+
+static __inline uint32_t RESET_TARGET (void) { return 0; }
+
+#endif
@@ -0,0 +1,2852 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Host benchmark for the CMSIS-DAP request path.
+ *
+ * Each scenario feeds HID reports through DAP/app.c exactly as the USB
+ * stack would and lets the firmware drive SWD against the simulated
+ * target in swd_sim.c. Because the target is clocked by the firmware's
+ * own SWCLK edges, the cycle counts are deterministic and can be used
+ * to catch throughput regressions: run with --check to compare them
+ * against the budgets below.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "DAP/CMSIS_DAP_config.h"
+#include "DAP/CMSIS_DAP.h"
+#include "DAP/app.h"
+#include "DAP/rtt.h"
+#include "DAP/stats.h"
+#include "DAP/tune.h"
+#include "DAP/block.h"
+#include "DAP/flash.h"
+#include "DAP/crc.h"
+#include "DAP/multidrop.h"
+#include "DAP/capture.h"
+#include "DAP/drop.h"
+#include "DAP/vfs.h"
+#include "USB/composite_usb_conf.h"
+
+#include "replay.h"
+#include "swd_sim.h"
+#include "swo_sim.h"
+#include "usb_sim.h"
+
+#define BENCH_BLOCK_ADDRESS     (SWD_SIM_RAM_BASE + 0x400U)
+#define BENCH_BLOCK_WORDS       256U
+
+#define CSW_WORD_INCREMENT      0x23000012U
+
+#define DP_ABORT_CLEAR_ALL      0x0000001EU
+#define DP_CTRL_POWERUP_REQ     0x50000000U
+#define DP_CTRL_POWERUP_ACK     0xA0000000U
+#define DP_CTRL_STICKYERR       0x00000020U
+
+/* Transfer request encodings */
+#define DP_READ(reg)            (DAP_TRANSFER_RnW | (reg))
+#define DP_WRITE(reg)           (reg)
+#define AP_READ(reg)            (DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW | (reg))
+#define AP_WRITE(reg)           (DAP_TRANSFER_APnDP | (reg))
+
+#define REG_IDCODE              0x00U
+#define REG_ABORT               0x00U
+#define REG_CTRL_STAT           DAP_TRANSFER_A2
+#define REG_SELECT              DAP_TRANSFER_A3
+#define REG_RDBUFF              (DAP_TRANSFER_A2 | DAP_TRANSFER_A3)
+#define REG_CSW                 0x00U
+#define REG_TAR                 DAP_TRANSFER_A2
+#define REG_DRW                 (DAP_TRANSFER_A2 | DAP_TRANSFER_A3)
+#define REG_IDR                 (DAP_TRANSFER_A2 | DAP_TRANSFER_A3)
+#define SELECT_BANK_IDR         0x000000F0U
+
+/* Words that fit into a single 64 byte TransferBlock packet */
+#define BLOCK_WRITE_WORDS       ((DAP_PACKET_SIZE - 5) / 4)
+#define BLOCK_READ_WORDS        ((DAP_PACKET_SIZE - 4) / 4)
+
+#define BENCH_RTT_CB            (SWD_SIM_RAM_BASE + 0x2344U)
+#define BENCH_RTT_UP_BUFFER     (SWD_SIM_RAM_BASE + 0x3000U)
+#define BENCH_RTT_UP_SIZE       128U
+#define BENCH_RTT_DOWN_BUFFER   (SWD_SIM_RAM_BASE + 0x3101U)
+#define BENCH_RTT_DOWN_SIZE     16U
+#define BENCH_RTT_BYTES         100U
+#define BENCH_RTT_TAR           (SWD_SIM_RAM_BASE + 0x123CU)
+
+#define BENCH_STREAM_ADDRESS    (SWD_SIM_RAM_BASE + 0x81F0U)
+#define BENCH_STREAM_WORDS      1024U
+#define BENCH_STREAM_BOUNDARIES 4U
+
+#define BENCH_SWO_BAUDRATE      2000000U
+#define BENCH_SWO_BYTES         300U
+
+struct bench_result {
+    uint32_t commands;          /* HID reports sent */
+    uint32_t bytes;
+    bool ok;
+};
+
+struct bench_scenario {
+    const char* name;
+    void (*run)(struct bench_result* result);
+    uint64_t cycle_budget;
+};
+
+static uint8_t request[DAP_PACKET_SIZE];
+static uint8_t response[DAP_PACKET_SIZE];
+static size_t request_len;
+static size_t response_len;
+
+/* Send requests over the CMSIS-DAP v2 bulk endpoints instead of HID */
+static bool bench_use_bulk;
+
+/* Request assembly */
+
+static void request_begin(uint8_t command) {
+    memset(request, 0, sizeof(request));
+    request[0] = command;
+    request_len = 1;
+}
+
+static void request_u8(uint8_t value) {
+    request[request_len++] = value;
+}
+
+static void request_u16(uint16_t value) {
+    request_u8(value & 0xFF);
+    request_u8(value >> 8);
+}
+
+static void request_u32(uint32_t value) {
+    request_u16(value & 0xFFFF);
+    request_u16(value >> 16);
+}
+
+static uint32_t response_u16(size_t offset) {
+    return ((uint32_t)response[offset] << 0)
+         | ((uint32_t)response[offset+1] << 8);
+}
+
+static uint32_t response_u32(size_t offset) {
+    return ((uint32_t)response[offset] << 0)
+         | ((uint32_t)response[offset+1] << 8)
+         | ((uint32_t)response[offset+2] << 16)
+         | ((uint32_t)response[offset+3] << 24);
+}
+
+/* Send the current request and run the firmware until it answers */
+static bool request_read(void) {
+    if (bench_use_bulk) {
+        return usb_sim_host_read_bulk(response, &response_len);
+    }
+
+    response_len = sizeof(response);
+    return usb_sim_host_read(response);
+}
+
+static bool request_execute(struct bench_result* result) {
+    unsigned int spins;
+
+    if (bench_use_bulk) {
+        usb_sim_host_write_bulk(request, request_len);
+    } else {
+        usb_sim_host_write(request, request_len);
+    }
+    result->commands++;
+
+    for (spins = 0; spins < 16; spins++) {
+        DAP_app_update();
+        if (request_read()) {
+            return response[0] == request[0];
+        }
+    }
+
+    fprintf(stderr, "No response to command 0x%02X\n", request[0]);
+    return false;
+}
+
+/* Collect the next response of a chain, without sending anything */
+static bool response_next(void) {
+    unsigned int spins;
+
+    for (spins = 0; spins < 16; spins++) {
+        DAP_app_update();
+        if (request_read()) {
+            return true;
+        }
+    }
+
+    fprintf(stderr, "Response chain stalled\n");
+    return false;
+}
+
+/* Issue a DAP_Transfer and check that every transfer completed */
+static bool transfer_execute(struct bench_result* result, uint8_t count) {
+    request[2] = count;
+    if (!request_execute(result)) {
+        return false;
+    }
+
+    if (response[1] != count || response[2] != DAP_TRANSFER_OK) {
+        fprintf(stderr, "Transfer failed: %u/%u, ack 0x%02X\n",
+                response[1], count, response[2]);
+        return false;
+    }
+
+    return true;
+}
+
+static void transfer_begin(void) {
+    request_begin(ID_DAP_Transfer);
+    request_u8(0);      /* DAP index */
+    request_u8(0);      /* Transfer count, filled in on execute */
+}
+
+static void transfer_write(uint8_t request_bits, uint32_t data) {
+    request_u8(request_bits);
+    request_u32(data);
+}
+
+static void transfer_read(uint8_t request_bits) {
+    request_u8(request_bits);
+}
+
+/* Target access sequences */
+
+static bool bench_set_clock(struct bench_result* result, uint32_t clock) {
+    request_begin(ID_DAP_SWJ_Clock);
+    request_u32(clock);
+    return request_execute(result) && response[1] == DAP_OK;
+}
+
+static bool bench_transfer_configure(struct bench_result* result,
+                                     uint8_t idle_cycles) {
+    request_begin(ID_DAP_TransferConfigure);
+    request_u8(idle_cycles);
+    request_u16(100);   /* WAIT retries */
+    request_u16(0);     /* Match retries */
+    return request_execute(result) && response[1] == DAP_OK;
+}
+
+static bool bench_connect(struct bench_result* result) {
+    static const uint8_t jtag_to_swd[] = { 0x9E, 0xE7 };
+    unsigned int i;
+
+    request_begin(ID_DAP_Connect);
+    request_u8(DAP_PORT_SWD);
+    if (!request_execute(result) || response[1] != DAP_PORT_SWD) {
+        return false;
+    }
+
+    if (!bench_set_clock(result, DAP_DEFAULT_SWJ_CLOCK)) {
+        return false;
+    }
+
+    if (!bench_transfer_configure(result, 0)) {
+        return false;
+    }
+
+    request_begin(ID_DAP_SWD_Configure);
+    request_u8(0);
+    if (!request_execute(result) || response[1] != DAP_OK) {
+        return false;
+    }
+
+    /* Line reset, JTAG-to-SWD, line reset, idle */
+    request_begin(ID_DAP_SWJ_Sequence);
+    request_u8(51);
+    for (i = 0; i < 7; i++) {
+        request_u8(0xFF);
+    }
+    if (!request_execute(result)) {
+        return false;
+    }
+
+    request_begin(ID_DAP_SWJ_Sequence);
+    request_u8(16);
+    request_u8(jtag_to_swd[0]);
+    request_u8(jtag_to_swd[1]);
+    if (!request_execute(result)) {
+        return false;
+    }
+
+    request_begin(ID_DAP_SWJ_Sequence);
+    request_u8(51);
+    for (i = 0; i < 7; i++) {
+        request_u8(0xFF);
+    }
+    if (!request_execute(result)) {
+        return false;
+    }
+
+    request_begin(ID_DAP_SWJ_Sequence);
+    request_u8(8);
+    request_u8(0x00);
+    if (!request_execute(result)) {
+        return false;
+    }
+
+    transfer_begin();
+    transfer_read(DP_READ(REG_IDCODE));
+    if (!transfer_execute(result, 1) || response_u32(3) != SWD_SIM_DPIDR) {
+        fprintf(stderr, "Unexpected IDCODE 0x%08X\n", response_u32(3));
+        return false;
+    }
+
+    /* Clear errors, power up the debug domain and wait for the ACK */
+    transfer_begin();
+    transfer_write(DP_WRITE(REG_ABORT), DP_ABORT_CLEAR_ALL);
+    transfer_write(DP_WRITE(REG_SELECT), 0);
+    transfer_write(DP_WRITE(REG_CTRL_STAT), DP_CTRL_POWERUP_REQ);
+    transfer_write(DAP_TRANSFER_MATCH_MASK, DP_CTRL_POWERUP_ACK);
+    transfer_write(DP_READ(REG_CTRL_STAT) | DAP_TRANSFER_MATCH_VALUE,
+                   DP_CTRL_POWERUP_ACK);
+    if (!transfer_execute(result, 5)) {
+        return false;
+    }
+
+    transfer_begin();
+    transfer_write(AP_WRITE(REG_CSW), CSW_WORD_INCREMENT);
+    return transfer_execute(result, 1);
+}
+
+static bool bench_set_tar(struct bench_result* result, uint32_t address) {
+    transfer_begin();
+    transfer_write(AP_WRITE(REG_TAR), address);
+    return transfer_execute(result, 1);
+}
+
+static uint32_t bench_pattern(uint32_t index) {
+    return (index * 0x9E3779B9U) ^ 0xA5A5A5A5U;
+}
+
+static bool bench_block_write(struct bench_result* result,
+                              uint32_t address, uint32_t words) {
+    uint32_t index = 0;
+
+    if (!bench_set_tar(result, address)) {
+        return false;
+    }
+
+    while (index < words) {
+        uint32_t count = words - index;
+        uint32_t i;
+        if (count > BLOCK_WRITE_WORDS) {
+            count = BLOCK_WRITE_WORDS;
+        }
+
+        request_begin(ID_DAP_TransferBlock);
+        request_u8(0);
+        request_u16(count);
+        request_u8(AP_WRITE(REG_DRW));
+        for (i = 0; i < count; i++) {
+            request_u32(bench_pattern(index + i));
+        }
+
+        if (!request_execute(result)
+            || response_u16(1) != count
+            || response[3] != DAP_TRANSFER_OK) {
+            fprintf(stderr, "Block write failed at word %u\n", index);
+            return false;
+        }
+
+        index += count;
+        result->bytes += count * 4;
+    }
+
+    return true;
+}
+
+static bool bench_block_read(struct bench_result* result,
+                             uint32_t address, uint32_t words) {
+    uint32_t index = 0;
+
+    if (!bench_set_tar(result, address)) {
+        return false;
+    }
+
+    while (index < words) {
+        uint32_t count = words - index;
+        uint32_t i;
+        if (count > BLOCK_READ_WORDS) {
+            count = BLOCK_READ_WORDS;
+        }
+
+        request_begin(ID_DAP_TransferBlock);
+        request_u8(0);
+        request_u16(count);
+        request_u8(AP_READ(REG_DRW));
+
+        if (!request_execute(result)
+            || response_u16(1) != count
+            || response[3] != DAP_TRANSFER_OK) {
+            fprintf(stderr, "Block read failed at word %u\n", index);
+            return false;
+        }
+
+        for (i = 0; i < count; i++) {
+            uint32_t expected = bench_pattern(index + i);
+            uint32_t actual = response_u32(4 + 4*i);
+            if (actual != expected) {
+                fprintf(stderr, "Word %u: read 0x%08X, expected 0x%08X\n",
+                        index + i, actual, expected);
+                return false;
+            }
+        }
+
+        index += count;
+        result->bytes += count * 4;
+    }
+
+    return true;
+}
+
+static void bench_fill_ram(uint32_t address, uint32_t words) {
+    uint32_t i;
+    for (i = 0; i < words; i++) {
+        swd_sim_write_word(address + 4*i, bench_pattern(i));
+    }
+}
+
+#if RTT_AVAILABLE
+/* Host end of the RTT stream; accepts a few bytes at a time, like a
+   nearly full VCDC buffer would */
+static uint8_t rtt_received[2 * BENCH_RTT_BYTES];
+static size_t rtt_received_len;
+static const char rtt_down_text[] = "reset\n";
+static size_t rtt_down_sent;
+
+static size_t bench_rtt_send(const uint8_t* data, size_t len) {
+    if (len > 24) {
+        len = 24;
+    }
+    if (len > sizeof(rtt_received) - rtt_received_len) {
+        len = sizeof(rtt_received) - rtt_received_len;
+    }
+    memcpy(&rtt_received[rtt_received_len], data, len);
+    rtt_received_len += len;
+    return len;
+}
+
+static size_t bench_rtt_recv(uint8_t* data, size_t max_bytes) {
+    size_t len = sizeof(rtt_down_text) - 1 - rtt_down_sent;
+    if (len > max_bytes) {
+        len = max_bytes;
+    }
+    memcpy(data, &rtt_down_text[rtt_down_sent], len);
+    rtt_down_sent += len;
+    return len;
+}
+
+static uint8_t rtt_pattern(uint32_t index) {
+    return (uint8_t)('A' + index % 26);
+}
+
+static void bench_poke_byte(uint32_t address, uint8_t value) {
+    uint32_t word = 0;
+    uint32_t shift = 8 * (address & 0x3U);
+    swd_sim_read_word(address & ~0x3U, &word);
+    word = (word & ~(0xFFU << shift)) | ((uint32_t)value << shift);
+    swd_sim_write_word(address & ~0x3U, word);
+}
+
+static uint8_t bench_peek_byte(uint32_t address) {
+    uint32_t word = 0;
+    swd_sim_read_word(address & ~0x3U, &word);
+    return (uint8_t)(word >> (8 * (address & 0x3U)));
+}
+
+/* Lay out a control block with two up buffers and one down buffer.
+   Up buffer 0 holds BENCH_RTT_BYTES that wrap around its end. */
+static void bench_rtt_setup_target(void) {
+    static const char id[] = "SEGGER RTT";
+    uint32_t desc = BENCH_RTT_CB + 24;
+    uint32_t start = BENCH_RTT_UP_SIZE - 28;
+    uint32_t i;
+
+    for (i = 0; i < 0x100; i += 4) {
+        swd_sim_write_word(BENCH_RTT_CB - 0x80 + i, 0);
+    }
+    for (i = 0; i < sizeof(id); i++) {
+        bench_poke_byte(BENCH_RTT_CB + i, (uint8_t)id[i]);
+    }
+    swd_sim_write_word(BENCH_RTT_CB + 16, 2);
+    swd_sim_write_word(BENCH_RTT_CB + 20, 1);
+
+    swd_sim_write_word(desc + 4, BENCH_RTT_UP_BUFFER);
+    swd_sim_write_word(desc + 8, BENCH_RTT_UP_SIZE);
+    swd_sim_write_word(desc + 12, (start + BENCH_RTT_BYTES) % BENCH_RTT_UP_SIZE);
+    swd_sim_write_word(desc + 16, start);
+    for (i = 0; i < BENCH_RTT_BYTES; i++) {
+        bench_poke_byte(BENCH_RTT_UP_BUFFER + (start + i) % BENCH_RTT_UP_SIZE,
+                        rtt_pattern(i));
+    }
+
+    desc += 2 * 24;
+    swd_sim_write_word(desc + 4, BENCH_RTT_DOWN_BUFFER);
+    swd_sim_write_word(desc + 8, BENCH_RTT_DOWN_SIZE);
+    swd_sim_write_word(desc + 12, BENCH_RTT_DOWN_SIZE - 2);
+    swd_sim_write_word(desc + 16, BENCH_RTT_DOWN_SIZE - 2);
+}
+
+static bool bench_rtt_command(struct bench_result* result, uint8_t enable,
+                              uint32_t address, uint32_t size) {
+    request_begin(ID_DAP_Vendor1);
+    request_u8(enable);
+    request_u32(address);
+    request_u32(size);
+    return request_execute(result) && response[1] == DAP_OK;
+}
+#endif
+
+#if DAP_STATS_AVAILABLE
+static bool bench_stats_page(struct bench_result* result, uint8_t page,
+                             uint8_t flags) {
+    request_begin(ID_DAP_Vendor2);
+    request_u8(page);
+    request_u8(flags);
+    return request_execute(result) && response[1] == DAP_OK;
+}
+#endif
+
+#if (SWO_UART != 0)
+static uint8_t swo_pattern(uint32_t index) {
+    return (uint8_t)(index * 7 + 3);
+}
+
+/* Feed trace bytes from the simulated UART, as the DMA would */
+static void swo_receive_pattern(uint32_t first, uint32_t count) {
+    uint32_t i;
+    for (i = 0; i < count; i++) {
+        uint8_t data = swo_pattern(first + i);
+        swo_sim_receive(&data, 1);
+    }
+}
+
+static bool bench_swo_command(struct bench_result* result, uint8_t command,
+                              uint8_t value) {
+    request_begin(command);
+    request_u8(value);
+    return request_execute(result) && response[1] == DAP_OK;
+}
+
+static bool bench_swo_start(struct bench_result* result, uint8_t transport) {
+    if (!bench_swo_command(result, ID_DAP_SWO_Transport, transport)
+        || !bench_swo_command(result, ID_DAP_SWO_Mode, DAP_SWO_UART)) {
+        return false;
+    }
+
+    request_begin(ID_DAP_SWO_Baudrate);
+    request_u32(BENCH_SWO_BAUDRATE);
+    if (!request_execute(result) || response_u32(1) != BENCH_SWO_BAUDRATE) {
+        fprintf(stderr, "SWO baudrate not accepted\n");
+        return false;
+    }
+
+    return bench_swo_command(result, ID_DAP_SWO_Control, 1);
+}
+
+static bool bench_swo_stop(struct bench_result* result) {
+    return bench_swo_command(result, ID_DAP_SWO_Control, 0)
+        && bench_swo_command(result, ID_DAP_SWO_Mode, DAP_SWO_OFF);
+}
+#endif
+
+/* Scenarios */
+
+static void scenario_connect(struct bench_result* result) {
+    result->ok = bench_connect(result);
+}
+
+static void scenario_block_write(struct bench_result* result) {
+    uint32_t i;
+
+    result->ok = bench_block_write(result, BENCH_BLOCK_ADDRESS,
+                                   BENCH_BLOCK_WORDS);
+    for (i = 0; result->ok && i < BENCH_BLOCK_WORDS; i++) {
+        uint32_t data = 0;
+        swd_sim_read_word(BENCH_BLOCK_ADDRESS + 4*i, &data);
+        if (data != bench_pattern(i)) {
+            fprintf(stderr, "Word %u: wrote 0x%08X, target has 0x%08X\n",
+                    i, bench_pattern(i), data);
+            result->ok = false;
+        }
+    }
+}
+
+static void scenario_block_read(struct bench_result* result) {
+    bench_fill_ram(BENCH_BLOCK_ADDRESS, BENCH_BLOCK_WORDS);
+    result->ok = bench_block_read(result, BENCH_BLOCK_ADDRESS,
+                                  BENCH_BLOCK_WORDS);
+}
+
+static void scenario_block_read_wait(struct bench_result* result) {
+    bench_fill_ram(BENCH_BLOCK_ADDRESS, BENCH_BLOCK_WORDS);
+    swd_sim_set_ap_wait_cycles(64);
+    result->ok = bench_block_read(result, BENCH_BLOCK_ADDRESS,
+                                  BENCH_BLOCK_WORDS);
+    swd_sim_set_ap_wait_cycles(0);
+}
+
+/* Same as block-read-1k, but with idle cycles after each transfer,
+   which takes the general transfer functions instead of the ones
+   specialized for the default configuration. */
+static void scenario_block_read_idle(struct bench_result* result) {
+    bench_fill_ram(BENCH_BLOCK_ADDRESS, BENCH_BLOCK_WORDS);
+    result->ok = bench_transfer_configure(result, 2)
+              && bench_block_read(result, BENCH_BLOCK_ADDRESS,
+                                  BENCH_BLOCK_WORDS)
+              && bench_transfer_configure(result, 0);
+}
+
+#if (DAP_SWD_SPI != 0)
+/* Same as block-read-1k, but below the slowest SPI clock so that the
+   data phases are bit-banged instead of shifted by the SPI. */
+static void scenario_block_read_gpio(struct bench_result* result) {
+    bench_fill_ram(BENCH_BLOCK_ADDRESS, BENCH_BLOCK_WORDS);
+    result->ok = bench_set_clock(result, 100000)
+              && bench_block_read(result, BENCH_BLOCK_ADDRESS,
+                                  BENCH_BLOCK_WORDS)
+              && bench_set_clock(result, DAP_DEFAULT_SWJ_CLOCK);
+}
+#endif
+
+/* Same as block-read-1k, but over the bulk endpoints. Bulk responses
+   are only as long as the data they carry. */
+static void scenario_block_read_bulk(struct bench_result* result) {
+    bench_fill_ram(BENCH_BLOCK_ADDRESS, BENCH_BLOCK_WORDS);
+    bench_use_bulk = true;
+    result->ok = bench_block_read(result, BENCH_BLOCK_ADDRESS,
+                                  BENCH_BLOCK_WORDS);
+    if (result->ok && response_len != 4 + 4*(BENCH_BLOCK_WORDS % BLOCK_READ_WORDS)) {
+        fprintf(stderr, "Unexpected bulk response length %u\n",
+                (unsigned int)response_len);
+        result->ok = false;
+    }
+    bench_use_bulk = false;
+}
+
+/* Same as block-read-1k, but with every request posted up front and
+   delivered by the simulated USB interrupt while the firmware is busy
+   on the wire. Each DAP_app_update must find its next request already
+   received, i.e. reception overlaps SWD execution. */
+#define BENCH_USB_IRQ_PERIOD    256
+
+static void scenario_block_read_irq(struct bench_result* result) {
+    uint32_t reports = 0;
+    uint32_t updates = 0;
+    uint32_t index;
+
+    bench_fill_ram(BENCH_BLOCK_ADDRESS, BENCH_BLOCK_WORDS);
+    result->ok = bench_set_tar(result, BENCH_BLOCK_ADDRESS);
+
+    for (index = 0; result->ok && index < BENCH_BLOCK_WORDS;
+         index += BLOCK_READ_WORDS) {
+        uint32_t count = BENCH_BLOCK_WORDS - index;
+        if (count > BLOCK_READ_WORDS) {
+            count = BLOCK_READ_WORDS;
+        }
+
+        request_begin(ID_DAP_TransferBlock);
+        request_u8(0);
+        request_u16(count);
+        request_u8(AP_READ(REG_DRW));
+        result->ok = usb_sim_host_post(request, request_len);
+        result->commands++;
+        reports++;
+    }
+
+    swd_sim_set_clock_hook(usb_sim_interrupt, BENCH_USB_IRQ_PERIOD);
+    usb_sim_interrupt();
+
+    index = 0;
+    while (result->ok && index < BENCH_BLOCK_WORDS) {
+        uint32_t count;
+        uint32_t i;
+
+        DAP_app_update();
+        if (++updates > reports || !usb_sim_host_read(response)) {
+            fprintf(stderr, "Firmware idle waiting for report %u\n", updates);
+            result->ok = false;
+            break;
+        }
+
+        count = response_u16(1);
+        if (response[0] != ID_DAP_TransferBlock
+            || response[3] != DAP_TRANSFER_OK) {
+            fprintf(stderr, "Block read failed at word %u\n", index);
+            result->ok = false;
+        }
+        for (i = 0; result->ok && i < count; i++) {
+            if (response_u32(4 + 4*i) != bench_pattern(index + i)) {
+                fprintf(stderr, "Word %u mismatch\n", index + i);
+                result->ok = false;
+            }
+        }
+
+        index += count;
+        result->bytes += count * 4;
+    }
+
+    swd_sim_set_clock_hook(NULL, 0);
+    if (result->ok && usb_sim_host_pending() != 0) {
+        fprintf(stderr, "Reports left undelivered\n");
+        result->ok = false;
+    }
+}
+
+/* More reports than the packet queue holds, delivered while the
+   firmware is busy elsewhere: the OUT endpoint must NAK once the queue
+   fills up rather than drop or overwrite reports. */
+#define OVERRUN_REPORTS         (DAP_PACKET_QUEUE_SIZE + 4)
+
+static void scenario_queue_overrun(struct bench_result* result) {
+    uint32_t report;
+    uint32_t received = 0;
+    unsigned int spins = 0;
+
+    bench_fill_ram(BENCH_BLOCK_ADDRESS, BENCH_BLOCK_WORDS);
+    result->ok = true;
+
+    for (report = 0; result->ok && report < OVERRUN_REPORTS; report++) {
+        transfer_begin();
+        request[2] = 2;
+        transfer_write(AP_WRITE(REG_TAR), BENCH_BLOCK_ADDRESS + 4*report);
+        transfer_read(AP_READ(REG_DRW));
+        result->ok = usb_sim_host_post(request, request_len);
+        result->commands++;
+    }
+
+    for (report = 0; report < OVERRUN_REPORTS; report++) {
+        usb_sim_interrupt();
+    }
+
+    if (result->ok && usb_sim_host_pending() == 0) {
+        fprintf(stderr, "Queue accepted %u reports\n", OVERRUN_REPORTS);
+        result->ok = false;
+    }
+
+    while (result->ok && received < OVERRUN_REPORTS) {
+        DAP_app_update();
+        usb_sim_interrupt();
+        if (!usb_sim_host_read(response)) {
+            if (++spins == 4 * OVERRUN_REPORTS) {
+                fprintf(stderr, "Stalled after %u reports\n", received);
+                result->ok = false;
+            }
+            continue;
+        }
+
+        if (response[0] != ID_DAP_Transfer || response[1] != 2
+            || response[2] != DAP_TRANSFER_OK
+            || response_u32(3) != bench_pattern(received)) {
+            fprintf(stderr, "Report %u out of order or corrupt\n", received);
+            result->ok = false;
+        }
+
+        received++;
+        result->bytes += 4;
+    }
+
+    if (result->ok && usb_sim_host_dropped() != 0) {
+        fprintf(stderr, "%u reports dropped\n", usb_sim_host_dropped());
+        result->ok = false;
+    }
+}
+
+#if DAP_STATS_AVAILABLE
+/* A short block read with WAIT responses, then the statistics read out
+   through the vendor command must agree with what the target saw. */
+#define STATS_WORDS             64
+#define STATS_PER_PAGE          ((DAP_PACKET_SIZE - 3) / 9)
+
+static void scenario_stats(struct bench_result* result) {
+    uint32_t counts[DAP_STATS_COMMANDS];
+    uint64_t cycles = 0;
+    uint8_t pages;
+    uint8_t page;
+    uint32_t i;
+
+    bench_fill_ram(BENCH_BLOCK_ADDRESS, STATS_WORDS);
+    result->ok = bench_stats_page(result, 0, 0x01);
+
+    swd_sim_set_ap_wait_cycles(64);
+    result->ok = result->ok && bench_block_read(result, BENCH_BLOCK_ADDRESS,
+                                                STATS_WORDS);
+    swd_sim_set_ap_wait_cycles(0);
+
+    if (!result->ok || !bench_stats_page(result, 0, 0)) {
+        result->ok = false;
+        return;
+    }
+
+    pages = response[2];
+    if (response_u32(7) != swd_sim_stats.ack_wait
+        || response_u32(11) != swd_sim_stats.ack_fault
+        || response[19] == 0 || response[20] != DAP_PACKET_QUEUE_SIZE) {
+        fprintf(stderr, "Stats summary mismatch: %u waits, %u faults\n",
+                response_u32(7), response_u32(11));
+        result->ok = false;
+        return;
+    }
+
+    memset(counts, 0, sizeof(counts));
+    for (page = 1; result->ok && page < pages; page++) {
+        uint32_t first = (page - 1) * STATS_PER_PAGE;
+        result->ok = bench_stats_page(result, page, 0);
+        for (i = 0; result->ok && i < STATS_PER_PAGE
+             && first + i < DAP_STATS_COMMANDS; i++) {
+            size_t offset = 3 + 9*i;
+            uint32_t id = (first + i == DAP_STATS_VENDOR) ? ID_DAP_Vendor0
+                                                          : first + i;
+            if (response[offset] != id) {
+                fprintf(stderr, "Stats page %u out of order\n", page);
+                result->ok = false;
+            }
+            counts[first + i] = response_u32(offset + 1);
+            cycles += response_u32(offset + 5);
+        }
+    }
+
+    /* The host build counts SWCLK cycles, so all of them must be
+       accounted to some command */
+    if (result->ok && (counts[ID_DAP_TransferBlock]
+                       != (STATS_WORDS + BLOCK_READ_WORDS - 1) / BLOCK_READ_WORDS
+                       || cycles != swd_sim_stats.swclk_cycles)) {
+        fprintf(stderr, "Stats: %u block reads, %llu of %llu cycles\n",
+                counts[ID_DAP_TransferBlock], (unsigned long long)cycles,
+                (unsigned long long)swd_sim_stats.swclk_cycles);
+        result->ok = false;
+    }
+
+    result->bytes += STATS_WORDS * 4;
+}
+#endif
+
+/* Requested SWJ clocks and the clock the host configuration generates
+   for each: fixed fast loop, delay loop or timer paced */
+static const struct {
+    uint32_t request;
+    uint8_t source;
+    uint32_t actual;
+} bench_clocks[] = {
+    { 12000000, DAP_CLOCK_SOURCE_FAST,  12000000 },
+    { 10000000, DAP_CLOCK_SOURCE_DELAY, 4800000 },
+#if (DAP_SWD_TIMER != 0)
+    {  1000000, DAP_CLOCK_SOURCE_TIMER, 1000000 },
+    {   700000, DAP_CLOCK_SOURCE_TIMER, 685714 },
+    {      100, DAP_CLOCK_SOURCE_TIMER, 100 },
+#else
+    {  1000000, DAP_CLOCK_SOURCE_DELAY, 923076 },
+#endif
+};
+
+/* Each clock must be reported back through the clock info vendor
+   command, and only timer paced clocks may wait on the timer, once per
+   half SWCLK period. */
+static void scenario_swj_clock(struct bench_result* result) {
+    size_t count = sizeof(bench_clocks)/sizeof(bench_clocks[0]);
+    size_t i;
+
+    result->ok = true;
+    for (i = 0; result->ok && i < count; i++) {
+        uint64_t cycles;
+        uint32_t waits;
+        uint32_t starts;
+
+        if (!bench_set_clock(result, bench_clocks[i].request)) {
+            result->ok = false;
+            break;
+        }
+
+        request_begin(ID_DAP_Vendor3);
+        if (!request_execute(result) || response[1] != DAP_OK) {
+            result->ok = false;
+            break;
+        }
+
+        if (response[2] != bench_clocks[i].source
+            || response_u32(4) != bench_clocks[i].request
+            || response_u32(8) != bench_clocks[i].actual) {
+            fprintf(stderr, "Clock %u Hz: source %u, %u Hz generated\n",
+                    bench_clocks[i].request, response[2], response_u32(8));
+            result->ok = false;
+            break;
+        }
+
+        cycles = swd_sim_stats.swclk_cycles;
+        waits = swd_sim_stats.timer_waits;
+        starts = swd_sim_stats.timer_starts;
+        transfer_begin();
+        transfer_read(DP_READ(REG_IDCODE));
+        if (!transfer_execute(result, 1) || response_u32(3) != SWD_SIM_DPIDR) {
+            result->ok = false;
+            break;
+        }
+
+        cycles = swd_sim_stats.swclk_cycles - cycles;
+        waits = swd_sim_stats.timer_waits - waits;
+        starts = swd_sim_stats.timer_starts - starts;
+        if (bench_clocks[i].source == DAP_CLOCK_SOURCE_TIMER
+            ? (starts != 1 || waits != 2 * cycles)
+            : (starts != 0 || waits != 0)) {
+            fprintf(stderr, "Clock %u Hz: %u timer waits for %llu cycles\n",
+                    bench_clocks[i].request, waits,
+                    (unsigned long long)cycles);
+            result->ok = false;
+        }
+    }
+
+    result->ok = result->ok && bench_set_clock(result, DAP_DEFAULT_SWJ_CLOCK);
+}
+
+#if DAP_CLOCK_TUNE_AVAILABLE
+/* A target at the end of a long cable: above cable_max_clock, one in
+   every BENCH_CABLE_NOISE_BITS bits it drives arrives inverted */
+#define BENCH_CABLE_MAX_CLOCK   2000000U
+#define BENCH_CABLE_SLOW_CLOCK  900000U
+#define BENCH_CABLE_NOISE_BITS  61U
+
+static uint32_t cable_bits;
+static uint32_t cable_max_clock;
+
+static bool bench_cable_noise(void) {
+    return DAP_Data.clock_actual > cable_max_clock
+        && ++cable_bits % BENCH_CABLE_NOISE_BITS == 0;
+}
+
+/* The sweep must settle on the fastest setting within the cable's limit,
+   a delay of 4 (1.71MHz) in the host configuration, put the host's TAR
+   back and leave the connection usable at the new clock. A slower cable
+   then makes it settle below the fastest timer-paced clock, where the
+   delay loop setting that passed must still be the one kept. */
+static void scenario_clock_tune(struct bench_result* result) {
+    uint32_t clock;
+
+    /* Start from a clock the cable handles, as a script would */
+    result->ok = bench_set_clock(result, 1000000)
+              && bench_set_tar(result, BENCH_BLOCK_ADDRESS);
+
+    cable_max_clock = BENCH_CABLE_MAX_CLOCK;
+    swd_sim_set_noise_hook(bench_cable_noise);
+    request_begin(ID_DAP_Vendor4);
+    request_u8(0);
+    request_u32(0);
+    result->ok = result->ok && request_execute(result);
+    swd_sim_set_noise_hook(NULL);
+
+    if (result->ok && (response[1] != DAP_OK || response[2] != 5
+                       || response[3] != 0 || response_u16(4) != 4
+                       || response_u32(6) != 1714286)) {
+        fprintf(stderr, "Clock tuning: status %u after %u settings, "
+                "delay %u, %u Hz\n", response[1], response[2],
+                response_u16(4), response_u32(6));
+        result->ok = false;
+    }
+
+    /* The four faster settings garble packets on purpose */
+    swd_sim_stats.protocol_errors = 0;
+
+    transfer_begin();
+    transfer_read(AP_READ(REG_TAR));
+    transfer_read(DP_READ(REG_RDBUFF));
+    if (result->ok && (!transfer_execute(result, 2)
+                       || response_u32(7) != BENCH_BLOCK_ADDRESS)) {
+        fprintf(stderr, "Clock tuning lost TAR\n");
+        result->ok = false;
+    }
+
+    request_begin(ID_DAP_Vendor3);
+    if (result->ok && (!request_execute(result)
+                       || response[2] != DAP_CLOCK_SOURCE_DELAY
+                       || response_u32(4) != 1714286)) {
+        fprintf(stderr, "Clock tuning did not keep the clock\n");
+        result->ok = false;
+    }
+
+    result->ok = result->ok && bench_set_clock(result, 500000);
+    cable_max_clock = BENCH_CABLE_SLOW_CLOCK;
+    swd_sim_set_noise_hook(bench_cable_noise);
+    request_begin(ID_DAP_Vendor4);
+    request_u8(0);
+    request_u32(0);
+    result->ok = result->ok && request_execute(result)
+              && response[1] == DAP_OK;
+    swd_sim_set_noise_hook(NULL);
+    swd_sim_stats.protocol_errors = 0;
+    clock = response_u32(6);
+
+    request_begin(ID_DAP_Vendor3);
+    if (result->ok && (!request_execute(result)
+                       || response[2] != DAP_CLOCK_SOURCE_DELAY
+                       || response_u32(4) != clock
+                       || clock > BENCH_CABLE_SLOW_CLOCK)) {
+        fprintf(stderr, "Clock tuning kept source %u at %u Hz, "
+                "tested %u Hz\n", response[2], response_u32(4), clock);
+        result->ok = false;
+    }
+
+    result->ok = result->ok && bench_set_clock(result, DAP_DEFAULT_SWJ_CLOCK);
+}
+#endif
+
+#if DAP_BLOCK_READ_AVAILABLE
+/* 4KB read by address with vendor command 0x85, crossing four 1KB TAR
+   boundaries. The first chunk runs on a saved and restored AP setup;
+   the rest continue on the host's own, so the probe only writes TAR
+   once more to resume and then at each boundary. */
+static void scenario_block_read_vendor(struct bench_result* result) {
+    uint32_t index = 0;
+    uint32_t tar_writes = 0;
+
+    bench_fill_ram(BENCH_STREAM_ADDRESS, BENCH_STREAM_WORDS);
+    result->ok = bench_set_tar(result, BENCH_BLOCK_ADDRESS);
+
+    while (result->ok && index < BENCH_STREAM_WORDS) {
+        uint32_t count = BENCH_STREAM_WORDS - index;
+        uint32_t i;
+        if (count > BLOCK_READ_WORDS) {
+            count = BLOCK_READ_WORDS;
+        }
+
+        request_begin(ID_DAP_Vendor5);
+        request_u8((index == 0) ? 0 : (DAP_BLOCK_HOST_AP | DAP_BLOCK_CONTINUE));
+        request_u32(BENCH_STREAM_ADDRESS + 4*index);
+        request_u16(count);
+        tar_writes -= swd_sim_stats.ap_writes;
+        if (!request_execute(result) || response[1] != DAP_OK
+            || response_u16(2) != count) {
+            fprintf(stderr, "Vendor block read failed at word %u\n", index);
+            result->ok = false;
+            break;
+        }
+        tar_writes += swd_sim_stats.ap_writes;
+
+        for (i = 0; i < count; i++) {
+            uint32_t actual = response_u32(4 + 4*i);
+            if (actual != bench_pattern(index + i)) {
+                fprintf(stderr, "Word %u: read 0x%08X, expected 0x%08X\n",
+                        index + i, actual, bench_pattern(index + i));
+                result->ok = false;
+            }
+        }
+
+        if (index == 0) {
+            /* The host's TAR must have survived the first chunk */
+            transfer_begin();
+            transfer_read(AP_READ(REG_TAR));
+            transfer_read(DP_READ(REG_RDBUFF));
+            if (result->ok && (!transfer_execute(result, 2)
+                               || response_u32(7) != BENCH_BLOCK_ADDRESS)) {
+                fprintf(stderr, "Vendor block read lost TAR\n");
+                result->ok = false;
+            }
+            tar_writes = 0;
+        }
+
+        index += count;
+        result->bytes += count * 4;
+    }
+
+    if (result->ok && tar_writes != 1 + BENCH_STREAM_BOUNDARIES) {
+        fprintf(stderr, "Vendor block read wrote TAR %u times\n", tar_writes);
+        result->ok = false;
+    }
+
+    /* Unaligned and oversized requests are refused */
+    request_begin(ID_DAP_Vendor5);
+    request_u8(DAP_BLOCK_HOST_AP);
+    request_u32(BENCH_STREAM_ADDRESS + 2);
+    request_u16(1);
+    if (result->ok && (!request_execute(result) || response[1] != DAP_ERROR
+                       || response_u16(2) != 0)) {
+        fprintf(stderr, "Unaligned vendor block read accepted\n");
+        result->ok = false;
+    }
+}
+#endif
+
+#if DAP_BLOCK_READ_AVAILABLE
+/* The same 4KB read as one request, answered with a chain of
+   responses. The DRW reads stay posted across the whole chain, so
+   apart from checking CTRL/STAT for sticky errors and saving the
+   host's TAR, RDBUFF is read only once. A request sent meanwhile must
+   wait for the end of the chain, and inside an ExecuteCommands batch
+   the read is refused. */
+static void scenario_block_read_chain(struct bench_result* result) {
+    uint32_t index = 0;
+    uint32_t dp_reads;
+    bool more = true;
+
+    bench_fill_ram(BENCH_STREAM_ADDRESS, BENCH_STREAM_WORDS);
+    result->ok = bench_set_tar(result, BENCH_BLOCK_ADDRESS);
+
+    request_begin(ID_DAP_Vendor5);
+    request_u8(0);
+    request_u32(BENCH_STREAM_ADDRESS);
+    request_u16(BENCH_STREAM_WORDS);
+    dp_reads = swd_sim_stats.dp_reads;
+    result->ok = result->ok && request_execute(result);
+
+    /* Queued behind the chain */
+    request_begin(ID_DAP_Info);
+    request_u8(DAP_ID_PACKET_COUNT);
+    usb_sim_host_write(request, request_len);
+    result->commands++;
+
+    while (result->ok && more) {
+        uint32_t header = response_u16(2);
+        uint32_t count = header & ~DAP_BLOCK_MORE;
+        uint32_t i;
+
+        if (response[0] != ID_DAP_Vendor5 || response[1] != DAP_OK
+            || index + count > BENCH_STREAM_WORDS) {
+            fprintf(stderr, "Chained read failed at word %u\n", index);
+            result->ok = false;
+            break;
+        }
+
+        for (i = 0; i < count; i++) {
+            uint32_t actual = response_u32(4 + 4*i);
+            if (actual != bench_pattern(index + i)) {
+                fprintf(stderr, "Word %u: read 0x%08X, expected 0x%08X\n",
+                        index + i, actual, bench_pattern(index + i));
+                result->ok = false;
+            }
+        }
+
+        index += count;
+        result->bytes += count * 4;
+        more = (header & DAP_BLOCK_MORE) != 0;
+        if (more && !response_next()) {
+            result->ok = false;
+        }
+    }
+
+    if (result->ok && (index != BENCH_STREAM_WORDS
+                       || swd_sim_stats.dp_reads - dp_reads != 3)) {
+        fprintf(stderr, "Chained read: %u words, %u DP reads\n",
+                index, swd_sim_stats.dp_reads - dp_reads);
+        result->ok = false;
+    }
+
+    if (result->ok && (!response_next() || response[0] != ID_DAP_Info)) {
+        fprintf(stderr, "Request behind the chain lost\n");
+        result->ok = false;
+    }
+
+    transfer_begin();
+    transfer_read(AP_READ(REG_TAR));
+    transfer_read(DP_READ(REG_RDBUFF));
+    if (result->ok && (!transfer_execute(result, 2)
+                       || response_u32(7) != BENCH_BLOCK_ADDRESS)) {
+        fprintf(stderr, "Chained read lost TAR\n");
+        result->ok = false;
+    }
+
+    request_begin(ID_DAP_ExecuteCommands);
+    request_u8(1);
+    request_u8(ID_DAP_Vendor5);
+    request_u8(0);
+    request_u32(BENCH_STREAM_ADDRESS);
+    request_u16(BLOCK_READ_WORDS + 1);
+    if (result->ok && (!request_execute(result) || response[2] != ID_DAP_Vendor5
+                       || response[3] != DAP_ERROR)) {
+        fprintf(stderr, "Chained read accepted inside ExecuteCommands\n");
+        result->ok = false;
+    }
+}
+#endif
+
+#if DAP_FLASH_AVAILABLE
+/* Flash programmed by the probe through a stand-in flash algorithm: the
+   core hook plays Init, EraseSector, ProgramPage and UnInit on a
+   simulated flash array, taking BENCH_PAGE_CYCLES per page, and checks
+   the registers each call starts with. */
+#define BENCH_FLASH_BASE        0x08000000U
+#define BENCH_FLASH_SIZE        4096U
+#define BENCH_SECTOR_SIZE       1024U
+#define BENCH_PAGE_SIZE         256U
+#define BENCH_PAGE_CYCLES       4000U
+#define BENCH_SLOW_PAGE         5U
+#define BENCH_SLOW_PAGE_CYCLES  60000U
+/* Erasing the sector after the end never returns */
+#define BENCH_HANG_SECTOR       (BENCH_FLASH_BASE + BENCH_FLASH_SIZE)
+
+#define BENCH_ALGO_ADDRESS      (SWD_SIM_RAM_BASE + 0xA000U)
+#define BENCH_ALGO_INIT         (BENCH_ALGO_ADDRESS + 0x05U)
+#define BENCH_ALGO_UNINIT       (BENCH_ALGO_ADDRESS + 0x11U)
+#define BENCH_ALGO_ERASE        (BENCH_ALGO_ADDRESS + 0x21U)
+#define BENCH_ALGO_PROGRAM      (BENCH_ALGO_ADDRESS + 0x41U)
+#define BENCH_ALGO_STATIC_BASE  (BENCH_ALGO_ADDRESS + 0x100U)
+#define BENCH_ALGO_WORDS        32U
+#define BENCH_ALGO_STACK        (SWD_SIM_RAM_BASE + 0xB000U)
+#define BENCH_PAGE_BUFFER0      (SWD_SIM_RAM_BASE + 0xB000U)
+#define BENCH_PAGE_BUFFER1      (SWD_SIM_RAM_BASE + 0xB400U)
+
+#define CORE_DHCSR              0xE000EDF0U
+#define DHCSR_HALT              0xA05F0003U
+
+#define FLASH_PAGE_WORDS        ((DAP_PACKET_SIZE - 9) / 4)
+#define FLASH_WRITE_WORDS       ((DAP_PACKET_SIZE - 7) / 4)
+
+static uint8_t bench_flash[BENCH_FLASH_SIZE];
+static uint32_t algo_errors;
+static uint32_t algo_pages;
+
+#if DAP_CRC_AVAILABLE
+#define BENCH_CRC_STUB          (SWD_SIM_RAM_BASE + 0xB800U)
+#define BENCH_CRC_POLY          0xEDB88320U
+#define BENCH_CRC_START         (BENCH_STREAM_ADDRESS + 1U)
+#define BENCH_CRC_LENGTH        (4U * BENCH_STREAM_WORDS - 3U)
+#define BENCH_CRC_SPLIT         2047U
+
+/* zlib's crc32() of target memory, a bit at a time */
+static uint32_t bench_crc32(uint32_t crc, uint32_t address, uint32_t length) {
+    crc = ~crc;
+    while (length--) {
+        uint32_t word = 0;
+        uint32_t bit;
+
+        swd_sim_read_word(address & ~0x3U, &word);
+        crc ^= (word >> (8 * (address & 0x3U))) & 0xFFU;
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 0x1U) ? BENCH_CRC_POLY : 0);
+        }
+        address++;
+    }
+    return ~crc;
+}
+#endif
+
+static uint32_t bench_algo(uint32_t* regs, bool finished) {
+    uint32_t pc = regs[SWD_SIM_REG_PC] | 0x1U;
+    uint32_t offset = regs[0] - BENCH_FLASH_BASE;
+    uint32_t i;
+
+    if (regs[SWD_SIM_REG_SP] != BENCH_ALGO_STACK
+        || regs[SWD_SIM_REG_R9] != BENCH_ALGO_STATIC_BASE
+        || regs[SWD_SIM_REG_LR] != (BENCH_ALGO_ADDRESS | 0x1U)
+        || regs[SWD_SIM_REG_XPSR] != 0x01000000U) {
+        algo_errors++;
+    }
+
+    if (pc == BENCH_ALGO_INIT || pc == BENCH_ALGO_UNINIT) {
+        regs[0] = 0;
+        return 100;
+    }
+
+    if (pc == BENCH_ALGO_ERASE && regs[0] == BENCH_HANG_SECTOR) {
+        return 0;
+    }
+
+    if (pc == BENCH_ALGO_ERASE && offset < BENCH_FLASH_SIZE) {
+        if (finished) {
+            memset(&bench_flash[offset & ~(BENCH_SECTOR_SIZE - 1)], 0xFF,
+                   BENCH_SECTOR_SIZE);
+            regs[0] = 0;
+        }
+        return 2000;
+    }
+
+    if (pc == BENCH_ALGO_PROGRAM && offset < BENCH_FLASH_SIZE
+        && regs[1] == BENCH_PAGE_SIZE) {
+        if (!finished) {
+            return (offset / BENCH_PAGE_SIZE == BENCH_SLOW_PAGE)
+                   ? BENCH_SLOW_PAGE_CYCLES : BENCH_PAGE_CYCLES;
+        }
+        /* Read the buffer at the end, so that it has to stay untouched
+           while the page is being programmed */
+        for (i = 0; i < BENCH_PAGE_SIZE; i += 4) {
+            uint32_t word = 0;
+            swd_sim_read_word(regs[2] + i, &word);
+            memcpy(&bench_flash[offset + i], &word, 4);
+        }
+        algo_pages++;
+        regs[0] = 0;
+        return 0;
+    }
+
+#if DAP_CRC_AVAILABLE
+    /* The CRC routine, recognized by the constant at its end; the
+       target takes a SWCLK cycle per byte */
+    if (pc == (BENCH_CRC_STUB | 0x1U)) {
+        uint32_t poly = 0;
+        swd_sim_read_word(BENCH_CRC_STUB + 0x24U, &poly);
+        if (poly == BENCH_CRC_POLY) {
+            if (finished) {
+                regs[0] = bench_crc32(regs[2], regs[0], regs[1]);
+            }
+            return 100 + regs[1];
+        }
+    }
+#endif
+
+    algo_errors++;
+    regs[0] = 1;
+    return 100;
+}
+
+static bool bench_flash_command(struct bench_result* result) {
+    if (!request_execute(result) || response[1] == DAP_ERROR) {
+        fprintf(stderr, "Flash command %u failed: status 0x%02X\n",
+                request[1], response[1]);
+        return false;
+    }
+    return true;
+}
+
+/* Wait for the running algorithm call to finish successfully */
+static bool bench_flash_wait(struct bench_result* result) {
+    unsigned int tries;
+
+    for (tries = 0; tries < 16; tries++) {
+        request_begin(ID_DAP_Vendor6);
+        request_u8(DAP_FLASH_STATUS);
+        if (!bench_flash_command(result)) {
+            return false;
+        }
+        if (!response[2]) {
+            return response_u32(3) == 0;
+        }
+    }
+
+    return false;
+}
+
+static bool bench_flash_call(struct bench_result* result, uint8_t function,
+                             uint32_t r0, uint32_t r1, uint32_t r2) {
+    request_begin(ID_DAP_Vendor6);
+    request_u8(DAP_FLASH_CALL);
+    request_u8(function);
+    request_u32(r0);
+    request_u32(r1);
+    request_u32(r2);
+    return bench_flash_command(result) && bench_flash_wait(result);
+}
+
+static bool bench_flash_load(struct bench_result* result) {
+    uint32_t index;
+    uint32_t i;
+
+    /* Halt the core, as a debugger would before flashing */
+    transfer_begin();
+    transfer_write(AP_WRITE(REG_TAR), CORE_DHCSR);
+    transfer_write(AP_WRITE(REG_DRW), DHCSR_HALT);
+    transfer_write(AP_WRITE(REG_TAR), BENCH_BLOCK_ADDRESS);
+    if (!transfer_execute(result, 3) || !swd_sim_core_halted()) {
+        return false;
+    }
+
+    /* A breakpoint, then the "code" */
+    for (index = 0; index < BENCH_ALGO_WORDS; index += FLASH_WRITE_WORDS) {
+        uint32_t count = BENCH_ALGO_WORDS - index;
+        if (count > FLASH_WRITE_WORDS) {
+            count = FLASH_WRITE_WORDS;
+        }
+
+        request_begin(ID_DAP_Vendor6);
+        request_u8(DAP_FLASH_WRITE);
+        request_u8(count);
+        request_u32(BENCH_ALGO_ADDRESS + 4*index);
+        for (i = 0; i < count; i++) {
+            request_u32((index + i == 0) ? 0xE00ABE00U : bench_pattern(index + i));
+        }
+        if (!bench_flash_command(result)) {
+            return false;
+        }
+    }
+
+    for (i = 1; i < BENCH_ALGO_WORDS; i++) {
+        uint32_t word = 0;
+        swd_sim_read_word(BENCH_ALGO_ADDRESS + 4*i, &word);
+        if (word != bench_pattern(i)) {
+            fprintf(stderr, "Flash algorithm word %u not loaded\n", i);
+            return false;
+        }
+    }
+
+    request_begin(ID_DAP_Vendor6);
+    request_u8(DAP_FLASH_SETUP);
+    request_u32(BENCH_ALGO_ADDRESS);
+    request_u32(BENCH_ALGO_STATIC_BASE);
+    request_u32(BENCH_ALGO_STACK);
+    request_u32(BENCH_ALGO_INIT);
+    request_u32(BENCH_ALGO_UNINIT);
+    request_u32(BENCH_ALGO_ERASE);
+    request_u32(BENCH_ALGO_PROGRAM);
+    request_u32(BENCH_PAGE_BUFFER0);
+    request_u32(BENCH_PAGE_BUFFER1);
+    request_u32(BENCH_PAGE_SIZE);
+    return bench_flash_command(result);
+}
+
+/* Every page after the first is sent while the previous one programs;
+   the slow page makes the probe ask for its successor to be resent. */
+static void scenario_flash_program(struct bench_result* result) {
+    uint32_t page_words = BENCH_PAGE_SIZE / 4;
+    uint32_t overlapped = 0;
+    uint32_t busy = 0;
+    uint32_t address;
+    uint32_t i;
+
+    memset(bench_flash, 0, sizeof(bench_flash));
+    algo_errors = 0;
+    algo_pages = 0;
+    swd_sim_set_core_hook(bench_algo);
+
+    result->ok = bench_flash_load(result)
+              && bench_flash_call(result, DAP_FLASH_INIT, BENCH_FLASH_BASE, 0, 2);
+
+    for (address = 0; result->ok && address < BENCH_FLASH_SIZE;
+         address += BENCH_SECTOR_SIZE) {
+        result->ok = bench_flash_call(result, DAP_FLASH_ERASE_SECTOR,
+                                      BENCH_FLASH_BASE + address, 0, 0);
+    }
+
+    for (address = 0; result->ok && address < BENCH_FLASH_SIZE;
+         address += BENCH_PAGE_SIZE) {
+        uint32_t base = address / 4;
+        uint32_t index = 0;
+
+        while (result->ok && index < page_words) {
+            uint32_t count = page_words - index;
+            if (count > FLASH_PAGE_WORDS) {
+                count = FLASH_PAGE_WORDS;
+            }
+
+            request_begin(ID_DAP_Vendor6);
+            request_u8(DAP_FLASH_PAGE);
+            request_u8(count);
+            request_u16(4 * index);
+            request_u32(BENCH_FLASH_BASE + address);
+            for (i = 0; i < count; i++) {
+                request_u32(bench_pattern(base + index + i));
+            }
+            if (!bench_flash_command(result) || response_u32(3) != 0) {
+                result->ok = false;
+                break;
+            }
+
+            if (response[1] == DAP_FLASH_BUSY) {
+                busy++;
+                continue;
+            }
+            if (index + count < page_words && !swd_sim_core_halted()) {
+                overlapped++;
+            }
+            index += count;
+            result->bytes += count * 4;
+        }
+    }
+
+    result->ok = result->ok && bench_flash_wait(result)
+              && bench_flash_call(result, DAP_FLASH_UNINIT, 2, 0, 0);
+
+    for (i = 0; result->ok && i < BENCH_FLASH_SIZE / 4; i++) {
+        uint32_t word;
+        memcpy(&word, &bench_flash[4*i], 4);
+        if (word != bench_pattern(i)) {
+            fprintf(stderr, "Flash word %u: 0x%08X, expected 0x%08X\n",
+                    i, word, bench_pattern(i));
+            result->ok = false;
+        }
+    }
+
+    /* The data for pages 2-16 was sent while the one before programmed */
+    if (result->ok && (algo_errors != 0
+                       || algo_pages != BENCH_FLASH_SIZE / BENCH_PAGE_SIZE
+                       || busy == 0
+                       || overlapped < BENCH_FLASH_SIZE / BENCH_PAGE_SIZE - 1)) {
+        fprintf(stderr, "Flash: %u bad calls, %u pages, %u busy, "
+                "%u chunks overlapped\n", algo_errors, algo_pages,
+                busy, overlapped);
+        result->ok = false;
+    }
+
+    transfer_begin();
+    transfer_read(AP_READ(REG_TAR));
+    transfer_read(DP_READ(REG_RDBUFF));
+    if (result->ok && (!transfer_execute(result, 2)
+                       || response_u32(7) != BENCH_BLOCK_ADDRESS)) {
+        fprintf(stderr, "Flash programming lost TAR\n");
+        result->ok = false;
+    }
+
+    swd_sim_set_core_hook(NULL);
+}
+
+/* An algorithm call that never reaches its breakpoint is halted once
+   DAP_FLASH_TIMEOUT_MS has passed, and the next call runs normally */
+static void scenario_flash_hang(struct bench_result* result) {
+    unsigned int polls;
+
+    algo_errors = 0;
+    swd_sim_set_core_hook(bench_algo);
+    result->ok = bench_flash_load(result);
+
+    request_begin(ID_DAP_Vendor6);
+    request_u8(DAP_FLASH_CALL);
+    request_u8(DAP_FLASH_ERASE_SECTOR);
+    request_u32(BENCH_HANG_SECTOR);
+    request_u32(0);
+    request_u32(0);
+    result->ok = result->ok && bench_flash_command(result);
+
+    for (polls = 0; result->ok && polls < 64; polls++) {
+        request_begin(ID_DAP_Vendor6);
+        request_u8(DAP_FLASH_STATUS);
+        if (!request_execute(result)) {
+            result->ok = false;
+        } else if (response[1] == DAP_ERROR) {
+            break;
+        }
+    }
+
+    if (result->ok && (polls == 64 || response[2] != 0
+                       || response_u32(3) != 0xFFFFFFFFU
+                       || !swd_sim_core_halted())) {
+        fprintf(stderr, "Hung flash call not stopped: %u polls, "
+                "running %u, result 0x%08X\n", polls, response[2],
+                response_u32(3));
+        result->ok = false;
+    }
+
+    result->ok = result->ok
+              && bench_flash_call(result, DAP_FLASH_INIT, BENCH_FLASH_BASE, 0, 2);
+    if (result->ok && algo_errors != 0) {
+        fprintf(stderr, "Flash: %u bad calls\n", algo_errors);
+        result->ok = false;
+    }
+
+    swd_sim_set_core_hook(NULL);
+}
+
+#if MSD_AVAILABLE
+#define DROP_HEX_END            0x900U
+#define DROP_HEX_SECOND         0xA00U
+#define DROP_HEX_SECOND_END     0xA40U
+#define DROP_BIN_SIZE           2048U
+
+static uint8_t drop_file[8192];
+static uint32_t drop_root_lba;
+static uint32_t drop_data_lba;
+static uint32_t drop_cluster_sectors;
+
+static uint8_t bench_flash_byte(uint32_t offset) {
+    return (uint8_t)(bench_pattern(offset / 4) >> (8 * (offset % 4)));
+}
+
+static uint8_t drop_bin_byte(uint32_t offset) {
+    static const uint32_t vectors[] = { 0x20002000U, BENCH_FLASH_BASE | 0x101U };
+    uint32_t word = (offset < sizeof(vectors)) ? vectors[offset / 4]
+                                               : ~bench_pattern(offset / 4);
+    return (uint8_t)(word >> (8 * (offset % 4)));
+}
+
+static uint32_t drop_lba(uint32_t cluster) {
+    return drop_data_lba + (cluster - 2) * drop_cluster_sectors;
+}
+
+/* Write sectors [first, last) of a file the way a host would, the
+   last one padded with zeroes */
+static void drop_copy(uint32_t cluster, uint32_t len,
+                      uint32_t first, uint32_t last) {
+    uint8_t sector[VFS_SECTOR_SIZE];
+    uint32_t i;
+
+    for (i = first; i < last && i * VFS_SECTOR_SIZE < len; i++) {
+        uint32_t count = len - i * VFS_SECTOR_SIZE;
+        memset(sector, 0, sizeof(sector));
+        memcpy(sector, &drop_file[i * VFS_SECTOR_SIZE],
+               (count < VFS_SECTOR_SIZE) ? count : VFS_SECTOR_SIZE);
+        vfs_write_sector(drop_lba(cluster) + i, sector);
+    }
+}
+
+/* The directory entry, usually written after the data */
+static void drop_dir_entry(uint32_t cluster, uint32_t len) {
+    uint8_t sector[VFS_SECTOR_SIZE];
+
+    memset(sector, 0, sizeof(sector));
+    memcpy(sector, "FIRMWAREBIN", 11);
+    sector[11] = 0x20;
+    sector[26] = (uint8_t)cluster;
+    sector[27] = (uint8_t)(cluster >> 8);
+    memcpy(&sector[28], &len, 4);
+    vfs_write_sector(drop_root_lba, sector);
+}
+
+static void drop_put_u32(uint8_t* data, uint32_t value) {
+    data[0] = (uint8_t)(value >> 0);
+    data[1] = (uint8_t)(value >> 8);
+    data[2] = (uint8_t)(value >> 16);
+    data[3] = (uint8_t)(value >> 24);
+}
+
+/* Header and code, as tools/dap_flash.py --export writes them, with
+   the same stand-in algorithm as the flash-program scenario */
+static uint32_t drop_algo_file(void) {
+    static const uint32_t fields[] = {
+        BENCH_ALGO_ADDRESS, BENCH_ALGO_STATIC_BASE, BENCH_ALGO_STACK,
+        BENCH_ALGO_INIT, BENCH_ALGO_UNINIT, BENCH_ALGO_ERASE,
+        BENCH_ALGO_PROGRAM, BENCH_PAGE_BUFFER0, BENCH_PAGE_BUFFER1,
+        BENCH_PAGE_SIZE,
+    };
+    uint32_t i;
+
+    memset(drop_file, 0, sizeof(drop_file));
+    drop_put_u32(&drop_file[0], DROP_ALGO_MAGIC0);
+    drop_put_u32(&drop_file[4], DROP_ALGO_MAGIC1);
+    drop_put_u32(&drop_file[DROP_ALGO_LOAD], BENCH_ALGO_ADDRESS);
+    drop_put_u32(&drop_file[DROP_ALGO_CODE_SIZE], 4 * BENCH_ALGO_WORDS);
+    drop_put_u32(&drop_file[DROP_ALGO_FLASH], BENCH_FLASH_BASE);
+    drop_put_u32(&drop_file[DROP_ALGO_FLASH_SIZE], BENCH_FLASH_SIZE);
+    drop_file[DROP_ALGO_EMPTY] = 0xFF;
+    for (i = 0; i < DAP_FLASH_FIELDS; i++) {
+        drop_put_u32(&drop_file[DROP_ALGO_FIELDS + 4*i], fields[i]);
+    }
+    drop_put_u32(&drop_file[DROP_ALGO_SECTORS], BENCH_SECTOR_SIZE);
+
+    for (i = 0; i < BENCH_ALGO_WORDS; i++) {
+        drop_put_u32(&drop_file[DROP_ALGO_HEADER_SIZE + 4*i],
+                     (i == 0) ? 0xE00ABE00U : bench_pattern(i));
+    }
+
+    return DROP_ALGO_HEADER_SIZE + 4 * BENCH_ALGO_WORDS;
+}
+
+static uint32_t drop_hex_record(uint32_t len, uint8_t type, uint16_t address,
+                                uint32_t offset, uint8_t count) {
+    char* out = (char*)&drop_file[len];
+    uint8_t sum = (uint8_t)(count + (address >> 8) + address + type);
+    int n = sprintf(out, ":%02X%04X%02X", count, address, type);
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        uint8_t byte = (type == 0x04) ? (uint8_t)(BENCH_FLASH_BASE >> (24 - 8*i))
+                                      : bench_flash_byte(offset + i);
+        n += sprintf(out + n, "%02X", byte);
+        sum += byte;
+    }
+    n += sprintf(out + n, "%02X\r\n", (uint8_t)(0x100U - sum));
+
+    return len + (uint32_t)n;
+}
+
+/* Two runs of data with a gap, in the upper 64KB segment */
+static uint32_t drop_hex_file(void) {
+    uint32_t len = 0;
+    uint32_t offset;
+
+    memset(drop_file, 0, sizeof(drop_file));
+    len = drop_hex_record(len, 0x04, 0, 0, 2);
+    for (offset = 0; offset < DROP_HEX_END; offset += 16) {
+        len = drop_hex_record(len, 0x00, (uint16_t)offset, offset, 16);
+    }
+    for (offset = DROP_HEX_SECOND; offset < DROP_HEX_SECOND_END; offset += 32) {
+        len = drop_hex_record(len, 0x00, (uint16_t)offset, offset, 32);
+    }
+    len = drop_hex_record(len, 0x01, 0, 0, 0);
+
+    return len;
+}
+
+static bool drop_status_is(const char* prefix) {
+    uint8_t sector[VFS_SECTOR_SIZE];
+
+    vfs_read_sector(drop_lba(3), sector);
+    if (strncmp((const char*)sector, prefix, strlen(prefix)) != 0) {
+        fprintf(stderr, "Drop status: %s\n", drop_status());
+        return false;
+    }
+    return true;
+}
+
+static bool drop_flash_is(uint32_t start, uint32_t end, int fill,
+                          uint8_t (*expected)(uint32_t offset)) {
+    uint32_t i;
+
+    for (i = start; i < end; i++) {
+        uint8_t value = expected ? expected(i) : (uint8_t)fill;
+        if (bench_flash[i] != value) {
+            fprintf(stderr, "Flash byte 0x%03X: 0x%02X, expected 0x%02X\n",
+                    i, bench_flash[i], value);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Files copied onto the MSD volume: an algorithm ended by its
+   directory entry, a HEX image ended by its EOF record with a stray
+   write in the middle, a binary that must be refused once the target
+   has been reset, an algorithm with a binary appended, ended by the
+   idle timeout, and one with a corrupt HEX record appended. The probe
+   connects to the target by itself. */
+static void scenario_msd_drop(struct bench_result* result) {
+    uint8_t sector[VFS_SECTOR_SIZE];
+    uint32_t len;
+    bool ok;
+
+    memset(bench_flash, 0, sizeof(bench_flash));
+    algo_errors = 0;
+    algo_pages = 0;
+    swd_sim_set_core_hook(bench_algo);
+
+    vfs_read_sector(0, sector);
+    drop_cluster_sectors = sector[13];
+    drop_root_lba = sector[14] + sector[16] * sector[22];
+    drop_data_lba = drop_root_lba + (sector[17] | (sector[18] << 8)) * 32
+                                  / VFS_SECTOR_SIZE;
+    ok = sector[510] == 0x55 && sector[511] == 0xAA
+      && memcmp(&sector[54], "FAT12", 5) == 0
+      && drop_status_is("Ready");
+
+    request_begin(ID_DAP_Disconnect);
+    ok = ok && request_execute(result);
+
+    len = drop_algo_file();
+    drop_copy(4, len, 0, 2);
+    drop_dir_entry(4, len);
+    ok = ok && drop_status_is("Flash algorithm loaded") && swd_sim_core_halted();
+
+    len = drop_hex_file();
+    drop_copy(5, len, 0, 3);
+    memset(sector, 0, sizeof(sector));
+    vfs_write_sector(drop_lba(40), sector);
+    vfs_write_sector(1, sector);
+    drop_copy(5, len, 3, 16);
+    ok = ok && drop_status_is("Programmed")
+      && drop_flash_is(0, DROP_HEX_END, 0, bench_flash_byte)
+      && drop_flash_is(DROP_HEX_END, DROP_HEX_SECOND, 0xFF, NULL)
+      && drop_flash_is(DROP_HEX_SECOND, DROP_HEX_SECOND_END, 0, bench_flash_byte)
+      && drop_flash_is(DROP_HEX_SECOND_END, 3 * BENCH_SECTOR_SIZE, 0xFF, NULL)
+      && drop_flash_is(3 * BENCH_SECTOR_SIZE, BENCH_FLASH_SIZE, 0, NULL)
+      && !swd_sim_core_halted() && swd_sim_stats.core_resets == 1
+      && DAP_Data.debug_port == DAP_PORT_DISABLED
+      && vfs_media_changed();
+    result->bytes += DROP_HEX_END + DROP_HEX_SECOND_END - DROP_HEX_SECOND;
+
+    for (len = 0; len < DROP_BIN_SIZE; len++) {
+        drop_file[len] = drop_bin_byte(len);
+    }
+    drop_copy(7, len, 0, 4);
+    drop_dir_entry(7, len);
+    ok = ok && !vfs_update(0) && swd_sim_stats.core_resets == 1
+      && drop_status_is("Programmed");
+
+    len = drop_algo_file();
+    for (len = 0; len < DROP_BIN_SIZE; len++) {
+        drop_file[2 * DROP_ALGO_HEADER_SIZE + len] = drop_bin_byte(len);
+    }
+    drop_copy(8, 2 * DROP_ALGO_HEADER_SIZE + len, 0, 6);
+    ok = ok && vfs_update(0) && vfs_update(VFS_IDLE_TIMEOUT_MS - 1)
+      && !vfs_update(VFS_IDLE_TIMEOUT_MS)
+      && drop_status_is("Programmed")
+      && drop_flash_is(0, DROP_BIN_SIZE, 0, drop_bin_byte)
+      && drop_flash_is(DROP_BIN_SIZE, DROP_HEX_END, 0, bench_flash_byte)
+      && swd_sim_stats.core_resets == 2;
+    result->bytes += DROP_BIN_SIZE;
+
+    /* A HEX record with a bad checksum must be refused before any of
+       its data reaches the flash */
+    len = drop_algo_file();
+    len = drop_hex_record(2 * DROP_ALGO_HEADER_SIZE, 0x04, 0, 0, 2);
+    len = drop_hex_record(len, 0x00, 0, 0, 16);
+    drop_file[len - 4] ^= 0x01;
+    len = drop_hex_record(len, 0x01, 0, 0, 0);
+    drop_copy(16, len, 0, 3);
+    drop_dir_entry(16, len);
+    ok = ok && drop_status_is("Error: bad HEX record")
+      && drop_flash_is(0, DROP_BIN_SIZE, 0, drop_bin_byte);
+
+    /* The directory shows the outcome as STATUS.TXT */
+    vfs_read_sector(drop_root_lba, sector);
+    ok = ok && memcmp(&sector[64], "STATUS  TXT", 11) == 0
+      && (uint32_t)(sector[92] | (sector[93] << 8)) == strlen(drop_status()) + 2;
+
+    if (ok && (algo_errors != 0 || algo_pages != 10 + DROP_BIN_SIZE / BENCH_PAGE_SIZE)) {
+        fprintf(stderr, "Drop: %u bad calls, %u pages\n", algo_errors, algo_pages);
+        ok = false;
+    }
+
+    swd_sim_set_core_hook(NULL);
+    result->ok = ok && bench_connect(result);
+}
+#endif
+
+#if DAP_CRC_AVAILABLE
+static bool bench_crc(struct bench_result* result, uint8_t mode,
+                      uint32_t address, uint32_t length, uint32_t crc) {
+    request_begin(ID_DAP_Vendor7);
+    request_u8(mode);
+    request_u32(address);
+    request_u32(length);
+    request_u32(crc);
+    request_u32(BENCH_CRC_STUB);
+    return request_execute(result);
+}
+
+/* A 4KB range with unaligned ends, first on the probe in two requests
+   with the CRC carried over, then on the target */
+static void scenario_crc(struct bench_result* result) {
+    uint32_t expected;
+    uint32_t crc;
+    unsigned int tries;
+
+    bench_fill_ram(BENCH_STREAM_ADDRESS, BENCH_STREAM_WORDS);
+    expected = bench_crc32(0, BENCH_CRC_START, BENCH_CRC_LENGTH);
+    algo_errors = 0;
+    swd_sim_set_core_hook(bench_algo);
+
+    result->ok = bench_crc(result, DAP_CRC_PROBE, BENCH_CRC_START,
+                           BENCH_CRC_SPLIT, 0)
+              && response[1] == DAP_OK;
+    crc = response_u32(2);
+    result->ok = result->ok
+              && bench_crc(result, DAP_CRC_PROBE, BENCH_CRC_START + BENCH_CRC_SPLIT,
+                           BENCH_CRC_LENGTH - BENCH_CRC_SPLIT, crc)
+              && response[1] == DAP_OK;
+    if (result->ok && response_u32(2) != expected) {
+        fprintf(stderr, "Probe CRC 0x%08X, expected 0x%08X\n",
+                response_u32(2), expected);
+        result->ok = false;
+    }
+    result->bytes = BENCH_CRC_LENGTH;
+
+    /* Too long for one request */
+    if (result->ok && (!bench_crc(result, DAP_CRC_PROBE, BENCH_CRC_START,
+                                  DAP_CRC_MAX_LENGTH + 1, 0)
+                       || response[1] != DAP_ERROR)) {
+        fprintf(stderr, "Overlong CRC request accepted\n");
+        result->ok = false;
+    }
+
+    result->ok = result->ok && bench_flash_load(result)
+              && bench_crc(result, DAP_CRC_TARGET, BENCH_CRC_START,
+                           BENCH_CRC_LENGTH, 0);
+    for (tries = 0; result->ok && response[1] == DAP_CRC_BUSY && tries < 16; tries++) {
+        result->ok = bench_crc(result, DAP_CRC_RESULT, 0, 0, 0);
+    }
+    if (result->ok && (response[1] != DAP_OK || response_u32(2) != expected
+                       || algo_errors != 0)) {
+        fprintf(stderr, "Target CRC 0x%08X, status 0x%02X, %u bad calls\n",
+                response_u32(2), response[1], algo_errors);
+        result->ok = false;
+    }
+
+    transfer_begin();
+    transfer_read(AP_READ(REG_TAR));
+    transfer_read(DP_READ(REG_RDBUFF));
+    if (result->ok && (!transfer_execute(result, 2)
+                       || response_u32(7) != BENCH_BLOCK_ADDRESS)) {
+        fprintf(stderr, "CRC lost TAR\n");
+        result->ok = false;
+    }
+
+    swd_sim_set_core_hook(NULL);
+}
+#endif
+#endif
+
+/* Scattered word reads in the style of a debugger polling peripherals:
+   TAR writes interleaved with posted DRW reads in a single Transfer. */
+static void scenario_scattered_read(struct bench_result* result) {
+    uint32_t round;
+    uint32_t i;
+
+    bench_fill_ram(BENCH_BLOCK_ADDRESS, BENCH_BLOCK_WORDS);
+    result->ok = true;
+
+    for (round = 0; round < 16 && result->ok; round++) {
+        transfer_begin();
+        for (i = 0; i < 6; i++) {
+            uint32_t index = (round * 37 + i * 11) % BENCH_BLOCK_WORDS;
+            transfer_write(AP_WRITE(REG_TAR), BENCH_BLOCK_ADDRESS + 4*index);
+            transfer_read(AP_READ(REG_DRW));
+        }
+
+        if (!transfer_execute(result, 12)) {
+            result->ok = false;
+            break;
+        }
+
+        for (i = 0; i < 6; i++) {
+            uint32_t index = (round * 37 + i * 11) % BENCH_BLOCK_WORDS;
+            if (response_u32(3 + 4*i) != bench_pattern(index)) {
+                fprintf(stderr, "Scattered read %u/%u mismatch\n", round, i);
+                result->ok = false;
+            }
+        }
+
+        result->bytes += 6 * 4;
+    }
+}
+
+/* Scattered word reads batched with QueueCommands/ExecuteCommands:
+   several Transfer commands share one report, and the queued reports
+   must be held back until the final ExecuteCommands report arrives. */
+#define BATCH_REPORTS           4
+#define BATCH_READS             6
+
+static void scenario_batched_read(struct bench_result* result) {
+    uint8_t responses[BATCH_REPORTS][DAP_PACKET_SIZE];
+    uint32_t report;
+    uint32_t i;
+
+    bench_fill_ram(BENCH_BLOCK_ADDRESS, BENCH_BLOCK_WORDS);
+    result->ok = true;
+
+    for (report = 0; report < BATCH_REPORTS; report++) {
+        bool last = (report + 1 == BATCH_REPORTS);
+        request_begin(last ? ID_DAP_ExecuteCommands : ID_DAP_QueueCommands);
+        request_u8(BATCH_READS);
+        for (i = 0; i < BATCH_READS; i++) {
+            uint32_t index = (report * 53 + i * 29) % BENCH_BLOCK_WORDS;
+            request_u8(ID_DAP_Transfer);
+            request_u8(0);
+            request_u8(2);
+            transfer_write(AP_WRITE(REG_TAR), BENCH_BLOCK_ADDRESS + 4*index);
+            transfer_read(AP_READ(REG_DRW));
+        }
+
+        usb_sim_host_write(request, request_len);
+        result->commands++;
+
+        DAP_app_update();
+        if (!last && usb_sim_host_read(response)) {
+            fprintf(stderr, "Queued report %u answered early\n", report);
+            result->ok = false;
+            return;
+        }
+    }
+
+    for (report = 0; report < BATCH_REPORTS; report++) {
+        unsigned int spins = 0;
+        while (!usb_sim_host_read(responses[report])) {
+            DAP_app_update();
+            if (++spins == 16) {
+                fprintf(stderr, "No response to batched report %u\n", report);
+                result->ok = false;
+                return;
+            }
+        }
+    }
+
+    for (report = 0; report < BATCH_REPORTS; report++) {
+        memcpy(response, responses[report], sizeof(response));
+        if (response[0] != ID_DAP_ExecuteCommands
+            || response[1] != BATCH_READS) {
+            fprintf(stderr, "Bad batched response header %02X %02X\n",
+                    response[0], response[1]);
+            result->ok = false;
+            return;
+        }
+
+        for (i = 0; i < BATCH_READS; i++) {
+            uint32_t index = (report * 53 + i * 29) % BENCH_BLOCK_WORDS;
+            size_t offset = 2 + 7*i;
+            if (response[offset] != ID_DAP_Transfer
+                || response[offset+1] != 2
+                || response[offset+2] != DAP_TRANSFER_OK
+                || response_u32(offset+3) != bench_pattern(index)) {
+                fprintf(stderr, "Batched read %u/%u mismatch\n", report, i);
+                result->ok = false;
+            }
+        }
+
+        result->bytes += BATCH_READS * 4;
+    }
+}
+
+#if RTT_AVAILABLE
+/* RTT polled by the probe between host commands: find the control
+   block, drain the up buffer, fill the down buffer, and leave the
+   host's SELECT, CSW and TAR as they were. */
+static void scenario_rtt(struct bench_result* result) {
+    uint32_t down_desc = BENCH_RTT_CB + 24 + 2 * 24;
+    uint32_t polls;
+    uint32_t i;
+    uint32_t value = 0;
+
+    bench_rtt_setup_target();
+    rtt_setup(&bench_rtt_send, &bench_rtt_recv);
+    rtt_received_len = 0;
+    rtt_down_sent = 0;
+
+    transfer_begin();
+    transfer_write(AP_WRITE(REG_TAR), BENCH_RTT_TAR);
+    transfer_write(DP_WRITE(REG_SELECT), SELECT_BANK_IDR);
+    result->ok = transfer_execute(result, 2)
+              && bench_rtt_command(result, 1, SWD_SIM_RAM_BASE, 0x4000);
+
+    for (polls = 0; result->ok && polls < 256; polls++) {
+        if (rtt_received_len == BENCH_RTT_BYTES
+            && rtt_down_sent == sizeof(rtt_down_text) - 1) {
+            break;
+        }
+        rtt_update();
+    }
+
+    if (result->ok && (!bench_rtt_command(result, 1, 0, 0)
+                       || response[2] != RTT_STATE_RUNNING
+                       || response_u32(3) != BENCH_RTT_CB)) {
+        fprintf(stderr, "RTT control block not found\n");
+        result->ok = false;
+    }
+
+    for (i = 0; result->ok && i < BENCH_RTT_BYTES; i++) {
+        if (i >= rtt_received_len || rtt_received[i] != rtt_pattern(i)) {
+            fprintf(stderr, "RTT up byte %u missing or wrong\n", i);
+            result->ok = false;
+        }
+    }
+    result->bytes += rtt_received_len;
+
+    /* The down buffer wraps after two bytes */
+    for (i = 0; result->ok && i < sizeof(rtt_down_text) - 1; i++) {
+        uint32_t offset = (BENCH_RTT_DOWN_SIZE - 2 + i) % BENCH_RTT_DOWN_SIZE;
+        if (bench_peek_byte(BENCH_RTT_DOWN_BUFFER + offset)
+            != (uint8_t)rtt_down_text[i]) {
+            fprintf(stderr, "RTT down byte %u wrong\n", i);
+            result->ok = false;
+        }
+    }
+    swd_sim_read_word(down_desc + 12, &value);
+    if (result->ok && value != (sizeof(rtt_down_text) - 3)) {
+        fprintf(stderr, "RTT down WrOff %u\n", value);
+        result->ok = false;
+    }
+
+    /* After the host's line reset nothing may go on the wire before
+       its DPIDR read */
+    request_begin(ID_DAP_SWJ_Sequence);
+    request_u8(51);
+    for (i = 0; i < 7; i++) {
+        request_u8(0xFF);
+    }
+    result->ok = result->ok && request_execute(result);
+    request_begin(ID_DAP_SWJ_Sequence);
+    request_u8(8);
+    request_u8(0x00);
+    result->ok = result->ok && request_execute(result);
+    value = swd_sim_stats.packets;
+    for (i = 0; i < 4; i++) {
+        rtt_update();
+    }
+    if (result->ok && swd_sim_stats.packets != value) {
+        fprintf(stderr, "RTT polled before the host read DPIDR\n");
+        result->ok = false;
+    }
+
+    /* A sticky error the host caused stays for the host to find */
+    transfer_begin();
+    transfer_read(DP_READ(REG_IDCODE));
+    transfer_write(DP_WRITE(REG_SELECT), 0);
+    transfer_write(AP_WRITE(REG_TAR), 0x60000000U);
+    transfer_read(AP_READ(REG_DRW));
+    request[2] = 4;
+    if (result->ok && (!request_execute(result)
+                       || response[2] != DAP_TRANSFER_FAULT)) {
+        fprintf(stderr, "Read from unmapped memory didn't fault\n");
+        result->ok = false;
+    }
+    for (i = 0; i < 4; i++) {
+        rtt_update();
+    }
+    transfer_begin();
+    transfer_read(DP_READ(REG_CTRL_STAT));
+    if (result->ok && (!transfer_execute(result, 1)
+                       || !(response_u32(3) & DP_CTRL_STICKYERR))) {
+        fprintf(stderr, "RTT cleared the host's sticky error\n");
+        result->ok = false;
+    }
+    transfer_begin();
+    transfer_write(DP_WRITE(REG_ABORT), DP_ABORT_CLEAR_ALL);
+    transfer_write(AP_WRITE(REG_TAR), BENCH_RTT_TAR);
+    transfer_write(DP_WRITE(REG_SELECT), SELECT_BANK_IDR);
+    result->ok = result->ok && transfer_execute(result, 3);
+
+    result->ok = result->ok && bench_rtt_command(result, 0, 0, 0);
+
+    /* The host's AP bank, CSW and TAR must be untouched */
+    transfer_begin();
+    transfer_read(AP_READ(REG_IDR));
+    transfer_write(DP_WRITE(REG_SELECT), 0);
+    transfer_read(AP_READ(REG_CSW));
+    transfer_read(AP_READ(REG_TAR));
+    if (result->ok && (!transfer_execute(result, 4)
+                       || response_u32(3) != SWD_SIM_AP_IDR
+                       || (response_u32(7) & 0x3FU) != (CSW_WORD_INCREMENT & 0x3FU)
+                       || response_u32(11) != BENCH_RTT_TAR)) {
+        fprintf(stderr, "RTT clobbered the host's AP state\n");
+        result->ok = false;
+    }
+}
+#endif
+
+#if (SWO_UART != 0)
+/* Trace capture polled with SWO_Data, then a capture that is left to
+   overflow the trace buffer. No SWCLK cycles are involved. */
+static void scenario_swo_data(struct bench_result* result) {
+    uint32_t received = 0;
+
+    result->ok = bench_swo_start(result, DAP_SWO_TRANSPORT_DATA);
+    swo_receive_pattern(0, BENCH_SWO_BYTES);
+
+    while (result->ok && received < BENCH_SWO_BYTES) {
+        uint32_t count;
+        uint32_t i;
+
+        request_begin(ID_DAP_SWO_Data);
+        request_u16(DAP_PACKET_SIZE);
+        if (!request_execute(result)) {
+            result->ok = false;
+            break;
+        }
+
+        count = response_u16(2);
+        if (count == 0 || (response[1] & DAP_SWO_BUFFER_OVERRUN)) {
+            fprintf(stderr, "SWO_Data stalled after %u bytes\n", received);
+            result->ok = false;
+        }
+        for (i = 0; result->ok && i < count; i++) {
+            if (response[4+i] != swo_pattern(received + i)) {
+                fprintf(stderr, "SWO byte %u mismatch\n", received + i);
+                result->ok = false;
+            }
+        }
+        received += count;
+        result->bytes += count;
+    }
+
+    /* Lap the reader; the oldest data is dropped and flagged */
+    swo_receive_pattern(0, 2 * SWO_BUFFER_SIZE);
+    request_begin(ID_DAP_SWO_Status);
+    if (result->ok && (!request_execute(result)
+                       || !(response[1] & DAP_SWO_CAPTURE_ACTIVE)
+                       || !(response[1] & DAP_SWO_BUFFER_OVERRUN)
+                       || response_u32(2) > SWO_BUFFER_SIZE)) {
+        fprintf(stderr, "SWO overrun not reported\n");
+        result->ok = false;
+    }
+
+    result->ok = result->ok && bench_swo_stop(result);
+}
+#endif
+
+#if (SWO_STREAM != 0)
+/* Trace capture streamed over the bulk trace endpoint */
+static void scenario_swo_stream(struct bench_result* result) {
+    uint8_t packet[USB_SIM_REPORT_SIZE];
+    uint32_t received = 0;
+    unsigned int spins = 0;
+
+    result->ok = bench_swo_start(result, DAP_SWO_TRANSPORT_STREAM);
+    swo_receive_pattern(0, BENCH_SWO_BYTES);
+
+    while (result->ok && received < BENCH_SWO_BYTES) {
+        size_t len;
+        size_t i;
+
+        DAP_app_update();
+        if (!usb_sim_host_read_trace(packet, &len)) {
+            if (++spins == 64) {
+                fprintf(stderr, "SWO stream stalled after %u bytes\n",
+                        received);
+                result->ok = false;
+            }
+            continue;
+        }
+
+        for (i = 0; result->ok && i < len; i++) {
+            if (packet[i] != swo_pattern(received + i)) {
+                fprintf(stderr, "SWO byte %u mismatch\n",
+                        received + (uint32_t)i);
+                result->ok = false;
+            }
+        }
+        received += len;
+        result->bytes += len;
+    }
+
+    result->ok = result->ok && bench_swo_stop(result);
+}
+#endif
+
+#if (TIMESTAMP_CLOCK != 0)
+/* A halt script style ExecuteCommands batch with timestamped transfers.
+   The report behind it is posted up front and the USB interrupt fires
+   every few SWCLK cycles, but the batch runs with interrupts masked, so
+   the report must still be waiting once the batch is done. Timestamps
+   count SWCLK cycles in the model and are taken where the data phase
+   starts, which is one turnaround later for writes than for reads. */
+#define TIMESTAMP_BATCH         3
+#define TIMESTAMP_TRANSFER_BITS (8 + 1 + 3 + 1 + 32 + 1)
+
+static void scenario_timestamps(struct bench_result* result) {
+    uint32_t previous = 0;
+    uint32_t i;
+
+    bench_fill_ram(BENCH_BLOCK_ADDRESS, BENCH_BLOCK_WORDS);
+    result->ok = true;
+
+    request_begin(ID_DAP_Info);
+    request_u8(DAP_ID_CAPABILITIES);
+    if (!request_execute(result) || response[1] != 1
+        || (response[2] & 0x30) != 0x30) {
+        fprintf(stderr, "Atomic commands or timer not advertised\n");
+        result->ok = false;
+        return;
+    }
+
+    request_begin(ID_DAP_Info);
+    request_u8(DAP_ID_TIMESTAMP_CLOCK);
+    if (!request_execute(result) || response[1] != 4
+        || response_u32(2) != TIMESTAMP_CLOCK) {
+        fprintf(stderr, "Bad timestamp clock\n");
+        result->ok = false;
+        return;
+    }
+
+    request_begin(ID_DAP_ExecuteCommands);
+    request_u8(TIMESTAMP_BATCH + 1);
+    for (i = 0; i < TIMESTAMP_BATCH; i++) {
+        request_u8(ID_DAP_Transfer);
+        request_u8(0);
+        request_u8(2);
+        transfer_write(AP_WRITE(REG_TAR) | DAP_TRANSFER_TIMESTAMP,
+                       BENCH_BLOCK_ADDRESS + 8*i*i);
+        transfer_read(AP_READ(REG_DRW) | DAP_TRANSFER_TIMESTAMP);
+    }
+    request_u8(ID_DAP_Transfer);
+    request_u8(0);
+    request_u8(1);
+    transfer_read(DP_READ(REG_IDCODE) | DAP_TRANSFER_TIMESTAMP);
+
+    result->ok = usb_sim_host_post(request, request_len);
+    request_begin(ID_DAP_Info);
+    request_u8(DAP_ID_PACKET_COUNT);
+    result->ok = result->ok && usb_sim_host_post(request, request_len);
+    result->commands += 2;
+
+    swd_sim_set_clock_hook(usb_sim_interrupt, 16);
+    usb_sim_interrupt();
+    DAP_app_update();
+    swd_sim_set_clock_hook(NULL, 0);
+
+    if (result->ok && usb_sim_host_pending() != 1) {
+        fprintf(stderr, "Report received during the batch\n");
+        result->ok = false;
+    }
+    if (result->ok && !usb_sim_host_read(response)) {
+        fprintf(stderr, "No response to the batch\n");
+        result->ok = false;
+    }
+
+    for (i = 0; result->ok && i < TIMESTAMP_BATCH; i++) {
+        size_t offset = 2 + 15*i;
+        uint32_t write = response_u32(offset + 3);
+        uint32_t read = response_u32(offset + 7);
+
+        if (response[offset] != ID_DAP_Transfer
+            || response[offset+1] != 2
+            || response[offset+2] != DAP_TRANSFER_OK
+            || response_u32(offset + 11) != bench_pattern(2*i*i)) {
+            fprintf(stderr, "Timestamped read %u failed\n", i);
+            result->ok = false;
+        } else if (read - write != TIMESTAMP_TRANSFER_BITS - 1
+                   || (i > 0 && write - previous < TIMESTAMP_TRANSFER_BITS)) {
+            fprintf(stderr, "Timestamps %u out of step: %u %u\n",
+                    i, write, read);
+            result->ok = false;
+        }
+        previous = read;
+        result->bytes += 4;
+    }
+
+    if (result->ok && (response[47] != ID_DAP_Transfer
+                       || response[49] != DAP_TRANSFER_OK
+                       || response_u32(50) - previous
+                          != 2 * TIMESTAMP_TRANSFER_BITS
+                       || response_u32(54) != SWD_SIM_DPIDR)) {
+        fprintf(stderr, "Timestamped IDCODE read failed\n");
+        result->ok = false;
+    }
+
+    /* The report held back arrives with the next interrupt */
+    usb_sim_interrupt();
+    DAP_app_update();
+    if (result->ok && (!usb_sim_host_read(response)
+                       || response[0] != ID_DAP_Info)) {
+        fprintf(stderr, "Report behind the batch lost\n");
+        result->ok = false;
+    }
+}
+#endif
+
+#if DAP_MULTIDROP_AVAILABLE
+/* Two SWDv2 targets on one bus, as on a dual-core part. Target 1 is
+   selected the way debuggers do it themselves, with DAP_SWD_Sequence;
+   after that the probe switches between them with vendor command 0x88.
+   Each target gets its own SELECT, CTRL/STAT and TAR, which must be in
+   effect again after switching back, without the debugger setting up
+   the target again. */
+#define BENCH_TARGETSEL(n)      (SWD_SIM_TARGETID | ((uint32_t)(n) << 28))
+#define BENCH_MULTIDROP_TAR     (BENCH_BLOCK_ADDRESS + 0x40U)
+
+static bool bench_multidrop_select(struct bench_result* result,
+                                   uint8_t flags, uint32_t targetsel,
+                                   uint8_t expected) {
+    request_begin(ID_DAP_Vendor8);
+    request_u8(flags);
+    request_u32(targetsel);
+    if (!request_execute(result) || response[1] != DAP_OK
+        || response[2] != expected || response_u32(3) != SWD_SIM_DPIDR) {
+        fprintf(stderr, "Selecting target 0x%08X failed: %02X %02X\n",
+                targetsel, response[1], response[2]);
+        return false;
+    }
+
+    return true;
+}
+
+static void scenario_multidrop(struct bench_result* result) {
+    uint32_t targetsel = BENCH_TARGETSEL(1);
+    uint32_t parity = targetsel;
+    uint32_t line_resets;
+    uint32_t i;
+
+    parity ^= parity >> 16;
+    parity ^= parity >> 8;
+    parity ^= parity >> 4;
+    parity ^= parity >> 2;
+    parity ^= parity >> 1;
+
+    swd_sim_set_multidrop(2);
+
+    /* Line reset, idle, TARGETSEL request, no ACK, TARGETSEL data */
+    request_begin(ID_DAP_SWD_Sequence);
+    request_u8(4);
+    request_u8(0);
+    for (i = 0; i < 7; i++) {
+        request_u8(0xFF);
+    }
+    request_u8(0x00);
+    request_u8(8);
+    request_u8(0x99);
+    request_u8(SWD_SEQUENCE_DIN | 5);
+    request_u8(33);
+    request_u32(targetsel);
+    request_u8(parity & 0x1U);
+    result->ok = request_execute(result) && response[1] == DAP_OK;
+
+    transfer_begin();
+    transfer_read(DP_READ(REG_IDCODE));
+    transfer_write(DP_WRITE(REG_ABORT), DP_ABORT_CLEAR_ALL);
+    transfer_write(DP_WRITE(REG_CTRL_STAT), DP_CTRL_POWERUP_REQ);
+    transfer_write(DP_WRITE(REG_SELECT), 0);
+    transfer_write(AP_WRITE(REG_TAR), BENCH_MULTIDROP_TAR);
+    if (result->ok && (!transfer_execute(result, 5)
+                       || response_u32(3) != SWD_SIM_DPIDR)) {
+        fprintf(stderr, "Target 1 setup failed\n");
+        result->ok = false;
+    }
+
+    /* Target 0 is new to the probe, and the sequence above left it
+       unsure which target it was talking to */
+    result->ok = result->ok
+        && bench_multidrop_select(result, 0, BENCH_TARGETSEL(0), 0);
+
+    transfer_begin();
+    transfer_write(DP_WRITE(REG_ABORT), DP_ABORT_CLEAR_ALL);
+    transfer_write(DP_WRITE(REG_CTRL_STAT), DP_CTRL_POWERUP_REQ);
+    transfer_write(DP_WRITE(REG_SELECT), SELECT_BANK_IDR);
+    transfer_read(AP_READ(REG_IDR));
+    if (result->ok && (!transfer_execute(result, 4)
+                       || response_u32(3) != SWD_SIM_AP_IDR)) {
+        fprintf(stderr, "Target 0 setup failed\n");
+        result->ok = false;
+    }
+
+    /* Target 1 is still unknown too */
+    result->ok = result->ok
+        && bench_multidrop_select(result, 0, BENCH_TARGETSEL(1), 0);
+
+    transfer_begin();
+    transfer_write(DP_WRITE(REG_CTRL_STAT), DP_CTRL_POWERUP_REQ);
+    transfer_write(DP_WRITE(REG_SELECT), 0);
+    if (result->ok && !transfer_execute(result, 2)) {
+        result->ok = false;
+    }
+
+    /* From here on, switching only costs the TARGETSEL and DPIDR read
+       the protocol requires, plus putting SELECT back */
+    line_resets = swd_sim_stats.line_resets;
+    for (i = 0; result->ok && i < 4; i++) {
+        uint32_t target = (i + 1) % 2;
+
+        if (!bench_multidrop_select(result, 0, BENCH_TARGETSEL(target),
+                                    DAP_MULTIDROP_RESTORED)
+            || response_u32(7) != DP_CTRL_POWERUP_REQ) {
+            result->ok = false;
+            break;
+        }
+
+        transfer_begin();
+        transfer_read(target ? AP_READ(REG_TAR) : AP_READ(REG_IDR));
+        if (!transfer_execute(result, 1)
+            || response_u32(3) != (target ? BENCH_MULTIDROP_TAR
+                                          : SWD_SIM_AP_IDR)) {
+            fprintf(stderr, "Target %u state lost\n", target);
+            result->ok = false;
+        }
+        result->bytes += 4;
+    }
+    if (result->ok && swd_sim_stats.line_resets - line_resets != 4) {
+        fprintf(stderr, "Switching sent %u line resets\n",
+                swd_sim_stats.line_resets - line_resets);
+        result->ok = false;
+    }
+
+    /* Nobody answers to an unknown TARGETSEL */
+    request_begin(ID_DAP_Vendor8);
+    request_u8(0);
+    request_u32(BENCH_TARGETSEL(5));
+    if (result->ok && (!request_execute(result) || response[1] != DAP_ERROR)) {
+        fprintf(stderr, "Unknown target answered\n");
+        result->ok = false;
+    }
+
+    /* Forgetting target 0 makes it new again; leave it selected with
+       the SELECT the other scenarios expect */
+    result->ok = result->ok
+        && bench_multidrop_select(result, DAP_MULTIDROP_FORGET,
+                                  BENCH_TARGETSEL(0), 0);
+    transfer_begin();
+    transfer_write(DP_WRITE(REG_SELECT), 0);
+    result->ok = result->ok && transfer_execute(result, 1);
+
+    swd_sim_set_multidrop(0);
+}
+#endif
+
+#if (DAP_SWD_CACHE != 0)
+/* A debug session as OpenOCD sends it: halt, poll, read the core
+   registers through DCRSR/DCRDR, dump 128 bytes, resume and poll again.
+   Every queue starts by writing SELECT and CSW again and every access
+   writes TAR, as OpenOCD does once its own AP cache was invalidated.
+   The trace is played twice, first with the register cache turned off
+   by vendor command 0x89: the reads must come back the same, and the
+   SWD packets saved must be exactly the writes the probe skipped.
+   Repeated writes to the control AP, which is not a MEM-AP, must all
+   reach the target. */
+#define TRACE_DHCSR             0xE000EDF0U
+#define TRACE_DCRSR             0xE000EDF4U
+#define TRACE_DCRDR             0xE000EDF8U
+#define TRACE_HALT              0xA05F0003U
+#define TRACE_RESUME            0xA05F0001U
+#define CSW_WORD_SINGLE         0x23000002U
+
+#define TRACE_DUMP_WORDS        8U
+#define TRACE_READS             73U
+#define TRACE_SKIPPED           64U
+
+#define TRACE_WRITE(reg, value) \
+    (reg), (uint8_t)(value), (uint8_t)((value) >> 8), \
+    (uint8_t)((value) >> 16), (uint8_t)((value) >> 24)
+#define TRACE_QUEUE(csw) \
+    TRACE_WRITE(DP_WRITE(REG_SELECT), 0), TRACE_WRITE(AP_WRITE(REG_CSW), csw)
+#define TRACE_READ_WORD(address) \
+    TRACE_WRITE(AP_WRITE(REG_TAR), address), AP_READ(REG_DRW)
+#define TRACE_WRITE_WORD(address, value) \
+    TRACE_WRITE(AP_WRITE(REG_TAR), address), \
+    TRACE_WRITE(AP_WRITE(REG_DRW), value)
+
+/* Transfer count, then the transfers of one DAP_Transfer request */
+#define TRACE_POLL \
+    4, TRACE_QUEUE(CSW_WORD_SINGLE), TRACE_READ_WORD(TRACE_DHCSR)
+#define TRACE_CORE_REG(n) \
+    8, TRACE_QUEUE(CSW_WORD_SINGLE), TRACE_WRITE_WORD(TRACE_DCRSR, n), \
+    TRACE_READ_WORD(TRACE_DHCSR), TRACE_READ_WORD(TRACE_DCRDR)
+#define TRACE_DUMP(offset) \
+    11, TRACE_QUEUE(CSW_WORD_INCREMENT), \
+    TRACE_WRITE(AP_WRITE(REG_TAR), BENCH_BLOCK_ADDRESS + (offset)), \
+    AP_READ(REG_DRW), AP_READ(REG_DRW), AP_READ(REG_DRW), AP_READ(REG_DRW), \
+    AP_READ(REG_DRW), AP_READ(REG_DRW), AP_READ(REG_DRW), AP_READ(REG_DRW)
+
+static const uint8_t openocd_trace[] = {
+    6, TRACE_QUEUE(CSW_WORD_SINGLE), TRACE_WRITE_WORD(TRACE_DHCSR, TRACE_HALT),
+    TRACE_READ_WORD(TRACE_DHCSR),
+    TRACE_POLL, TRACE_POLL, TRACE_POLL, TRACE_POLL,
+    TRACE_CORE_REG(0), TRACE_CORE_REG(1), TRACE_CORE_REG(2),
+    TRACE_CORE_REG(3), TRACE_CORE_REG(4), TRACE_CORE_REG(5),
+    TRACE_CORE_REG(6), TRACE_CORE_REG(7), TRACE_CORE_REG(8),
+    TRACE_CORE_REG(9), TRACE_CORE_REG(10), TRACE_CORE_REG(11),
+    TRACE_CORE_REG(12), TRACE_CORE_REG(13), TRACE_CORE_REG(14),
+    TRACE_CORE_REG(15), TRACE_CORE_REG(16),
+    TRACE_DUMP(0x00), TRACE_DUMP(0x20), TRACE_DUMP(0x40), TRACE_DUMP(0x60),
+    TRACE_POLL,
+    4, TRACE_QUEUE(CSW_WORD_SINGLE), TRACE_WRITE_WORD(TRACE_DHCSR, TRACE_RESUME),
+    TRACE_POLL,
+};
+
+static bool bench_cache_control(struct bench_result* result, uint8_t mode,
+                                uint32_t* skipped) {
+    request_begin(ID_DAP_Vendor9);
+    request_u8(mode);
+    if (!request_execute(result) || response[1] != DAP_OK) {
+        fprintf(stderr, "Register cache mode %u refused\n", mode);
+        return false;
+    }
+
+    *skipped = response_u32(3);
+    return true;
+}
+
+/* Play the trace; returns the number of words read, 0 on failure */
+static uint32_t bench_play_trace(struct bench_result* result,
+                                 uint32_t* reads) {
+    size_t offset = 0;
+    uint32_t count = 0;
+
+    while (offset < sizeof(openocd_trace)) {
+        uint8_t transfers = openocd_trace[offset++];
+        uint32_t first = count;
+        uint8_t i;
+
+        transfer_begin();
+        for (i = 0; i < transfers; i++) {
+            uint8_t request_bits = openocd_trace[offset++];
+            request_u8(request_bits);
+            if (request_bits & DAP_TRANSFER_RnW) {
+                count++;
+            } else {
+                request_u32(((uint32_t)openocd_trace[offset] << 0)
+                            | ((uint32_t)openocd_trace[offset+1] << 8)
+                            | ((uint32_t)openocd_trace[offset+2] << 16)
+                            | ((uint32_t)openocd_trace[offset+3] << 24));
+                offset += 4;
+            }
+        }
+
+        if (!transfer_execute(result, transfers)) {
+            return 0;
+        }
+        for (i = 0; first + i < count; i++) {
+            reads[first + i] = response_u32(3 + 4*i);
+        }
+    }
+
+    return count;
+}
+
+static void scenario_register_cache(struct bench_result* result) {
+    static uint32_t reads[2][TRACE_READS];
+    uint32_t packets[2];
+    uint32_t skipped[3];
+    uint32_t commands;
+    uint32_t run;
+    uint32_t i;
+
+    bench_fill_ram(BENCH_BLOCK_ADDRESS, BENCH_BLOCK_WORDS);
+    result->ok = bench_connect(result);
+
+    for (run = 0; result->ok && run < 2; run++) {
+        result->ok = bench_cache_control(result, (uint8_t)run, &skipped[run]);
+        packets[run] = swd_sim_stats.packets;
+        if (result->ok
+            && bench_play_trace(result, reads[run]) != TRACE_READS) {
+            fprintf(stderr, "Trace stopped in run %u\n", run);
+            result->ok = false;
+        }
+        packets[run] = swd_sim_stats.packets - packets[run];
+        result->bytes += 4 * TRACE_READS;
+    }
+    result->ok = result->ok
+        && bench_cache_control(result, DAP_CACHE_QUERY, &skipped[2]);
+
+    if (result->ok && memcmp(reads[0], reads[1], sizeof(reads[0])) != 0) {
+        fprintf(stderr, "Reads differ with the register cache\n");
+        result->ok = false;
+    }
+    for (i = 0; result->ok && i < 4 * TRACE_DUMP_WORDS; i++) {
+        if (reads[1][TRACE_READS - 2 - 4 * TRACE_DUMP_WORDS + i]
+            != bench_pattern(i)) {
+            fprintf(stderr, "Dumped word %u mismatch\n", i);
+            result->ok = false;
+        }
+    }
+
+    if (result->ok && (skipped[1] != skipped[0]
+                       || skipped[2] - skipped[1] != TRACE_SKIPPED
+                       || packets[0] - packets[1] != TRACE_SKIPPED)) {
+        fprintf(stderr, "Skipped %u writes, saved %u of %u packets\n",
+                skipped[2] - skipped[1], packets[0] - packets[1],
+                packets[0]);
+        result->ok = false;
+    }
+
+    /* The control AP is not a MEM-AP: a repeated write to its bank 0 is
+       another command and must reach the target */
+    commands = swd_sim_stats.ctrl_ap_commands;
+    transfer_begin();
+    transfer_write(DP_WRITE(REG_SELECT),
+                   (SWD_SIM_CTRL_AP << 24) | SELECT_BANK_IDR);
+    transfer_read(AP_READ(REG_IDR));
+    transfer_write(DP_WRITE(REG_SELECT), SWD_SIM_CTRL_AP << 24);
+    transfer_write(AP_WRITE(REG_TAR), 1);
+    transfer_write(AP_WRITE(REG_TAR), 1);
+    transfer_write(DP_WRITE(REG_SELECT), 0);
+    if (result->ok && (!transfer_execute(result, 6)
+                       || response_u32(3) != SWD_SIM_CTRL_AP_IDR
+                       || swd_sim_stats.ctrl_ap_commands - commands != 2)) {
+        fprintf(stderr, "Control AP ran %u of 2 commands\n",
+                swd_sim_stats.ctrl_ap_commands - commands);
+        result->ok = false;
+    }
+}
+#endif
+
+#if DAP_CAPTURE_AVAILABLE
+/* A short session captured by the probe and drained the way the main
+   loop does it, then replayed: connect, a TransferBlock read, a queued
+   batch and a chained vendor read. The simulated target is still in
+   the same state, so every response must come back as captured. */
+#define CAPTURE_SESSION_WORDS   48U
+
+static uint8_t capture_stream[DAP_CAPTURE_BUFFER_SIZE];
+static size_t capture_stream_len;
+
+static size_t bench_capture_send(const uint8_t* data, size_t len) {
+    /* Takes a little at a time, like the virtual CDC port */
+    if (len > 100) {
+        len = 100;
+    }
+    if (len > sizeof(capture_stream) - capture_stream_len) {
+        len = sizeof(capture_stream) - capture_stream_len;
+    }
+    memcpy(&capture_stream[capture_stream_len], data, len);
+    capture_stream_len += len;
+    return len;
+}
+
+static bool bench_capture_command(struct bench_result* result, uint8_t mode) {
+    request_begin(ID_DAP_Vendor10);
+    request_u8(mode);
+    if (!request_execute(result) || response[1] != DAP_OK
+        || response[2] != (mode == CAPTURE_MODE_START) || response_u32(3) != 0) {
+        fprintf(stderr, "Capture mode %u refused\n", mode);
+        return false;
+    }
+    while (capture_update()) {
+    }
+    return true;
+}
+
+static void scenario_capture_replay(struct bench_result* result) {
+    struct replay_result replay;
+    uint32_t commands;
+    uint32_t i;
+
+    bench_fill_ram(BENCH_BLOCK_ADDRESS, BENCH_BLOCK_WORDS);
+    capture_setup(&bench_capture_send);
+    capture_stream_len = 0;
+
+    result->ok = bench_capture_command(result, CAPTURE_MODE_START);
+    commands = result->commands;
+    result->ok = result->ok && bench_connect(result)
+        && bench_block_read(result, BENCH_BLOCK_ADDRESS, CAPTURE_SESSION_WORDS);
+
+    for (i = 0; result->ok && i < 2; i++) {
+        request_begin(i == 0 ? ID_DAP_QueueCommands : ID_DAP_ExecuteCommands);
+        request_u8(1);
+        request_u8(ID_DAP_Transfer);
+        request_u8(0);
+        request_u8(2);
+        transfer_write(AP_WRITE(REG_TAR), BENCH_BLOCK_ADDRESS + 4*i);
+        transfer_read(AP_READ(REG_DRW));
+        usb_sim_host_write(request, request_len);
+        result->commands++;
+    }
+    for (i = 0; result->ok && i < 2; i++) {
+        result->ok = response_next() && response[0] == ID_DAP_ExecuteCommands
+            && response_u32(5) == bench_pattern(i);
+    }
+
+#if DAP_BLOCK_READ_AVAILABLE
+    request_begin(ID_DAP_Vendor5);
+    request_u8(0);
+    request_u32(BENCH_BLOCK_ADDRESS);
+    request_u16(CAPTURE_SESSION_WORDS);
+    result->ok = result->ok && request_execute(result);
+    while (result->ok && (response_u16(2) & DAP_BLOCK_MORE)) {
+        result->ok = response_next();
+    }
+#endif
+    commands = result->commands - commands;
+    result->bytes += 2 * 4 * CAPTURE_SESSION_WORDS;
+
+    /* The stop command is not logged */
+    result->ok = result->ok && bench_capture_command(result, CAPTURE_MODE_STOP);
+    if (!result->ok) {
+        fprintf(stderr, "Captured session failed\n");
+        return;
+    }
+
+    result->ok = replay_run(capture_stream, capture_stream_len, &replay);
+    result->commands += replay.commands;
+    if (result->ok && (replay.commands != commands || replay.gaps != 0
+                       || replay.matched != replay.responses
+                       || replay.responses <= commands)) {
+        fprintf(stderr, "Replayed %u of %u commands, %u of %u responses "
+                "as captured\n", replay.commands, commands, replay.matched,
+                replay.responses);
+        result->ok = false;
+    }
+}
+#endif
+
+/* Budgets are the measured cycle counts of the current implementation;
+   a regression in the SWD code shows up as an increase here. */
+static const struct bench_scenario scenarios[] = {
+    { "connect",            scenario_connect,           449 },
+    { "block-write-1k",     scenario_block_write,       12742 },
+    { "block-read-1k",      scenario_block_read,        12696 },
+#if (DAP_SWD_SPI != 0)
+    { "block-read-1k-gpio", scenario_block_read_gpio,   12696 },
+#endif
+    { "block-read-1k-bulk", scenario_block_read_bulk,   12696 },
+    { "block-read-1k-irq",  scenario_block_read_irq,    12696 },
+    { "block-read-1k-wait", scenario_block_read_wait,   19417 },
+    { "block-read-1k-idle", scenario_block_read_idle,   13248 },
+#if DAP_BLOCK_READ_AVAILABLE
+    { "block-read-4k-vendor", scenario_block_read_vendor, 51060 },
+    { "block-read-4k-chain", scenario_block_read_chain, 47886 },
+#endif
+#if DAP_FLASH_AVAILABLE
+    { "flash-program",      scenario_flash_program,     220524 },
+    { "flash-hang",         scenario_flash_hang,        105892 },
+#endif
+#if DAP_CRC_AVAILABLE && DAP_FLASH_AVAILABLE
+    { "crc",                scenario_crc,               59110 },
+#endif
+#if MSD_AVAILABLE
+    { "msd-drop",           scenario_msd_drop,          385287 },
+#endif
+    { "queue-overrun",      scenario_queue_overrun,     2254 },
+    { "scattered-read",     scenario_scattered_read,    13248 },
+    { "batched-read",       scenario_batched_read,      3312 },
+#if (TIMESTAMP_CLOCK != 0)
+    { "timestamps",         scenario_timestamps,        460 },
+#endif
+    { "swj-clock",          scenario_swj_clock,         230 },
+#if DAP_CLOCK_TUNE_AVAILABLE
+    { "clock-tune",         scenario_clock_tune,        15763 },
+#endif
+#if DAP_STATS_AVAILABLE
+    { "stats",              scenario_stats,             4995 },
+#endif
+#if RTT_AVAILABLE
+    { "rtt",                scenario_rtt,               146766 },
+#endif
+#if (SWO_UART != 0)
+    { "swo-data",           scenario_swo_data,          0 },
+#endif
+#if (SWO_STREAM != 0)
+    { "swo-stream",         scenario_swo_stream,        0 },
+#endif
+#if DAP_MULTIDROP_AVAILABLE
+    { "multidrop",          scenario_multidrop,         2646 },
+#endif
+#if (DAP_SWD_CACHE != 0)
+    { "register-cache",     scenario_register_cache,    21792 },
+#endif
+#if DAP_CAPTURE_AVAILABLE
+    { "capture-replay",     scenario_capture_replay,    11476 },
+#endif
+};
+
+int main(int argc, char** argv) {
+    const char* replay = NULL;
+    bool check = false;
+    bool passed = true;
+    size_t i;
+
+    for (i = 1; i < (size_t)argc; i++) {
+        if (strcmp(argv[i], "--check") == 0) {
+            check = true;
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < (size_t)argc) {
+            replay = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--check] [--replay CAPTURE]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    swd_sim_power_on();
+    usb_sim_reset();
+    DAP_app_setup(NULL, NULL);
+    cmp_usb_enable_interrupts();
+
+    if (replay) {
+        return replay_file(replay);
+    }
+
+    printf("%-20s %8s %10s %10s %10s %6s %6s\n", "scenario", "reports",
+           "swclk", "swclk/rpt", "swclk/byte", "waits", "faults");
+
+    for (i = 0; i < sizeof(scenarios)/sizeof(scenarios[0]); i++) {
+        const struct bench_scenario* scenario = &scenarios[i];
+        struct bench_result result = { 0, 0, false };
+        uint64_t cycles;
+
+        swd_sim_clear_stats();
+        scenario->run(&result);
+        cycles = swd_sim_stats.swclk_cycles;
+
+        printf("%-20s %8u %10llu %10.1f ", scenario->name, result.commands,
+               (unsigned long long)cycles,
+               result.commands ? (double)cycles / result.commands : 0.0);
+        if (result.bytes) {
+            printf("%10.2f ", (double)cycles / result.bytes);
+        } else {
+            printf("%10s ", "-");
+        }
+        printf("%6u %6u\n", swd_sim_stats.ack_wait, swd_sim_stats.ack_fault);
+
+        if (!result.ok || swd_sim_stats.protocol_errors != 0) {
+            fprintf(stderr, "%s: FAILED (%u protocol errors)\n",
+                    scenario->name, swd_sim_stats.protocol_errors);
+            passed = false;
+        } else if (check && cycles > scenario->cycle_budget) {
+            fprintf(stderr, "%s: %llu SWCLK cycles exceeds budget of %llu\n",
+                    scenario->name, (unsigned long long)cycles,
+                    (unsigned long long)scenario->cycle_budget);
+            passed = false;
+        }
+    }
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef CONFIG_H_INCLUDED
+#define CONFIG_H_INCLUDED
+
+#define PRODUCT_NAME "DAP42 Host"
+
+#define CAN_RX_AVAILABLE 0
+#define CAN_TX_AVAILABLE 0
+
+#define VCDC_AVAILABLE 0
+#define CDC_AVAILABLE 0
+#define DFU_AVAILABLE 0
+#define DAP_BULK_AVAILABLE 1
+#define SWO_AVAILABLE 1
+#define RTT_AVAILABLE 1
+#define DAP_STATS_AVAILABLE 1
+#define DAP_CLOCK_TUNE_AVAILABLE 1
+#define DAP_BLOCK_READ_AVAILABLE 1
+#define DAP_FLASH_AVAILABLE 1
+/* Short enough for the bench to run into, at a SWCLK cycle per CPU cycle */
+#define DAP_FLASH_TIMEOUT_MS 2
+#define DAP_CRC_AVAILABLE 1
+#define DAP_MULTIDROP_AVAILABLE 1
+#define DAP_CAPTURE_AVAILABLE 1
+#define DAP_CAPTURE_BUFFER_SIZE 4096
+#define MSD_AVAILABLE 1
+
+#endif
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Host stand-in for the libopencm3 SysTick registers used by the
+ * CMSIS-DAP timer macros. Every read of STK_CSR advances the counter
+ * by one tick so that timeout loops always terminate.
+ */
+
+#ifndef HOST_LIBOPENCM3_SYSTICK_H_INCLUDED
+#define HOST_LIBOPENCM3_SYSTICK_H_INCLUDED
+
+#include <stdint.h>
+
+extern uint32_t host_stk_rvr;
+extern uint32_t host_stk_cvr;
+extern uint32_t* host_stk_csr(void);
+
+#define STK_CSR                 (*host_stk_csr())
+#define STK_RVR                 host_stk_rvr
+#define STK_CVR                 host_stk_cvr
+
+#define STK_CSR_COUNTFLAG       (1 << 16)
+#define STK_CSR_CLKSOURCE       (1 << 2)
+#define STK_CSR_TICKINT         (1 << 1)
+#define STK_CSR_ENABLE          (1 << 0)
+
+#endif
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Host stand-in for libopencm3/usb/usbd.h. The host build never talks
+ * to a USB peripheral; the device handle and callbacks only need to
+ * be types.
+ */
+
+#ifndef HOST_LIBOPENCM3_USBD_H_INCLUDED
+#define HOST_LIBOPENCM3_USBD_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct _usbd_device usbd_device;
+
+/* Callback types named by USB/composite_usb_conf.h */
+struct usb_setup_data;
+
+typedef void (*usbd_control_complete_callback)(usbd_device *usbd_dev,
+                                               struct usb_setup_data *req);
+typedef int (*usbd_control_callback)(usbd_device *usbd_dev,
+                                     struct usb_setup_data *req,
+                                     uint8_t **buf, uint16_t *len,
+                                     usbd_control_complete_callback *complete);
+typedef void (*usbd_set_config_callback)(usbd_device *usbd_dev,
+                                         uint16_t wValue);
+typedef void (*usbd_sof_callback)(void);
+
+#endif
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "DAP/CMSIS_DAP_config.h"
+#include "DAP/CMSIS_DAP.h"
+#include "DAP/app.h"
+#include "DAP/capture.h"
+
+#include "replay.h"
+#include "swd_sim.h"
+#include "usb_sim.h"
+
+/* Main loop passes to wait for a response before giving up on it */
+#define REPLAY_SPINS            16
+
+/* Responses outstanding at once: a full packet queue, each packet
+   possibly followed by a long chain */
+#define REPLAY_PENDING          256
+
+struct replay_record {
+    uint8_t flags;
+    uint32_t start;
+    uint32_t duration;
+    const uint8_t* request;
+    uint8_t request_len;
+    const uint8_t* response;
+    uint8_t response_len;
+};
+
+static struct replay_record pending[REPLAY_PENDING];
+static uint32_t pending_head;
+static uint32_t pending_count;
+
+static uint32_t read_u32(const uint8_t* data) {
+    return ((uint32_t)data[0] << 0)
+         | ((uint32_t)data[1] << 8)
+         | ((uint32_t)data[2] << 16)
+         | ((uint32_t)data[3] << 24);
+}
+
+static bool replay_parse(const uint8_t* data, size_t len, size_t* offset,
+                         struct replay_record* record) {
+    const uint8_t* header = &data[*offset];
+
+    if (len - *offset < CAPTURE_HEADER_SIZE || header[0] != CAPTURE_SYNC
+        || header[8] > USB_SIM_REPORT_SIZE || header[9] > USB_SIM_REPORT_SIZE
+        || len - *offset - CAPTURE_HEADER_SIZE
+           < (size_t)header[8] + header[9]) {
+        fprintf(stderr, "Bad capture record at offset %zu\n", *offset);
+        return false;
+    }
+
+    record->flags = header[1];
+    record->start = read_u32(&header[2]);
+    record->duration = (uint32_t)header[6] | ((uint32_t)header[7] << 8);
+    record->request_len = header[8];
+    record->response_len = header[9];
+    record->request = &header[CAPTURE_HEADER_SIZE];
+    record->response = record->request + record->request_len;
+
+    *offset += CAPTURE_HEADER_SIZE + record->request_len
+               + record->response_len;
+    return true;
+}
+
+static void replay_expect(const struct replay_record* record,
+                          struct replay_result* result) {
+    if (pending_count < REPLAY_PENDING) {
+        pending[(pending_head + pending_count) % REPLAY_PENDING] = *record;
+        pending_count++;
+    }
+    result->responses++;
+}
+
+/* Run the firmware until the outstanding responses are in; those that
+   never come count as mismatches */
+static void replay_collect(struct replay_result* result) {
+    uint8_t response[USB_SIM_REPORT_SIZE];
+    unsigned int spins = 0;
+
+    while (pending_count > 0 && spins++ < REPLAY_SPINS) {
+        DAP_app_update();
+        while (pending_count > 0 && usb_sim_host_read(response)) {
+            const struct replay_record* record = &pending[pending_head];
+            if (memcmp(response, record->response,
+                       record->response_len) == 0) {
+                result->matched++;
+            }
+            pending_head = (pending_head + 1) % REPLAY_PENDING;
+            pending_count--;
+            spins = 0;
+        }
+    }
+
+    pending_head = 0;
+    pending_count = 0;
+}
+
+static bool replay_post(const struct replay_record* record,
+                        struct replay_result* result) {
+    uint8_t request[USB_SIM_REPORT_SIZE];
+    unsigned int spins;
+
+    memset(request, 0, sizeof(request));
+    memcpy(request, record->request, record->request_len);
+
+    /* NAKed while the packet queue is full */
+    for (spins = 0; spins < REPLAY_SPINS; spins++) {
+        if (usb_sim_host_write(request, sizeof(request))) {
+            result->commands++;
+            return true;
+        }
+        DAP_app_update();
+    }
+
+    fprintf(stderr, "Request 0x%02X not accepted\n", request[0]);
+    return false;
+}
+
+static double replay_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+bool replay_run(const uint8_t* data, size_t len,
+                struct replay_result* result) {
+    struct replay_record record;
+    uint64_t swclk_cycles = swd_sim_stats.swclk_cycles;
+    double started = replay_now();
+    uint32_t first_start = 0;
+    bool queued = false;
+    size_t offset = 0;
+    bool ok = true;
+
+    memset(result, 0, sizeof(*result));
+    pending_head = 0;
+    pending_count = 0;
+
+    while (ok && offset < len) {
+        ok = replay_parse(data, len, &offset, &record);
+        if (!ok) {
+            break;
+        }
+
+        if (result->records++ == 0) {
+            first_start = record.start;
+        }
+        result->captured_us = (uint32_t)(record.start + record.duration
+                                         - first_start);
+        result->bytes += record.request_len + record.response_len;
+        if (record.flags & CAPTURE_LOST) {
+            result->gaps++;
+        }
+
+        /* Further packets of the previous response */
+        if (record.flags & CAPTURE_CHAINED) {
+            replay_expect(&record, result);
+            continue;
+        }
+        if (record.request_len == 0) {
+            continue;
+        }
+
+        /* Like a debugger, wait for the answers before going on,
+           except behind queued commands, which are only answered once
+           the batch is complete */
+        if (!queued) {
+            replay_collect(result);
+        }
+        queued = (record.request[0] == ID_DAP_QueueCommands);
+
+        ok = replay_post(&record, result);
+        replay_expect(&record, result);
+    }
+    replay_collect(result);
+
+    result->swclk_cycles = swd_sim_stats.swclk_cycles - swclk_cycles;
+    result->seconds = replay_now() - started;
+    return ok;
+}
+
+int replay_file(const char* path) {
+    struct replay_result result;
+    uint8_t* data;
+    FILE* file;
+    long len;
+    bool ok;
+
+    file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+
+    fseek(file, 0, SEEK_END);
+    len = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data = malloc(len > 0 ? (size_t)len : 1);
+    if (!data || len < 0 || fread(data, 1, (size_t)len, file) != (size_t)len) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        fclose(file);
+        free(data);
+        return EXIT_FAILURE;
+    }
+    fclose(file);
+
+    ok = replay_run(data, (size_t)len, &result);
+    free(data);
+
+    printf("%u records, %u commands, %u of %u responses as captured\n",
+           result.records, result.commands, result.matched,
+           result.responses);
+    if (result.gaps) {
+        printf("%u gaps where the probe dropped records\n", result.gaps);
+    }
+    if (result.captured_us) {
+        printf("captured: %10.0f commands/s\n",
+               result.commands * 1e6 / result.captured_us);
+    }
+    if (result.seconds > 0) {
+        printf("replayed: %10.0f commands/s, %llu SWCLK cycles",
+               result.commands / result.seconds,
+               (unsigned long long)result.swclk_cycles);
+        if (result.bytes) {
+            printf(", %.2f SWCLK cycles/byte",
+                   (double)result.swclk_cycles / result.bytes);
+        }
+        printf("\n");
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef REPLAY_H_INCLUDED
+#define REPLAY_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Replay of a DAP traffic capture (see DAP/capture.h) against the
+ * simulated target. The captured requests go through the same HID
+ * endpoint path as the benchmark, so queued commands and chained
+ * responses behave as they did on the probe. Responses only match the
+ * captured ones where the simulated target answers like the real one:
+ * its RAM and core debug registers, but no flash controller.
+ */
+
+struct replay_result {
+    uint32_t records;           /* Records in the capture */
+    uint32_t commands;          /* Requests replayed */
+    uint32_t responses;         /* Response packets expected */
+    uint32_t matched;           /* Response packets identical to the capture */
+    uint32_t gaps;              /* Records with CAPTURE_LOST set */
+    uint32_t bytes;             /* Request and response bytes captured */
+    uint64_t captured_us;       /* From the first to the end of the last command */
+    uint64_t swclk_cycles;      /* SWCLK cycles of the replay */
+    double seconds;             /* Host time the replay took */
+};
+
+extern bool replay_run(const uint8_t* data, size_t len,
+                       struct replay_result* result);
+
+/* Replay a capture file and print the figures; returns an exit code */
+extern int replay_file(const char* path);
+
+#endif
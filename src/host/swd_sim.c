@@ -0,0 +1,881 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "swd_sim.h"
+
+/* Request header bits, in wire order after the start bit */
+#define REQ_APnDP               (1U << 0)
+#define REQ_RnW                 (1U << 1)
+#define REQ_A2                  (1U << 2)
+#define REQ_A3                  (1U << 3)
+
+#define ACK_OK                  0x1U
+#define ACK_WAIT                0x2U
+#define ACK_FAULT               0x4U
+
+/* DP CTRL/STAT bits */
+#define CTRL_STICKYORUN         (1U << 1)
+#define CTRL_STICKYCMP          (1U << 4)
+#define CTRL_STICKYERR          (1U << 5)
+#define CTRL_WDATAERR           (1U << 7)
+#define CTRL_CDBGPWRUPREQ       (1U << 28)
+#define CTRL_CDBGPWRUPACK       (1U << 29)
+#define CTRL_CSYSPWRUPREQ       (1U << 30)
+#define CTRL_CSYSPWRUPACK       (1U << 31)
+
+/* DP ABORT bits */
+#define ABORT_STKCMPCLR         (1U << 1)
+#define ABORT_STKERRCLR         (1U << 2)
+#define ABORT_WDERRCLR          (1U << 3)
+#define ABORT_ORUNERRCLR        (1U << 4)
+
+/* MEM-AP register offsets */
+#define AP_CSW                  0x00U
+#define AP_TAR                  0x04U
+#define AP_DRW                  0x0CU
+#define AP_BD0                  0x10U
+#define AP_CFG                  0xF4U
+#define AP_BASE                 0xF8U
+#define AP_IDR                  0xFCU
+
+#define CSW_SIZE_MASK           0x7U
+#define CSW_ADDRINC_MASK        (0x3U << 4)
+#define CSW_ADDRINC_SINGLE      (0x1U << 4)
+#define CSW_ADDRINC_PACKED      (0x2U << 4)
+#define CSW_DEVICEEN            (1U << 6)
+
+/* Cortex-M debug registers */
+#define CORE_DHCSR              0xE000EDF0U
+#define CORE_DCRSR              0xE000EDF4U
+#define CORE_DCRDR              0xE000EDF8U
+#define CORE_DEMCR              0xE000EDFCU
+#define CORE_AIRCR              0xE000ED0CU
+
+#define DHCSR_DBGKEY            0xA05F0000U
+#define DHCSR_KEY_MASK          0xFFFF0000U
+#define DHCSR_C_HALT            (1U << 1)
+#define DHCSR_C_MASK            0x0000002FU
+#define DHCSR_S_REGRDY          (1U << 16)
+#define DHCSR_S_HALT            (1U << 17)
+#define DCRSR_REGWnR            (1U << 16)
+#define DCRSR_REGSEL_MASK       0x7FU
+#define AIRCR_VECTKEY           0x05FA0000U
+#define AIRCR_KEY_MASK          0xFFFF0000U
+#define AIRCR_SYSRESETREQ       (1U << 2)
+
+#define LINE_RESET_BITS         50
+#define SWJ_SELECT_BITS         16
+
+enum swd_sim_state {
+    STATE_LOCKOUT,              /* Waiting for a line reset */
+    STATE_RESET,                /* Line reset seen, waiting for idle */
+    STATE_IDLE,                 /* Waiting for a start bit */
+    STATE_HEADER,               /* Shifting in the packet request */
+    STATE_TURNAROUND_ACK,       /* Turnaround before the ACK */
+    STATE_ACK,                  /* Driving ACK[2:0] */
+    STATE_READ_DATA,            /* Driving RDATA[31:0] and parity */
+    STATE_TURNAROUND_WRITE,     /* Turnaround before WDATA */
+    STATE_WRITE_DATA,           /* Sampling WDATA[31:0] and parity */
+};
+
+struct swd_sim_pins {
+    uint32_t swclk;
+    uint32_t host_swdio;
+    uint32_t host_oe;
+    uint32_t target_swdio;
+    uint32_t target_oe;
+    uint32_t nreset;
+};
+
+struct swd_sim_dp {
+    uint32_t ctrl_stat;
+    uint32_t select;
+    uint32_t rdbuff;
+    uint32_t turnaround;
+};
+
+struct swd_sim_ap {
+    uint32_t csw;
+    uint32_t tar;
+    uint32_t busy_cycles;
+};
+
+struct swd_sim_core {
+    uint32_t regs[SWD_SIM_CORE_REGS];
+    uint32_t dhcsr;             /* Control bits */
+    uint32_t dcrdr;
+    uint32_t demcr;
+    uint32_t run_cycles;        /* Until the code started by the hook halts */
+    bool halted;
+};
+
+struct swd_sim_packet {
+    uint32_t request;
+    uint32_t ack;
+    uint32_t data;
+    uint32_t bits;
+    uint32_t count;
+};
+
+struct swd_sim_stats swd_sim_stats;
+
+static struct swd_sim_pins pins;
+static struct swd_sim_dp dps[SWD_SIM_TARGETS];
+static struct swd_sim_ap aps[SWD_SIM_TARGETS];
+static struct swd_sim_dp* dp = &dps[0];
+static struct swd_sim_ap* ap = &aps[0];
+static struct swd_sim_core core;
+static struct swd_sim_packet packet;
+static enum swd_sim_state state;
+static uint32_t consecutive_ones;
+static uint32_t bits_since_reset;
+static uint32_t ap_wait_cycles;
+
+/* Multi-drop: targets on the bus (0 for a single-drop SW-DP), whether
+   the first packet after a line reset is still to come, and whether
+   the current write is a TARGETSEL */
+static uint32_t multidrop_targets;
+static bool targetsel_allowed;
+static bool targetsel_pending;
+
+static void (*clock_hook)(void);
+static uint32_t clock_hook_period;
+static uint32_t clock_hook_count;
+static bool (*noise_hook)(void);
+static uint32_t (*core_hook)(uint32_t* regs, bool finished);
+
+static uint32_t ram[SWD_SIM_RAM_SIZE / 4];
+
+static uint32_t parity32(uint32_t value) {
+    value ^= value >> 16;
+    value ^= value >> 8;
+    value ^= value >> 4;
+    value ^= value >> 2;
+    value ^= value >> 1;
+    return value & 1U;
+}
+
+/* Target memory */
+
+static bool ram_contains(uint32_t address) {
+    return (address >= SWD_SIM_RAM_BASE)
+        && (address - SWD_SIM_RAM_BASE) < SWD_SIM_RAM_SIZE;
+}
+
+bool swd_sim_read_word(uint32_t address, uint32_t* data) {
+    if (!ram_contains(address)) {
+        return false;
+    }
+    *data = ram[(address - SWD_SIM_RAM_BASE) / 4];
+    return true;
+}
+
+bool swd_sim_write_word(uint32_t address, uint32_t data) {
+    if (!ram_contains(address)) {
+        return false;
+    }
+    ram[(address - SWD_SIM_RAM_BASE) / 4] = data;
+    return true;
+}
+
+/* Debug register accesses; always whole words */
+static bool core_access(uint32_t address, bool write, uint32_t* data) {
+    uint32_t regsel;
+
+    switch (address) {
+        case CORE_DHCSR:
+            if (!write) {
+                *data = core.dhcsr | DHCSR_S_REGRDY
+                      | (core.halted ? DHCSR_S_HALT : 0);
+            } else if ((*data & DHCSR_KEY_MASK) == DHCSR_DBGKEY) {
+                core.dhcsr = *data & DHCSR_C_MASK;
+                if (core.dhcsr & DHCSR_C_HALT) {
+                    core.halted = true;
+                    core.run_cycles = 0;
+                } else if (core.halted) {
+                    core.halted = false;
+                    core.run_cycles = core_hook ? core_hook(core.regs, false) : 0;
+                }
+            }
+            return true;
+        case CORE_DCRSR:
+            regsel = *data & DCRSR_REGSEL_MASK;
+            if (write && core.halted && regsel < SWD_SIM_CORE_REGS) {
+                if (*data & DCRSR_REGWnR) {
+                    core.regs[regsel] = core.dcrdr;
+                } else {
+                    core.dcrdr = core.regs[regsel];
+                }
+            } else if (!write) {
+                *data = 0;
+            }
+            return true;
+        case CORE_DCRDR:
+            if (write) {
+                core.dcrdr = *data;
+            } else {
+                *data = core.dcrdr;
+            }
+            return true;
+        case CORE_DEMCR:
+            if (write) {
+                core.demcr = *data;
+            } else {
+                *data = core.demcr;
+            }
+            return true;
+        case CORE_AIRCR:
+            /* A system reset leaves debug enabled and the core running */
+            if (write && (*data & AIRCR_KEY_MASK) == AIRCR_VECTKEY
+                && (*data & AIRCR_SYSRESETREQ)) {
+                core.dhcsr &= ~DHCSR_C_HALT;
+                core.halted = false;
+                core.run_cycles = 0;
+                swd_sim_stats.core_resets++;
+            } else if (!write) {
+                *data = 0xFA050000U;
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* The code the core hook started reached its breakpoint */
+static void core_clock(void) {
+    if (core.run_cycles == 0 || --core.run_cycles > 0) {
+        return;
+    }
+
+    if (core_hook) {
+        core_hook(core.regs, true);
+    }
+    core.halted = true;
+    core.regs[SWD_SIM_REG_PC] = core.regs[SWD_SIM_REG_LR] & ~0x1U;
+}
+
+/* Perform a MEM-AP data access, using the byte lanes that correspond
+   to the CSW transfer size. */
+static bool mem_access(uint32_t target, bool write, uint32_t* data) {
+    uint32_t size = ap->csw & CSW_SIZE_MASK;
+    uint32_t address = target & ~0x3U;
+    uint32_t shift = (target & 0x3U) * 8;
+    uint32_t mask;
+    uint32_t word;
+
+    if (core_access(address, write, data)) {
+        return true;
+    }
+
+    if (size == 0) {
+        mask = 0xFFU << shift;
+    } else if (size == 1) {
+        mask = 0xFFFFU << (shift & 16);
+    } else {
+        mask = 0xFFFFFFFFU;
+    }
+
+    if (!swd_sim_read_word(address, &word)) {
+        return false;
+    }
+
+    if (write) {
+        word = (word & ~mask) | (*data & mask);
+        swd_sim_write_word(address, word);
+    } else {
+        *data = word & mask;
+    }
+
+    return true;
+}
+
+/* Advance TAR after a DRW access. Auto-increment only carries within
+   the low 10 bits, as permitted by ADIv5. */
+static void tar_increment(void) {
+    uint32_t increment;
+
+    if ((ap->csw & CSW_ADDRINC_MASK) == 0) {
+        return;
+    }
+
+    increment = 1U << (ap->csw & CSW_SIZE_MASK);
+    ap->tar = (ap->tar & ~0x3FFU) | ((ap->tar + increment) & 0x3FFU);
+}
+
+static uint32_t ap_register(uint32_t request) {
+    return (dp->select & 0xF0U) | (request & (REQ_A2 | REQ_A3));
+}
+
+static void ap_read(uint32_t request) {
+    uint32_t reg = ap_register(request);
+    uint32_t data = 0;
+
+    swd_sim_stats.ap_reads++;
+
+    if ((dp->select >> 24) == SWD_SIM_CTRL_AP) {
+        dp->rdbuff = (reg == AP_IDR) ? SWD_SIM_CTRL_AP_IDR : 0;
+        return;
+    }
+    if ((dp->select >> 24) != 0) {
+        /* No AP at this index; reads as zero */
+        dp->rdbuff = 0;
+        return;
+    }
+
+    switch (reg) {
+        case AP_CSW:
+            data = ap->csw | CSW_DEVICEEN;
+            break;
+        case AP_TAR:
+            data = ap->tar;
+            break;
+        case AP_DRW:
+            if (!mem_access(ap->tar, false, &data)) {
+                dp->ctrl_stat |= CTRL_STICKYERR;
+                data = 0;
+            }
+            tar_increment();
+            break;
+        case AP_BD0:
+        case AP_BD0 + 0x4:
+        case AP_BD0 + 0x8:
+        case AP_BD0 + 0xC:
+            if (!mem_access((ap->tar & ~0xFU) | (reg & 0xCU), false, &data)) {
+                dp->ctrl_stat |= CTRL_STICKYERR;
+                data = 0;
+            }
+            break;
+        case AP_CFG:
+            data = 0;
+            break;
+        case AP_BASE:
+            data = 0xE00FF003U;
+            break;
+        case AP_IDR:
+            data = SWD_SIM_AP_IDR;
+            break;
+        default:
+            data = 0;
+            break;
+    }
+
+    dp->rdbuff = data;
+    ap->busy_cycles = ap_wait_cycles;
+}
+
+static void ap_write(uint32_t request, uint32_t data) {
+    uint32_t reg = ap_register(request);
+
+    swd_sim_stats.ap_writes++;
+
+    if ((dp->select >> 24) == SWD_SIM_CTRL_AP) {
+        /* Every write to bank 0 runs a command, even a repeated one */
+        if (reg < 0x10U) {
+            swd_sim_stats.ctrl_ap_commands++;
+        }
+        return;
+    }
+    if ((dp->select >> 24) != 0) {
+        return;
+    }
+
+    switch (reg) {
+        case AP_CSW:
+            ap->csw = data & ~CSW_DEVICEEN;
+            break;
+        case AP_TAR:
+            ap->tar = data;
+            break;
+        case AP_DRW:
+            if (!mem_access(ap->tar, true, &data)) {
+                dp->ctrl_stat |= CTRL_STICKYERR;
+            }
+            tar_increment();
+            break;
+        case AP_BD0:
+        case AP_BD0 + 0x4:
+        case AP_BD0 + 0x8:
+        case AP_BD0 + 0xC:
+            if (!mem_access((ap->tar & ~0xFU) | (reg & 0xCU), true, &data)) {
+                dp->ctrl_stat |= CTRL_STICKYERR;
+            }
+            break;
+        default:
+            break;
+    }
+
+    ap->busy_cycles = ap_wait_cycles;
+}
+
+static uint32_t dp_read(uint32_t request) {
+    uint32_t data = 0;
+
+    swd_sim_stats.dp_reads++;
+
+    switch (request & (REQ_A2 | REQ_A3)) {
+        case 0:
+            data = SWD_SIM_DPIDR;
+            break;
+        case REQ_A2:
+            if (dp->select & 0x1U) {
+                /* WCR */
+                data = (dp->turnaround - 1) << 8;
+            } else {
+                data = dp->ctrl_stat;
+            }
+            break;
+        case REQ_A3:
+            /* RESEND */
+            data = packet.data;
+            break;
+        case REQ_A2 | REQ_A3:
+            data = dp->rdbuff;
+            break;
+    }
+
+    return data;
+}
+
+static void dp_write(uint32_t request, uint32_t data) {
+    swd_sim_stats.dp_writes++;
+
+    switch (request & (REQ_A2 | REQ_A3)) {
+        case 0:
+            if (data & ABORT_STKCMPCLR) {
+                dp->ctrl_stat &= ~CTRL_STICKYCMP;
+            }
+            if (data & ABORT_STKERRCLR) {
+                dp->ctrl_stat &= ~CTRL_STICKYERR;
+            }
+            if (data & ABORT_WDERRCLR) {
+                dp->ctrl_stat &= ~CTRL_WDATAERR;
+            }
+            if (data & ABORT_ORUNERRCLR) {
+                dp->ctrl_stat &= ~CTRL_STICKYORUN;
+            }
+            break;
+        case REQ_A2:
+            if (dp->select & 0x1U) {
+                dp->turnaround = ((data >> 8) & 0x3U) + 1;
+            } else {
+                uint32_t writable = CTRL_CDBGPWRUPREQ | CTRL_CSYSPWRUPREQ
+                                  | 0x00FFFF00U | 0x0000000DU;
+                uint32_t sticky = dp->ctrl_stat & (CTRL_STICKYORUN | CTRL_STICKYCMP
+                                                 | CTRL_STICKYERR | CTRL_WDATAERR);
+                dp->ctrl_stat = (data & writable) | sticky;
+                if (dp->ctrl_stat & CTRL_CDBGPWRUPREQ) {
+                    dp->ctrl_stat |= CTRL_CDBGPWRUPACK;
+                }
+                if (dp->ctrl_stat & CTRL_CSYSPWRUPREQ) {
+                    dp->ctrl_stat |= CTRL_CSYSPWRUPACK;
+                }
+            }
+            break;
+        case REQ_A3:
+            dp->select = data;
+            break;
+        default:
+            break;
+    }
+}
+
+/* Decide how to respond to a freshly decoded packet request. Reads are
+   performed immediately so that the data is ready for the data phase;
+   writes are committed once the data phase completes. */
+static void start_packet(uint32_t request) {
+    bool is_ap = (request & REQ_APnDP) != 0;
+    bool is_read = (request & REQ_RnW) != 0;
+    uint32_t reg = request & (REQ_A2 | REQ_A3);
+    bool sticky = (dp->ctrl_stat & (CTRL_STICKYERR | CTRL_WDATAERR)) != 0;
+
+    swd_sim_stats.packets++;
+    packet.request = request;
+
+    if (sticky && (is_ap || !((is_read && reg != (REQ_A2 | REQ_A3))
+                              || (!is_read && reg == 0)))) {
+        /* Only IDCODE, CTRL/STAT, RESEND and ABORT remain accessible */
+        packet.ack = ACK_FAULT;
+    } else if (ap->busy_cycles > 0
+               && (is_ap || (is_read && reg == (REQ_A2 | REQ_A3)))) {
+        packet.ack = ACK_WAIT;
+    } else {
+        packet.ack = ACK_OK;
+        if (is_read) {
+            if (is_ap) {
+                /* Return the previous result and post a new read */
+                packet.data = dp->rdbuff;
+                ap_read(request);
+            } else {
+                packet.data = dp_read(request);
+            }
+        }
+    }
+
+    if (packet.ack == ACK_OK) {
+        swd_sim_stats.ack_ok++;
+    } else if (packet.ack == ACK_WAIT) {
+        swd_sim_stats.ack_wait++;
+    } else {
+        swd_sim_stats.ack_fault++;
+    }
+}
+
+static void finish_write(uint32_t data, uint32_t parity) {
+    if (parity32(data) != parity) {
+        swd_sim_stats.protocol_errors++;
+        dp->ctrl_stat |= CTRL_WDATAERR;
+        return;
+    }
+
+    if (packet.request & REQ_APnDP) {
+        ap_write(packet.request, data);
+    } else {
+        dp_write(packet.request, data);
+    }
+}
+
+static void line_reset(void) {
+    uint32_t i;
+
+    swd_sim_stats.line_resets++;
+    bits_since_reset = 0;
+    pins.target_oe = 0;
+    for (i = 0; i < SWD_SIM_TARGETS; i++) {
+        dps[i].select = 0;
+    }
+    targetsel_allowed = (multidrop_targets > 0);
+    state = STATE_RESET;
+}
+
+/* Every DP on the bus compares the TARGETSEL data with its TARGETID
+   and instance; the others stay quiet until the next line reset */
+static void target_select(uint32_t data, uint32_t parity) {
+    uint32_t i;
+
+    swd_sim_stats.target_selects++;
+    if (parity32(data) != parity) {
+        swd_sim_stats.protocol_errors++;
+        state = STATE_LOCKOUT;
+        return;
+    }
+
+    for (i = 0; i < multidrop_targets; i++) {
+        if (data == (SWD_SIM_TARGETID | (i << 28))) {
+            dp = &dps[i];
+            ap = &aps[i];
+            state = STATE_IDLE;
+            return;
+        }
+    }
+
+    state = STATE_LOCKOUT;
+}
+
+/* Advance the target by one SWCLK rising edge */
+static void swd_sim_clock(void) {
+    bool driven = pins.host_oe && !pins.target_oe;
+    uint32_t bit = pins.host_swdio;
+
+    swd_sim_stats.swclk_cycles++;
+    if (bits_since_reset <= SWJ_SELECT_BITS) {
+        bits_since_reset++;
+    }
+    if (ap->busy_cycles > 0) {
+        ap->busy_cycles--;
+    }
+    core_clock();
+
+    if (driven && bit) {
+        consecutive_ones++;
+        if (consecutive_ones == LINE_RESET_BITS) {
+            line_reset();
+            return;
+        }
+    } else {
+        consecutive_ones = 0;
+    }
+
+    switch (state) {
+        case STATE_LOCKOUT:
+            break;
+        case STATE_RESET:
+            if (driven && !bit) {
+                state = STATE_IDLE;
+            }
+            break;
+        case STATE_IDLE:
+            if (driven && bit) {
+                packet.bits = 1;
+                packet.count = 0;
+                state = STATE_HEADER;
+            }
+            break;
+        case STATE_HEADER: {
+            if (!driven) {
+                swd_sim_stats.protocol_errors++;
+                state = STATE_LOCKOUT;
+                break;
+            }
+            packet.bits |= bit << (++packet.count);
+            if (packet.count < 7) {
+                break;
+            }
+
+            /* start, APnDP, RnW, A2, A3, parity, stop, park */
+            uint32_t request = (packet.bits >> 1) & 0xFU;
+            uint32_t parity = (packet.bits >> 5) & 0x1U;
+            uint32_t stop = (packet.bits >> 6) & 0x1U;
+            uint32_t park = (packet.bits >> 7) & 0x1U;
+            if (stop != 0 || park != 1 || parity32(request) != parity) {
+                /* The JTAG-to-SWD select sequence that follows a line
+                   reset is expected to look like garbage, and so is
+                   the start of a line reset sent to an idle target. */
+                if (bits_since_reset > SWJ_SELECT_BITS && packet.bits != 0xFFU) {
+                    swd_sim_stats.protocol_errors++;
+                }
+                state = STATE_LOCKOUT;
+                break;
+            }
+
+            if (targetsel_allowed && request == (REQ_A2 | REQ_A3)) {
+                /* TARGETSEL: not acknowledged, the data follows where
+                   the turnarounds and ACK would be */
+                targetsel_allowed = false;
+                targetsel_pending = true;
+                packet.bits = 0;
+                packet.count = 2 * dp->turnaround + 3;
+                state = STATE_TURNAROUND_WRITE;
+                break;
+            }
+            if (targetsel_allowed && multidrop_targets > 1) {
+                /* Every DP on the bus answers at once */
+                swd_sim_stats.protocol_errors++;
+            }
+            targetsel_allowed = false;
+
+            start_packet(request);
+            packet.count = dp->turnaround;
+            state = STATE_TURNAROUND_ACK;
+            break;
+        }
+        case STATE_TURNAROUND_ACK:
+            if (--packet.count == 0) {
+                pins.target_oe = 1;
+                pins.target_swdio = packet.ack & 0x1U;
+                packet.count = 1;
+                state = STATE_ACK;
+            }
+            break;
+        case STATE_ACK:
+            if (packet.count < 3) {
+                pins.target_swdio = (packet.ack >> packet.count) & 0x1U;
+                packet.count++;
+            } else if (packet.ack == ACK_OK && (packet.request & REQ_RnW)) {
+                pins.target_swdio = packet.data & 0x1U;
+                packet.count = 1;
+                state = STATE_READ_DATA;
+            } else if (packet.ack == ACK_OK) {
+                pins.target_oe = 0;
+                packet.bits = 0;
+                packet.count = dp->turnaround;
+                state = STATE_TURNAROUND_WRITE;
+            } else {
+                pins.target_oe = 0;
+                state = STATE_IDLE;
+            }
+            break;
+        case STATE_READ_DATA:
+            if (packet.count < 32) {
+                pins.target_swdio = (packet.data >> packet.count) & 0x1U;
+                packet.count++;
+            } else if (packet.count == 32) {
+                pins.target_swdio = parity32(packet.data);
+                packet.count++;
+            } else {
+                pins.target_oe = 0;
+                state = STATE_IDLE;
+            }
+            break;
+        case STATE_TURNAROUND_WRITE:
+            if (--packet.count == 0) {
+                state = STATE_WRITE_DATA;
+            }
+            break;
+        case STATE_WRITE_DATA:
+            if (packet.count < 32) {
+                packet.bits |= bit << packet.count;
+                packet.count++;
+            } else if (targetsel_pending) {
+                targetsel_pending = false;
+                target_select(packet.bits, bit);
+            } else {
+                finish_write(packet.bits, bit);
+                state = STATE_IDLE;
+            }
+            break;
+    }
+}
+
+/* Pin interface */
+
+void swd_sim_swclk(uint32_t level) {
+    level &= 0x1U;
+    if (level && !pins.swclk) {
+        pins.swclk = level;
+        swd_sim_clock();
+        if (clock_hook && ++clock_hook_count >= clock_hook_period) {
+            clock_hook_count = 0;
+            clock_hook();
+        }
+    } else {
+        pins.swclk = level;
+    }
+}
+
+uint32_t swd_sim_swclk_in(void) {
+    return pins.swclk;
+}
+
+void swd_sim_swdio_out(uint32_t bit) {
+    pins.host_swdio = bit & 0x1U;
+}
+
+void swd_sim_swdio_oe(uint32_t enable) {
+    pins.host_oe = enable ? 1 : 0;
+}
+
+uint32_t swd_sim_swdio_in(void) {
+    if (pins.target_oe) {
+        if (noise_hook && noise_hook()) {
+            return pins.target_swdio ^ 0x1U;
+        }
+        return pins.target_swdio;
+    } else if (pins.host_oe) {
+        return pins.host_swdio;
+    }
+
+    /* Pulled up when nobody drives the line */
+    return 1;
+}
+
+/* SPI master in mode 3 (SCK idles high, data is sampled on the rising
+   edge) shifting LSB first over SWCLK and SWDIO. MOSI only reaches the
+   line while the host is driving SWDIO. */
+uint32_t swd_sim_spi_shift(uint32_t data, uint32_t bits) {
+    uint32_t in = 0;
+    uint32_t i;
+
+    for (i = 0; i < bits; i++) {
+        swd_sim_swclk(0);
+        swd_sim_swdio_out(data >> i);
+        in |= swd_sim_swdio_in() << i;
+        swd_sim_swclk(1);
+    }
+
+    return in;
+}
+
+/* 16-bit timer counting at the CPU clock; periods beyond 16 bits are
+   reached through the prescaler, rounding the period up. */
+uint32_t swd_sim_timer_set_period(uint32_t ticks) {
+    uint32_t prescaler = (ticks - 1) >> 16;
+    uint32_t reload = (ticks + prescaler) / (prescaler + 1);
+
+    return (prescaler + 1) * reload;
+}
+
+void swd_sim_timer_start(void) {
+    swd_sim_stats.timer_starts++;
+}
+
+void swd_sim_timer_wait(void) {
+    swd_sim_stats.timer_waits++;
+}
+
+void swd_sim_nreset_out(uint32_t bit) {
+    pins.nreset = bit & 0x1U;
+}
+
+uint32_t swd_sim_nreset_in(void) {
+    return pins.nreset;
+}
+
+/* Model control */
+
+void swd_sim_power_on(void) {
+    uint32_t i;
+
+    memset(&pins, 0, sizeof(pins));
+    memset(dps, 0, sizeof(dps));
+    memset(aps, 0, sizeof(aps));
+    memset(&core, 0, sizeof(core));
+    memset(&packet, 0, sizeof(packet));
+    memset(ram, 0, sizeof(ram));
+
+    pins.nreset = 1;
+    for (i = 0; i < SWD_SIM_TARGETS; i++) {
+        dps[i].turnaround = 1;
+        aps[i].csw = 0x03000002U;
+    }
+    dp = &dps[0];
+    ap = &aps[0];
+    multidrop_targets = 0;
+    targetsel_allowed = false;
+    targetsel_pending = false;
+    consecutive_ones = 0;
+    bits_since_reset = SWJ_SELECT_BITS + 1;
+    state = STATE_LOCKOUT;
+
+    swd_sim_clear_stats();
+}
+
+void swd_sim_clear_stats(void) {
+    memset(&swd_sim_stats, 0, sizeof(swd_sim_stats));
+}
+
+void swd_sim_set_multidrop(uint32_t targets) {
+    multidrop_targets = (targets < SWD_SIM_TARGETS) ? targets : SWD_SIM_TARGETS;
+    if (multidrop_targets == 0) {
+        dp = &dps[0];
+        ap = &aps[0];
+    }
+}
+
+void swd_sim_set_ap_wait_cycles(uint32_t cycles) {
+    ap_wait_cycles = cycles;
+}
+
+void swd_sim_set_clock_hook(void (*hook)(void), uint32_t period) {
+    clock_hook = hook;
+    clock_hook_period = period;
+    clock_hook_count = 0;
+}
+
+void swd_sim_set_noise_hook(bool (*hook)(void)) {
+    noise_hook = hook;
+}
+
+void swd_sim_set_core_hook(uint32_t (*hook)(uint32_t* regs, bool finished)) {
+    core_hook = hook;
+}
+
+bool swd_sim_core_halted(void) {
+    return core.halted;
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef SWD_SIM_H_INCLUDED
+#define SWD_SIM_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Bit-level model of an ADIv5 SW-DP with an AHB MEM-AP in front of a
+ * block of RAM and the debug registers of a Cortex-M core, and a vendor
+ * control AP at APSEL 1 whose bank 0 registers are commands, or of
+ * several SWDv2 multi-drop DPs sharing them. The model is clocked by the probe's SWCLK edges
+ * and samples/drives SWDIO exactly like a real target would, so every
+ * cycle the firmware spends on the wire is visible in the statistics.
+ */
+
+#define SWD_SIM_DPIDR           0x0BB11477U
+#define SWD_SIM_TARGETID        0x01002927U
+#define SWD_SIM_TARGETS         2
+#define SWD_SIM_AP_IDR          0x04770021U
+#define SWD_SIM_CTRL_AP         1U
+#define SWD_SIM_CTRL_AP_IDR     0x02880000U
+#define SWD_SIM_RAM_BASE        0x20000000U
+#define SWD_SIM_RAM_SIZE        (64U * 1024U)
+
+/* Core registers as numbered by DCRSR REGSEL */
+#define SWD_SIM_CORE_REGS       17
+#define SWD_SIM_REG_R9          9
+#define SWD_SIM_REG_SP          13
+#define SWD_SIM_REG_LR          14
+#define SWD_SIM_REG_PC          15
+#define SWD_SIM_REG_XPSR        16
+
+struct swd_sim_stats {
+    uint64_t swclk_cycles;      /* SWCLK rising edges */
+    uint32_t packets;           /* Valid packet requests decoded */
+    uint32_t ack_ok;
+    uint32_t ack_wait;
+    uint32_t ack_fault;
+    uint32_t protocol_errors;   /* Malformed requests and parity errors */
+    uint32_t line_resets;
+    uint32_t target_selects;    /* TARGETSEL writes, matching or not */
+    uint32_t dp_reads;
+    uint32_t dp_writes;
+    uint32_t ap_reads;
+    uint32_t ap_writes;
+    uint32_t ctrl_ap_commands;  /* Writes to the control AP's commands */
+    uint32_t timer_starts;      /* Transfers paced by the SWCLK timer */
+    uint32_t timer_waits;       /* Half periods ended by the SWCLK timer */
+    uint32_t core_resets;       /* System resets requested through AIRCR */
+};
+
+extern struct swd_sim_stats swd_sim_stats;
+
+/* Pin interface used by host/DAP/CMSIS_DAP_config.h */
+extern void swd_sim_swclk(uint32_t level);
+extern uint32_t swd_sim_swclk_in(void);
+extern void swd_sim_swdio_out(uint32_t bit);
+extern void swd_sim_swdio_oe(uint32_t enable);
+extern uint32_t swd_sim_swdio_in(void);
+extern void swd_sim_nreset_out(uint32_t bit);
+extern uint32_t swd_sim_nreset_in(void);
+
+/* SPI peripheral sharing the SWCLK/SWDIO pins, for DAP_SWD_SPI */
+extern uint32_t swd_sim_spi_shift(uint32_t data, uint32_t bits);
+
+/* Timer pacing the SWCLK half periods, for DAP_SWD_TIMER */
+extern uint32_t swd_sim_timer_set_period(uint32_t ticks);
+extern void swd_sim_timer_start(void);
+extern void swd_sim_timer_wait(void);
+
+/* Model control */
+extern void swd_sim_power_on(void);
+extern void swd_sim_clear_stats(void);
+extern void swd_sim_set_ap_wait_cycles(uint32_t cycles);
+
+/* Put targets multi-drop DPs on the bus, each with its own MEM-AP but
+   sharing the RAM and core, selected with TARGETSEL = TARGETID |
+   (instance << 28). 0 goes back to the single-drop DP, target 0. */
+extern void swd_sim_set_multidrop(uint32_t targets);
+
+/* Call hook every period SWCLK cycles, e.g. to raise a simulated
+   interrupt in the middle of a transfer. A NULL hook disables it. */
+extern void swd_sim_set_clock_hook(void (*hook)(void), uint32_t period);
+
+/* Ask hook about every bit the target drives; when it returns true the
+   probe reads the bit inverted, like noise on a long cable. A NULL
+   hook disables it. */
+extern void swd_sim_set_noise_hook(bool (*hook)(void));
+
+/* The core comes out of power-on running. Once it has been halted
+   through DHCSR, resuming it calls hook with the register file and
+   finished false; the hook returns how many SWCLK cycles the code at
+   PC runs, 0 for ever. After that many cycles hook is called again
+   with finished true to apply the code's effects, and the core halts
+   as if on a breakpoint at LR. A NULL hook disables it. */
+extern void swd_sim_set_core_hook(uint32_t (*hook)(uint32_t* regs, bool finished));
+extern bool swd_sim_core_halted(void);
+
+/* Backdoor access to the simulated target RAM */
+extern bool swd_sim_read_word(uint32_t address, uint32_t* data);
+extern bool swd_sim_write_word(uint32_t address, uint32_t data);
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+
+#include "swo_uart.h"
+#include "swo_sim.h"
+
+/* Same limits as USART2 on the 48MHz APB with 16x oversampling */
+#define SWO_SIM_USART_CLOCK     48000000U
+
+static uint8_t* capture_buffer;
+static uint32_t capture_size;
+static uint32_t capture_count;
+static uint32_t baudrate_divider;
+static bool capturing;
+
+uint32_t swo_uart_set_baudrate(uint32_t baudrate) {
+    uint32_t divider;
+
+    if (baudrate == 0) {
+        return 0;
+    }
+
+    divider = (SWO_SIM_USART_CLOCK + baudrate / 2) / baudrate;
+    if (divider < 16) {
+        divider = 16;
+    } else if (divider > 0xFFFF) {
+        return 0;
+    }
+
+    baudrate_divider = divider;
+    return SWO_SIM_USART_CLOCK / divider;
+}
+
+void swo_uart_start(uint8_t* buffer, uint32_t size) {
+    capture_buffer = buffer;
+    capture_size = size;
+    capture_count = 0;
+    capturing = (baudrate_divider != 0);
+}
+
+void swo_uart_stop(void) {
+    capturing = false;
+}
+
+uint32_t swo_uart_count(void) {
+    return capture_count;
+}
+
+size_t swo_sim_receive(const uint8_t* data, size_t len) {
+    size_t i;
+
+    if (!capturing) {
+        return 0;
+    }
+
+    for (i = 0; i < len; i++) {
+        capture_buffer[capture_count % capture_size] = data[i];
+        capture_count++;
+    }
+
+    return len;
+}
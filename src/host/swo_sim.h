@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef SWO_SIM_H_INCLUDED
+#define SWO_SIM_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Stand-in for the SWO UART/DMA driver in swo_uart.c. Bytes "sent" by
+ * the target are written into the capture buffer the same way the DMA
+ * channel would, wrapping around without regard for the reader.
+ */
+
+/* Returns the number of bytes captured; 0 if capture is stopped */
+extern size_t swo_sim_receive(const uint8_t* data, size_t len);
+
+#endif
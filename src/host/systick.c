@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdint.h>
+
+#include <libopencm3/cm3/systick.h>
+
+#include "tick.h"
+#include "swd_sim.h"
+
+/*
+ * SysTick emulation for the CMSIS-DAP timeout helpers. There is no
+ * free-running counter on the host, so every access to STK_CSR counts
+ * as a fixed slice of CPU time; this bounds the WAIT retry loops
+ * without depending on how fast the host happens to be.
+ */
+
+#define HOST_STK_TICKS_PER_ACCESS   48U
+
+uint32_t host_stk_rvr;
+uint32_t host_stk_cvr;
+
+static uint32_t stk_csr;
+
+uint32_t* host_stk_csr(void) {
+    if (stk_csr & STK_CSR_ENABLE) {
+        if (host_stk_cvr <= HOST_STK_TICKS_PER_ACCESS) {
+            host_stk_cvr = host_stk_rvr;
+            stk_csr |= STK_CSR_COUNTFLAG;
+        } else {
+            host_stk_cvr -= HOST_STK_TICKS_PER_ACCESS;
+        }
+    }
+
+    return &stk_csr;
+}
+
+/* There is no CPU to count cycles of; use the SWCLK cycles instead */
+uint32_t get_cycles(void) {
+    return (uint32_t)swd_sim_stats.swclk_cycles;
+}
+
+/* Nor a timer; timestamps count one microsecond per SWCLK cycle */
+uint32_t get_micros(void) {
+    return (uint32_t)swd_sim_stats.swclk_cycles;
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <string.h>
+
+#include <libopencm3/cm3/cortex.h>
+
+#include "USB/composite_usb_conf.h"
+#include "USB/hid.h"
+#include "USB/bulk.h"
+#include "usb_sim.h"
+
+/* Packets sent by one side, waiting to be read by the other */
+struct usb_sim_queue {
+    uint8_t packets[USB_SIM_IN_QUEUE_SIZE][USB_SIM_REPORT_SIZE];
+    size_t lengths[USB_SIM_IN_QUEUE_SIZE];
+    size_t head;
+    size_t tail;
+};
+
+/* One OUT/IN endpoint pair as seen by the firmware */
+struct usb_sim_endpoint {
+    GenericCallback sent_callback;
+    HostOutBufferFunction buffer_callback;
+    HostOutFunction recv_callback;
+    bool paused;
+};
+
+static struct usb_sim_endpoint hid_endpoint;
+static struct usb_sim_endpoint bulk_endpoint;
+
+static struct usb_sim_queue hid_in_queue;
+static struct usb_sim_queue bulk_in_queue;
+static struct usb_sim_queue trace_in_queue;
+
+/* HID reports posted by the host, waiting for the USB interrupt */
+static struct usb_sim_queue hid_out_queue;
+static bool interrupts_enabled;
+static bool interrupts_masked;
+static uint32_t dropped_packets;
+
+static bool usb_sim_queue_put(struct usb_sim_queue* queue,
+                              const uint8_t* packet, size_t len) {
+    size_t next_tail = (queue->tail + 1) % USB_SIM_IN_QUEUE_SIZE;
+    if (next_tail == queue->head || len > USB_SIM_REPORT_SIZE) {
+        return false;
+    }
+
+    memset(queue->packets[queue->tail], 0, USB_SIM_REPORT_SIZE);
+    memcpy(queue->packets[queue->tail], packet, len);
+    queue->lengths[queue->tail] = len;
+    queue->tail = next_tail;
+    return true;
+}
+
+static bool usb_sim_queue_get(struct usb_sim_queue* queue,
+                              uint8_t* packet, size_t* len) {
+    if (queue->head == queue->tail) {
+        return false;
+    }
+
+    memcpy(packet, queue->packets[queue->head], USB_SIM_REPORT_SIZE);
+    *len = queue->lengths[queue->head];
+    queue->head = (queue->head + 1) % USB_SIM_IN_QUEUE_SIZE;
+    return true;
+}
+
+/* An OUT transaction the endpoint accepted (i.e. did not NAK) */
+static bool usb_sim_deliver(struct usb_sim_endpoint* endpoint,
+                            const uint8_t* packet, size_t len) {
+    uint8_t* buf;
+
+    if (endpoint->paused || !endpoint->buffer_callback) {
+        return false;
+    }
+
+    buf = endpoint->buffer_callback();
+    if (buf == NULL) {
+        dropped_packets++;
+        return true;
+    }
+
+    memcpy(buf, packet, len);
+    if (endpoint->recv_callback) {
+        endpoint->recv_callback(buf, (uint16_t)len);
+    }
+    return true;
+}
+
+/* The host collected an IN packet, freeing up the endpoint */
+static void usb_sim_in_complete(struct usb_sim_endpoint* endpoint) {
+    if (interrupts_enabled && !interrupts_masked && endpoint->sent_callback) {
+        endpoint->sent_callback();
+    }
+}
+
+void hid_setup(usbd_device* usbd_dev,
+               GenericCallback report_sent_cb,
+               HostOutBufferFunction report_buffer_cb,
+               HostOutFunction report_recv_cb) {
+    (void)usbd_dev;
+    hid_endpoint.sent_callback = report_sent_cb;
+    hid_endpoint.buffer_callback = report_buffer_cb;
+    hid_endpoint.recv_callback = report_recv_cb;
+}
+
+bool hid_send_report(const uint8_t* report, size_t len) {
+    return usb_sim_queue_put(&hid_in_queue, report, len);
+}
+
+void hid_pause_receive(bool pause) {
+    hid_endpoint.paused = pause;
+}
+
+void bulk_setup(usbd_device* usbd_dev,
+                GenericCallback packet_sent_cb,
+                HostOutBufferFunction packet_buffer_cb,
+                HostOutFunction packet_recv_cb) {
+    (void)usbd_dev;
+    bulk_endpoint.sent_callback = packet_sent_cb;
+    bulk_endpoint.buffer_callback = packet_buffer_cb;
+    bulk_endpoint.recv_callback = packet_recv_cb;
+}
+
+bool bulk_send_packet(const uint8_t* packet, size_t len) {
+    return usb_sim_queue_put(&bulk_in_queue, packet, len);
+}
+
+void bulk_pause_receive(bool pause) {
+    bulk_endpoint.paused = pause;
+}
+
+bool bulk_send_trace(const uint8_t* data, size_t len) {
+    return usb_sim_queue_put(&trace_in_queue, data, len);
+}
+
+void usb_sim_reset(void) {
+    memset(&hid_in_queue, 0, sizeof(hid_in_queue));
+    memset(&bulk_in_queue, 0, sizeof(bulk_in_queue));
+    memset(&trace_in_queue, 0, sizeof(trace_in_queue));
+    memset(&hid_out_queue, 0, sizeof(hid_out_queue));
+    dropped_packets = 0;
+}
+
+void cmp_usb_enable_interrupts(void) {
+    interrupts_enabled = true;
+}
+
+void cmp_usb_disable_interrupts(void) {
+    interrupts_enabled = false;
+}
+
+/* PRIMASK */
+uint32_t cm_mask_interrupts(uint32_t mask) {
+    uint32_t previous = interrupts_masked ? 1 : 0;
+    interrupts_masked = (mask != 0);
+    return previous;
+}
+
+bool usb_sim_host_write(const uint8_t* report, size_t len) {
+    uint8_t packet[USB_SIM_REPORT_SIZE];
+
+    memset(packet, 0, sizeof(packet));
+    memcpy(packet, report, len);
+    return usb_sim_deliver(&hid_endpoint, packet, USB_SIM_REPORT_SIZE);
+}
+
+bool usb_sim_host_read(uint8_t* report) {
+    size_t len;
+
+    if (!usb_sim_queue_get(&hid_in_queue, report, &len)) {
+        return false;
+    }
+
+    usb_sim_in_complete(&hid_endpoint);
+    return true;
+}
+
+bool usb_sim_host_write_bulk(const uint8_t* packet, size_t len) {
+    return usb_sim_deliver(&bulk_endpoint, packet, len);
+}
+
+bool usb_sim_host_read_bulk(uint8_t* packet, size_t* len) {
+    if (!usb_sim_queue_get(&bulk_in_queue, packet, len)) {
+        return false;
+    }
+
+    usb_sim_in_complete(&bulk_endpoint);
+    return true;
+}
+
+bool usb_sim_host_read_trace(uint8_t* packet, size_t* len) {
+    return usb_sim_queue_get(&trace_in_queue, packet, len);
+}
+
+bool usb_sim_host_post(const uint8_t* report, size_t len) {
+    return usb_sim_queue_put(&hid_out_queue, report, len);
+}
+
+size_t usb_sim_host_pending(void) {
+    return (hid_out_queue.tail + USB_SIM_IN_QUEUE_SIZE - hid_out_queue.head)
+           % USB_SIM_IN_QUEUE_SIZE;
+}
+
+uint32_t usb_sim_host_dropped(void) {
+    return dropped_packets;
+}
+
+/* Deliver one posted report, unless the endpoint is NAKing */
+void usb_sim_interrupt(void) {
+    uint8_t packet[USB_SIM_REPORT_SIZE];
+    size_t len;
+
+    if (!interrupts_enabled || interrupts_masked || hid_endpoint.paused
+        || hid_out_queue.head == hid_out_queue.tail) {
+        return;
+    }
+
+    usb_sim_queue_get(&hid_out_queue, packet, &len);
+    usb_sim_deliver(&hid_endpoint, packet, USB_SIM_REPORT_SIZE);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef USB_SIM_H_INCLUDED
+#define USB_SIM_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Host side of the simulated HID and bulk endpoint pairs and the SWO
+ * trace endpoint. Packets written by the "host" are delivered straight
+ * to the callbacks registered through hid_setup() or bulk_setup(),
+ * unless the firmware is NAKing that endpoint, in which case the write
+ * fails; packets sent by the firmware are queued until they are
+ * collected by the host, which also counts as IN completion.
+ *
+ * Reports posted with usb_sim_host_post() instead wait until the
+ * simulated USB interrupt runs, one report per usb_sim_interrupt()
+ * call, and only while the firmware has the interrupt enabled and
+ * interrupts are not masked with cm_mask_interrupts().
+ */
+
+#define USB_SIM_REPORT_SIZE     64
+#define USB_SIM_IN_QUEUE_SIZE   32
+
+extern void usb_sim_reset(void);
+extern bool usb_sim_host_write(const uint8_t* report, size_t len);
+extern bool usb_sim_host_read(uint8_t* report);
+extern bool usb_sim_host_write_bulk(const uint8_t* packet, size_t len);
+extern bool usb_sim_host_read_bulk(uint8_t* packet, size_t* len);
+extern bool usb_sim_host_read_trace(uint8_t* packet, size_t* len);
+
+extern bool usb_sim_host_post(const uint8_t* report, size_t len);
+extern size_t usb_sim_host_pending(void);
+extern uint32_t usb_sim_host_dropped(void);
+extern void usb_sim_interrupt(void);
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <libopencm3/cm3/cortex.h>
+
+#include "sched.h"
+#include "tick.h"
+
+static volatile uint32_t sched_pending = 0;
+
+void sched_post(uint32_t events) {
+    uint32_t masked = cm_mask_interrupts(1);
+    sched_pending |= events;
+    cm_mask_interrupts(masked);
+}
+
+static uint32_t sched_take(void) {
+    uint32_t masked = cm_mask_interrupts(1);
+    uint32_t events = sched_pending;
+    sched_pending = 0;
+    cm_mask_interrupts(masked);
+
+    return events;
+}
+
+/* WFI still wakes up for an interrupt that arrives while they are
+   masked, so an event posted after the check isn't slept through */
+static void sched_idle(void) {
+    cm_disable_interrupts();
+    if (sched_pending == 0) {
+        __asm__ volatile ("wfi");
+    }
+    cm_enable_interrupts();
+}
+
+void sched_run(struct sched_task* tasks, size_t num_tasks) {
+    uint32_t events = sched_take();
+    bool busy = false;
+    size_t i;
+
+    for (i = 0; i < num_tasks; i++) {
+        struct sched_task* task = &tasks[i];
+        if (!task->busy && (task->events & events) == 0) {
+            continue;
+        }
+
+        /* A task gets at least one call, then more while it has work
+           left and its budget isn't used up */
+        uint32_t start = get_micros();
+        do {
+            task->busy = task->run();
+        } while (task->busy && (get_micros() - start) < task->budget_us);
+
+        busy = busy || task->busy;
+    }
+
+    if (!busy) {
+        sched_idle();
+    }
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef SCHED_H_INCLUDED
+#define SCHED_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+  A small cooperative scheduler for the main loop. Interrupt handlers
+  post events; each round runs the tasks waiting for one of the events
+  posted since the last round, plus any task that still had work left
+  after its previous turn. When no task has work left, the CPU sleeps
+  until the next interrupt.
+*/
+
+#define SCHED_EVENT_USB     (1U << 0)   /* USB interrupt */
+#define SCHED_EVENT_UART    (1U << 1)   /* Console USART or its DMA */
+#define SCHED_EVENT_TICK    (1U << 2)   /* Millisecond SysTick */
+#define SCHED_EVENT_VCDC    (1U << 3)   /* Data queued for the virtual CDC port */
+
+/* Returns true if the task has more work to do right away */
+typedef bool (*SchedTaskFunction)(void);
+
+struct sched_task {
+    SchedTaskFunction run;
+    uint32_t events;        /* Events that wake the task */
+    uint32_t budget_us;     /* How long it may keep the CPU per round */
+    bool busy;              /* It had work left at the end of its turn */
+};
+
+/* Safe to call from interrupt handlers */
+extern void sched_post(uint32_t events);
+
+/* Runs one round of the tasks, in order, and sleeps if none of them
+   has work left and no event is pending */
+extern void sched_run(struct sched_task* tasks, size_t num_tasks);
+
+#endif
@@ -60,6 +60,7 @@ Provides definitions about:
 */
 
 #include <libopencm3/stm32/gpio.h>
+#include "config.h"
 
 // Board configuration options
 
@@ -75,10 +76,32 @@ Provides definitions about:
 /// required.
 #define IO_PORT_WRITE_CYCLES    2               ///< I/O Cycles: 2=default, 1=Cortex-M0+ fast I/0
 
+/// Time the SWCLK delay loops against SysTick at startup, so that the clock reported for
+/// them includes the loop overhead. Without it, the nominal CPU_CLOCK/(2*cycles) is used.
+#define SWJ_CLOCK_CALIBRATE     1               ///< Measured delay loops: 1 = enabled, 0 = nominal
+
 /// Indicate that Serial Wire Debug (SWD) communication mode is available at the Debug Access Port.
 /// This information is returned by the command \ref DAP_Info as part of <b>Capabilities</b>.
 #define DAP_SWD                 1               ///< SWD Mode:  1 = available, 0 = not available
 
+/// Shift the SWD packet request and data phases with the SPI peripheral instead of
+/// bit-banging every bit. Not available on this board: SWCLK (PA6) and SWDIO (PA5)
+/// are wired to SPI1 MISO and SCK, the wrong way around for an SPI master.
+#define DAP_SWD_SPI             0               ///< SWD over SPI: 1 = enabled, 0 = bit-bang only
+
+/// Pace the SWD transfers with a hardware timer at clocks the paced loop keeps up with,
+/// which generates the requested SWCLK exactly (rounded down to the timer resolution)
+/// rather than approximating it with delay loops. The fastest paced clock follows from the
+/// loop overhead SWJ_CalibrateClock() measures at startup, so this needs
+/// SWJ_CLOCK_CALIBRATE. Faster clocks, SWJ sequences and JTAG still use the delay loops.
+/// Off until the paced loop has been checked on a scope on this MCU.
+#define DAP_SWD_TIMER           0               ///< SWD timer pacing: 1 = enabled, 0 = delay loops only
+
+/// Skip DAP_Transfer writes to DP SELECT and AP CSW/TAR that would not change them. The
+/// probe follows what was last written (and TAR auto-increment); vendor command 0x89
+/// turns it off for APs where writing the same value again has side effects.
+#define DAP_SWD_CACHE           1               ///< SWD register cache: 1 = enabled, 0 = disabled
+
 /// Indicate that JTAG communication mode is available at the Debug Port.
 /// This information is returned by the command \ref DAP_Info as part of <b>Capabilities</b>.
 #if defined(CONF_JTAG)
@@ -113,6 +136,21 @@ Provides definitions about:
 
 #define DAP_PACKET_QUEUE_SIZE (DAP_PACKET_COUNT+8)
 
+/// Indicate that UART Serial Wire Output (SWO) trace is available.
+/// This information is returned by the command \ref DAP_Info as part of <b>Capabilities</b>.
+#define SWO_UART                SWO_AVAILABLE   ///< SWO UART:  1 = available, 0 = not available
+
+/// SWO Trace Buffer Size.
+#define SWO_BUFFER_SIZE         512             ///< SWO Trace Buffer Size in bytes (must be 2^n)
+
+/// SWO Streaming Trace on the third endpoint of the CMSIS-DAP v2 bulk interface.
+#define SWO_STREAM              (SWO_UART && DAP_BULK_AVAILABLE)
+
+/// Clock frequency of the Test Domain Timer, whose value is returned with transfers that
+/// request a timestamp. The timer counts CPU cycles with SysTick, which is cheap enough
+/// to latch in the middle of a transfer without stretching SWCLK.
+#define TIMESTAMP_CLOCK         CPU_CLOCK       ///< Timestamp clock in Hz (0 = timestamps not supported).
+
 /// Debug Unit is connected to fixed Target Device.
 /// The Debug Unit may be part of an evaluation board and always connected to a fixed
 /// known device.  In this case a Device Vendor and Device Name string is stored which
@@ -224,6 +262,63 @@ static __inline void     PIN_SWDIO_OUT_DISABLE (void)
   GPIOA_MODER &= ~( (0x3 << (PIN_SWDIO_BITPOS << 1)) );
 }
 
+#if (DAP_SWD_TIMER != 0)
+/*
+SWD bit timing paced by TIM14. The timer overflows once per half SWCLK period
+and the transfer loop waits for every overflow before the next edge.
+*/
+
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/timer.h>
+
+#define SWD_TIMER               TIM14
+#define SWD_TIMER_CLOCK         CPU_CLOCK       // APB, not divided
+
+static __inline void SWD_TIMER_SETUP (void)
+{
+  rcc_periph_clock_enable(RCC_TIM14);
+  TIM_CR1(SWD_TIMER) = TIM_CR1_URS | TIM_CR1_CEN;
+}
+
+// Program a half SWCLK period of at least the given number of timer clocks,
+// using the prescaler for periods beyond 16 bits. Returns the period set.
+static __inline uint32_t SWD_TIMER_SET_PERIOD (uint32_t ticks)
+{
+  uint32_t psc = (ticks - 1) >> 16;
+  uint32_t arr = (ticks + psc) / (psc + 1);
+
+  TIM_PSC(SWD_TIMER) = psc;
+  TIM_ARR(SWD_TIMER) = arr - 1;
+  TIM_EGR(SWD_TIMER) = TIM_EGR_UG;
+  return (psc + 1) * arr;
+}
+
+// Restart the half period count at the start of a transfer
+static __inline void SWD_TIMER_START (void)
+{
+  TIM_EGR(SWD_TIMER) = TIM_EGR_UG;
+  TIM_SR(SWD_TIMER)  = ~TIM_SR_UIF;
+}
+
+// Wait for the end of the current half period
+static __inline void SWD_TIMER_WAIT (void)
+{
+  while (!(TIM_SR(SWD_TIMER) & TIM_SR_UIF));
+  TIM_SR(SWD_TIMER) = ~TIM_SR_UIF;
+}
+
+#endif
+
+#if (TIMESTAMP_CLOCK != 0)
+#include "tick.h"
+
+// Current value of the Test Domain Timer
+static __inline uint32_t TIMESTAMP_GET (void)
+{
+  return get_cycles();
+}
+#endif
+
 /*
 JTAG-only functionality (not used in this application)
 */
@@ -294,6 +389,9 @@ static __inline void DAP_SETUP (void) {
 
   GPIOB_MODER &= ~( (0x3 << (PIN_nRESET_BITPOS << 1)) );
   GPIOB_MODER |=  ( (0x1 << (PIN_nRESET_BITPOS << 1)) );
+#if (DAP_SWD_TIMER != 0)
+  SWD_TIMER_SETUP();
+#endif
 }
 
 static __inline uint32_t RESET_TARGET (void) { return 0; }
@@ -28,9 +28,46 @@
 #define VCDC_AVAILABLE 1
 #define VCDC_TX_BUFFER_SIZE 256
 #define VCDC_RX_BUFFER_SIZE 256
+/* Longest a partly filled IN packet waits for more data, in ms */
+#define VCDC_LATENCY_MS 2
+
+/* On-probe SEGGER RTT polling, piped to the virtual CDC port */
+#define RTT_AVAILABLE 1
+
+/* Command and transfer counters, read out with a DAP vendor command */
+#define DAP_STATS_AVAILABLE 1
+
+/* Probe-side search for the fastest error-free SWD clock */
+#define DAP_CLOCK_TUNE_AVAILABLE 1
+
+/* Memory reads by address with probe-side TAR handling */
+#define DAP_BLOCK_READ_AVAILABLE 1
+
+/* Flash programming with a flash algorithm run by the probe. A call
+   still running after DAP_FLASH_TIMEOUT_MS is taken to have hung or
+   faulted, and the core is halted. */
+#define DAP_FLASH_AVAILABLE 1
+#define DAP_FLASH_TIMEOUT_MS 5000
+
+/* CRC-32 of target memory, computed on the probe or the target */
+#define DAP_CRC_AVAILABLE 1
+
+/* Switching between SWD multi-drop targets, keeping their DP state */
+#define DAP_MULTIDROP_AVAILABLE 1
+
+/* DAP traffic capture for replaying, drained to the virtual CDC port */
+#define DAP_CAPTURE_AVAILABLE 1
+#define DAP_CAPTURE_BUFFER_SIZE 512
+
+/* No endpoints left for mass storage beside the virtual CDC port */
+#define MSD_AVAILABLE 0
 
 #define CDC_AVAILABLE 1
 #define DEFAULT_BAUDRATE 115200
+/* Longest a partly filled IN packet waits for more UART data, in ms */
+#define CDC_LATENCY_MS 2
+
+#define DAP_BULK_AVAILABLE 1
 
 #define CONSOLE_USART USART2
 #define CONSOLE_TX_BUFFER_SIZE 128
@@ -45,6 +82,26 @@
 #define CONSOLE_USART_IRQ_NAME  usart2_isr
 #define CONSOLE_USART_NVIC_LINE NVIC_USART2_IRQ
 
+/* USART2 requests are fixed to channels 4 (TX) and 5 (RX) */
+#define CONSOLE_DMA DMA1
+#define CONSOLE_DMA_CLOCK RCC_DMA
+#define CONSOLE_RX_DMA_CHANNEL DMA_CHANNEL5
+#define CONSOLE_TX_DMA_CHANNEL DMA_CHANNEL4
+#define CONSOLE_DMA_IRQ_NAME dma1_channel4_5_isr
+#define CONSOLE_DMA_NVIC_LINE NVIC_DMA1_CHANNEL4_5_IRQ
+
+#define USB_IRQ_NAME            usb_isr
+#define USB_NVIC_LINE           NVIC_USB_IRQ
+
+/* SWO capture borrows the serial bridge's UART; connect SWO to RX (PA3) */
+#define SWO_AVAILABLE 1
+#define SWO_USART CONSOLE_USART
+#define SWO_USART_CLOCK_FREQ rcc_apb1_frequency
+#define SWO_DMA CONSOLE_DMA
+#define SWO_DMA_CLOCK CONSOLE_DMA_CLOCK
+#define SWO_DMA_CHANNEL CONSOLE_RX_DMA_CHANNEL
+#define SWO_DMA_NVIC_LINE CONSOLE_DMA_NVIC_LINE
+
 #define DFU_AVAILABLE 1
 #define nBOOT0_GPIO_CLOCK RCC_GPIOF
 #define nBOOT0_GPIO_PORT GPIOF
@@ -68,6 +125,10 @@
 #define USART_SR_TXE USART_ISR_TXE
 #endif
 
+#ifndef USART_SR_IDLE
+#define USART_SR_IDLE USART_ISR_IDLE
+#endif
+
 /* Word size for usart_recv and usart_send */
 typedef uint8_t usart_word_t;
 
@@ -76,10 +76,32 @@ Provides definitions about:
 /// required.
 #define IO_PORT_WRITE_CYCLES    2               ///< I/O Cycles: 2=default, 1=Cortex-M0+ fast I/0
 
+/// Time the SWCLK delay loops against SysTick at startup, so that the clock reported for
+/// them includes the loop overhead. Without it, the nominal CPU_CLOCK/(2*cycles) is used.
+#define SWJ_CLOCK_CALIBRATE     1               ///< Measured delay loops: 1 = enabled, 0 = nominal
+
 /// Indicate that Serial Wire Debug (SWD) communication mode is available at the Debug Access Port.
 /// This information is returned by the command \ref DAP_Info as part of <b>Capabilities</b>.
 #define DAP_SWD                 1               ///< SWD Mode:  1 = available, 0 = not available
 
+/// Shift the SWD packet request and data phases with the SPI peripheral instead of
+/// bit-banging every bit. SWCLK (PB13) is SPI2 SCK and SWDIO (PB14) is SPI2 MISO;
+/// enabling this also requires SPI2 MOSI (PB15) to be bridged to SWDIO.
+#define DAP_SWD_SPI             0               ///< SWD over SPI: 1 = enabled, 0 = bit-bang only
+
+/// Pace the SWD transfers with a hardware timer at clocks the paced loop keeps up with,
+/// which generates the requested SWCLK exactly (rounded down to the timer resolution)
+/// rather than approximating it with delay loops. The fastest paced clock follows from the
+/// loop overhead SWJ_CalibrateClock() measures at startup, so this needs
+/// SWJ_CLOCK_CALIBRATE. Faster clocks, SWJ sequences and JTAG still use the delay loops.
+/// Off until the paced loop has been checked on a scope on this MCU.
+#define DAP_SWD_TIMER           0               ///< SWD timer pacing: 1 = enabled, 0 = delay loops only
+
+/// Skip DAP_Transfer writes to DP SELECT and AP CSW/TAR that would not change them. The
+/// probe follows what was last written (and TAR auto-increment); vendor command 0x89
+/// turns it off for APs where writing the same value again has side effects.
+#define DAP_SWD_CACHE           1               ///< SWD register cache: 1 = enabled, 0 = disabled
+
 /// Indicate that JTAG communication mode is available at the Debug Port.
 /// This information is returned by the command \ref DAP_Info as part of <b>Capabilities</b>.
 #if defined(CONF_JTAG)
@@ -114,6 +136,21 @@ Provides definitions about:
 
 #define DAP_PACKET_QUEUE_SIZE (DAP_PACKET_COUNT+8)
 
+/// Indicate that UART Serial Wire Output (SWO) trace is available.
+/// This information is returned by the command \ref DAP_Info as part of <b>Capabilities</b>.
+#define SWO_UART                SWO_AVAILABLE   ///< SWO UART:  1 = available, 0 = not available
+
+/// SWO Trace Buffer Size.
+#define SWO_BUFFER_SIZE         4096            ///< SWO Trace Buffer Size in bytes (must be 2^n)
+
+/// SWO Streaming Trace on the third endpoint of the CMSIS-DAP v2 bulk interface.
+#define SWO_STREAM              (SWO_UART && DAP_BULK_AVAILABLE)
+
+/// Clock frequency of the Test Domain Timer, whose value is returned with transfers that
+/// request a timestamp. The timer counts CPU cycles with SysTick, which is cheap enough
+/// to latch in the middle of a transfer without stretching SWCLK.
+#define TIMESTAMP_CLOCK         CPU_CLOCK       ///< Timestamp clock in Hz (0 = timestamps not supported).
+
 /// Debug Unit is connected to fixed Target Device.
 /// The Debug Unit may be part of an evaluation board and always connected to a fixed
 /// known device.  In this case a Device Vendor and Device Name string is stored which
@@ -233,6 +270,150 @@ static __inline void     PIN_SWDIO_OUT_DISABLE (void)
 #endif
 }
 
+#if (DAP_SWD_SPI != 0)
+/*
+SWD data phases shifted by SPI2 in mode 3 (SCK idles high, data sampled on the
+rising edge), LSB first. The pins are only handed to the SPI while it shifts.
+*/
+
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/spi.h>
+
+#define SWD_SPI                 SPI2
+#define SWD_SPI_PCLK            (CPU_CLOCK/2)   // APB1
+#define SWD_SPI_MOSI_GPIO_PORT  GPIOB
+#define SWD_SPI_MOSI_GPIO_PIN   GPIO15
+
+#define SWD_SPI_CR1             (SPI_CR1_MSTR | SPI_CR1_SSM | SPI_CR1_SSI | \
+                                 SPI_CR1_LSBFIRST | SPI_CR1_CPOL | SPI_CR1_CPHA)
+#define SWD_SPI_CR1_BR_SHIFT    3
+
+static __inline void SWD_SPI_SETUP (void)
+{
+  rcc_periph_clock_enable(RCC_SPI2);
+  SPI_CR1(SWD_SPI) = SWD_SPI_CR1;
+}
+
+// Select the fastest SPI clock that does not exceed the requested clock.
+// Returns 0 if the clock is too slow for the SPI, so the data phases
+// fall back to bit-banging.
+static __inline uint32_t SWD_SPI_SET_CLOCK (uint32_t clock)
+{
+  uint32_t br = 0;
+
+  while ((SWD_SPI_PCLK >> (br + 1)) > clock) {
+    if (++br > 7) {
+      return 0;
+    }
+  }
+
+  SPI_CR1(SWD_SPI) = SWD_SPI_CR1 | (br << SWD_SPI_CR1_BR_SHIFT);
+  return 1;
+}
+
+static __inline uint32_t SWD_SPI_SHIFT (uint32_t frame)
+{
+  SPI_DR(SWD_SPI) = frame;
+  while (!(SPI_SR(SWD_SPI) & SPI_SR_RXNE));
+  return SPI_DR(SWD_SPI);
+}
+
+static __inline uint32_t SWD_SPI_TRANSFER (uint32_t data, uint32_t bits)
+{
+  uint32_t val;
+
+  gpio_set_mode(SWCLK_GPIO_PORT, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_ALTFN_PUSHPULL, SWCLK_GPIO_PIN);
+  if (bits == 8) {
+    SPI_CR1(SWD_SPI) |= SPI_CR1_SPE;
+    val  = SWD_SPI_SHIFT(data & 0xFF);
+  } else {
+    SPI_CR1(SWD_SPI) |= SPI_CR1_DFF;
+    SPI_CR1(SWD_SPI) |= SPI_CR1_SPE;
+    val  = SWD_SPI_SHIFT(data & 0xFFFF);
+    val |= SWD_SPI_SHIFT(data >> 16) << 16;
+  }
+  while (SPI_SR(SWD_SPI) & SPI_SR_BSY);
+  SPI_CR1(SWD_SPI) &= ~(SPI_CR1_SPE | SPI_CR1_DFF);
+  gpio_set_mode(SWCLK_GPIO_PORT, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_PUSHPULL, SWCLK_GPIO_PIN);
+
+  return val;
+}
+
+// Shift out 8 or 32 bits; SWDIO is left as a GPIO output
+static __inline void SWD_SPI_WRITE (uint32_t data, uint32_t bits)
+{
+  PIN_SWDIO_OUT_DISABLE();
+  gpio_set_mode(SWD_SPI_MOSI_GPIO_PORT, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_ALTFN_PUSHPULL, SWD_SPI_MOSI_GPIO_PIN);
+  SWD_SPI_TRANSFER(data, bits);
+  gpio_set_mode(SWD_SPI_MOSI_GPIO_PORT, GPIO_MODE_INPUT, GPIO_CNF_INPUT_FLOAT, SWD_SPI_MOSI_GPIO_PIN);
+  PIN_SWDIO_OUT_ENABLE();
+}
+
+// Shift in 8 or 32 bits; SWDIO must already be released by the probe
+static __inline uint32_t SWD_SPI_READ (uint32_t bits)
+{
+  return SWD_SPI_TRANSFER(0, bits);
+}
+
+#endif
+
+#if (DAP_SWD_TIMER != 0)
+/*
+SWD bit timing paced by TIM4. The timer overflows once per half SWCLK period
+and the transfer loop waits for every overflow before the next edge.
+*/
+
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/timer.h>
+
+#define SWD_TIMER               TIM4
+#define SWD_TIMER_CLOCK         CPU_CLOCK       // APB1 timers run at 2x PCLK1
+
+static __inline void SWD_TIMER_SETUP (void)
+{
+  rcc_periph_clock_enable(RCC_TIM4);
+  TIM_CR1(SWD_TIMER) = TIM_CR1_URS | TIM_CR1_CEN;
+}
+
+// Program a half SWCLK period of at least the given number of timer clocks,
+// using the prescaler for periods beyond 16 bits. Returns the period set.
+static __inline uint32_t SWD_TIMER_SET_PERIOD (uint32_t ticks)
+{
+  uint32_t psc = (ticks - 1) >> 16;
+  uint32_t arr = (ticks + psc) / (psc + 1);
+
+  TIM_PSC(SWD_TIMER) = psc;
+  TIM_ARR(SWD_TIMER) = arr - 1;
+  TIM_EGR(SWD_TIMER) = TIM_EGR_UG;
+  return (psc + 1) * arr;
+}
+
+// Restart the half period count at the start of a transfer
+static __inline void SWD_TIMER_START (void)
+{
+  TIM_EGR(SWD_TIMER) = TIM_EGR_UG;
+  TIM_SR(SWD_TIMER)  = ~TIM_SR_UIF;
+}
+
+// Wait for the end of the current half period
+static __inline void SWD_TIMER_WAIT (void)
+{
+  while (!(TIM_SR(SWD_TIMER) & TIM_SR_UIF));
+  TIM_SR(SWD_TIMER) = ~TIM_SR_UIF;
+}
+
+#endif
+
+#if (TIMESTAMP_CLOCK != 0)
+#include "tick.h"
+
+// Current value of the Test Domain Timer
+static __inline uint32_t TIMESTAMP_GET (void)
+{
+  return get_cycles();
+}
+#endif
+
 /*
 JTAG-only functionality (not used in this application)
 */
@@ -300,6 +481,13 @@ static __inline void DAP_SETUP (void) {
   // Configure nRESET as an open-drain output
   GPIO_BSRR(nRESET_GPIO_PORT) = nRESET_GPIO_PIN;
   gpio_set_mode(nRESET_GPIO_PORT, GPIO_MODE_OUTPUT_2_MHZ, GPIO_CNF_OUTPUT_OPENDRAIN, nRESET_GPIO_PIN);
+
+#if (DAP_SWD_SPI != 0)
+  SWD_SPI_SETUP();
+#endif
+#if (DAP_SWD_TIMER != 0)
+  SWD_TIMER_SETUP();
+#endif
 }
 
 static __inline uint32_t RESET_TARGET (void) { return 0; }
@@ -27,9 +27,47 @@
 #define VCDC_AVAILABLE 1
 #define VCDC_TX_BUFFER_SIZE 128
 #define VCDC_RX_BUFFER_SIZE 128
+/* Longest a partly filled IN packet waits for more data, in ms */
+#define VCDC_LATENCY_MS 2
+
+/* On-probe SEGGER RTT polling, piped to the virtual CDC port */
+#define RTT_AVAILABLE 1
+
+/* Command and transfer counters, read out with a DAP vendor command */
+#define DAP_STATS_AVAILABLE 1
+
+/* Probe-side search for the fastest error-free SWD clock */
+#define DAP_CLOCK_TUNE_AVAILABLE 1
+
+/* Memory reads by address with probe-side TAR handling */
+#define DAP_BLOCK_READ_AVAILABLE 1
+
+/* Flash programming with a flash algorithm run by the probe. A call
+   still running after DAP_FLASH_TIMEOUT_MS is taken to have hung or
+   faulted, and the core is halted. */
+#define DAP_FLASH_AVAILABLE 1
+#define DAP_FLASH_TIMEOUT_MS 5000
+
+/* CRC-32 of target memory, computed on the probe or the target */
+#define DAP_CRC_AVAILABLE 1
+
+/* Switching between SWD multi-drop targets, keeping their DP state */
+#define DAP_MULTIDROP_AVAILABLE 1
+
+/* DAP traffic capture for replaying, drained to the virtual CDC port */
+#define DAP_CAPTURE_AVAILABLE 1
+#define DAP_CAPTURE_BUFFER_SIZE 2048
+
+/* Not enough packet memory left for the mass storage endpoints */
+#define MSD_AVAILABLE 0
 
 #define CDC_AVAILABLE 1
 #define DEFAULT_BAUDRATE 115200
+/* Longest a partly filled IN packet waits for more UART data, in ms */
+#define CDC_LATENCY_MS 2
+
+/* Not enough packet memory left for another pair of bulk endpoints */
+#define DAP_BULK_AVAILABLE 0
 
 #define CONSOLE_USART USART3
 #define CONSOLE_TX_BUFFER_SIZE 128
@@ -46,6 +84,27 @@
 #define CONSOLE_USART_IRQ_NAME  usart3_isr
 #define CONSOLE_USART_NVIC_LINE NVIC_USART3_IRQ
 
+#define CONSOLE_DMA DMA1
+#define CONSOLE_DMA_CLOCK RCC_DMA1
+#define CONSOLE_RX_DMA_CHANNEL DMA_CHANNEL3
+#define CONSOLE_TX_DMA_CHANNEL DMA_CHANNEL2
+#define CONSOLE_DMA_IRQ_NAME dma1_channel3_isr
+#define CONSOLE_DMA_NVIC_LINE NVIC_DMA1_CHANNEL3_IRQ
+#define CONSOLE_TX_DMA_IRQ_NAME dma1_channel2_isr
+#define CONSOLE_TX_DMA_NVIC_LINE NVIC_DMA1_CHANNEL2_IRQ
+
+#define USB_IRQ_NAME            usb_lp_can_rx0_isr
+#define USB_NVIC_LINE           NVIC_USB_LP_CAN_RX0_IRQ
+
+/* SWO capture borrows the serial bridge's UART; connect SWO to PB11 */
+#define SWO_AVAILABLE 1
+#define SWO_USART CONSOLE_USART
+#define SWO_USART_CLOCK_FREQ rcc_apb1_frequency
+#define SWO_DMA CONSOLE_DMA
+#define SWO_DMA_CLOCK CONSOLE_DMA_CLOCK
+#define SWO_DMA_CHANNEL CONSOLE_RX_DMA_CHANNEL
+#define SWO_DMA_NVIC_LINE CONSOLE_DMA_NVIC_LINE
+
 /* Word size for usart_recv and usart_send */
 typedef uint16_t usart_word_t;
 
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <libopencm3/cm3/nvic.h>
+#include <libopencm3/stm32/dma.h>
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/usart.h>
+
+#include "config.h"
+#include "console.h"
+#include "target.h"
+#include "swo_uart.h"
+
+#if SWO_AVAILABLE
+
+#ifdef USART_RDR
+#define SWO_USART_RX_DATA USART_RDR(SWO_USART)
+#else
+#define SWO_USART_RX_DATA USART_DR(SWO_USART)
+#endif
+
+static uint32_t swo_baudrate_divider = 0;
+
+static uint32_t swo_buffer_size = 0;
+static volatile uint32_t swo_wraps = 0;
+static volatile bool swo_running = false;
+
+/* Serial bridge settings, restored when capture stops */
+static uint32_t saved_cr1;
+static uint32_t saved_cr2;
+static uint32_t saved_cr3;
+static uint32_t saved_brr;
+
+uint32_t swo_uart_set_baudrate(uint32_t baudrate) {
+    const uint32_t clock = SWO_USART_CLOCK_FREQ;
+
+    if (baudrate == 0) {
+        return 0;
+    }
+
+    /* 16x oversampling needs a divider of at least 16 */
+    uint32_t divider = (clock + baudrate / 2) / baudrate;
+    if (divider < 16) {
+        divider = 16;
+    } else if (divider > 0xFFFF) {
+        return 0;
+    }
+
+    swo_baudrate_divider = divider;
+    return clock / divider;
+}
+
+void swo_uart_start(uint8_t* buffer, uint32_t size) {
+    target_console_init();
+    console_suspend();
+
+    saved_cr1 = USART_CR1(SWO_USART);
+    saved_cr2 = USART_CR2(SWO_USART);
+    saved_cr3 = USART_CR3(SWO_USART);
+    saved_brr = USART_BRR(SWO_USART);
+
+    /* 8N1, receive only, no interrupts */
+    usart_disable(SWO_USART);
+    USART_CR1(SWO_USART) = USART_CR1_RE;
+    USART_CR2(SWO_USART) = 0;
+    USART_CR3(SWO_USART) = USART_CR3_DMAR;
+#ifdef USART_CR3_OVRDIS
+    /* Keep receiving even if a byte was missed */
+    USART_CR3(SWO_USART) |= USART_CR3_OVRDIS;
+#endif
+    USART_BRR(SWO_USART) = swo_baudrate_divider;
+
+    rcc_periph_clock_enable(SWO_DMA_CLOCK);
+    dma_channel_reset(SWO_DMA, SWO_DMA_CHANNEL);
+    dma_set_peripheral_address(SWO_DMA, SWO_DMA_CHANNEL,
+                               (uint32_t)&SWO_USART_RX_DATA);
+    dma_set_memory_address(SWO_DMA, SWO_DMA_CHANNEL, (uint32_t)buffer);
+    dma_set_number_of_data(SWO_DMA, SWO_DMA_CHANNEL, (uint16_t)size);
+    dma_set_read_from_peripheral(SWO_DMA, SWO_DMA_CHANNEL);
+    dma_enable_memory_increment_mode(SWO_DMA, SWO_DMA_CHANNEL);
+    dma_set_peripheral_size(SWO_DMA, SWO_DMA_CHANNEL, DMA_CCR_PSIZE_8BIT);
+    dma_set_memory_size(SWO_DMA, SWO_DMA_CHANNEL, DMA_CCR_MSIZE_8BIT);
+    dma_set_priority(SWO_DMA, SWO_DMA_CHANNEL, DMA_CCR_PL_VERY_HIGH);
+    dma_enable_circular_mode(SWO_DMA, SWO_DMA_CHANNEL);
+    dma_enable_transfer_complete_interrupt(SWO_DMA, SWO_DMA_CHANNEL);
+
+    swo_buffer_size = size;
+    swo_wraps = 0;
+    swo_running = true;
+
+    nvic_enable_irq(SWO_DMA_NVIC_LINE);
+    dma_enable_channel(SWO_DMA, SWO_DMA_CHANNEL);
+    usart_enable(SWO_USART);
+}
+
+void swo_uart_stop(void) {
+    usart_disable(SWO_USART);
+    dma_disable_channel(SWO_DMA, SWO_DMA_CHANNEL);
+    dma_clear_interrupt_flags(SWO_DMA, SWO_DMA_CHANNEL, DMA_TCIF);
+    swo_running = false;
+
+    /* Hand the UART back to the serial bridge */
+    USART_CR3(SWO_USART) = saved_cr3;
+    USART_CR2(SWO_USART) = saved_cr2;
+    USART_BRR(SWO_USART) = saved_brr;
+    USART_CR1(SWO_USART) = saved_cr1;
+    console_resume();
+}
+
+uint32_t swo_uart_count(void) {
+    uint32_t remaining;
+    uint32_t wraps;
+
+    /*
+      The transfer counter reloads when the DMA wraps around, slightly
+      before the interrupt handler counts the wrap. Retry if the counter
+      reloaded or the handler ran while we were looking.
+    */
+    do {
+        remaining = DMA_CNDTR(SWO_DMA, SWO_DMA_CHANNEL);
+        wraps = swo_wraps;
+        if (dma_get_interrupt_flag(SWO_DMA, SWO_DMA_CHANNEL, DMA_TCIF)) {
+            wraps++;
+        }
+    } while ((DMA_CNDTR(SWO_DMA, SWO_DMA_CHANNEL) > remaining)
+             || (wraps < swo_wraps));
+
+    return wraps * swo_buffer_size + (swo_buffer_size - remaining);
+}
+
+/* Called from the serial bridge's DMA interrupt while capture runs */
+void swo_uart_dma_isr(void) {
+    if (swo_running && dma_get_interrupt_flag(SWO_DMA, SWO_DMA_CHANNEL, DMA_TCIF)) {
+        dma_clear_interrupt_flags(SWO_DMA, SWO_DMA_CHANNEL, DMA_TCIF);
+        swo_wraps++;
+    }
+}
+
+#endif
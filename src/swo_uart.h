@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2026, agent
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice
+ * appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef SWO_UART_H_INCLUDED
+#define SWO_UART_H_INCLUDED
+
+#include <stdint.h>
+
+/*
+ * SWO capture in UART (NRZ) mode. While capture is running, the UART
+ * receiver and its DMA channel are borrowed from the serial bridge and
+ * DMA copies every received byte into a circular buffer without
+ * involving the CPU.
+ */
+
+/* Returns the baudrate actually achieved, or 0 if it can't be reached */
+extern uint32_t swo_uart_set_baudrate(uint32_t baudrate);
+
+/* size must be a power of two */
+extern void swo_uart_start(uint8_t* buffer, uint32_t size);
+extern void swo_uart_stop(void);
+
+/* Total number of bytes received since capture was started, modulo 2^32 */
+extern uint32_t swo_uart_count(void);
+
+/* DMA transfer-complete handling; the interrupt belongs to console.c */
+extern void swo_uart_dma_isr(void);
+
+#endif
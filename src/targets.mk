@@ -40,6 +40,11 @@ ifeq ($(TARGET),STM32F103-DFUBOOT)
 	DEFS				+= -DDFU_AVAILABLE=1
 	ARCH				= STM32F1
 endif
+ifeq ($(TARGET),HOST)
+	TARGET_COMMON_DIR	:= ./host
+	TARGET_SPEC_DIR		:= ./host
+	ARCH				= HOST
+endif
 ifndef ARCH
 $(error Unknown target $(TARGET))
 endif
@@ -19,20 +19,26 @@
 #include <libopencm3/cm3/systick.h>
 #include <libopencm3/stm32/rcc.h>
 #include <libopencm3/cm3/nvic.h>
+#include <libopencm3/cm3/scb.h>
 
 #include "tick.h"
+#include "sched.h"
 
 volatile uint32_t __ticks = 0;
 
+static uint32_t tick_period_us;
+
 void sys_tick_handler(void)
 {
     __ticks++;
+    sched_post(SCHED_EVENT_TICK);
 }
 
 bool tick_setup(uint32_t tick_freq_hz) {
     bool success = false;
 
     if (systick_set_frequency(tick_freq_hz, rcc_ahb_frequency)) {
+        tick_period_us = 1000000 / tick_freq_hz;
         systick_clear();
         systick_interrupt_enable();
         success = true;
@@ -52,3 +58,39 @@ void tick_stop(void) {
 uint32_t get_ticks(void) {
     return __ticks;
 }
+
+/* Ticks and the SysTick count in the same tick period */
+static uint32_t get_tick_value(uint32_t* value) {
+    uint32_t ticks;
+
+    /* Retry if the tick interrupt ran in between */
+    do {
+        ticks = __ticks;
+        *value = systick_get_value();
+        /* With interrupts masked, the counter may have wrapped without
+           the tick being counted yet */
+        if (SCB_ICSR & SCB_ICSR_PENDSTSET) {
+            *value = systick_get_value();
+            ticks++;
+        }
+    } while (ticks != __ticks && !(SCB_ICSR & SCB_ICSR_PENDSTSET));
+
+    return ticks;
+}
+
+uint32_t get_cycles(void) {
+    uint32_t reload = systick_get_reload();
+    uint32_t value;
+    uint32_t ticks = get_tick_value(&value);
+
+    return ticks * (reload + 1) + (reload - value);
+}
+
+uint32_t get_micros(void) {
+    uint32_t reload = systick_get_reload();
+    uint32_t value;
+    uint32_t ticks = get_tick_value(&value);
+
+    return ticks * tick_period_us
+        + (reload - value) / (rcc_ahb_frequency / 1000000);
+}
@@ -19,6 +19,9 @@
 #ifndef TICK_H_INCLUDED
 #define TICK_H_INCLUDED
 
+#include <stdbool.h>
+#include <stdint.h>
+
 extern bool tick_setup(uint32_t tick_freq_hz);
 extern void tick_start(void);
 extern void tick_stop(void);
@@ -27,4 +30,10 @@ extern volatile uint32_t __ticks;
 
 extern uint32_t get_ticks(void);
 
+/* CPU clock cycles counted by SysTick; wraps around */
+extern uint32_t get_cycles(void);
+
+/* Microseconds since tick_start(); wraps around */
+extern uint32_t get_micros(void);
+
 #endif
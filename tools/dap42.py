@@ -0,0 +1,265 @@
+#
+# Copyright (c) 2026, agent
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice
+# appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+# WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+# AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+# CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+# LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+# NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+# CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+"""Host side of the dap42 vendor commands.
+
+Requires the hidapi Python bindings (pip install hidapi). Memory reads
+use vendor command 0x85, whose responses can continue over several
+packets: every packet repeats the header, and all but the last have
+BLOCK_MORE set in the word count. Vendor command 0x86 drives the
+probe's flash programming engine, and 0x87 computes CRC-32s of target
+memory on the probe or the target. 0x88 switches between the targets
+of an SWD multi-drop bus, and 0x89 controls the probe's cache of
+SELECT, CSW and TAR. 0x8A starts and stops capturing the DAP traffic
+to the virtual serial port.
+"""
+
+import struct
+
+import hid
+
+VID = 0x1209
+PID = 0xDA42
+
+PACKET_SIZE = 64
+
+ID_DAP_VENDOR_BLOCK_READ = 0x85
+DAP_OK = 0x00
+
+BLOCK_HOST_AP = 0x01
+BLOCK_CONTINUE = 0x02
+BLOCK_MORE = 0x8000
+
+# Largest word count one 0x85 request can ask for
+BLOCK_MAX_WORDS = BLOCK_MORE - 1
+
+ID_DAP_VENDOR_FLASH = 0x86
+FLASH_SETUP = 0x00
+FLASH_WRITE = 0x01
+FLASH_CALL = 0x02
+FLASH_STATUS = 0x03
+FLASH_PAGE = 0x04
+
+FLASH_INIT = 0x00
+FLASH_UNINIT = 0x01
+FLASH_ERASE_SECTOR = 0x02
+
+FLASH_BUSY = 0x01
+FLASH_WRITE_WORDS = (PACKET_SIZE - 7) // 4
+FLASH_PAGE_WORDS = (PACKET_SIZE - 9) // 4
+
+ID_DAP_VENDOR_CRC = 0x87
+CRC_PROBE = 0x00
+CRC_TARGET = 0x01
+CRC_RESULT = 0x02
+
+CRC_BUSY = 0x01
+CRC_MAX_LENGTH = 4096
+
+# Bytes of target RAM the CRC_TARGET routine takes
+CRC_STUB_SIZE = 40
+
+ID_DAP_VENDOR_MULTIDROP = 0x88
+MULTIDROP_FORGET = 0x01
+MULTIDROP_RESTORED = 0x01
+
+ID_DAP_VENDOR_CACHE = 0x89
+CACHE_DISABLE = 0x00
+CACHE_ENABLE = 0x01
+CACHE_QUERY = 0xFF
+
+ID_DAP_VENDOR_CAPTURE = 0x8A
+CAPTURE_STOP = 0x00
+CAPTURE_START = 0x01
+CAPTURE_QUERY = 0xFF
+
+
+class ProbeError(Exception):
+    pass
+
+
+class Probe:
+    def __init__(self, serial=None):
+        self.dev = hid.device()
+        self.dev.open(VID, PID, serial)
+
+    def close(self):
+        self.dev.close()
+
+    def send(self, data):
+        # Report ID 0, then the DAP command
+        self.dev.write(bytes([0]) + bytes(data))
+
+    def receive(self, command, timeout=1000):
+        response = bytes(self.dev.read(PACKET_SIZE, timeout))
+        if len(response) < 2 or response[0] != command:
+            raise ProbeError(
+                "Probe does not support command 0x{:02X}".format(command))
+        return response
+
+    def command(self, data, timeout=1000):
+        """Send one command and check the status byte of its response"""
+        self.send(data)
+        response = self.receive(data[0], timeout)
+        if response[1] != DAP_OK:
+            raise ProbeError(
+                "Probe rejected command 0x{:02X}".format(data[0]))
+        return response
+
+    def read_words(self, address, count, flags=0):
+        """Read count words from a word-aligned address. By default the
+        debugger's SELECT, CSW and TAR are restored afterwards."""
+        data = bytearray()
+        while count > 0:
+            words = min(count, BLOCK_MAX_WORDS)
+            self.send(struct.pack("<BBIH", ID_DAP_VENDOR_BLOCK_READ, flags,
+                                  address, words))
+            chunk = self._receive_chain(address)
+            if len(chunk) != 4 * words:
+                raise ProbeError("Short read at 0x{:08X}".format(address))
+            data += chunk
+            address += 4 * words
+            count -= words
+        return bytes(data)
+
+    def read_memory(self, address, length, flags=0):
+        """Read length bytes; the address must be word-aligned"""
+        if address & 3:
+            raise ValueError("Address must be word-aligned")
+        return self.read_words(address, (length + 3) // 4, flags)[:length]
+
+    def flash_command(self, data):
+        """Send a 0x86 request; returns (status, running, result)"""
+        self.send(bytes([ID_DAP_VENDOR_FLASH]) + bytes(data))
+        response = self.receive(ID_DAP_VENDOR_FLASH)
+        if response[1] not in (DAP_OK, FLASH_BUSY):
+            raise ProbeError("Flash request 0x{:02X} failed".format(data[0]))
+        return response[1], response[2] != 0, struct.unpack_from(
+            "<I", response, 3)[0]
+
+    def flash_setup(self, breakpoint, static_base, stack_pointer, init,
+                    uninit, erase_sector, program_page, buffers, page_size):
+        self.flash_command(struct.pack(
+            "<B10I", FLASH_SETUP, breakpoint, static_base, stack_pointer,
+            init, uninit, erase_sector, program_page, buffers[0],
+            buffers[1], page_size))
+
+    def flash_load(self, address, data):
+        """Write the flash algorithm into target RAM"""
+        data = bytes(data) + bytes(-len(data) % 4)
+        for offset in range(0, len(data), 4 * FLASH_WRITE_WORDS):
+            chunk = data[offset:offset + 4 * FLASH_WRITE_WORDS]
+            self.flash_command(struct.pack("<BBI", FLASH_WRITE,
+                                           len(chunk) // 4,
+                                           address + offset) + chunk)
+
+    def flash_wait(self):
+        """Wait for the running algorithm call; returns its result"""
+        while True:
+            _, running, result = self.flash_command([FLASH_STATUS])
+            if not running:
+                return result
+
+    def flash_call(self, function, r0=0, r1=0, r2=0):
+        """Run Init, UnInit or EraseSector and return its result"""
+        self.flash_command(struct.pack("<BB3I", FLASH_CALL, function,
+                                       r0, r1, r2))
+        return self.flash_wait()
+
+    def flash_program(self, address, data, page_size):
+        """Program whole pages; the probe programs one page while the
+        next is being sent"""
+        for page in range(0, len(data), page_size):
+            chunks = range(0, page_size, 4 * FLASH_PAGE_WORDS)
+            for offset in chunks:
+                chunk = data[page + offset:
+                             page + min(offset + 4 * FLASH_PAGE_WORDS,
+                                        page_size)]
+                request = struct.pack("<BBHI", FLASH_PAGE, len(chunk) // 4,
+                                      offset, address + page) + chunk
+                status, _, result = self.flash_command(request)
+                while status == FLASH_BUSY:
+                    status, _, result = self.flash_command(request)
+                if result != 0:
+                    raise ProbeError("Programming failed before 0x{:08X}"
+                                     .format(address + page))
+        if self.flash_wait() != 0:
+            raise ProbeError("Programming the last page failed")
+
+    def crc_command(self, mode, address=0, length=0, crc=0, stub=0):
+        """Send a 0x87 request; returns (status, crc)"""
+        self.send(struct.pack("<BB4I", ID_DAP_VENDOR_CRC, mode, address,
+                              length, crc, stub))
+        response = self.receive(ID_DAP_VENDOR_CRC)
+        if response[1] not in (DAP_OK, CRC_BUSY):
+            raise ProbeError("CRC of 0x{:08X} failed".format(address))
+        return response[1], struct.unpack_from("<I", response, 2)[0]
+
+    def crc32(self, address, length):
+        """CRC-32 of target memory, as zlib.crc32(), read by the probe"""
+        crc = 0
+        for offset in range(0, length, CRC_MAX_LENGTH):
+            _, crc = self.crc_command(CRC_PROBE, address + offset,
+                                      min(CRC_MAX_LENGTH, length - offset),
+                                      crc)
+        return crc
+
+    def crc32_on_target(self, address, length, stub):
+        """The same, computed by the target core with a routine at the
+        word-aligned RAM address stub; needs the flash engine set up"""
+        status, crc = self.crc_command(CRC_TARGET, address, length, 0, stub)
+        while status == CRC_BUSY:
+            status, crc = self.crc_command(CRC_RESULT)
+        return crc
+
+    def select_target(self, targetsel, forget=False):
+        """Select a multi-drop target by its TARGETSEL value; returns
+        (restored, dpidr, ctrl_stat). When restored is True the probe
+        has put back the SELECT last used with this target, and
+        ctrl_stat is the CTRL/STAT last written to it."""
+        response = self.command(struct.pack(
+            "<BBI", ID_DAP_VENDOR_MULTIDROP,
+            MULTIDROP_FORGET if forget else 0, targetsel))
+        restored = (response[2] & MULTIDROP_RESTORED) != 0
+        dpidr, ctrl_stat = struct.unpack_from("<II", response, 3)
+        return restored, dpidr, ctrl_stat
+
+    def register_cache(self, mode=CACHE_QUERY):
+        """Turn the probe's register cache off or on, or leave it as it
+        is; returns (enabled, number of writes skipped so far)"""
+        response = self.command(bytes([ID_DAP_VENDOR_CACHE, mode]))
+        return response[2] != 0, struct.unpack_from("<I", response, 3)[0]
+
+    def capture(self, mode=CAPTURE_QUERY):
+        """Start or stop capturing the DAP traffic, or just ask; returns
+        (running, number of records dropped since the start)"""
+        response = self.command(bytes([ID_DAP_VENDOR_CAPTURE, mode]))
+        return response[2] != 0, struct.unpack_from("<I", response, 3)[0]
+
+    def _receive_chain(self, address):
+        data = bytearray()
+        more = True
+        while more:
+            response = self.receive(ID_DAP_VENDOR_BLOCK_READ)
+            header = struct.unpack_from("<H", response, 2)[0]
+            count = header & ~BLOCK_MORE
+            more = (header & BLOCK_MORE) != 0
+            data += response[4:4 + 4 * count]
+            if response[1] != DAP_OK:
+                raise ProbeError("Read failed at 0x{:08X}".format(
+                    address + len(data)))
+        return bytes(data)
@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2026, agent
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice
+# appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+# WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+# AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+# CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+# LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+# NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+# CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+"""Capture the CMSIS-DAP traffic of a debug session on a dap42.
+
+Requires the hidapi and pyserial Python modules. The probe logs every
+request and response (vendor command 0x8A) and drains the log to its
+virtual serial port, which this script saves until interrupted with
+Ctrl-C. RTT must not be running, since it uses the same port. Replay
+the capture against the simulated target with
+
+    make TARGET=HOST replay CAPTURE=FILE
+
+Run this first, then the debugger (OpenOCD, pyOCD, ...):
+
+    dap_capture.py [--serial SERIAL] PORT OUTPUT
+"""
+
+import argparse
+import sys
+import time
+
+import serial
+
+import dap42
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--serial", help="serial number of the probe")
+    parser.add_argument("port", help="virtual serial port of the probe")
+    parser.add_argument("output", help="file to write the capture to")
+    args = parser.parse_args()
+
+    port = serial.Serial(args.port, timeout=0.1)
+    probe = dap42.Probe(args.serial)
+    try:
+        port.reset_input_buffer()
+        probe.capture(dap42.CAPTURE_START)
+        print("Capturing, Ctrl-C to stop")
+        with open(args.output, "wb") as f:
+            try:
+                while True:
+                    f.write(port.read(4096))
+            except KeyboardInterrupt:
+                pass
+            _, lost = probe.capture(dap42.CAPTURE_STOP)
+            # Whatever the probe still holds
+            deadline = time.time() + 0.5
+            while time.time() < deadline:
+                f.write(port.read(4096))
+    except dap42.ProbeError as e:
+        sys.exit(str(e))
+    finally:
+        probe.close()
+        port.close()
+
+    if lost:
+        print("The probe dropped {} records; the serial port did not keep "
+              "up".format(lost))
+
+
+if __name__ == "__main__":
+    main()
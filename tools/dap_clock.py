@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2026, agent
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice
+# appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+# WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+# AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+# CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+# LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+# NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+# CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+"""Report the SWD clock a dap42 generates (CMSIS-DAP vendor command 0x83).
+
+Requires the hidapi Python bindings (pip install hidapi). With --set, the
+probe is first asked for that clock, as a debugger would with
+DAP_SWJ_Clock; the report then shows what the probe actually generates.
+
+With --tune, the probe searches for the fastest clock that the target
+answers without errors (vendor command 0x84) and keeps it. The target
+must already be connected and powered up by a debugger, e.g. OpenOCD
+after init.
+
+    dap_clock.py [--serial SERIAL] [--set HZ]
+    dap_clock.py [--serial SERIAL] --tune [--min HZ] [--iterations N]
+"""
+
+import argparse
+import struct
+import sys
+
+import hid
+
+VID = 0x1209
+PID = 0xDA42
+
+ID_DAP_SWJ_CLOCK = 0x11
+ID_DAP_VENDOR_CLOCK_INFO = 0x83
+ID_DAP_VENDOR_CLOCK_TUNE = 0x84
+DAP_OK = 0x00
+
+CLOCK_SOURCES = {
+    0: "delay loop (nominal)",
+    1: "fast loop (nominal)",
+    2: "timer (exact)",
+}
+
+
+def command(dev, data, timeout=1000):
+    # Report ID 0, then the DAP command
+    dev.write(bytes([0]) + bytes(data))
+    response = bytes(dev.read(64, timeout))
+    if len(response) < 2 or response[0] != data[0]:
+        sys.exit("Probe does not support command 0x{:02X}".format(data[0]))
+    if response[1] != DAP_OK:
+        sys.exit("Probe rejected command 0x{:02X}".format(data[0]))
+    return response
+
+
+def tune(dev, min_clock, iterations):
+    # Slow settings take a while; allow for the whole sweep
+    result = command(dev, struct.pack("<BBI", ID_DAP_VENDOR_CLOCK_TUNE,
+                                      iterations, min_clock), timeout=10000)
+    steps, fast = result[2], result[3]
+    delay, clock = struct.unpack_from("<HI", result, 4)
+    print("Tuned:        {} Hz ({}) after {} settings".format(
+        clock, "fast loop" if fast else "delay {}".format(delay), steps))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--serial", help="serial number of the probe")
+    parser.add_argument("--set", type=int, metavar="HZ",
+                        help="request this SWD clock first")
+    parser.add_argument("--tune", action="store_true",
+                        help="search for the fastest error-free clock")
+    parser.add_argument("--min", type=int, default=0, metavar="HZ",
+                        help="slowest clock to try when tuning")
+    parser.add_argument("--iterations", type=int, default=0, metavar="N",
+                        help="test transfers per setting when tuning")
+    args = parser.parse_args()
+
+    dev = hid.device()
+    dev.open(VID, PID, args.serial)
+
+    if args.set is not None:
+        command(dev, struct.pack("<BI", ID_DAP_SWJ_CLOCK, args.set))
+    if args.tune:
+        tune(dev, args.min, args.iterations)
+
+    info = command(dev, [ID_DAP_VENDOR_CLOCK_INFO])
+    source, spi = info[2], info[3]
+    requested, actual, max_timer = struct.unpack_from("<III", info, 4)
+
+    print("Requested:    {} Hz".format(requested))
+    print("Generated:    {} Hz".format(actual))
+    print("Source:       {}{}".format(
+        CLOCK_SOURCES.get(source, "unknown ({})".format(source)),
+        ", SPI data phases" if spi else ""))
+    if max_timer:
+        print("Timer limit:  {} Hz".format(max_timer))
+
+    dev.close()
+
+
+if __name__ == "__main__":
+    main()
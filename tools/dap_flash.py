@@ -0,0 +1,235 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2026, agent
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice
+# appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+# WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+# AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+# CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+# LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+# NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+# CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+
+"""Program target flash with the dap42's flash engine (vendor command 0x86).
+
+Requires the hidapi and pyelftools Python modules. ALGORITHM is a
+CMSIS-Pack flash algorithm (.FLM); IMAGE is a raw binary written from
+the start of the flash, or from --address. The target core must already
+be halted by a debugger, e.g. OpenOCD after "reset halt". The algorithm,
+its stack and two page buffers go into target RAM at --ram.
+
+--verify checks the programmed image against a CRC-32 computed on the
+probe, or with --verify=target, by the target core.
+
+With --export, nothing is programmed. The algorithm, and the image if
+one is given, are written to FILE instead, ready to be copied onto the
+probe's drag-and-drop drive (see src/DAP/drop.h).
+
+    dap_flash.py [--serial SERIAL] [--ram ADDR] [--ram-size SIZE]
+                 [--address ADDR] [--verify[=probe|target]] ALGORITHM IMAGE
+    dap_flash.py [--ram ADDR] [--ram-size SIZE] [--address ADDR]
+                 --export FILE ALGORITHM [IMAGE]
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+from elftools.elf.elffile import ELFFile
+
+import dap42
+
+# BKPT stub in front of the algorithm; functions return to it
+BREAKPOINT_STUB = struct.pack("<I", 0xE00ABE00)
+STACK_SIZE = 0x400
+
+# struct FlashDevice from FlashOS.h
+DEVICE_ADDRESS = 132
+DEVICE_SIZE = 136
+DEVICE_PAGE_SIZE = 140
+DEVICE_EMPTY = 148
+DEVICE_SECTORS = 160
+SECTORS_END = 0xFFFFFFFF
+
+# Header of an exported algorithm, from src/DAP/drop.h
+EXPORT_MAGIC = b"DAP42FLM"
+EXPORT_REGIONS = 4
+EXPORT_SECTOR = 512
+
+
+class Algorithm:
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            elf = ELFFile(f)
+            code = elf.get_section_by_name("PrgCode")
+            data = elf.get_section_by_name("PrgData")
+            device = elf.get_section_by_name("DevDscr")
+            if code is None or device is None:
+                sys.exit("{} is not a flash algorithm".format(path))
+
+            self.blob = code.data()
+            self.data_offset = len(self.blob)
+            if data is not None:
+                # Zero-initialized data is loaded as zeroes too
+                self.data_offset = data["sh_addr"] - code["sh_addr"]
+                contents = (bytes(data["sh_size"])
+                            if data["sh_type"] == "SHT_NOBITS"
+                            else data.data())
+                self.blob = self.blob.ljust(self.data_offset, b"\0") + contents
+
+            symbols = elf.get_section_by_name(".symtab")
+            self.entries = {}
+            for name in ("Init", "UnInit", "EraseSector", "ProgramPage"):
+                symbol = symbols.get_symbol_by_name(name)
+                if not symbol:
+                    sys.exit("{} has no {} function".format(path, name))
+                self.entries[name] = symbol[0]["st_value"] - code["sh_addr"]
+
+            self._parse_device(device.data())
+
+    def _parse_device(self, device):
+        self.flash_address, = struct.unpack_from("<I", device, DEVICE_ADDRESS)
+        self.flash_size, = struct.unpack_from("<I", device, DEVICE_SIZE)
+        self.page_size, = struct.unpack_from("<I", device, DEVICE_PAGE_SIZE)
+        self.empty = device[DEVICE_EMPTY]
+        self.sectors = []
+        offset = DEVICE_SECTORS
+        while True:
+            size, address = struct.unpack_from("<II", device, offset)
+            if size == SECTORS_END:
+                break
+            self.sectors.append((address, size))
+            offset += 8
+
+    def sectors_in(self, start, end):
+        """Flash addresses of the sectors that overlap [start, end)"""
+        result = []
+        for i, (offset, size) in enumerate(self.sectors):
+            limit = (self.sectors[i + 1][0] if i + 1 < len(self.sectors)
+                     else self.flash_size)
+            address = offset
+            while address < limit:
+                sector = self.flash_address + address
+                if sector < end and sector + size > start:
+                    result.append(sector)
+                address += size
+        return result
+
+
+def export(path, algo, fields, ram, image):
+    """Write the algorithm, then the image from the next sector on"""
+    if len(algo.sectors) > EXPORT_REGIONS:
+        sys.exit("Algorithm has more than {} sector regions"
+                 .format(EXPORT_REGIONS))
+    code = BREAKPOINT_STUB + algo.blob
+    header = EXPORT_MAGIC + struct.pack(
+        "<IIIII", ram, len(code), algo.flash_address, algo.flash_size,
+        algo.empty)
+    header += struct.pack("<10I", *fields)
+    for address, size in algo.sectors:
+        header += struct.pack("<II", size, address)
+    contents = header.ljust(EXPORT_SECTOR, b"\0") + code
+    if image is not None:
+        contents = contents.ljust(-(-len(contents) // EXPORT_SECTOR)
+                                  * EXPORT_SECTOR, b"\0") + image
+    with open(path, "wb") as f:
+        f.write(contents)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--serial", help="serial number of the probe")
+    parser.add_argument("--ram", type=lambda x: int(x, 0),
+                        default=0x20000000, help="target RAM to use")
+    parser.add_argument("--ram-size", type=lambda x: int(x, 0),
+                        default=0x2000, help="bytes of target RAM to use")
+    parser.add_argument("--address", type=lambda x: int(x, 0),
+                        help="flash address of the image")
+    parser.add_argument("--verify", nargs="?", const="probe",
+                        choices=("probe", "target"),
+                        help="check the image by CRC afterwards")
+    parser.add_argument("--export", metavar="FILE",
+                        help="write a file for the drag-and-drop drive")
+    parser.add_argument("algorithm")
+    parser.add_argument("image", nargs="?")
+    args = parser.parse_args()
+    if args.image is None and args.export is None:
+        parser.error("an image is needed unless exporting")
+
+    algo = Algorithm(args.algorithm)
+    image = None
+    if args.image is not None:
+        with open(args.image, "rb") as f:
+            image = f.read()
+
+    address = args.address if args.address is not None else algo.flash_address
+    if (address - algo.flash_address) % algo.page_size:
+        sys.exit("Image must start on a page boundary")
+    if image is not None:
+        image += bytes([algo.empty]) * (-len(image) % algo.page_size)
+
+    load = args.ram + len(BREAKPOINT_STUB)
+    stack = (load + len(algo.blob) + STACK_SIZE + 7) & ~7
+    buffers = (stack, stack + algo.page_size)
+    crc_stub = buffers[1] + algo.page_size
+    if crc_stub + dap42.CRC_STUB_SIZE > args.ram + args.ram_size:
+        sys.exit("Algorithm and page buffers don't fit in {} bytes of RAM"
+                 .format(args.ram_size))
+    fields = (args.ram, load + algo.data_offset, stack,
+              load + algo.entries["Init"],
+              load + algo.entries["UnInit"],
+              load + algo.entries["EraseSector"],
+              load + algo.entries["ProgramPage"],
+              buffers[0], buffers[1], algo.page_size)
+
+    if args.export is not None:
+        if image is not None and address != algo.flash_address:
+            sys.exit("Exported images start at the start of the flash")
+        export(args.export, algo, fields, args.ram, image)
+        print("Wrote {}".format(args.export))
+        return
+
+    probe = dap42.Probe(args.serial)
+    try:
+        probe.flash_load(args.ram, BREAKPOINT_STUB + algo.blob)
+        probe.flash_setup(*fields[:7], buffers, algo.page_size)
+
+        # Function codes for Init/UnInit: 1 erase, 2 program
+        if probe.flash_call(dap42.FLASH_INIT, address, 0, 1) != 0:
+            sys.exit("Init failed")
+        for sector in algo.sectors_in(address, address + len(image)):
+            if probe.flash_call(dap42.FLASH_ERASE_SECTOR, sector) != 0:
+                sys.exit("Erasing 0x{:08X} failed".format(sector))
+        probe.flash_call(dap42.FLASH_UNINIT, 1)
+
+        if probe.flash_call(dap42.FLASH_INIT, address, 0, 2) != 0:
+            sys.exit("Init failed")
+        probe.flash_program(address, image, algo.page_size)
+        probe.flash_call(dap42.FLASH_UNINIT, 2)
+
+        if args.verify == "target":
+            crc = probe.crc32_on_target(address, len(image), crc_stub)
+        elif args.verify:
+            crc = probe.crc32(address, len(image))
+        if args.verify and crc != zlib.crc32(image):
+            sys.exit("Verify failed: CRC 0x{:08X}, expected 0x{:08X}"
+                     .format(crc, zlib.crc32(image)))
+    except dap42.ProbeError as e:
+        sys.exit("{} (is the core halted?)".format(e))
+    finally:
+        probe.close()
+
+    print("Programmed {} bytes at 0x{:08X}{}".format(
+        len(image), address, " and verified" if args.verify else ""))
+
+
+if __name__ == "__main__":
+    main()
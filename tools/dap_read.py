@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2026, agent
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice
+# appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+# WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+# AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+# CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+# LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+# NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+# CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+"""Dump target memory through a dap42 (CMSIS-DAP vendor command 0x85).
+
+Requires the hidapi Python bindings (pip install hidapi). The target must
+already be connected and powered up by a debugger, e.g. OpenOCD after
+init. The probe handles TAR and its 1KB auto-increment limit itself and
+answers the whole read as one chain of responses; the host's SELECT,
+CSW and TAR are left as they were.
+
+    dap_read.py [--serial SERIAL] ADDRESS LENGTH [OUTPUT]
+"""
+
+import argparse
+import sys
+
+import dap42
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--serial", help="serial number of the probe")
+    parser.add_argument("address", type=lambda x: int(x, 0))
+    parser.add_argument("length", type=lambda x: int(x, 0),
+                        help="bytes to read")
+    parser.add_argument("output", nargs="?",
+                        help="file to write (default: hex dump to stdout)")
+    args = parser.parse_args()
+
+    if args.address & 3:
+        sys.exit("Address must be word-aligned")
+
+    probe = dap42.Probe(args.serial)
+    try:
+        data = probe.read_memory(args.address, args.length)
+    except dap42.ProbeError as e:
+        sys.exit(str(e))
+    finally:
+        probe.close()
+
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(data)
+        return
+
+    for offset in range(0, len(data), 16):
+        line = data[offset:offset + 16]
+        print("{:08X}: {}".format(args.address + offset,
+                                   " ".join("{:02X}".format(b) for b in line)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2026, agent
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice
+# appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+# WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+# AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+# CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+# LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+# NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+# CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+"""Dump the dap42 command statistics (CMSIS-DAP vendor command 0x82).
+
+Requires the hidapi Python bindings (pip install hidapi). The probe can
+stay attached to a debugger while this runs; the HID interface accepts
+commands from more than one process.
+
+    dap_stats.py [--serial SERIAL] [--clear]
+"""
+
+import argparse
+import struct
+import sys
+
+import hid
+
+VID = 0x1209
+PID = 0xDA42
+
+ID_DAP_VENDOR_STATS = 0x82
+DAP_OK = 0x00
+
+COMMAND_NAMES = {
+    0x00: "Info",
+    0x01: "HostStatus",
+    0x02: "Connect",
+    0x03: "Disconnect",
+    0x04: "TransferConfigure",
+    0x05: "Transfer",
+    0x06: "TransferBlock",
+    0x07: "TransferAbort",
+    0x08: "WriteABORT",
+    0x09: "Delay",
+    0x0A: "ResetTarget",
+    0x10: "SWJ_Pins",
+    0x11: "SWJ_Clock",
+    0x12: "SWJ_Sequence",
+    0x13: "SWD_Configure",
+    0x14: "JTAG_Sequence",
+    0x15: "JTAG_Configure",
+    0x16: "JTAG_IDCODE",
+    0x17: "SWO_Transport",
+    0x18: "SWO_Mode",
+    0x19: "SWO_Baudrate",
+    0x1A: "SWO_Control",
+    0x1B: "SWO_Status",
+    0x1C: "SWO_Data",
+    0x1D: "SWD_Sequence",
+    0x1E: "SWO_ExtendedStatus",
+    0x1F: "UART_Transport",
+    0x20: "UART_Configure",
+    0x21: "UART_Transfer",
+    0x22: "UART_Control",
+    0x23: "UART_Status",
+    0x80: "Vendor",
+}
+
+
+def stats_page(dev, page, clear=False):
+    # Report ID 0, then the DAP command
+    dev.write(bytes([0, ID_DAP_VENDOR_STATS, page, 1 if clear else 0]))
+    response = bytes(dev.read(64, 1000))
+    if len(response) < 3 or response[0] != ID_DAP_VENDOR_STATS:
+        sys.exit("Probe does not support the statistics command")
+    if response[1] != DAP_OK:
+        sys.exit("Probe rejected statistics page {}".format(page))
+    return response
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--serial", help="serial number of the probe")
+    parser.add_argument("--clear", action="store_true",
+                        help="reset the counters after reading them")
+    args = parser.parse_args()
+
+    dev = hid.device()
+    dev.open(VID, PID, args.serial)
+
+    summary = stats_page(dev, 0)
+    pages = summary[2]
+    clock, waits, faults, in_busy = struct.unpack_from("<IIII", summary, 3)
+    high_water, queue_size = summary[19], summary[20]
+
+    print("WAIT acks:        {}".format(waits))
+    print("FAULT acks:       {}".format(faults))
+    print("IN endpoint busy: {}".format(in_busy))
+    print("Queue high-water: {}/{}".format(high_water, queue_size - 1))
+    print()
+    print("{:<18} {:>10} {:>14} {:>12}".format(
+        "command", "count", "total ms", "avg us"))
+
+    for page in range(1, pages):
+        data = stats_page(dev, page)
+        offset = 3
+        while offset + 9 <= len(data):
+            command, count, cycles = struct.unpack_from("<BII", data, offset)
+            offset += 9
+            if count == 0:
+                continue
+            name = COMMAND_NAMES.get(command, "0x{:02X}".format(command))
+            seconds = cycles / clock
+            print("{:<18} {:>10} {:>14.3f} {:>12.1f}".format(
+                name, count, seconds * 1e3, seconds * 1e6 / count))
+
+    if args.clear:
+        stats_page(dev, 0, clear=True)
+
+    dev.close()
+
+
+if __name__ == "__main__":
+    main()